@@ -3,21 +3,31 @@
 AnimatedModel::AnimatedModel(AnimatedModelData modelData, ID3D11ShaderResourceView * textureRV, ID3D11Device * d3dDevice)
 	: _textureRV(textureRV)
 {
-	_geometry = Mesh(modelData.meshData, d3dDevice);
+	//models with morph targets rewrite their vertex buffer whenever the weights change
+	bool morphed = !modelData.morphTargets.empty();
+	if (d3dDevice)
+	{
+		_geometry = Mesh(modelData.meshData, d3dDevice, morphed);
+	}
+
+	if (morphed)
+	{
+		_morphTargets = MorphTargets::Blender(modelData.meshData.Vertices, std::move(modelData.morphTargets));
+		_morphWeights.assign(_morphTargets.GetTargetCount(), 0.0f);
+	}
 
-	_rootJoint = CreateJoints(modelData.joints.rootJoint);
+	_skeleton = Skeleton(modelData.joints);
+	_animator = Animator(_skeleton);
 
-	_jointCount = modelData.joints.jointCount;
+	_poseTranslations.resize(_skeleton.GetJointCount());
+	_poseRotations.resize(_skeleton.GetJointCount());
+	_modelTransforms.resize(_skeleton.GetJointCount());
 
 	_material.ambient = XMFLOAT4(0.1f, 0.1f, 0.1f, 1.0f);
 	_material.diffuse = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
 	_material.specular = XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
 	_material.specularPower = 0.0f;
 
-	XMFLOAT4X4 identity;
-	XMStoreFloat4x4(&identity, XMMatrixIdentity());
-	_rootJoint->CalculateInverseBindTransform(identity);
-
 	_transform._rotation = Quaternion(-XM_PIDIV2 - 0.5f, XM_PI, 0.0f);
 
 	_animationPlayRate = 0.8f;
@@ -25,139 +35,70 @@ AnimatedModel::AnimatedModel(AnimatedModelData modelData, ID3D11ShaderResourceVi
 
 AnimatedModel::~AnimatedModel()
 {
-	if (_rootJoint) delete _rootJoint;
 }
 
-void AnimatedModel::DoAnimation(Animation* animation)
+void AnimatedModel::DoAnimation(Animation* animation, float fadeSeconds)
 {
-	_animationTime = 0;
+	_animator.Play(0, Motion(animation), fadeSeconds);
+}
 
-	_currentAnimation = animation;
+void AnimatedModel::DoAnimation(AnimationStream * stream, float fadeSeconds)
+{
+	_animator.Play(0, Motion(stream), fadeSeconds);
 }
 
 void AnimatedModel::Update(float deltaTime)
 {
 	_transform.UpdateWorldMatrix();
 
-	if (!_currentAnimation)
+	if (!IsAnimating())
 	{
 		return;
 	}
 
-	IncreaseAnimationTime(deltaTime);
-
-	std::map<std::string, XMFLOAT4X4> currentPos = CalculateCurrentAnimationPose();
-	XMFLOAT4X4 identity;
-	XMStoreFloat4x4(&identity, XMMatrixIdentity());
-	ApplyPoseToJoints(currentPos, _rootJoint, identity);
-}
+	_animator.Update(deltaTime * _animationPlayRate, _poseTranslations.data(), _poseRotations.data());
 
-void AnimatedModel::GetJointTransforms(XMMATRIX* jointMatrices)
-{
-	AddJointsToArray(_rootJoint, jointMatrices);
+	_skeleton.ComputeModelTransforms(_poseTranslations.data(), _poseRotations.data(), _modelTransforms.data());
 }
 
-void AnimatedModel::Draw(ID3D11DeviceContext * pImmediateContext)
+void AnimatedModel::GetJointTransforms(XMFLOAT4X4* jointMatrices)
 {
-	pImmediateContext->IASetVertexBuffers(0, 1, &_geometry._vertexBuffer, &_geometry._vertexBufferStride, &_geometry._vertexBufferOffset);
-	pImmediateContext->IASetIndexBuffer(_geometry._indexBuffer, DXGI_FORMAT_R16_UINT, 0);
-
-	pImmediateContext->DrawIndexed(_geometry._numberOfIndices, 0, 0);
+	_skeleton.ComputePalette(IsAnimating() ? _modelTransforms.data() : nullptr, XMMatrixTranspose(_transform.GetWorldMatrix()), jointMatrices);
 }
 
-void AnimatedModel::IncreaseAnimationTime(float deltaTime)
+void AnimatedModel::SetMorphWeight(const std::string & name, float weight)
 {
-	_animationTime += deltaTime * _animationPlayRate;
-
-	if (_animationTime > _currentAnimation->GetLength())
+	int target = _morphTargets.FindTarget(name);
+	if (target >= 0)
 	{
-		_animationTime = 0.0f;
+		_morphWeights[target] = weight;
 	}
 }
 
-std::map<std::string, XMFLOAT4X4> AnimatedModel::CalculateCurrentAnimationPose()
-{
-	KeyFrame previousFrame, nextFrame;
-
-	GetPreviousAndNextFrames(previousFrame, nextFrame);
-
-	float progression = CalculateProgression(previousFrame, nextFrame);
-
-	return InterpolatePoses(previousFrame, nextFrame, progression);
-}
-
-void AnimatedModel::ApplyPoseToJoints(std::map<std::string, XMFLOAT4X4> currentPose, Joint* joint, XMFLOAT4X4 parentTransform)
-{
-	XMFLOAT4X4 currentLocalTransform = currentPose.at(joint->_name);
-	XMMATRIX currentTransform = XMMatrixMultiply(XMLoadFloat4x4(&parentTransform), XMLoadFloat4x4(&currentLocalTransform));
-
-	XMFLOAT4X4 currentTransformAsFloats;
-
-	for (Joint* childJoint : joint->_children)
-	{
-		XMStoreFloat4x4(&currentTransformAsFloats, currentTransform);
-		ApplyPoseToJoints(currentPose, childJoint, currentTransformAsFloats);
-	}
-
-	currentTransform = XMMatrixMultiply(currentTransform, XMLoadFloat4x4(&joint->GetInverseBindTransform()));
-
-	XMStoreFloat4x4(&currentTransformAsFloats, currentTransform);
-
-	joint->SetAnimationTransform(currentTransformAsFloats);
-}
-
-void AnimatedModel::GetPreviousAndNextFrames(KeyFrame & previousFrame, KeyFrame & nextFrame)
+void AnimatedModel::Draw(ID3D11DeviceContext * pImmediateContext)
 {
-	previousFrame = _currentAnimation->GetKeyFrames()[0];
-	nextFrame = previousFrame;
-	for (int i = 1; i < _currentAnimation->GetKeyFrames().size(); i++)
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	if (!_morphWeights.empty() && _morphTargets.Apply(_morphWeights.data()) &&
+		SUCCEEDED(pImmediateContext->Map(_geometry._vertexBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
 	{
-		nextFrame = _currentAnimation->GetKeyFrames()[i];
-		if (nextFrame.GetTimeStamp() > _animationTime)
-		{
-			break;
-		}
-		previousFrame = _currentAnimation->GetKeyFrames()[i];
+		//a discarded buffer comes back undefined, so all of it is written even though only the morphed vertices moved
+		const std::vector<SkeletalVertex>& vertices = _morphTargets.GetVertices();
+		memcpy(mapped.pData, vertices.data(), vertices.size() * sizeof(SkeletalVertex));
+		pImmediateContext->Unmap(_geometry._vertexBuffer, 0);
 	}
-}
 
-float AnimatedModel::CalculateProgression(KeyFrame previousFrame, KeyFrame nextFrame)
-{
-	float totalTime = nextFrame.GetTimeStamp() - previousFrame.GetTimeStamp();
-	float currentTime = _animationTime - previousFrame.GetTimeStamp();
-
-	return currentTime / totalTime;
-}
+	pImmediateContext->IASetVertexBuffers(0, 1, &_geometry._vertexBuffer, &_geometry._vertexBufferStride, &_geometry._vertexBufferOffset);
+	pImmediateContext->IASetIndexBuffer(_geometry._indexBuffer, _geometry._indexFormat, 0);
 
-std::map<std::string, XMFLOAT4X4> AnimatedModel::InterpolatePoses(KeyFrame previousFrame, KeyFrame nextFrame, float progression)
-{
-	std::map<std::string, XMFLOAT4X4> currentPose;
-	for (auto jointName : previousFrame.GetJointKeyFrames())
+	if (_geometry._submeshes.empty())
 	{
-		JointTransform previousTransform = previousFrame.GetJointKeyFrames().at(jointName.first);
-		JointTransform nextTransform = nextFrame.GetJointKeyFrames().at(jointName.first);
-		JointTransform currentTransform = JointTransform::interpolate(previousTransform, nextTransform, progression);
-		currentPose[jointName.first] = currentTransform.GetLocalTransform();
-	}
-	return currentPose;
-}
-
-void AnimatedModel::AddJointsToArray(Joint * rootJoint, XMMATRIX * jointMatrices)
-{
-	jointMatrices[rootJoint->_index] = XMMatrixTranspose(_transform.GetWorldMatrix()) * (_currentAnimation ? XMLoadFloat4x4(&rootJoint->GetAnimatedTransform()) : XMMatrixIdentity());
-	for (Joint* childJoint : rootJoint->_children)
-	{
-		AddJointsToArray(childJoint, jointMatrices);
+		pImmediateContext->DrawIndexed(_geometry._numberOfIndices, 0, 0);
+		return;
 	}
-}
-
-Joint * AnimatedModel::CreateJoints(JointData data)
-{
-	Joint* joint = new Joint(data.index, data.nameID, data.bindLocalTransform, data.inverseBindTransform);
 
-	for (JointData* child : data.children)
+	//the buffers are bound once and every material's range drawn from them
+	for (const Submesh& submesh : _geometry._submeshes)
 	{
-		joint->AddChild(CreateJoints(*child));
+		pImmediateContext->DrawIndexed(submesh.IndexCount, submesh.StartIndex, 0);
 	}
-	return joint;
 }
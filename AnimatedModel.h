@@ -1,11 +1,14 @@
 #pragma once
 
 #include "Mesh.h"
-#include "Joint.h"
 #include "Animation.h"
+#include "AnimationStream.h"
+#include "Animator.h"
+#include "Skeleton.h"
+#include "MorphTargets.h"
 
-#include<map>
 #include<string>
+#include<vector>
 
 #include "GameObject.h"//just for material
 
@@ -18,25 +21,50 @@ private:
 
 	Material _material;
 
-	Joint* _rootJoint = nullptr;
-	int _jointCount;
+	Skeleton _skeleton;
 
-	Animation* _currentAnimation = nullptr;
-	float _animationTime = 0;
+	//blends whatever the model is playing into the local pose of every joint in skeleton order, and the model
+	//transforms last worked out from it
+	Animator _animator;
+	std::vector<Vector3D> _poseTranslations;
+	std::vector<Quaternion> _poseRotations;
+	std::vector<XMFLOAT4X4> _modelTransforms;
 
 	float _animationPlayRate;
 
 	Transform _transform;
 
+	//Blended on the CPU and uploaded before the next draw whenever a weight changes
+	MorphTargets::Blender _morphTargets;
+	std::vector<float> _morphWeights;
+
 public:
+	//Without a device the model has no buffers, so it can be animated but not drawn
 	AnimatedModel(AnimatedModelData modelData, ID3D11ShaderResourceView* textureRV, ID3D11Device * d3dDevice);
 	~AnimatedModel();
 
-	void DoAnimation(Animation* animation);
+	//Plays the clip on the animator's first layer, crossfading from what was playing over fadeSeconds. A null clip stops
+	//the layer, so a model whose file had no clips stays in its bind pose
+	void DoAnimation(Animation* animation, float fadeSeconds = 0.0f);
+
+	//Plays a clip streamed from its cooked file, which has to outlive the model or the next DoAnimation
+	void DoAnimation(AnimationStream* stream, float fadeSeconds = 0.0f);
 
 	void Update(float deltaTime);
 
-	void GetJointTransforms(XMMATRIX* jointMatrices);
+	//Fills the skinning palette, which needs a slot for every one of the skeleton's skin indices
+	void GetJointTransforms(XMFLOAT4X4* jointMatrices);
+
+	const Skeleton& GetSkeleton() const { return _skeleton; }
+
+	//For layers and blend spaces beyond the single clip DoAnimation plays
+	Animator& GetAnimator() { return _animator; }
+
+	size_t GetMorphTargetCount() const { return _morphTargets.GetTargetCount(); }
+
+	//Names that aren't one of the model's morph targets are ignored
+	void SetMorphWeight(const std::string& name, float weight);
+	void SetMorphWeight(size_t target, float weight) { _morphWeights[target] = weight; }
 
 	void Draw(ID3D11DeviceContext* pImmediateContext);
 
@@ -47,19 +75,5 @@ public:
 	Transform* GetTransform() { return &_transform; }
 private:
 
-	void IncreaseAnimationTime(float deltaTime);
-
-	std::map<std::string, XMFLOAT4X4> CalculateCurrentAnimationPose();
-
-	void ApplyPoseToJoints(std::map<std::string, XMFLOAT4X4> currentPose, Joint* joint, XMFLOAT4X4 parentTransform);
-
-	void GetPreviousAndNextFrames(KeyFrame &previousFrame, KeyFrame &nextFrame);
-
-	float CalculateProgression(KeyFrame previousFrame, KeyFrame nextFrame);
-
-	std::map<std::string, XMFLOAT4X4> InterpolatePoses(KeyFrame previousFrame, KeyFrame NextFrame, float progression);
-
-	void AddJointsToArray(Joint* rootJoint, XMMATRIX* jointMatrices);
-
-	Joint* CreateJoints(JointData data);
+	bool IsAnimating() const { return _animator.IsPlaying(); }
 };
\ No newline at end of file
@@ -0,0 +1,106 @@
+#include "AnimatedModelData.h"
+#include <algorithm>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+
+namespace
+{
+	//SSE2 has no 32 bit integer max or min, so they're built from a compare
+	inline void MaxMin(__m128i a, __m128i b, __m128i& max, __m128i& min)
+	{
+		__m128i greater = _mm_cmpgt_epi32(a, b);
+		max = _mm_or_si128(_mm_and_si128(greater, a), _mm_andnot_si128(greater, b));
+		min = _mm_or_si128(_mm_and_si128(greater, b), _mm_andnot_si128(greater, a));
+	}
+
+	//one step of the sorting network, lanes set in keepMax take the larger of themselves and their partner
+	inline __m128i CompareExchange(__m128i keys, __m128i partners, __m128i keepMax)
+	{
+		__m128i max, min;
+		MaxMin(keys, partners, max, min);
+		return _mm_or_si128(_mm_and_si128(keepMax, max), _mm_andnot_si128(keepMax, min));
+	}
+}
+#endif
+
+void VertexSkinData::LimitJointNumber(int max)
+{
+	if (max > c_MaxSkinInfluences)
+		max = c_MaxSkinInfluences;
+
+	unsigned short sortedJointIds[c_MaxSkinInfluences];
+	float sortedWeights[c_MaxSkinInfluences];
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+	//weights are never negative so their bits order the same way as integers. The bottom two bits are swapped for the
+	//slot the weight came from, which makes every key unique and says where to fetch the joint from once sorted. They
+	//count down so that of two equal weights the one added first stays ahead
+	__m128i keys = _mm_or_si128(_mm_and_si128(_mm_castps_si128(_mm_loadu_ps(weights)), _mm_set1_epi32(~3)), _mm_setr_epi32(3, 2, 1, 0));
+
+	//the three steps of a four element sorting network, largest first
+	keys = CompareExchange(keys, _mm_shuffle_epi32(keys, _MM_SHUFFLE(2, 3, 0, 1)), _mm_setr_epi32(-1, 0, -1, 0));
+	keys = CompareExchange(keys, _mm_shuffle_epi32(keys, _MM_SHUFFLE(1, 0, 3, 2)), _mm_setr_epi32(-1, -1, 0, 0));
+	keys = CompareExchange(keys, _mm_shuffle_epi32(keys, _MM_SHUFFLE(3, 1, 2, 0)), _mm_setr_epi32(-1, -1, 0, 0));
+
+	int sortedKeys[c_MaxSkinInfluences];
+	_mm_storeu_si128((__m128i*)sortedKeys, keys);
+
+	for (int i = 0; i < c_MaxSkinInfluences; i++)
+	{
+		int slot = 3 - (sortedKeys[i] & 3);
+		sortedJointIds[i] = jointIds[slot];
+		sortedWeights[i] = weights[slot];
+	}
+
+	//everything past max is masked off before the weights are summed and scaled
+	__m128i lanes = _mm_setr_epi32(0, 1, 2, 3);
+	__m128 kept = _mm_and_ps(_mm_castsi128_ps(_mm_cmplt_epi32(lanes, _mm_set1_epi32(max))), _mm_loadu_ps(sortedWeights));
+
+	__m128 total = _mm_add_ps(kept, _mm_shuffle_ps(kept, kept, _MM_SHUFFLE(2, 3, 0, 1)));
+	total = _mm_add_ps(total, _mm_shuffle_ps(total, total, _MM_SHUFFLE(1, 0, 3, 2)));
+
+	if (_mm_cvtss_f32(total) > 0.0f)
+	{
+		kept = _mm_min_ps(_mm_div_ps(kept, total), _mm_set1_ps(1.0f));
+	}
+
+	_mm_storeu_ps(weights, kept);
+#else
+	for (int i = 0; i < c_MaxSkinInfluences; i++)
+	{
+		sortedJointIds[i] = jointIds[i];
+		sortedWeights[i] = weights[i];
+	}
+
+	for (int i = 1; i < c_MaxSkinInfluences; i++)
+	{
+		for (int j = i; j > 0 && sortedWeights[j] > sortedWeights[j - 1]; j--)
+		{
+			std::swap(sortedWeights[j], sortedWeights[j - 1]);
+			std::swap(sortedJointIds[j], sortedJointIds[j - 1]);
+		}
+	}
+
+	float total = 0.0f;
+	for (int i = 0; i < max; i++)
+	{
+		total += sortedWeights[i];
+	}
+
+	for (int i = 0; i < c_MaxSkinInfluences; i++)
+	{
+		weights[i] = i < max ? sortedWeights[i] : 0.0f;
+
+		if (total > 0.0f)
+			weights[i] = std::min(weights[i] / total, 1.0f);
+	}
+#endif
+
+	for (int i = 0; i < c_MaxSkinInfluences; i++)
+	{
+		jointIds[i] = i < max ? sortedJointIds[i] : 0;
+	}
+
+	count = max;
+}
@@ -61,92 +61,59 @@ struct SkeletalMeshData
 		:vertices(vertices), textureCoords(textureCoords), normals(normals), indices(indices), jointIDs(jointIDs), vertexWeights(vertexWeights) {}
 };
 
+//Most joints a vertex is skinned to, the vertex format has room for four
+const int c_MaxSkinInfluences = 4;
+
+//Influences are kept in fixed arrays rather than vectors, every vertex of the skin has one of these and the loader
+//copies them around freely
 struct VertexSkinData
 {
-	std::vector<int> jointIds;
-	std::vector<float> weights;
-
-	void SetNumberOfEffects(int numberOfEffects)
-	{
-		jointIds.resize(numberOfEffects);
-		weights.resize(numberOfEffects);
-	}
+	unsigned short jointIds[c_MaxSkinInfluences] = {};
+	float weights[c_MaxSkinInfluences] = {};
+	int count = 0;
 
+	//Keeps the largest influences seen so far, one that is smaller than all of them is dropped once the arrays are full
 	void AddJointEffect(int jointId, float weight)
 	{
-		for (int i = 0; i < weights.size(); i++)
-		{
-			if (weight > weights[i])
-			{
-				jointIds.emplace(jointIds.begin() + i, jointId);
-				jointIds.pop_back();
-				weights.emplace(weights.begin() + i, weight);
-				weights.pop_back();
-				break;
-			}
-		}
-	}
-
-	void LimitJointNumber(int max)
-	{
-		if (max > 4)
-			max = 4;
-
-		jointIds.resize(max);
-		weights.resize(max);
-
-		float total = 0.0f;
-		for (float weight : weights)
+		int slot = count;
+		if (count < c_MaxSkinInfluences)
 		{
-			total += weight;
+			count++;
 		}
-
-		if (total != 1.0f)
+		else
 		{
-			for (int i = 0; i < max; i++)
+			slot = 0;
+			for (int i = 1; i < c_MaxSkinInfluences; i++)
 			{
-				weights[i] = (((weights[i] / total) < (1)) ? (weights[i] / total) : (1));
+				if (weights[i] < weights[slot])
+					slot = i;
 			}
+
+			if (weight <= weights[slot])
+				return;
 		}
+
+		jointIds[slot] = (unsigned short)jointId;
+		weights[slot] = weight;
 	}
 
-	XMFLOAT4 GetWeights()
+	//Sorts the influences from largest to smallest, drops all but the first max and scales the rest to add up to one
+	void LimitJointNumber(int max);
+
+	XMFLOAT4 GetWeights() const
 	{
-		XMFLOAT4 returnWeights = { 0.0f,0.0f,0.0f,0.0f };
+		XMFLOAT4 returnWeights = { weights[0], weights[1], weights[2], weights[3] };
 
-		for (int i = 0; i < weights.size(); i++)
-		{
-			if (i == 0)
-				returnWeights.x = weights[i];
-			if (i == 1)
-				returnWeights.y = weights[i];
-			if (i == 2)
-				returnWeights.z = weights[i];
-			if (i == 3)
-				//returnWeights.w = weights[i];
-				returnWeights.w = 1.0f - weights[0] - weights[1] - weights[2];
-		}
+		//the last weight takes up whatever rounding left over so the four always add up to exactly one
+		if (count == c_MaxSkinInfluences)
+			returnWeights.w = 1.0f - weights[0] - weights[1] - weights[2];
 
 		return returnWeights;
 	}
 
-	XMUINT4 GetBoneIndices()
+	XMUINT4 GetBoneIndices() const
 	{
-		XMUINT4 returnIndices = { 0,0,0,0 };
-
-		for (int i = 0; i < jointIds.size(); i++)
-		{
-			if (i == 0)
-				returnIndices.x = jointIds[i];
-			if (i == 1)
-				returnIndices.y = jointIds[i];
-			if (i == 2)
-				returnIndices.z = jointIds[i];
-			if (i == 3)
-				returnIndices.w = jointIds[i];
-		}
-
-		return returnIndices;
+		return XMUINT4(jointIds[0], jointIds[1], jointIds[2], jointIds[3]);
 	}
 };
 
@@ -156,8 +123,10 @@ struct SkinningData
 	std::vector<VertexSkinData> verticesSkinData;
 	std::vector<XMFLOAT4X4> bindMatrices;
 
+	SkinningData() = default;
+
 	SkinningData(std::vector<std::string> jointOrder, std::vector<VertexSkinData> verticesSkinData, std::vector<XMFLOAT4X4> bindMatrices)
-		:jointOrder(jointOrder), verticesSkinData(verticesSkinData), bindMatrices(bindMatrices){}
+		:jointOrder(std::move(jointOrder)), verticesSkinData(std::move(verticesSkinData)), bindMatrices(std::move(bindMatrices)){}
 };
 
 struct VertexData
@@ -165,11 +134,9 @@ struct VertexData
 	Vector3D position;
 	int textureIndex = -1;
 	int normalIndex = -1;
-	VertexData *duplicateVertex = nullptr;
+	int duplicateIndex = -1; //where the copy with a different texture or normal sits in the vertex list, -1 for none
 	int index;
 	float length;
-	std::vector<Vector3D> tangents;
-	Vector3D averagedTangent;
 
 	VertexSkinData weightsData;
 
@@ -190,29 +157,31 @@ struct VertexData
 	{
 		return textureIndexOther == textureIndex && normalIndexOther == normalIndex;
 	}
+};
 
-	VertexData* GetDuplicateVertex()
-	{
-		return duplicateVertex;
-	}
+//How far a morph target moves one vertex's position and normal. Each is padded to four floats with a zero so it can be
+//added to the vertex in a single SSE register
+struct MorphDelta
+{
+	XMFLOAT4 position;
+	XMFLOAT4 normal;
+};
 
-	void AverageTangents()
-	{
-		if (tangents.size() == 0)
-		{
-			return;
-		}
-		for (Vector3D tangent : tangents)
-		{
-			//TODO generate or load tangents
-		}
-	}
+//A blend shape kept as the deltas of just the vertices it moves, in ascending vertex order so applying it walks
+//forward through the vertex buffer
+struct MorphTargetData
+{
+	std::string name;
+	std::vector<UINT> vertices;
+	std::vector<MorphDelta> deltas; //one for each of the vertices
 };
 
 struct AnimatedModelData
 {
 	SkeletonData joints;
 	IndexedSkeletalModel meshData;
+	std::vector<std::string> materials; //names the submeshes' material ids refer to, "" for primitives without one
+	std::vector<MorphTargetData> morphTargets; //relative to meshData's vertices, empty for models without any
 
 	AnimatedModelData(SkeletonData joints, IndexedSkeletalModel meshData)
 		:joints(joints), meshData(meshData) {}
@@ -234,7 +203,7 @@ struct AnimatedModelData
 			verts[i].Tangent = meshData.Vertices[i].Tangent;
 		}
 
-		unsigned short* indicesArray = new unsigned short[meshData.Indices.size()];
+		UINT* indicesArray = new UINT[meshData.Indices.size()];
 		for (int i = 0; i < meshData.Indices.size(); i++)
 		{
 			indicesArray[i] = meshData.Indices[i];
@@ -1,36 +1,165 @@
 #include "Animation.h"
+#include "JointTransform.h"
+#include "Skeleton.h"
 
-Animation::Animation(AnimationData animationData)
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+namespace
+{
+	//keyframes within this fraction of an interval of where an even rate puts them still count as evenly spaced
+	const float c_SampleRateTolerance = 1e-3f;
+
+	float FindSampleRate(const std::vector<float>& times)
+	{
+		if (times.size() < 2 || times.back() <= times.front())
+		{
+			return 0.0f;
+		}
+
+		double interval = ((double)times.back() - times.front()) / (times.size() - 1);
+		for (size_t i = 1; i < times.size(); i++)
+		{
+			if (std::fabs(times[i] - (times.front() + i * interval)) > interval * c_SampleRateTolerance)
+			{
+				return 0.0f;
+			}
+		}
+
+		return (float)(1.0 / interval);
+	}
+}
+
+Animation::Animation(float lengthInSeconds, std::vector<float> times, UINT jointCount)
+	:_length(lengthInSeconds), _times(std::move(times)), _tracks(jointCount, -1)
+{
+	_sampleRate = FindSampleRate(_times);
+}
+
+Animation::Animation(const AnimationData& animationData, const SkeletonData& skeleton)
+	:_length(animationData.lengthSeconds)
 {
-	_length = animationData.lengthSeconds;
+	std::vector<const JointData*> joints;
+	Skeleton::Flatten(skeleton.rootJoint, joints);
 
-	
-	_keyFrames.resize(animationData.keyframes.size());
+	_tracks.assign(joints.size(), -1);
 
-	for (int i = 0; i < _keyFrames.size(); i++)
+	_times.reserve(animationData.keyframes.size());
+	for (const KeyFrameData& keyframe : animationData.keyframes)
 	{
-		_keyFrames[i] = CreateKeyFrame(animationData.keyframes[i]);
+		_times.push_back(keyframe.time);
+	}
+	_sampleRate = FindSampleRate(_times);
+
+	std::unordered_map<std::string, UINT> jointIndices;
+	for (UINT i = 0; i < joints.size(); i++)
+	{
+		jointIndices.emplace(joints[i]->nameID, i);
+	}
+
+	std::vector<bool> animated(joints.size(), false);
+	for (const KeyFrameData& keyframe : animationData.keyframes)
+	{
+		for (const auto& jointTransform : keyframe.jointTransforms)
+		{
+			auto it = jointIndices.find(jointTransform.first);
+			if (it != jointIndices.end())
+			{
+				animated[it->second] = true;
+			}
+		}
+	}
+
+	std::vector<XMFLOAT4X4> localTransforms(_times.size());
+	for (UINT joint = 0; joint < joints.size(); joint++)
+	{
+		if (!animated[joint])
+		{
+			continue;
+		}
+
+		for (size_t keyframe = 0; keyframe < _times.size(); keyframe++)
+		{
+			const std::map<std::string, XMFLOAT4X4>& transforms = animationData.keyframes[keyframe].jointTransforms;
+			auto it = transforms.find(joints[joint]->nameID);
+			localTransforms[keyframe] = it != transforms.end() ? it->second : joints[joint]->bindLocalTransform;
+		}
+
+		SetTrack(joint, localTransforms.data());
 	}
 }
 
-KeyFrame Animation::CreateKeyFrame(KeyFrameData data)
+void Animation::SetTrack(UINT joint, const XMFLOAT4X4* localTransforms)
 {
-	std::map<std::string, JointTransform> map = std::map<std::string, JointTransform>();
+	if (_tracks[joint] < 0)
+	{
+		_tracks[joint] = (int)(_translations.size() / (_times.empty() ? 1 : _times.size()));
+		_translations.resize(_translations.size() + _times.size());
+		_rotations.resize(_rotations.size() + _times.size());
+	}
+
+	Vector3D* translations = &_translations[(size_t)_tracks[joint] * _times.size()];
+	Quaternion* rotations = &_rotations[(size_t)_tracks[joint] * _times.size()];
+
+	for (size_t keyframe = 0; keyframe < _times.size(); keyframe++)
+	{
+		JointTransform transform = JointTransform::Decompose(localTransforms[keyframe]);
+		translations[keyframe] = transform._position;
+		rotations[keyframe] = transform._rotation;
+	}
+}
+
+UINT Animation::FindKeyFrame(float time, UINT & cursor) const
+{
+	UINT last = (UINT)_times.size() - 1;
+	UINT keyframe = std::min(cursor, last);
+
+	if (_sampleRate > 0.0f)
+	{
+		float index = (time - _times[0]) * _sampleRate;
+		keyframe = index <= 0.0f ? 0 : std::min((UINT)index, last);
+	}
 
-	for (auto jointData : data.jointTransforms)
+	//rounding can leave the computed keyframe one out, and playback usually moves the cursor on one or two
+	for (int step = 0; step < 2 && keyframe < last && _times[keyframe + 1] <= time; step++)
 	{
-		Vector3D translation = Vector3D(jointData.second._14, jointData.second._24, jointData.second._34);
+		keyframe++;
+	}
 
-		//Vector3D translation = Vector3D();
+	if ((keyframe > 0 && _times[keyframe] > time) || (keyframe < last && _times[keyframe + 1] <= time))
+	{
+		UINT after = (UINT)(std::upper_bound(_times.begin(), _times.end(), time) - _times.begin());
+		keyframe = after > 0 ? after - 1 : 0;
+	}
 
-		Quaternion rotation = Quaternion(jointData.second);
+	cursor = keyframe;
+	return keyframe;
+}
 
-		//Quaternion rotation = Quaternion();
+void Animation::Sample(float time, UINT& cursor, Vector3D* translations, Quaternion* rotations) const
+{
+	if (_times.empty())
+	{
+		return;
+	}
+
+	//the keyframe at or before the time and the one after it, or the last twice past the end
+	size_t previous = FindKeyFrame(time, cursor);
+	size_t next = previous + 1 < _times.size() ? previous + 1 : previous;
 
-		JointTransform jointTransform  = JointTransform(translation, rotation);
+	float span = _times[next] - _times[previous];
+	float progression = span > 0.0f ? std::min(std::max((time - _times[previous]) / span, 0.0f), 1.0f) : 0.0f;
+
+	for (size_t joint = 0; joint < _tracks.size(); joint++)
+	{
+		if (_tracks[joint] < 0)
+		{
+			continue;
+		}
 
-		map.insert(std::pair<std::string, JointTransform>(jointData.first, jointTransform));
+		size_t first = (size_t)_tracks[joint] * _times.size();
+		JointTransform::Interpolate(_translations[first + previous], _rotations[first + previous],
+			_translations[first + next], _rotations[first + next], progression, translations[joint], rotations[joint]);
 	}
-	
-	return KeyFrame(data.time, map);
 }
@@ -1,25 +1,63 @@
 #pragma once
 
 #include <vector>
-#include "KeyFrame.h"
 #include "AnimatedModelData.h"
+#include "Quaternion.h"
+#include "Vector.h"
 
+//A clip stored as a track per animated joint, each a translation and a rotation at every one of the clip's keyframe
+//times. Joints are indexed in Skeleton's depth first order, the same order as the cooked joints, so sampling never
+//has to look a joint up by name
 class Animation
 {
 private:
 	float _length;
-	std::vector<KeyFrame> _keyFrames;
-	
+	std::vector<float> _times; //shared by every track
+	float _sampleRate; //keyframes a second when they are evenly spaced, zero when they aren't
+	std::vector<int> _tracks; //per joint, which track animates it or -1
+	std::vector<Vector3D> _translations; //each track's keyframes one after another
+	std::vector<Quaternion> _rotations;
 
 public:
-	Animation(float lengthInSeconds, std::vector<KeyFrame> frames)
-		:_keyFrames(frames), _length(lengthInSeconds) {}
+	Animation()
+		:_length(0.0f), _sampleRate(0.0f) {}
 
-	Animation(AnimationData animationData);
+	//Tracks are added with SetTrack
+	Animation(float lengthInSeconds, std::vector<float> times, UINT jointCount);
+
+	//Joints missing from some of the keyframes hold their bind pose there, joints not in the skeleton are dropped
+	Animation(const AnimationData& animationData, const SkeletonData& skeleton);
+
+	//Decomposes a local transform for each keyframe into the joint's track
+	void SetTrack(UINT joint, const XMFLOAT4X4* localTransforms);
 
 	float GetLength() const { return _length; }
 
-	std::vector<KeyFrame> GetKeyFrames() { return _keyFrames; }
+	UINT GetJointCount() const { return (UINT)_tracks.size(); }
+	UINT GetKeyFrameCount() const { return (UINT)_times.size(); }
+
+	const std::vector<float>& GetTimes() const { return _times; }
+
+	float GetSampleRate() const { return _sampleRate; }
+
+	bool HasTrack(UINT joint) const { return _tracks[joint] >= 0; }
+
+	//Both have a value for each keyframe, the joint must have a track
+	const Vector3D* GetTranslations(UINT joint) const { return &_translations[(size_t)_tracks[joint] * _times.size()]; }
+	const Quaternion* GetRotations(UINT joint) const { return &_rotations[(size_t)_tracks[joint] * _times.size()]; }
+
+	//The last keyframe at or before time, or the first if time is before it. The cursor is the keyframe the last
+	//lookup found: playback only moves it on a keyframe or so, which is checked first, and a seek or a loop falls back
+	//to a binary search. Evenly spaced clips compute the keyframe from the time instead
+	UINT FindKeyFrame(float time, UINT& cursor) const;
+
+	//Writes the joints' interpolated local translation and rotation at time, one slot per joint. Joints without a
+	//track are left as they were
+	void Sample(float time, UINT& cursor, Vector3D* translations, Quaternion* rotations) const;
 
-	KeyFrame CreateKeyFrame(KeyFrameData data);
-};
\ No newline at end of file
+	void Sample(float time, Vector3D* translations, Quaternion* rotations) const
+	{
+		UINT cursor = 0;
+		Sample(time, cursor, translations, rotations);
+	}
+};
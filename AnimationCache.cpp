@@ -0,0 +1,477 @@
+#include "AnimationCache.h"
+#include "Animation.h"
+#include "JointTransform.h"
+#include "Skeleton.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+namespace
+{
+	//depth first so every parent is written before its children
+	void FlattenJoints(const JointData& joint, int parent, std::vector<AnimationCache::CookedJoint>& joints, std::vector<char>& names)
+	{
+		AnimationCache::CookedJoint cookedJoint;
+		cookedJoint.Parent = parent;
+		cookedJoint.SkinIndex = (UINT)joint.index;
+		cookedJoint.NameOffset = (UINT)names.size();
+		cookedJoint.Reserved = 0;
+		cookedJoint.BindLocalTransform = joint.bindLocalTransform;
+		cookedJoint.InverseBindTransform = joint.inverseBindTransform;
+
+		names.insert(names.end(), joint.nameID.begin(), joint.nameID.end());
+		names.push_back('\0');
+
+		int index = (int)joints.size();
+		joints.push_back(cookedJoint);
+
+		for (const JointData* child : joint.children)
+		{
+			FlattenJoints(*child, index, joints, names);
+		}
+	}
+
+	template<typename ElementType>
+	const ElementType* FindElements(const MeshCache::CookedMesh& cookedMesh, UINT type, UINT& count)
+	{
+		const MeshCache::Section* section = cookedMesh.FindSection(type);
+		if (!section || section->ElementStride != sizeof(ElementType))
+		{
+			return nullptr;
+		}
+
+		count = section->ElementCount;
+		return (const ElementType*)cookedMesh.GetSectionData(*section);
+	}
+}
+
+bool AnimationCache::AddAnimatedModel(MeshCache::Writer & writer, const SkeletonData & skeleton, const std::vector<AnimationData>& clips, float sampleRate)
+{
+	if (sampleRate > 0.0f)
+	{
+		std::vector<AnimationData> resampled;
+		for (const AnimationData& clip : clips)
+		{
+			resampled.push_back(ResampleClip(clip, skeleton, sampleRate));
+		}
+
+		return AddAnimatedModel(writer, skeleton, resampled);
+	}
+
+	std::vector<CookedJoint> joints;
+	std::vector<char> names;
+	FlattenJoints(skeleton.rootJoint, -1, joints, names);
+
+	CookedSkeleton cookedSkeleton;
+	cookedSkeleton.JointCount = (UINT)joints.size();
+	cookedSkeleton.SkinJointCount = (UINT)skeleton.jointCount;
+
+	std::unordered_map<std::string, UINT> jointIndices;
+	for (UINT i = 0; i < joints.size(); i++)
+	{
+		jointIndices.emplace(&names[joints[i].NameOffset], i);
+	}
+
+	std::vector<CookedClip> cookedClips;
+	std::vector<CookedTrack> tracks;
+	std::vector<CookedChunk> chunks;
+	std::vector<char> chunkData;
+
+	for (const AnimationData& clip : clips)
+	{
+		CookedClip cookedClip;
+		cookedClip.LengthSeconds = clip.lengthSeconds;
+		cookedClip.KeyframeCount = (UINT)clip.keyframes.size();
+		cookedClip.FirstTrack = (UINT)tracks.size();
+		cookedClip.FirstChunk = (UINT)chunks.size();
+
+		//a track for every skeleton joint keyed anywhere in the clip, in joint order
+		std::vector<bool> animated(joints.size(), false);
+		for (const KeyFrameData& keyframe : clip.keyframes)
+		{
+			for (const auto& jointTransform : keyframe.jointTransforms)
+			{
+				auto it = jointIndices.find(jointTransform.first);
+				if (it != jointIndices.end())
+				{
+					animated[it->second] = true;
+				}
+			}
+		}
+
+		std::vector<std::string> trackNames;
+		for (UINT joint = 0; joint < joints.size(); joint++)
+		{
+			if (animated[joint])
+			{
+				tracks.push_back({ joint });
+				trackNames.push_back(&names[joints[joint].NameOffset]);
+			}
+		}
+
+		cookedClip.TrackCount = (UINT)tracks.size() - cookedClip.FirstTrack;
+
+		//each chunk takes the keyframes up to c_ChunkSeconds after its first plus the one the next chunk starts on
+		UINT first = 0;
+		while (first < cookedClip.KeyframeCount)
+		{
+			UINT end = first + 1;
+			while (end < cookedClip.KeyframeCount && clip.keyframes[end].time < clip.keyframes[first].time + c_ChunkSeconds)
+			{
+				end++;
+			}
+
+			UINT next = end;
+			if (end < cookedClip.KeyframeCount)
+			{
+				end++;
+			}
+
+			CookedChunk chunk;
+			chunk.StartTime = clip.keyframes[first].time;
+			chunk.EndTime = clip.keyframes[end - 1].time;
+			chunk.FirstKeyframe = first;
+			chunk.KeyframeCount = end - first;
+			chunk.Offset = chunkData.size();
+			chunk.Size = GetChunkSize(chunk.KeyframeCount, cookedClip.TrackCount);
+			chunks.push_back(chunk);
+
+			chunkData.resize((size_t)(chunk.Offset + chunk.Size), 0);
+			float* times = (float*)&chunkData[(size_t)chunk.Offset];
+			XMFLOAT4X4* transforms = (XMFLOAT4X4*)&chunkData[(size_t)(chunk.Offset + GetChunkTimesSize(chunk.KeyframeCount))];
+
+			for (UINT keyframe = first; keyframe < end; keyframe++)
+			{
+				times[keyframe - first] = clip.keyframes[keyframe].time;
+			}
+
+			for (UINT track = 0; track < cookedClip.TrackCount; track++)
+			{
+				const XMFLOAT4X4& bindLocalTransform = joints[tracks[cookedClip.FirstTrack + track].Joint].BindLocalTransform;
+
+				for (UINT keyframe = first; keyframe < end; keyframe++)
+				{
+					auto it = clip.keyframes[keyframe].jointTransforms.find(trackNames[track]);
+					*transforms++ = it != clip.keyframes[keyframe].jointTransforms.end() ? it->second : bindLocalTransform;
+				}
+			}
+
+			first = next;
+		}
+
+		cookedClip.ChunkCount = (UINT)chunks.size() - cookedClip.FirstChunk;
+		cookedClips.push_back(cookedClip);
+	}
+
+	return writer.AddSection(MeshCache::Section_Skeleton, &cookedSkeleton, sizeof(CookedSkeleton), 1) &&
+		writer.AddSection(MeshCache::Section_Joints, joints.data(), sizeof(CookedJoint), joints.size()) &&
+		writer.AddSection(MeshCache::Section_JointNames, names.data(), sizeof(char), names.size()) &&
+		writer.AddSection(MeshCache::Section_Clips, cookedClips.data(), sizeof(CookedClip), cookedClips.size()) &&
+		writer.AddSection(MeshCache::Section_Tracks, tracks.data(), sizeof(CookedTrack), tracks.size()) &&
+		writer.AddSection(MeshCache::Section_ClipChunks, chunks.data(), sizeof(CookedChunk), chunks.size()) &&
+		writer.AddSection(MeshCache::Section_ChunkData, chunkData.data(), sizeof(char), chunkData.size());
+}
+
+AnimationData AnimationCache::ResampleClip(const AnimationData & clip, const SkeletonData & skeleton, float sampleRate)
+{
+	if (clip.keyframes.size() < 2 || sampleRate <= 0.0f)
+	{
+		return clip;
+	}
+
+	Animation source(clip, skeleton);
+
+	std::vector<const JointData*> joints;
+	Skeleton::Flatten(skeleton.rootJoint, joints);
+
+	std::vector<Vector3D> translations(joints.size());
+	std::vector<Quaternion> rotations(joints.size());
+
+	float firstTime = clip.keyframes.front().time;
+	float duration = clip.keyframes.back().time - firstTime;
+	UINT keyframeCount = (UINT)std::ceil(duration * sampleRate - 1e-3f) + 1;
+
+	AnimationData resampled;
+	resampled.lengthSeconds = clip.lengthSeconds;
+	resampled.keyframes.resize(keyframeCount);
+
+	UINT cursor = 0;
+	for (UINT keyframe = 0; keyframe < keyframeCount; keyframe++)
+	{
+		KeyFrameData& resampledKeyframe = resampled.keyframes[keyframe];
+		resampledKeyframe.time = firstTime + keyframe / sampleRate;
+
+		source.Sample(resampledKeyframe.time, cursor, translations.data(), rotations.data());
+
+		for (UINT joint = 0; joint < joints.size(); joint++)
+		{
+			if (source.HasTrack(joint))
+			{
+				XMFLOAT4X4 localTransform;
+				XMStoreFloat4x4(&localTransform, JointTransform::CalculateLocalTransform(translations[joint], rotations[joint]));
+				resampledKeyframe.jointTransforms.emplace(joints[joint]->nameID, localTransform);
+			}
+		}
+	}
+
+	return resampled;
+}
+
+bool AnimationCache::GetAnimatedModel(const MeshCache::CookedMesh & cookedMesh, CookedAnimatedModel & view)
+{
+	if (!cookedMesh.IsOpen())
+	{
+		return false;
+	}
+
+	UINT skeletonCount = 0, jointCount = 0, namesSize = 0, trackCount = 0, chunkCount = 0, chunkDataSize = 0;
+
+	view.Skeleton = FindElements<CookedSkeleton>(cookedMesh, MeshCache::Section_Skeleton, skeletonCount);
+	view.Joints = FindElements<CookedJoint>(cookedMesh, MeshCache::Section_Joints, jointCount);
+	view.Names = FindElements<char>(cookedMesh, MeshCache::Section_JointNames, namesSize);
+	view.Clips = FindElements<CookedClip>(cookedMesh, MeshCache::Section_Clips, view.ClipCount);
+	view.Tracks = FindElements<CookedTrack>(cookedMesh, MeshCache::Section_Tracks, trackCount);
+	view.Chunks = FindElements<CookedChunk>(cookedMesh, MeshCache::Section_ClipChunks, chunkCount);
+	view.ChunkData = FindElements<char>(cookedMesh, MeshCache::Section_ChunkData, chunkDataSize);
+
+	//empty sections still have to be present, only their pointers may be past the end of the data
+	if (!view.Skeleton || !view.Joints || !view.Names || !view.Clips || !view.Tracks || !view.Chunks || !view.ChunkData)
+	{
+		DBG_OUTPUT(L"Cooked animated model is missing a section\n");
+		return false;
+	}
+
+	if (skeletonCount != 1 || jointCount == 0 || view.Skeleton->JointCount != jointCount || namesSize == 0 || view.Names[namesSize - 1] != '\0')
+	{
+		DBG_OUTPUT(L"Cooked skeleton is malformed\n");
+		return false;
+	}
+
+	for (UINT joint = 0; joint < jointCount; joint++)
+	{
+		int parent = view.Joints[joint].Parent;
+		bool validParent = joint == 0 ? parent == -1 : parent >= 0 && (UINT)parent < joint;
+
+		if (!validParent || view.Joints[joint].NameOffset >= namesSize || view.Joints[joint].SkinIndex > view.Skeleton->SkinJointCount)
+		{
+			DBG_OUTPUT(L"Cooked joint %u is malformed\n", joint);
+			return false;
+		}
+	}
+
+	for (UINT clipIndex = 0; clipIndex < view.ClipCount; clipIndex++)
+	{
+		const CookedClip& clip = view.Clips[clipIndex];
+
+		bool tracksInBounds = clip.FirstTrack <= trackCount && clip.TrackCount <= trackCount - clip.FirstTrack;
+		bool chunksInBounds = clip.FirstChunk <= chunkCount && clip.ChunkCount <= chunkCount - clip.FirstChunk && (clip.ChunkCount > 0) == (clip.KeyframeCount > 0);
+
+		if (!tracksInBounds || !chunksInBounds)
+		{
+			DBG_OUTPUT(L"Cooked clip %u is outside the keyframe data\n", clipIndex);
+			return false;
+		}
+
+		for (UINT i = 0; i < clip.TrackCount; i++)
+		{
+			if (view.Tracks[clip.FirstTrack + i].Joint >= jointCount)
+			{
+				DBG_OUTPUT(L"Cooked clip %u has a malformed track\n", clipIndex);
+				return false;
+			}
+		}
+
+		//the chunks have to cover the keyframes in order, each overlapping the next by one, for streaming to find them
+		UINT nextKeyframe = 0;
+		for (UINT i = 0; i < clip.ChunkCount; i++)
+		{
+			const CookedChunk& chunk = view.Chunks[clip.FirstChunk + i];
+			bool last = i + 1 == clip.ChunkCount;
+
+			bool valid = chunk.FirstKeyframe == nextKeyframe && chunk.KeyframeCount > (last ? 0u : 1u) &&
+				chunk.KeyframeCount <= clip.KeyframeCount - chunk.FirstKeyframe && chunk.Offset % 16 == 0 &&
+				chunk.Size == GetChunkSize(chunk.KeyframeCount, clip.TrackCount) && chunk.Offset <= chunkDataSize && chunk.Size <= chunkDataSize - chunk.Offset;
+
+			if (!valid || (last && chunk.FirstKeyframe + chunk.KeyframeCount != clip.KeyframeCount))
+			{
+				DBG_OUTPUT(L"Cooked clip %u has a malformed chunk\n", clipIndex);
+				return false;
+			}
+
+			nextKeyframe = chunk.FirstKeyframe + chunk.KeyframeCount - 1;
+		}
+	}
+
+	return true;
+}
+
+SkeletonData AnimationCache::ReadSkeleton(const CookedAnimatedModel & view)
+{
+	std::vector<JointData*> joints(view.Skeleton->JointCount);
+
+	for (UINT i = 0; i < joints.size(); i++)
+	{
+		const CookedJoint& cookedJoint = view.Joints[i];
+
+		joints[i] = new JointData((int)cookedJoint.SkinIndex, view.GetJointName(i), cookedJoint.BindLocalTransform);
+		joints[i]->inverseBindTransform = cookedJoint.InverseBindTransform;
+
+		if (cookedJoint.Parent >= 0)
+		{
+			joints[cookedJoint.Parent]->AddChild(joints[i]);
+		}
+	}
+
+	//the skeleton keeps its own copy of the root, which shares the child pointers
+	SkeletonData skeleton(view.Skeleton->SkinJointCount, *joints[0]);
+	delete joints[0];
+
+	return skeleton;
+}
+
+std::vector<AnimationData> AnimationCache::ReadClips(const CookedAnimatedModel & view)
+{
+	std::vector<AnimationData> clips(view.ClipCount);
+
+	for (UINT clipIndex = 0; clipIndex < view.ClipCount; clipIndex++)
+	{
+		const CookedClip& cookedClip = view.Clips[clipIndex];
+		AnimationData& clip = clips[clipIndex];
+
+		clip.lengthSeconds = cookedClip.LengthSeconds;
+		clip.keyframes.resize(cookedClip.KeyframeCount);
+
+		std::vector<std::string> trackNames(cookedClip.TrackCount);
+		for (UINT track = 0; track < cookedClip.TrackCount; track++)
+		{
+			trackNames[track] = view.GetJointName(view.Tracks[cookedClip.FirstTrack + track].Joint);
+		}
+
+		//the keyframe a chunk shares with the next is read from the next
+		for (UINT i = 0; i < cookedClip.ChunkCount; i++)
+		{
+			const CookedChunk& chunk = view.Chunks[cookedClip.FirstChunk + i];
+			UINT ownKeyframes = i + 1 == cookedClip.ChunkCount ? chunk.KeyframeCount : chunk.KeyframeCount - 1;
+
+			const float* times = view.GetChunkTimes(chunk);
+			for (UINT keyframe = 0; keyframe < ownKeyframes; keyframe++)
+			{
+				clip.keyframes[chunk.FirstKeyframe + keyframe].time = times[keyframe];
+			}
+
+			for (UINT track = 0; track < cookedClip.TrackCount; track++)
+			{
+				const XMFLOAT4X4* transforms = view.GetChunkTransforms(chunk, track);
+
+				for (UINT keyframe = 0; keyframe < ownKeyframes; keyframe++)
+				{
+					clip.keyframes[chunk.FirstKeyframe + keyframe].jointTransforms.emplace(trackNames[track], transforms[keyframe]);
+				}
+			}
+		}
+	}
+
+	return clips;
+}
+
+UINT AnimationCache::CookedAnimatedModel::FindChunk(const CookedClip & clip, float time) const
+{
+	if (clip.ChunkCount <= 1)
+	{
+		return 0;
+	}
+
+	//the last chunk starting at or before the time
+	const CookedChunk* first = Chunks + clip.FirstChunk;
+	const CookedChunk* found = std::upper_bound(first + 1, first + clip.ChunkCount, time,
+		[](float value, const CookedChunk& chunk) { return value < chunk.StartTime; });
+
+	return (UINT)(found - first) - 1;
+}
+
+bool AnimationCache::AddMorphTargets(MeshCache::Writer & writer, const std::vector<MorphTargetData>& targets)
+{
+	if (targets.empty())
+	{
+		return true;
+	}
+
+	std::vector<CookedMorphTarget> cookedTargets;
+	std::vector<UINT> vertices;
+	std::vector<MorphDelta> deltas;
+	std::vector<char> names;
+
+	for (const MorphTargetData& target : targets)
+	{
+		CookedMorphTarget cookedTarget;
+		cookedTarget.NameOffset = (UINT)names.size();
+		cookedTarget.FirstDelta = (UINT)deltas.size();
+		cookedTarget.DeltaCount = (UINT)target.deltas.size();
+		cookedTarget.Reserved = 0;
+		cookedTargets.push_back(cookedTarget);
+
+		vertices.insert(vertices.end(), target.vertices.begin(), target.vertices.end());
+		deltas.insert(deltas.end(), target.deltas.begin(), target.deltas.end());
+		names.insert(names.end(), target.name.begin(), target.name.end());
+		names.push_back('\0');
+	}
+
+	return writer.AddSection(MeshCache::Section_MorphTargets, cookedTargets.data(), sizeof(CookedMorphTarget), cookedTargets.size()) &&
+		writer.AddSection(MeshCache::Section_MorphVertices, vertices.data(), sizeof(UINT), vertices.size()) &&
+		writer.AddSection(MeshCache::Section_MorphDeltas, deltas.data(), sizeof(MorphDelta), deltas.size()) &&
+		writer.AddSection(MeshCache::Section_MorphNames, names.data(), sizeof(char), names.size());
+}
+
+bool AnimationCache::ReadMorphTargets(const MeshCache::CookedMesh & cookedMesh, UINT vertexCount, std::vector<MorphTargetData>& targets)
+{
+	targets.clear();
+
+	UINT targetCount = 0, vertexIndexCount = 0, deltaCount = 0, namesSize = 0;
+
+	const CookedMorphTarget* cookedTargets = FindElements<CookedMorphTarget>(cookedMesh, MeshCache::Section_MorphTargets, targetCount);
+	if (!cookedTargets)
+	{
+		return true;
+	}
+
+	const UINT* vertices = FindElements<UINT>(cookedMesh, MeshCache::Section_MorphVertices, vertexIndexCount);
+	const MorphDelta* deltas = FindElements<MorphDelta>(cookedMesh, MeshCache::Section_MorphDeltas, deltaCount);
+	const char* names = FindElements<char>(cookedMesh, MeshCache::Section_MorphNames, namesSize);
+
+	if (!vertices || !deltas || !names || vertexIndexCount != deltaCount || namesSize == 0 || names[namesSize - 1] != '\0')
+	{
+		DBG_OUTPUT(L"Cooked morph targets are missing a section\n");
+		return false;
+	}
+
+	targets.resize(targetCount);
+
+	for (UINT i = 0; i < targetCount; i++)
+	{
+		const CookedMorphTarget& cookedTarget = cookedTargets[i];
+
+		bool inBounds = cookedTarget.NameOffset < namesSize && cookedTarget.FirstDelta <= deltaCount && cookedTarget.DeltaCount <= deltaCount - cookedTarget.FirstDelta;
+
+		//the vertices have to ascend and stay inside the model for the blender to apply them blindly
+		for (UINT delta = 0; inBounds && delta < cookedTarget.DeltaCount; delta++)
+		{
+			UINT vertex = vertices[cookedTarget.FirstDelta + delta];
+			inBounds = vertex < vertexCount && (delta == 0 || vertex > vertices[cookedTarget.FirstDelta + delta - 1]);
+		}
+
+		if (!inBounds)
+		{
+			DBG_OUTPUT(L"Cooked morph target %u is malformed\n", i);
+			targets.clear();
+			return false;
+		}
+
+		MorphTargetData& target = targets[i];
+		target.name = names + cookedTarget.NameOffset;
+		target.vertices.assign(vertices + cookedTarget.FirstDelta, vertices + cookedTarget.FirstDelta + cookedTarget.DeltaCount);
+		target.deltas.assign(deltas + cookedTarget.FirstDelta, deltas + cookedTarget.FirstDelta + cookedTarget.DeltaCount);
+	}
+
+	return true;
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <vector>
+
+#include "Commons.h"
+#include "AnimatedModelData.h"
+#include "MeshCache.h"
+
+//The skeleton and animation clips of a skinned model stored in the same cooked container as its vertices. Joints are a
+//flat array with parent indices and clips hold a track of transforms per animated joint, so the whole thing can be read
+//in place from the file mapping
+namespace AnimationCache
+{
+	struct CookedSkeleton
+	{
+		UINT JointCount; //elements in the joint section
+		UINT SkinJointCount; //joints the skin's bone indices refer to
+	};
+
+	//Parents always come before their children, the root is the first joint and has a parent of -1
+	struct CookedJoint
+	{
+		int Parent;
+		UINT SkinIndex; //into the skin's joints, SkinJointCount for joints the skin doesn't bind
+		UINT NameOffset; //into the name section
+		UINT Reserved;
+		XMFLOAT4X4 BindLocalTransform;
+		XMFLOAT4X4 InverseBindTransform;
+	};
+
+	//Keyframes are cooked in chunks of about this long so a clip can be streamed instead of loaded whole
+	const float c_ChunkSeconds = 2.0f;
+
+	struct CookedClip
+	{
+		float LengthSeconds;
+		UINT KeyframeCount;
+		UINT FirstTrack;
+		UINT TrackCount;
+		UINT FirstChunk;
+		UINT ChunkCount;
+	};
+
+	//A joint animated by the clip it belongs to, which has its transforms in every chunk
+	struct CookedTrack
+	{
+		UINT Joint; //into the joint section
+	};
+
+	//A run of a clip's keyframes that also holds the first keyframe of the next chunk, so any time from StartTime to
+	//EndTime can be sampled from this chunk alone. Its data is the keyframe times padded to 16 bytes followed by each
+	//track's transforms at those times, one track after another
+	struct CookedChunk
+	{
+		float StartTime;
+		float EndTime;
+		UINT FirstKeyframe; //of the clip
+		UINT KeyframeCount;
+		UINT64 Offset; //into the chunk data section
+		UINT64 Size;
+	};
+
+	inline UINT64 GetChunkTimesSize(UINT keyframeCount)
+	{
+		return ((UINT64)keyframeCount * sizeof(float) + 15) & ~(UINT64)15;
+	}
+
+	inline UINT64 GetChunkSize(UINT keyframeCount, UINT trackCount)
+	{
+		return GetChunkTimesSize(keyframeCount) + (UINT64)keyframeCount * trackCount * sizeof(XMFLOAT4X4);
+	}
+
+	//A morph target's deltas are a range of the morph vertex and delta sections
+	struct CookedMorphTarget
+	{
+		UINT NameOffset; //into the morph name section
+		UINT FirstDelta;
+		UINT DeltaCount;
+		UINT Reserved;
+	};
+
+	//Typed pointers into the sections of an open cooked file, valid for as long as it stays open
+	struct CookedAnimatedModel
+	{
+		const CookedSkeleton* Skeleton;
+		const CookedJoint* Joints;
+		const char* Names;
+		const CookedClip* Clips;
+		UINT ClipCount;
+		const CookedTrack* Tracks;
+		const CookedChunk* Chunks;
+		const char* ChunkData;
+
+		const char* GetJointName(UINT joint) const { return Names + Joints[joint].NameOffset; }
+
+		const float* GetChunkTimes(const CookedChunk& chunk) const { return (const float*)(ChunkData + chunk.Offset); }
+
+		//track is the index into the clip's tracks rather than the track section
+		const XMFLOAT4X4* GetChunkTransforms(const CookedChunk& chunk, UINT track) const
+		{
+			return (const XMFLOAT4X4*)(ChunkData + chunk.Offset + GetChunkTimesSize(chunk.KeyframeCount)) + (size_t)track * chunk.KeyframeCount;
+		}
+
+		//The chunk of the clip whose keyframes are either side of time, clamped to the first and last
+		UINT FindChunk(const CookedClip& clip, float time) const;
+	};
+
+	//Flattens the skeleton and splits the clips into chunks of c_ChunkSeconds. Clip joints that aren't in the skeleton are dropped and joints
+	//missing from some of a clip's keyframes hold their bind pose there. A sample rate other than zero resamples every
+	//clip to it first
+	bool AddAnimatedModel(MeshCache::Writer& writer, const SkeletonData& skeleton, const std::vector<AnimationData>& clips, float sampleRate = 0.0f);
+
+	//Keyframes evenly spaced at sampleRate a second from the clip's first to past its last, interpolated the way playback
+	//does, so the runtime can work out the keyframe for a time instead of searching for it
+	AnimationData ResampleClip(const AnimationData& clip, const SkeletonData& skeleton, float sampleRate);
+
+	//False if the file has no skeleton or any of its indices or ranges point outside their sections
+	bool GetAnimatedModel(const MeshCache::CookedMesh& cookedMesh, CookedAnimatedModel& view);
+
+	//Adds nothing when there are no morph targets
+	bool AddMorphTargets(MeshCache::Writer& writer, const std::vector<MorphTargetData>& targets);
+
+	//Leaves targets empty and returns true if the file has none. False if the sections are malformed or refer to
+	//vertices past vertexCount
+	bool ReadMorphTargets(const MeshCache::CookedMesh& cookedMesh, UINT vertexCount, std::vector<MorphTargetData>& targets);
+
+	//Copies the mapped data back out into the loader's types for the code that still works with them
+	SkeletonData ReadSkeleton(const CookedAnimatedModel& view);
+	std::vector<AnimationData> ReadClips(const CookedAnimatedModel& view);
+}
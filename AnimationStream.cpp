@@ -0,0 +1,163 @@
+#include "AnimationStream.h"
+
+namespace
+{
+	const UINT c_NoChunk = ~0u;
+}
+
+AnimationStream::AnimationStream(const AnimationCache::CookedAnimatedModel & view, UINT clip)
+	: _view(view), _clip(view.Clips[clip]), _request(c_NoChunk), _decoding(c_NoChunk)
+{
+	if (_clip.ChunkCount == 0)
+	{
+		_current.reset(new Chunk());
+		_current->Index = 0;
+		_current->Clip = Animation(_clip.LengthSeconds, std::vector<float>(), _view.Skeleton->JointCount);
+		return;
+	}
+
+	//the first chunk is decoded up front so starting playback doesn't wait
+	_current = Decode(0);
+
+	if (_clip.ChunkCount > 1)
+	{
+		_worker = std::thread(&AnimationStream::Prefetch, this);
+		RequestNext(0, nullptr);
+	}
+}
+
+AnimationStream::~AnimationStream()
+{
+	if (_worker.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_stop = true;
+		}
+
+		_condition.notify_all();
+		_worker.join();
+	}
+}
+
+const Animation& AnimationStream::GetChunk(float time)
+{
+	if (_clip.ChunkCount > 1)
+	{
+		UINT chunk = _view.FindChunk(_clip, time);
+		if (chunk != _current->Index)
+		{
+			MoveTo(chunk);
+		}
+	}
+
+	return _current->Clip;
+}
+
+std::unique_ptr<AnimationStream::Chunk> AnimationStream::Decode(UINT chunk) const
+{
+	const AnimationCache::CookedChunk& cookedChunk = _view.Chunks[_clip.FirstChunk + chunk];
+	const float* times = _view.GetChunkTimes(cookedChunk);
+
+	std::unique_ptr<Chunk> decoded(new Chunk());
+	decoded->Index = chunk;
+	decoded->Clip = Animation(_clip.LengthSeconds, std::vector<float>(times, times + cookedChunk.KeyframeCount), _view.Skeleton->JointCount);
+
+	for (UINT track = 0; track < _clip.TrackCount; track++)
+	{
+		decoded->Clip.SetTrack(_view.Tracks[_clip.FirstTrack + track].Joint, _view.GetChunkTransforms(cookedChunk, track));
+	}
+
+	return decoded;
+}
+
+void AnimationStream::MoveTo(UINT chunk)
+{
+	std::unique_ptr<Chunk> retired = std::move(_current);
+
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+
+		//a chunk the worker is part way through is finished sooner there than started again here
+		if (_decoding == chunk)
+		{
+			_stalls++;
+			_condition.wait(lock, [this] { return _decoding == c_NoChunk; });
+		}
+
+		if (_prefetched && _prefetched->Index == chunk)
+		{
+			_current = std::move(_prefetched);
+		}
+	}
+
+	//a seek, or playback outrunning the worker
+	if (!_current)
+	{
+		_stalls++;
+		_current = Decode(chunk);
+	}
+
+	RequestNext(chunk, std::move(retired));
+}
+
+void AnimationStream::RequestNext(UINT chunk, std::unique_ptr<Chunk> retired)
+{
+	//playback loops, so the last chunk is followed by the first
+	UINT next = (chunk + 1) % _clip.ChunkCount;
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		_retired = std::move(retired);
+
+		if ((_prefetched && _prefetched->Index == next) || _decoding == next)
+		{
+			return;
+		}
+
+		_request = next;
+	}
+
+	_condition.notify_all();
+}
+
+void AnimationStream::Prefetch()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	while (true)
+	{
+		_condition.wait(lock, [this] { return _stop || _request != c_NoChunk || _retired; });
+
+		if (_stop)
+		{
+			return;
+		}
+
+		UINT chunk = _request;
+		_request = c_NoChunk;
+		_decoding = chunk;
+
+		//a chunk that is no longer wanted is dropped along with the one playback has left
+		std::unique_ptr<Chunk> retired = std::move(_retired);
+		std::unique_ptr<Chunk> unused = chunk != c_NoChunk ? std::move(_prefetched) : nullptr;
+
+		lock.unlock();
+
+		retired.reset();
+		unused.reset();
+
+		std::unique_ptr<Chunk> decoded = chunk != c_NoChunk ? Decode(chunk) : nullptr;
+
+		lock.lock();
+
+		if (decoded)
+		{
+			_prefetched = std::move(decoded);
+		}
+
+		_decoding = c_NoChunk;
+		_condition.notify_all();
+	}
+}
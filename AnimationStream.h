@@ -0,0 +1,67 @@
+#pragma once
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "AnimationCache.h"
+#include "Animation.h"
+
+//Plays one clip of a cooked file without decoding all of it. Only the chunk under the playhead and the one after it
+//are held as tracks; when playback moves into a chunk the following one is decoded on a worker thread, so unless
+//the playhead jumps somewhere new the frame never waits on the file
+class AnimationStream
+{
+public:
+	//The view has to stay valid, so its cooked file open, for as long as the stream is
+	AnimationStream(const AnimationCache::CookedAnimatedModel& view, UINT clip);
+	~AnimationStream();
+
+	AnimationStream(const AnimationStream&) = delete;
+	AnimationStream& operator=(const AnimationStream&) = delete;
+
+	float GetLength() const { return _clip.LengthSeconds; }
+
+	UINT GetChunkCount() const { return _clip.ChunkCount; }
+
+	//The chunk covering time as a clip of its own, valid until the next call. Chunks are loaded and prefetched from
+	//here, so it should only be called by one thread at a time
+	const Animation& GetChunk(float time);
+
+	//Times the playhead reached a chunk the worker hadn't decoded yet, each one a frame that waited for it
+	UINT GetStalls() const { return _stalls; }
+
+private:
+	struct Chunk
+	{
+		UINT Index;
+		Animation Clip;
+	};
+
+	std::unique_ptr<Chunk> Decode(UINT chunk) const;
+
+	void MoveTo(UINT chunk);
+
+	void RequestNext(UINT chunk, std::unique_ptr<Chunk> retired);
+
+	void Prefetch();
+
+	AnimationCache::CookedAnimatedModel _view;
+	AnimationCache::CookedClip _clip;
+
+	std::unique_ptr<Chunk> _current;
+	UINT _stalls = 0;
+
+	//shared with the worker
+	std::mutex _mutex;
+	std::condition_variable _condition;
+	std::unique_ptr<Chunk> _prefetched;
+	std::unique_ptr<Chunk> _retired; //freed on the worker so the frame doesn't pay for it
+	UINT _request;
+	UINT _decoding;
+	bool _stop = false;
+	std::thread _worker;
+};
@@ -0,0 +1,43 @@
+#include "AnimationSystem.h"
+
+#include <algorithm>
+
+#include "Parallel.h"
+
+UINT AnimationSystem::Add(AnimatedModel * model)
+{
+	_paletteOffsets.push_back(_palettes.size());
+	XMFLOAT4X4 identity;
+	XMStoreFloat4x4(&identity, XMMatrixIdentity());
+	_palettes.resize(_palettes.size() + model->GetSkeleton().GetPaletteSize(), identity);
+	_models.emplace_back(model);
+
+	return (UINT)_models.size() - 1;
+}
+
+unsigned int AnimationSystem::Update(float deltaTime)
+{
+	//the models are independent, each batch only reads shared clips and skeletons and writes its own models' state
+	//and palette ranges, so the batches can run without synchronising until they are joined
+	return Parallel::For(_models.size(), c_MinModelsPerTask, [&](size_t begin, size_t end, unsigned int)
+	{
+		for (size_t model = begin; model < end; model++)
+		{
+			_models[model]->Update(deltaTime);
+			_models[model]->GetJointTransforms(&_palettes[_paletteOffsets[model]]);
+		}
+	}, _threadCount);
+}
+
+UINT AnimationSystem::CopyPalette(UINT model, XMMATRIX * destination, UINT capacity) const
+{
+	UINT count = std::min(GetPaletteSize(model), capacity);
+
+	const XMFLOAT4X4* palette = GetPalette(model);
+	for (UINT joint = 0; joint < count; joint++)
+	{
+		destination[joint] = XMLoadFloat4x4(&palette[joint]);
+	}
+
+	return count;
+}
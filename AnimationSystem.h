@@ -0,0 +1,57 @@
+#pragma once
+
+#include <directxmath.h>
+#include <memory>
+#include <vector>
+
+#include "AnimatedModel.h"
+
+using namespace DirectX;
+
+//Owns every animated model and updates them together, splitting the models into contiguous batches run one to a core.
+//Each model samples its clip, poses its skeleton and writes its skinning palette to its own range of one shared buffer,
+//so the batches never write to anything in common and nothing is locked while they run
+class AnimationSystem
+{
+public:
+	AnimationSystem() = default;
+
+	AnimationSystem(const AnimationSystem&) = delete;
+	AnimationSystem& operator=(const AnimationSystem&) = delete;
+
+	//Takes ownership of the model and returns its index. A clip can be shared by any number of models but a stream
+	//can't, as each stream is read by whichever thread updates its model
+	UINT Add(AnimatedModel* model);
+
+	AnimatedModel* GetModel(UINT model) const { return _models[model].get(); }
+
+	UINT GetModelCount() const { return (UINT)_models.size(); }
+
+	//Caps the threads Update runs on, 0 uses one per core
+	void SetThreadCount(unsigned int threadCount) { _threadCount = threadCount; }
+
+	//Advances and poses every model and rebuilds all the palettes, returns the number of batches it ran
+	unsigned int Update(float deltaTime);
+
+	//The model's palette from the last Update, transposed for the skinning shader with a slot for every skin index
+	const XMFLOAT4X4* GetPalette(UINT model) const { return &_palettes[_paletteOffsets[model]]; }
+
+	UINT GetPaletteSize(UINT model) const { return _models[model]->GetSkeleton().GetPaletteSize(); }
+
+	//Loads the model's palette into a constant buffer's matrix array, dropping any joints past its capacity. Returns
+	//the number of matrices written
+	UINT CopyPalette(UINT model, XMMATRIX* destination, UINT capacity) const;
+
+private:
+	//below this a batch costs more to start than it saves
+	static const size_t c_MinModelsPerTask = 8;
+
+	std::vector<std::unique_ptr<AnimatedModel>> _models;
+
+	//where each model's palette starts in _palettes
+	std::vector<size_t> _paletteOffsets;
+	//XMFLOAT4X4 as std::vector doesn't keep XMMATRIX 16 byte aligned on 32 bit builds
+	std::vector<XMFLOAT4X4> _palettes;
+
+	unsigned int _threadCount = 0;
+};
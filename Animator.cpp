@@ -0,0 +1,493 @@
+#include "Animator.h"
+#include "JointTransform.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	//one joint of each kernel, for the joints left after the last group of four and when there's no SSE
+	void BlendJoint(const Vector3D& translation, const Quaternion& rotation, const Vector3D& targetTranslation, const Quaternion& targetRotation,
+		float weight, Vector3D& outTranslation, Quaternion& outRotation)
+	{
+		float sign = Quaternion::Dot(rotation, targetRotation) < 0.0f ? -1.0f : 1.0f;
+
+		Quaternion blended(
+			rotation.r + (targetRotation.r * sign - rotation.r) * weight,
+			rotation.i + (targetRotation.i * sign - rotation.i) * weight,
+			rotation.j + (targetRotation.j * sign - rotation.j) * weight,
+			rotation.k + (targetRotation.k * sign - rotation.k) * weight);
+		float scale = 1.0f / sqrtf(blended.GetSqrMagnitude());
+
+		outTranslation.x = translation.x + (targetTranslation.x - translation.x) * weight;
+		outTranslation.y = translation.y + (targetTranslation.y - translation.y) * weight;
+		outTranslation.z = translation.z + (targetTranslation.z - translation.z) * weight;
+		outRotation = blended.Scale(scale);
+	}
+
+	void AddJoint(const Vector3D& translation, const Quaternion& rotation, const Vector3D& additiveTranslation, const Quaternion& additiveRotation,
+		const Vector3D& referenceTranslation, const Quaternion& referenceRotation, float weight, Vector3D& outTranslation, Quaternion& outRotation)
+	{
+		//the rotation taking the reference to the additive pose, scaled toward no rotation by the weight
+		Quaternion delta = Quaternion(referenceRotation).Conjugate() * additiveRotation;
+		if (delta.r < 0.0f)
+		{
+			delta = delta.Scale(-1.0f);
+		}
+
+		Quaternion scaled(1.0f + (delta.r - 1.0f) * weight, delta.i * weight, delta.j * weight, delta.k * weight);
+		scaled = scaled.Scale(1.0f / sqrtf(scaled.GetSqrMagnitude()));
+
+		outTranslation.x = translation.x + (additiveTranslation.x - referenceTranslation.x) * weight;
+		outTranslation.y = translation.y + (additiveTranslation.y - referenceTranslation.y) * weight;
+		outTranslation.z = translation.z + (additiveTranslation.z - referenceTranslation.z) * weight;
+		outRotation = Quaternion(rotation) * scaled;
+	}
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+	//four joints' weights spread over their twelve translation floats, three registers of x y z x, y z x y and z x y z
+	void SpreadWeights(__m128 weights, __m128& first, __m128& second, __m128& third)
+	{
+		first = _mm_shuffle_ps(weights, weights, _MM_SHUFFLE(1, 0, 0, 0));
+		second = _mm_shuffle_ps(weights, weights, _MM_SHUFFLE(2, 2, 1, 1));
+		third = _mm_shuffle_ps(weights, weights, _MM_SHUFFLE(3, 3, 3, 2));
+	}
+
+	__m128 LoadWeights(float weight, const float* mask, UINT joint)
+	{
+		return mask ? _mm_mul_ps(_mm_set1_ps(weight), _mm_loadu_ps(mask + joint)) : _mm_set1_ps(weight);
+	}
+
+	//four quaternions loaded and transposed so each register holds one component of all four
+	void LoadRotations(const Quaternion* rotations, __m128& r, __m128& i, __m128& j, __m128& k)
+	{
+		r = _mm_loadu_ps(&rotations[0].r);
+		i = _mm_loadu_ps(&rotations[1].r);
+		j = _mm_loadu_ps(&rotations[2].r);
+		k = _mm_loadu_ps(&rotations[3].r);
+		_MM_TRANSPOSE4_PS(r, i, j, k);
+	}
+
+	void StoreRotations(Quaternion* rotations, __m128 r, __m128 i, __m128 j, __m128 k)
+	{
+		_MM_TRANSPOSE4_PS(r, i, j, k);
+		_mm_storeu_ps(&rotations[0].r, r);
+		_mm_storeu_ps(&rotations[1].r, i);
+		_mm_storeu_ps(&rotations[2].r, j);
+		_mm_storeu_ps(&rotations[3].r, k);
+	}
+
+	void Normalise(__m128& r, __m128& i, __m128& j, __m128& k)
+	{
+		__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(r, r), _mm_mul_ps(i, i)), _mm_add_ps(_mm_mul_ps(j, j), _mm_mul_ps(k, k))));
+		__m128 scale = _mm_div_ps(_mm_set1_ps(1.0f), length);
+		r = _mm_mul_ps(r, scale);
+		i = _mm_mul_ps(i, scale);
+		j = _mm_mul_ps(j, scale);
+		k = _mm_mul_ps(k, scale);
+	}
+#endif
+
+	void RemoveMissingClips(std::vector<Motion::Sample>& samples)
+	{
+		samples.erase(std::remove_if(samples.begin(), samples.end(), [](const Motion::Sample& sample) { return sample.Clip == nullptr; }), samples.end());
+	}
+}
+
+void PoseBlending::Blend(const Vector3D * translations, const Quaternion * rotations, const Vector3D * targetTranslations, const Quaternion * targetRotations,
+	float weight, const float * mask, UINT jointCount, Vector3D * outTranslations, Quaternion * outRotations)
+{
+	UINT joint = 0;
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+	//four joints' translations are twelve floats, three registers, and blend a float at a time whatever joint it
+	//belongs to. Their rotations are transposed so the dot products and normalising work across all four at once
+	const __m128 signBit = _mm_set1_ps(-0.0f);
+
+	for (; joint + 4 <= jointCount; joint += 4)
+	{
+		__m128 weights = LoadWeights(weight, mask, joint);
+		__m128 weightsX, weightsY, weightsZ;
+		SpreadWeights(weights, weightsX, weightsY, weightsZ);
+
+		const float* from = &translations[joint].x;
+		const float* to = &targetTranslations[joint].x;
+		__m128 a0 = _mm_loadu_ps(from), a1 = _mm_loadu_ps(from + 4), a2 = _mm_loadu_ps(from + 8);
+		__m128 b0 = _mm_loadu_ps(to), b1 = _mm_loadu_ps(to + 4), b2 = _mm_loadu_ps(to + 8);
+
+		float* out = &outTranslations[joint].x;
+		_mm_storeu_ps(out, _mm_add_ps(a0, _mm_mul_ps(_mm_sub_ps(b0, a0), weightsX)));
+		_mm_storeu_ps(out + 4, _mm_add_ps(a1, _mm_mul_ps(_mm_sub_ps(b1, a1), weightsY)));
+		_mm_storeu_ps(out + 8, _mm_add_ps(a2, _mm_mul_ps(_mm_sub_ps(b2, a2), weightsZ)));
+
+		__m128 ar, ai, aj, ak, br, bi, bj, bk;
+		LoadRotations(rotations + joint, ar, ai, aj, ak);
+		LoadRotations(targetRotations + joint, br, bi, bj, bk);
+
+		//targets on the far side of the sphere are flipped so the blend takes the shorter way round
+		__m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ar, br), _mm_mul_ps(ai, bi)), _mm_add_ps(_mm_mul_ps(aj, bj), _mm_mul_ps(ak, bk)));
+		__m128 flip = _mm_and_ps(_mm_cmplt_ps(dot, _mm_setzero_ps()), signBit);
+
+		__m128 r = _mm_add_ps(ar, _mm_mul_ps(_mm_sub_ps(_mm_xor_ps(br, flip), ar), weights));
+		__m128 i = _mm_add_ps(ai, _mm_mul_ps(_mm_sub_ps(_mm_xor_ps(bi, flip), ai), weights));
+		__m128 j = _mm_add_ps(aj, _mm_mul_ps(_mm_sub_ps(_mm_xor_ps(bj, flip), aj), weights));
+		__m128 k = _mm_add_ps(ak, _mm_mul_ps(_mm_sub_ps(_mm_xor_ps(bk, flip), ak), weights));
+
+		Normalise(r, i, j, k);
+		StoreRotations(outRotations + joint, r, i, j, k);
+	}
+#endif
+
+	for (; joint < jointCount; joint++)
+	{
+		BlendJoint(translations[joint], rotations[joint], targetTranslations[joint], targetRotations[joint], mask ? weight * mask[joint] : weight,
+			outTranslations[joint], outRotations[joint]);
+	}
+}
+
+void PoseBlending::Add(const Vector3D * translations, const Quaternion * rotations, const Vector3D * additiveTranslations, const Quaternion * additiveRotations,
+	const Vector3D * referenceTranslations, const Quaternion * referenceRotations, float weight, const float * mask, UINT jointCount,
+	Vector3D * outTranslations, Quaternion * outRotations)
+{
+	UINT joint = 0;
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+	const __m128 signBit = _mm_set1_ps(-0.0f);
+	const __m128 one = _mm_set1_ps(1.0f);
+
+	for (; joint + 4 <= jointCount; joint += 4)
+	{
+		__m128 weights = LoadWeights(weight, mask, joint);
+		__m128 weightsX, weightsY, weightsZ;
+		SpreadWeights(weights, weightsX, weightsY, weightsZ);
+
+		const float* base = &translations[joint].x;
+		const float* additive = &additiveTranslations[joint].x;
+		const float* reference = &referenceTranslations[joint].x;
+		__m128 t0 = _mm_add_ps(_mm_loadu_ps(base), _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(additive), _mm_loadu_ps(reference)), weightsX));
+		__m128 t1 = _mm_add_ps(_mm_loadu_ps(base + 4), _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(additive + 4), _mm_loadu_ps(reference + 4)), weightsY));
+		__m128 t2 = _mm_add_ps(_mm_loadu_ps(base + 8), _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(additive + 8), _mm_loadu_ps(reference + 8)), weightsZ));
+
+		float* out = &outTranslations[joint].x;
+		_mm_storeu_ps(out, t0);
+		_mm_storeu_ps(out + 4, t1);
+		_mm_storeu_ps(out + 8, t2);
+
+		__m128 pr, pi, pj, pk, qr, qi, qj, qk;
+		LoadRotations(referenceRotations + joint, pr, pi, pj, pk);
+		LoadRotations(additiveRotations + joint, qr, qi, qj, qk);
+
+		//the delta is the reference's conjugate times the additive rotation, the conjugate folded into the signs
+		__m128 dr = _mm_add_ps(_mm_add_ps(_mm_mul_ps(pr, qr), _mm_mul_ps(pi, qi)), _mm_add_ps(_mm_mul_ps(pj, qj), _mm_mul_ps(pk, qk)));
+		__m128 di = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(pr, qi), _mm_mul_ps(pk, qj)), _mm_add_ps(_mm_mul_ps(pi, qr), _mm_mul_ps(pj, qk)));
+		__m128 dj = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(pr, qj), _mm_mul_ps(pi, qk)), _mm_add_ps(_mm_mul_ps(pj, qr), _mm_mul_ps(pk, qi)));
+		__m128 dk = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(pr, qk), _mm_mul_ps(pj, qi)), _mm_add_ps(_mm_mul_ps(pk, qr), _mm_mul_ps(pi, qj)));
+
+		//then scaled from no rotation toward the delta by the weight, the shorter way round
+		__m128 flip = _mm_and_ps(_mm_cmplt_ps(dr, _mm_setzero_ps()), signBit);
+		__m128 sr = _mm_add_ps(one, _mm_mul_ps(_mm_sub_ps(_mm_xor_ps(dr, flip), one), weights));
+		__m128 si = _mm_mul_ps(_mm_xor_ps(di, flip), weights);
+		__m128 sj = _mm_mul_ps(_mm_xor_ps(dj, flip), weights);
+		__m128 sk = _mm_mul_ps(_mm_xor_ps(dk, flip), weights);
+		Normalise(sr, si, sj, sk);
+
+		__m128 br, bi, bj, bk;
+		LoadRotations(rotations + joint, br, bi, bj, bk);
+
+		__m128 r = _mm_sub_ps(_mm_mul_ps(br, sr), _mm_add_ps(_mm_add_ps(_mm_mul_ps(bi, si), _mm_mul_ps(bj, sj)), _mm_mul_ps(bk, sk)));
+		__m128 i = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(br, si), _mm_mul_ps(bi, sr)), _mm_mul_ps(bj, sk)), _mm_mul_ps(bk, sj));
+		__m128 j = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(br, sj), _mm_mul_ps(bj, sr)), _mm_mul_ps(bk, si)), _mm_mul_ps(bi, sk));
+		__m128 k = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(br, sk), _mm_mul_ps(bk, sr)), _mm_mul_ps(bi, sj)), _mm_mul_ps(bj, si));
+
+		StoreRotations(outRotations + joint, r, i, j, k);
+	}
+#endif
+
+	for (; joint < jointCount; joint++)
+	{
+		AddJoint(translations[joint], rotations[joint], additiveTranslations[joint], additiveRotations[joint], referenceTranslations[joint],
+			referenceRotations[joint], mask ? weight * mask[joint] : weight, outTranslations[joint], outRotations[joint]);
+	}
+}
+
+Motion Motion::BlendSpace1D(std::vector<Sample> samples)
+{
+	RemoveMissingClips(samples);
+	std::sort(samples.begin(), samples.end(), [](const Sample& a, const Sample& b) { return a.X < b.X; });
+
+	Motion motion;
+	motion._samples = std::move(samples);
+	motion._dimensions = 1;
+	return motion;
+}
+
+Motion Motion::BlendSpace2D(std::vector<Sample> samples)
+{
+	RemoveMissingClips(samples);
+
+	Motion motion;
+	motion._samples = std::move(samples);
+	motion._dimensions = 2;
+	return motion;
+}
+
+void Motion::ComputeWeights(std::vector<float>& weights) const
+{
+	weights.assign(_samples.size(), 0.0f);
+	if (_samples.empty())
+	{
+		return;
+	}
+
+	if (_dimensions == 0 || _samples.size() == 1)
+	{
+		weights[0] = 1.0f;
+		return;
+	}
+
+	if (_dimensions == 1)
+	{
+		//the clips are sorted, so the parameter falls between two neighbours or past one of the ends
+		size_t after = std::upper_bound(_samples.begin(), _samples.end(), _x, [](float x, const Sample& sample) { return x < sample.X; }) - _samples.begin();
+		if (after == 0 || after == _samples.size())
+		{
+			weights[after == 0 ? 0 : after - 1] = 1.0f;
+			return;
+		}
+
+		const Sample& before = _samples[after - 1];
+		float alpha = (_x - before.X) / (_samples[after].X - before.X);
+		weights[after - 1] = 1.0f - alpha;
+		weights[after] = alpha;
+		return;
+	}
+
+	//inverse square distance weighting, a clip right on the parameters plays on its own
+	float total = 0.0f;
+	for (size_t sample = 0; sample < _samples.size(); sample++)
+	{
+		float dx = _x - _samples[sample].X;
+		float dy = _y - _samples[sample].Y;
+		float distanceSquared = dx * dx + dy * dy;
+		if (distanceSquared < 1e-6f)
+		{
+			weights.assign(_samples.size(), 0.0f);
+			weights[sample] = 1.0f;
+			return;
+		}
+
+		weights[sample] = 1.0f / distanceSquared;
+		total += weights[sample];
+	}
+
+	for (float& weight : weights)
+	{
+		weight /= total;
+	}
+}
+
+float Motion::GetLength(const std::vector<float>& weights) const
+{
+	if (_stream)
+	{
+		return _stream->GetLength();
+	}
+
+	float length = 0.0f;
+	for (size_t sample = 0; sample < _samples.size(); sample++)
+	{
+		length += weights[sample] * _samples[sample].Clip->GetLength();
+	}
+	return length;
+}
+
+Animator::Animator(const Skeleton & skeleton)
+	:_jointCount(skeleton.GetJointCount())
+{
+	for (UINT joint = 0; joint < _jointCount; joint++)
+	{
+		JointTransform bindPose = JointTransform::Decompose(skeleton.GetBindLocalTransforms()[joint]);
+		_bindTranslations.push_back(bindPose._position);
+		_bindRotations.push_back(bindPose._rotation);
+	}
+
+	_layerTranslations.resize(_jointCount);
+	_fadeTranslations.resize(_jointCount);
+	_sampleTranslations.resize(_jointCount);
+	_layerRotations.resize(_jointCount);
+	_fadeRotations.resize(_jointCount);
+	_sampleRotations.resize(_jointCount);
+
+	AddLayer(Layer_Override);
+}
+
+UINT Animator::AddLayer(LayerMode mode, float weight, std::vector<float> mask)
+{
+	Layer layer;
+	layer.Mode = mode;
+	layer.Weight = weight;
+	layer.Mask = std::move(mask);
+
+	_layers.push_back(std::move(layer));
+	return (UINT)_layers.size() - 1;
+}
+
+void Animator::Play(UINT layer, Motion motion, float fadeSeconds)
+{
+	Layer& playing = _layers[layer];
+
+	//a fade interrupted by another drops the motion it was fading out
+	if (fadeSeconds > 0.0f && !playing.Current.Source.IsEmpty())
+	{
+		playing.Previous = std::move(playing.Current);
+		playing.FadeTime = 0.0f;
+		playing.FadeDuration = fadeSeconds;
+	}
+	else
+	{
+		playing.Previous = Playback();
+		playing.FadeDuration = 0.0f;
+	}
+
+	playing.Current = Playback();
+	playing.Current.Cursors.assign(std::max<size_t>(motion.GetSamples().size(), 1), 0);
+	playing.Current.Source = std::move(motion);
+}
+
+bool Animator::IsPlaying() const
+{
+	for (const Layer& layer : _layers)
+	{
+		if (!layer.Current.Source.IsEmpty())
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void Animator::Update(float deltaTime, Vector3D * translations, Quaternion * rotations)
+{
+	ResetToBindPose(translations, rotations);
+
+	for (Layer& layer : _layers)
+	{
+		//a layer with nothing to add is skipped, and its motion doesn't advance until it has weight again
+		if (layer.Current.Source.IsEmpty() || layer.Weight <= 0.0f)
+		{
+			continue;
+		}
+
+		Evaluate(layer.Current, deltaTime, _layerTranslations.data(), _layerRotations.data());
+
+		if (layer.FadeDuration > 0.0f)
+		{
+			layer.FadeTime += deltaTime;
+			if (layer.FadeTime >= layer.FadeDuration)
+			{
+				layer.Previous = Playback();
+				layer.FadeDuration = 0.0f;
+			}
+			else
+			{
+				Evaluate(layer.Previous, deltaTime, _fadeTranslations.data(), _fadeRotations.data());
+				PoseBlending::Blend(_fadeTranslations.data(), _fadeRotations.data(), _layerTranslations.data(), _layerRotations.data(),
+					layer.FadeTime / layer.FadeDuration, nullptr, _jointCount, _layerTranslations.data(), _layerRotations.data());
+			}
+		}
+
+		const float* mask = layer.Mask.empty() ? nullptr : layer.Mask.data();
+
+		if (layer.Mode == Layer_Additive)
+		{
+			PoseBlending::Add(translations, rotations, _layerTranslations.data(), _layerRotations.data(), _bindTranslations.data(),
+				_bindRotations.data(), layer.Weight, mask, _jointCount, translations, rotations);
+		}
+		else if (layer.Weight >= 1.0f && !mask)
+		{
+			//a full weight override replaces everything under it
+			std::copy(_layerTranslations.begin(), _layerTranslations.end(), translations);
+			std::copy(_layerRotations.begin(), _layerRotations.end(), rotations);
+		}
+		else
+		{
+			PoseBlending::Blend(translations, rotations, _layerTranslations.data(), _layerRotations.data(), layer.Weight, mask, _jointCount,
+				translations, rotations);
+		}
+	}
+}
+
+std::vector<float> Animator::CreateMask(const Skeleton & skeleton, UINT joint, float weight)
+{
+	//parents come before their children, so one pass down the arrays finds everything below the joint
+	std::vector<float> mask(skeleton.GetJointCount(), 0.0f);
+	mask[joint] = weight;
+	for (UINT child = joint + 1; child < skeleton.GetJointCount(); child++)
+	{
+		int parent = skeleton.GetParent(child);
+		if (parent >= (int)joint && mask[parent] != 0.0f)
+		{
+			mask[child] = weight;
+		}
+	}
+	return mask;
+}
+
+void Animator::Evaluate(Playback & playback, float deltaTime, Vector3D * translations, Quaternion * rotations)
+{
+	ResetToBindPose(translations, rotations);
+
+	const Motion& motion = playback.Source;
+	motion.ComputeWeights(_weights);
+
+	//the phase is the fraction of a loop played, which keeps the clips of a blend space in step whatever their lengths
+	float length = motion.GetLength(_weights);
+	if (length > 0.0f)
+	{
+		playback.Phase += deltaTime / length;
+		playback.Phase -= floorf(playback.Phase);
+	}
+
+	if (AnimationStream* stream = motion.GetStream())
+	{
+		float time = playback.Phase * length;
+		stream->GetChunk(time).Sample(time, playback.Cursors[0], translations, rotations);
+		return;
+	}
+
+	//each clip is blended in by its share of the weight so far, which leaves every clip with its own weight overall
+	float accumulated = 0.0f;
+	for (size_t sample = 0; sample < _weights.size(); sample++)
+	{
+		if (_weights[sample] <= 0.0f)
+		{
+			continue;
+		}
+
+		const Animation& clip = *motion.GetSamples()[sample].Clip;
+		float time = playback.Phase * clip.GetLength();
+		bool first = accumulated == 0.0f;
+		accumulated += _weights[sample];
+
+		if (first)
+		{
+			clip.Sample(time, playback.Cursors[sample], translations, rotations);
+			continue;
+		}
+
+		ResetToBindPose(_sampleTranslations.data(), _sampleRotations.data());
+		clip.Sample(time, playback.Cursors[sample], _sampleTranslations.data(), _sampleRotations.data());
+		PoseBlending::Blend(translations, rotations, _sampleTranslations.data(), _sampleRotations.data(), _weights[sample] / accumulated, nullptr,
+			_jointCount, translations, rotations);
+	}
+}
+
+void Animator::ResetToBindPose(Vector3D * translations, Quaternion * rotations) const
+{
+	std::copy(_bindTranslations.begin(), _bindTranslations.end(), translations);
+	std::copy(_bindRotations.begin(), _bindRotations.end(), rotations);
+}
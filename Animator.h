@@ -1,9 +1,150 @@
 #pragma once
 
+#include <vector>
+
+#include "Animation.h"
+#include "AnimationStream.h"
+#include "Skeleton.h"
+
+//Kernels that combine whole poses, each pose a translation array and a rotation array with a slot per joint. They
+//work on four joints at a time with SSE and may write over either of their inputs. A mask scales the weight of each
+//joint and can be null to apply the weight everywhere
+namespace PoseBlending
+{
+	//Moves the pose toward the target by weight, rotations taking the shorter way round
+	void Blend(const Vector3D* translations, const Quaternion* rotations, const Vector3D* targetTranslations, const Quaternion* targetRotations,
+		float weight, const float* mask, UINT jointCount, Vector3D* outTranslations, Quaternion* outRotations);
+
+	//Adds weight of how far the additive pose is from the reference pose on top of the pose
+	void Add(const Vector3D* translations, const Quaternion* rotations, const Vector3D* additiveTranslations, const Quaternion* additiveRotations,
+		const Vector3D* referenceTranslations, const Quaternion* referenceRotations, float weight, const float* mask, UINT jointCount,
+		Vector3D* outTranslations, Quaternion* outRotations);
+}
+
+//Something a layer of an Animator plays: one clip, a streamed clip, or a blend space of clips placed along one or
+//two parameters. The clips in a blend space play in step, each at the same fraction of its length
+class Motion
+{
+public:
+	struct Sample
+	{
+		const Animation* Clip;
+		float X;
+		float Y;
+	};
+
+	Motion()
+		:_stream(nullptr), _dimensions(0), _x(0.0f), _y(0.0f) {}
+
+	//A null clip or stream makes an empty motion, which a layer treats as nothing playing
+	explicit Motion(const Animation* clip)
+		:_samples(clip ? 1 : 0, Sample{ clip, 0.0f, 0.0f }), _stream(nullptr), _dimensions(0), _x(0.0f), _y(0.0f) {}
+
+	//The stream has to outlive the motion and can't be played by more than one motion at a time
+	explicit Motion(AnimationStream* stream)
+		:_stream(stream), _dimensions(0), _x(0.0f), _y(0.0f) {}
+
+	//Blends between the two clips either side of the parameter, Y is ignored. Samples without a clip are left out
+	static Motion BlendSpace1D(std::vector<Sample> samples);
+
+	//Weights every clip by how close it is to the parameters, so it doesn't need the clips laid out on a grid. Samples
+	//without a clip are left out
+	static Motion BlendSpace2D(std::vector<Sample> samples);
+
+	bool IsEmpty() const { return _samples.empty() && !_stream; }
+
+	void SetParameters(float x, float y) { _x = x; _y = y; }
+
+	//The weight of each of the clips at the current parameters, summing to one
+	void ComputeWeights(std::vector<float>& weights) const;
+
+	//The length of a loop with the clips weighted as they are now
+	float GetLength(const std::vector<float>& weights) const;
+
+	const std::vector<Sample>& GetSamples() const { return _samples; }
+	AnimationStream* GetStream() const { return _stream; }
+
+private:
+	std::vector<Sample> _samples;
+	AnimationStream* _stream;
+	UINT _dimensions;
+	float _x;
+	float _y;
+};
+
+//Works out a skeleton's local pose each update from layers of motions. Layers are applied in order over the bind
+//pose, each either replacing what is under it or adding to it, by the layer's weight and per joint mask. A layer
+//given a new motion crossfades to it from the one it was playing
 class Animator
 {
 public:
-	Animator();
+	enum LayerMode
+	{
+		Layer_Override,
+		Layer_Additive
+	};
+
+	Animator() {}
+
+	//Starts with one override layer at full weight covering every joint
+	explicit Animator(const Skeleton& skeleton);
+
+	//Additive layers add how far their motion is from the bind pose. An empty mask covers every joint, otherwise it
+	//needs a weight per joint. Returns the new layer's index
+	UINT AddLayer(LayerMode mode, float weight = 1.0f, std::vector<float> mask = std::vector<float>());
+
+	UINT GetLayerCount() const { return (UINT)_layers.size(); }
+
+	void SetLayerWeight(UINT layer, float weight) { _layers[layer].Weight = weight; }
+
+	//Plays the motion from its start, crossfading from whatever the layer was playing over fadeSeconds. With no fade,
+	//or nothing playing before, it cuts straight to it
+	void Play(UINT layer, Motion motion, float fadeSeconds = 0.0f);
+
+	//The blend space parameters of the motion the layer is playing
+	void SetParameters(UINT layer, float x, float y = 0.0f) { _layers[layer].Current.Source.SetParameters(x, y); }
+
+	bool IsPlaying() const;
+
+	//Advances every layer and writes the blended local pose, a slot per joint
+	void Update(float deltaTime, Vector3D* translations, Quaternion* rotations);
+
+	//A mask covering the joint and everything below it with the weight, and nothing else
+	static std::vector<float> CreateMask(const Skeleton& skeleton, UINT joint, float weight = 1.0f);
 
 private:
-};
\ No newline at end of file
+	//a motion and how far through a loop of it playback is
+	struct Playback
+	{
+		Motion Source;
+		float Phase = 0.0f;
+		std::vector<UINT> Cursors; //one per clip, so each keeps its own place
+	};
+
+	struct Layer
+	{
+		LayerMode Mode;
+		float Weight;
+		std::vector<float> Mask;
+		Playback Current;
+		Playback Previous; //faded out over FadeDuration
+		float FadeTime = 0.0f;
+		float FadeDuration = 0.0f;
+	};
+
+	//advances the motion and samples it over the bind pose into the pose arrays
+	void Evaluate(Playback& playback, float deltaTime, Vector3D* translations, Quaternion* rotations);
+
+	void ResetToBindPose(Vector3D* translations, Quaternion* rotations) const;
+
+	UINT _jointCount = 0;
+	std::vector<Vector3D> _bindTranslations;
+	std::vector<Quaternion> _bindRotations;
+
+	std::vector<Layer> _layers;
+
+	//scratch poses, kept so an update allocates nothing
+	std::vector<Vector3D> _layerTranslations, _fadeTranslations, _sampleTranslations;
+	std::vector<Quaternion> _layerRotations, _fadeRotations, _sampleRotations;
+	std::vector<float> _weights;
+};
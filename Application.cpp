@@ -199,11 +199,12 @@ HRESULT Application::Initialise(HINSTANCE hInstance, int nCmdShow)
 	ID3D11ShaderResourceView *_pAOGunTextureRV;
 	ID3D11ShaderResourceView *_pEmissiveGunTextureRV;
 
-	AnimatedModelData modelData = ColladaLoader::LoadModel("Resources/model.dae", 4);
+	ColladaLoader::ColladaScene characterScene = ColladaLoader::Import("Resources/model.dae", 4);
+	ColladaLoader::OutputTimings(L"Resources/model.dae", characterScene.Timings);
 
-	AnimationData animationData = ColladaLoader::LoadAnimation("Resources/model.dae");
+	AnimatedModelData& modelData = characterScene.Model;
 
-	Animation* animation = new Animation(animationData);
+	Animation* animation = characterScene.Clips.empty() ? nullptr : new Animation(characterScene.Clips[0], modelData.joints);
 
 	Mesh SpaceManGeometry(modelData.ToIndexedModel(), _pd3dDevice);
 
@@ -265,7 +266,7 @@ HRESULT Application::Initialise(HINSTANCE hInstance, int nCmdShow)
 
 	Mesh planeGeometry(GeometryGenerator::CreateGrid(250.0f, 250.0f, 100, 100, 15, 15), _pd3dDevice);
 
-	Mesh sphereGeometry(GeometryGenerator::CreateSphere(0.5f, 20, 20), _pd3dDevice);
+	Mesh sphereGeometry(VertexCompression::Compress(GeometryGenerator::CreateSphere(0.5f, 20, 20)), _pd3dDevice);
 
 	Mesh cylinderGeometry(GeometryGenerator::CreateCylinder(0.5f,0.5f,1.0f, 20, 2), _pd3dDevice);
 
@@ -273,7 +274,7 @@ HRESULT Application::Initialise(HINSTANCE hInstance, int nCmdShow)
 
 	//Mesh SpaceManGeometry(OBJLoader::Load("Resources\\SpaceMan.obj", true), _pd3dDevice);
 
-	Mesh GunGeometry(OBJLoader::Load("Resources\\Gun.obj", true), _pd3dDevice);
+	Mesh GunGeometry = OBJLoader::LoadMesh("Resources\\Gun.obj", true, _pd3dDevice);
 
 	Terrain::InitInfo tii;
 	tii.HeightMapFilename = L"Resources\\terrain.raw";
@@ -291,7 +292,8 @@ HRESULT Application::Initialise(HINSTANCE hInstance, int nCmdShow)
 	_terrain.Init(_pd3dDevice, _pImmediateContext, tii, ProceduralLandscape::LoadHeightMap(tii));
 
 
-	_character = new AnimatedModel(modelData, _pDiffuseManTextureRV, _pd3dDevice);
+	_characterIndex = _animationSystem.Add(new AnimatedModel(modelData, _pDiffuseManTextureRV, _pd3dDevice));
+	_character = _animationSystem.GetModel(_characterIndex);
 
 	_character->DoAnimation(animation);
 
@@ -372,6 +374,7 @@ HRESULT Application::Initialise(HINSTANCE hInstance, int nCmdShow)
 		else if (i == 2)
 		{
 			gameObject = new GameObject("Sphere " + std::to_string(i), transform, sphereGeometry, shinyMaterial);
+			gameObject->SetShaderToUse(FX_COMPRESSED);
 		}
 		else if (i == 3)
 		{
@@ -415,6 +418,13 @@ HRESULT Application::InitShadersAndInputLayout()
 	// Compile the normal map pixel shader
     hr = CompileShaderFromFile(L"DX11 Framework.fx", "NormalPS", "ps_5_0", &pPSBlob);
 	hr = _pd3dDevice->CreatePixelShader(pPSBlob->GetBufferPointer(), pPSBlob->GetBufferSize(), nullptr, &_pNormalPixelShader);
+
+	//Compile the compressed vertex shader, it decodes VertexCompression's vertices and then carries on as the normal map one
+	hr = CompileShaderFromFile(L"DX11 Framework.fx", "CompressedNormalVS", "vs_5_0", &pVSBlob);
+	hr = _pd3dDevice->CreateVertexShader(pVSBlob->GetBufferPointer(), pVSBlob->GetBufferSize(), nullptr, &_pCompressedVertexShader);
+
+	hr = _pd3dDevice->CreateInputLayout(VertexCompression::c_InputLayout, ARRAYSIZE(VertexCompression::c_InputLayout), pVSBlob->GetBufferPointer(),
+		pVSBlob->GetBufferSize(), &_pCompressedLayout);
 	
 	//Compile the simple Parralax map vertex shader
 	hr = CompileShaderFromFile(L"DX11 Framework.fx", "SimpleParralaxVS", "vs_5_0", &pVSBlob);
@@ -440,12 +450,18 @@ HRESULT Application::InitShadersAndInputLayout()
 	hr = CompileShaderFromFile(L"ShadowMap.fx", "ShadowMapVS", "vs_5_0", &pVSBlob);
 	hr = _pd3dDevice->CreateVertexShader(pVSBlob->GetBufferPointer(), pVSBlob->GetBufferSize(), nullptr, &_pShadowMapVertexShader);
 
+	hr = _pd3dDevice->CreateInputLayout(DepthStreams::c_DepthInputLayout, ARRAYSIZE(DepthStreams::c_DepthInputLayout), pVSBlob->GetBufferPointer(),
+		pVSBlob->GetBufferSize(), &_pDepthLayout);
+
 	
 
 	//Compile the SSAO Normal Depth vertex shader
 	hr = CompileShaderFromFile(L"SSAONormalDepth.fx", "SSAONormalDepthVS", "vs_5_0", &pVSBlob);
 	hr = _pd3dDevice->CreateVertexShader(pVSBlob->GetBufferPointer(), pVSBlob->GetBufferSize(), nullptr, &_pSSAONormalDepthVertexShader);
 
+	hr = _pd3dDevice->CreateInputLayout(DepthStreams::c_NormalDepthInputLayout, ARRAYSIZE(DepthStreams::c_NormalDepthInputLayout), pVSBlob->GetBufferPointer(),
+		pVSBlob->GetBufferSize(), &_pNormalDepthLayout);
+
 	//Compile the SSAO Normal Depth pixel shader
 	hr = CompileShaderFromFile(L"SSAONormalDepth.fx", "SSAONormalDepthPS", "ps_5_0", &pPSBlob);
 	hr = _pd3dDevice->CreatePixelShader(pPSBlob->GetBufferPointer(), pPSBlob->GetBufferSize(), nullptr, &_pSSAONormalDepthPixelShader);
@@ -467,7 +483,7 @@ HRESULT Application::InitShadersAndInputLayout()
     {
         { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
 		{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		{ "TANGENT", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "TANGENT", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
 		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 }
 	};
 
@@ -498,7 +514,7 @@ HRESULT Application::InitShadersAndInputLayout()
 	D3D11_INPUT_ELEMENT_DESC layoutPostProcess[] =
 	{
 		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 36, D3D11_INPUT_PER_VERTEX_DATA, 0 }
+		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 40, D3D11_INPUT_PER_VERTEX_DATA, 0 }
 	};
 
 	numElements = ARRAYSIZE(layoutPostProcess);
@@ -599,7 +615,7 @@ HRESULT Application::InitShadersAndInputLayout()
 	D3D11_INPUT_ELEMENT_DESC layoutSkinned[] = 
 	{
 		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0},
-		{ "TANGENT", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "TANGENT", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
 		{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
 		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
 		{ "BLENDWEIGHT", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
@@ -821,6 +837,13 @@ HRESULT Application::InitDevice()
 	bd.CPUAccessFlags = 0;
 	hr = _pd3dDevice->CreateBuffer(&bd, nullptr, &_pSkinnedConstantBuffer);
 
+	ZeroMemory(&bd, sizeof(bd));
+	bd.Usage = D3D11_USAGE_DEFAULT;
+	bd.ByteWidth = sizeof(DecodeConstantBuffer);
+	bd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	bd.CPUAccessFlags = 0;
+	hr = _pd3dDevice->CreateBuffer(&bd, nullptr, &_pDecodeConstantBuffer);
+
     if (FAILED(hr))
         return hr;
 
@@ -944,14 +967,19 @@ void Application::Cleanup()
 
     if (_pConstantBuffer) _pConstantBuffer->Release();
 	if (_pTessConstantBuffer) _pTessConstantBuffer->Release();
+	if (_pDecodeConstantBuffer) _pDecodeConstantBuffer->Release();
 
     if (_pVertexLayout) _pVertexLayout->Release();
 	if (_pPostProcessLayout) _pPostProcessLayout->Release();
 	if (_pTerrainLayout) _pTerrainLayout->Release();
 	if (_pSSOALayout) _pSSOALayout->Release();
+	if (_pDepthLayout) _pDepthLayout->Release();
+	if (_pNormalDepthLayout) _pNormalDepthLayout->Release();
+	if (_pCompressedLayout) _pCompressedLayout->Release();
 
     if (_pNormalVertexShader) _pNormalVertexShader->Release();
     if (_pNormalPixelShader) _pNormalPixelShader->Release();
+	if (_pCompressedVertexShader) _pCompressedVertexShader->Release();
 	if (_pParralaxVertexShader) _pParralaxVertexShader->Release();
 	if (_pParralaxPixelShader) _pParralaxPixelShader->Release();
 	if (_pParralaxOcclusionVertexShader) _pParralaxOcclusionVertexShader->Release();
@@ -1007,9 +1035,6 @@ void Application::Cleanup()
 			gameObject = nullptr;
 		}
 	}
-
-	if (_character) delete _character;
-
 }
 
 void Application::moveForward(int objectNumber)
@@ -1091,9 +1116,7 @@ void Application::DrawSceneToShadowMap()
 
 	skinCb.ViewProjection = XMMatrixTranspose(XMMatrixMultiply(view, projection));
 
-	XMMATRIX* boneMatrices = reinterpret_cast<XMMATRIX*>(skinCb.WorldMatrixArray);
-
-	_character->GetJointTransforms(boneMatrices);
+	_animationSystem.CopyPalette(_characterIndex, skinCb.WorldMatrixArray, ARRAYSIZE(skinCb.WorldMatrixArray));
 
 	skinCb.ViewProjection = XMMatrixTranspose(XMMatrixMultiply(view, projection));
 
@@ -1104,7 +1127,7 @@ void Application::DrawSceneToShadowMap()
 	//Render All Other Objects ---------------------------------------------------------
 
 
-	_pImmediateContext->IASetInputLayout(_pVertexLayout);
+	_pImmediateContext->IASetInputLayout(_pDepthLayout);
 
 	_pImmediateContext->VSSetConstantBuffers(0, 1, &_pConstantBuffer);
 	_pImmediateContext->PSSetConstantBuffers(0, 1, &_pConstantBuffer);
@@ -1135,7 +1158,7 @@ void Application::DrawSceneToShadowMap()
 		}
 
 		//Draw Object
-		gameObject->Draw(_pImmediateContext);
+		gameObject->DrawDepth(_pImmediateContext, DepthStreams::Stream_Depth);
 
 	}
 }
@@ -1152,7 +1175,7 @@ void Application::DrawSceneToSSAODepthMap()
 	_pImmediateContext->PSSetShader(_pSSAONormalDepthPixelShader, nullptr, 0);
 	_pImmediateContext->HSSetShader(nullptr, nullptr, 0);
 	_pImmediateContext->DSSetShader(nullptr, nullptr, 0);
-	_pImmediateContext->IASetInputLayout(_pVertexLayout);
+	_pImmediateContext->IASetInputLayout(_pNormalDepthLayout);
 
 	XMMATRIX world;
 
@@ -1179,7 +1202,7 @@ void Application::DrawSceneToSSAODepthMap()
 		}
 	
 		//Draw Object
-		gameObject->Draw(_pImmediateContext);
+		gameObject->DrawDepth(_pImmediateContext, DepthStreams::Stream_NormalDepth);
 	}
 }
 
@@ -1346,12 +1369,16 @@ void Application::Update(float deltaTime)
 	_camera->Update();
 
 	_character->GetTransform()->_position.y = _terrain.GetHeight(_character->GetTransform()->_position.x, _character->GetTransform()->_position.z);
-	_character->Update(deltaTime);
+	_animationSystem.Update(deltaTime);
+
+	//pixels covered by one unit at a distance of one, the objects scale their LOD errors by this to pick a level
+	float pixelsPerUnit = (float)_renderHeight / (2.0f * tanf(_camera->GetFovY() * 0.5f));
 
 	// Update objects
 	for (auto gameObject : _gameObjects)
 	{
 		gameObject->Update(deltaTime);
+		gameObject->SelectLOD(_camera->GetPosition(), pixelsPerUnit);
 	}
 
 	counter+= deltaTime;
@@ -1464,9 +1491,7 @@ void Application::Draw()
 	SkinnedConstantBuffer skinCb;
 	ConstantBuffer cb;
 
-	XMMATRIX* boneMatrices = reinterpret_cast<XMMATRIX*>(skinCb.WorldMatrixArray);
-
-	_character->GetJointTransforms(boneMatrices);
+	_animationSystem.CopyPalette(_characterIndex, skinCb.WorldMatrixArray, ARRAYSIZE(skinCb.WorldMatrixArray));
 
 	skinCb.ViewProjection = XMMatrixTranspose(XMMatrixMultiply(view, projection));
 	skinCb.ShadowTransform = XMMatrixTranspose(shadowTransform);
@@ -1551,6 +1576,28 @@ void Application::Draw()
 			_pImmediateContext->PSSetShaderResources(1, 1, &textureRV);
 			cb.HasTexture = 1.0f;
 			break;
+		case FX_COMPRESSED:
+		{
+			const Mesh& geometry = gameObject->GetGeometryData();
+			DecodeConstantBuffer decodeCB;
+			decodeCB.DecodeScale = geometry._decodeScale;
+			decodeCB.DecodeOffset = geometry._decodeOffset;
+			_pImmediateContext->UpdateSubresource(_pDecodeConstantBuffer, 0, nullptr, &decodeCB, 0, 0);
+			_pImmediateContext->VSSetConstantBuffers(2, 1, &_pDecodeConstantBuffer);
+
+			_pImmediateContext->IASetInputLayout(_pCompressedLayout);
+			_pImmediateContext->VSSetShader(_pCompressedVertexShader, nullptr, 0);
+			_pImmediateContext->PSSetShader(_pNormalPixelShader, nullptr, 0);
+			_pImmediateContext->HSSetShader(nullptr, nullptr, 0);
+			_pImmediateContext->DSSetShader(nullptr, nullptr, 0);
+
+			textureRV = gameObject->GetTextureRV(TX_DIFFUSE);
+			_pImmediateContext->PSSetShaderResources(0, 1, &textureRV);
+			textureRV = gameObject->GetTextureRV(TX_NORMAL);
+			_pImmediateContext->PSSetShaderResources(1, 1, &textureRV);
+			cb.HasTexture = 1.0f;
+			break;
+		}
 		case FX_PARRALAXED:
 			cb.HeightMapScale = heightMapScale;
 			_pImmediateContext->VSSetShader(_pParralaxVertexShader, nullptr, 0);
@@ -1628,6 +1675,7 @@ void Application::Draw()
 		gameObject->Draw(_pImmediateContext);
 		_pImmediateContext->RSSetState(ViewMode());
 		_pImmediateContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+		_pImmediateContext->IASetInputLayout(_pVertexLayout);
 	}
 
 	
@@ -1664,7 +1712,7 @@ void Application::Draw()
 	//_pImmediateContext->UpdateSubresource(_pConstantBuffer, 0, nullptr, &PostProcess::Bloom(true, 150.0f, 2.0f, _renderHeight, _renderWidth), 0, 0);
 	
 	_pImmediateContext->IASetVertexBuffers(0, 1, &_fullscreenQuad->_vertexBuffer, &_fullscreenQuad->_vertexBufferStride, &_fullscreenQuad->_vertexBufferOffset);
-	_pImmediateContext->IASetIndexBuffer(_fullscreenQuad->_indexBuffer, DXGI_FORMAT_R16_UINT, 0);
+	_pImmediateContext->IASetIndexBuffer(_fullscreenQuad->_indexBuffer, _fullscreenQuad->_indexFormat, 0);
 	
 	_pImmediateContext->DrawIndexed(_fullscreenQuad->_numberOfIndices, 0, 0);
 	
@@ -11,6 +11,7 @@
 #include "Commons.h"
 #include "Terrain.h"
 #include "AnimatedModel.h"
+#include "AnimationSystem.h"
 
 #include <vector>
 /*
@@ -47,6 +48,7 @@ private:
 	ID3D11RenderTargetView* _pRenderTargetView;
 	ID3D11VertexShader*     _pNormalVertexShader;
 	ID3D11PixelShader*      _pNormalPixelShader;
+	ID3D11VertexShader*     _pCompressedVertexShader = nullptr;
 	ID3D11VertexShader*     _pParralaxVertexShader;
 	ID3D11PixelShader*      _pParralaxPixelShader;
 	ID3D11VertexShader*     _pParralaxOcclusionVertexShader;
@@ -86,12 +88,16 @@ private:
 	ID3D11InputLayout*		_pSSOALayout;
 	ID3D11InputLayout*		_pTerrainLayout;
 	ID3D11InputLayout*		_pSkinnedLayout;
+	ID3D11InputLayout*		_pDepthLayout = nullptr;
+	ID3D11InputLayout*		_pNormalDepthLayout = nullptr;
+	ID3D11InputLayout*		_pCompressedLayout = nullptr;
 
 	Mesh*					_fullscreenQuad;
 
 	ID3D11Buffer*           _pConstantBuffer;
 	ID3D11Buffer*			_pTessConstantBuffer;
 	ID3D11Buffer*			_pSkinnedConstantBuffer;
+	ID3D11Buffer*			_pDecodeConstantBuffer = nullptr;
 
 	ID3D11DepthStencilView*		_depthStencilView = nullptr;
 	ID3D11Texture2D*			_depthStencilBuffer = nullptr;
@@ -122,7 +128,10 @@ private:
 
 	Terrain _terrain;
 
+	//Owns the character, which is updated and has its palette built along with any other animated models
+	AnimationSystem _animationSystem;
 	AnimatedModel* _character;
+	UINT _characterIndex;
 
 	vector<GameObject *> _gameObjects;
 
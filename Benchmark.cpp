@@ -0,0 +1,1011 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstdarg>
+#include <fstream>
+#include <random>
+
+#include <psapi.h>
+
+#include "Commons.h"
+#include "JointTransform.h"
+#include "Animation.h"
+#include "AnimationStream.h"
+#include "AnimationSystem.h"
+#include "Animator.h"
+#include "ColladaLoader.h"
+#include "DepthStreams.h"
+#include "MappedFile.h"
+#include "ObJLoader.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "Meshlets.h"
+#include "MorphTargets.h"
+#include "Parallel.h"
+#include "VertexCompression.h"
+#include "TinyXML2.h"
+
+#pragma comment(lib, "psapi.lib")
+
+namespace
+{
+	typedef std::chrono::high_resolution_clock Clock;
+
+	double MillisecondsSince(Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	//runs the function the given number of times and returns the fastest time, the minimum is the least noisy measure
+	template<typename Function>
+	double BestOf(int runs, Function function)
+	{
+		double best = 0.0;
+		for (int i = 0; i < runs; i++)
+		{
+			Clock::time_point start = Clock::now();
+			function();
+			double time = MillisecondsSince(start);
+			if (i == 0 || time < best)
+				best = time;
+		}
+		return best;
+	}
+
+	std::ofstream s_log;
+
+	//the working set and the private bytes committed by the process, in kilobytes
+	void GetMemoryUsage(double& workingSet, double& privateBytes)
+	{
+		PROCESS_MEMORY_COUNTERS_EX counters = {};
+		GetProcessMemoryInfo(GetCurrentProcess(), (PROCESS_MEMORY_COUNTERS*)&counters, sizeof(counters));
+
+		workingSet = counters.WorkingSetSize / 1024.0;
+		privateBytes = counters.PrivateUsage / 1024.0;
+	}
+
+	//the mapping only ends in a zero when the file doesn't fill its last page, otherwise the parser needs its own copy
+	tinyxml2::XMLError ParseMapped(tinyxml2::XMLDocument& document, const MappedFile& source)
+	{
+		return source.IsNullTerminated() ? document.ParseInSitu(source.GetData(), source.GetSize()) : document.Parse(source.GetData(), source.GetSize());
+	}
+}
+
+void Benchmark::RunAll()
+{
+	s_log.open("Benchmark.log", std::ios::out | std::ios::trunc);
+
+	const char* objFiles[] = { "Resources\\Ball.obj", "Resources\\Gun.obj", "Resources\\Car.obj", "Resources\\SpaceMan.obj" };
+	for (const char* filename : objFiles)
+	{
+		OBJParsing(filename);
+		MeshCacheLoading(filename);
+		VertexCacheOptimization(filename);
+		CompressedVertices(filename);
+		LODChain(filename);
+		DepthOnlyStreams(filename);
+		MeshletCulling(filename);
+	}
+
+	const char* colladaFiles[] = { "Resources\\model.dae", "Resources\\maeanimation.dae" };
+	for (const char* filename : colladaFiles)
+	{
+		ColladaImport(filename);
+	}
+	MorphTargetBlending("Resources\\maeanimation.dae");
+	AnimationStreaming("Resources\\model.dae", 60.0f);
+	KeyframeLookup(10000);
+	AnimationScaling("Resources\\model.dae");
+	LayeredBlending(128);
+
+	const char* xmlFiles[] = { "Resources\\Man.DAE", "Resources\\maeanimation.dae" };
+	for (const char* filename : xmlFiles)
+	{
+		XMLLoading(filename);
+	}
+	XMLBatchLoading(xmlFiles, sizeof(xmlFiles) / sizeof(xmlFiles[0]), 16);
+
+	s_log.close();
+}
+
+void Benchmark::OBJParsing(const char * filename)
+{
+	OBJLoader::OBJData data;
+	if (!OBJLoader::ParseMapped(filename, true, data))
+	{
+		Report("OBJ parsing: %s not found, skipped\n", filename);
+		return;
+	}
+
+	double streamTime = BestOf(3, [&]() { OBJLoader::OBJData streamData; OBJLoader::ParseStream(filename, true, streamData); });
+	double mappedTime = BestOf(3, [&]() { OBJLoader::OBJData mappedData; OBJLoader::ParseMapped(filename, true, mappedData); });
+
+	Report("OBJ parsing: %s, %u positions, %u triangles, stream %.2f ms, mapped %.2f ms (%.1fx)\n",
+		filename, (unsigned int)data.Positions.size(), (unsigned int)data.PositionIndices.size() / 3,
+		streamTime, mappedTime, mappedTime > 0.0 ? streamTime / mappedTime : 0.0);
+}
+
+void Benchmark::MeshCacheLoading(const char * filename)
+{
+	//the first load cooks the file if it is missing or stale so the timed runs all hit the cache
+	IndexedModel model = OBJLoader::Load(filename, true);
+	if (model.Vertices.empty())
+	{
+		Report("Mesh cache: %s not found, skipped\n", filename);
+		return;
+	}
+
+	double validateTime = BestOf(3, [&]() { MeshCache::CookedMesh cookedMesh; IndexedModel unused; OBJLoader::LoadCooked(filename, true, 0.0f, cookedMesh, unused); });
+	double readTime = BestOf(3, [&]() { IndexedModel cachedModel = OBJLoader::Load(filename, true); });
+
+	Report("Mesh cache: %s, %u vertices, %u indices, hash and validate %.2f ms, read into vectors %.2f ms\n",
+		filename, (unsigned int)model.Vertices.size(), (unsigned int)model.Indices.size(), validateTime, readTime);
+}
+
+void Benchmark::VertexCacheOptimization(const char * filename)
+{
+	MeshCache::CookedMesh cookedMesh;
+	IndexedModel model;
+	if (!OBJLoader::LoadCooked(filename, true, 0.0f, cookedMesh, model) || !cookedMesh.ReadModel(model.Vertices, model.Indices))
+	{
+		Report("Vertex cache: %s has no cooked file, skipped\n", filename);
+		return;
+	}
+
+	const MeshCache::Section* section = cookedMesh.FindSection(MeshCache::Section_OptimizeStatistics);
+	if (!section || section->ElementStride != sizeof(MeshOptimizer::OptimizeStatistics))
+	{
+		Report("Vertex cache: %s has no optimize statistics, skipped\n", filename);
+		return;
+	}
+
+	MeshOptimizer::OptimizeStatistics statistics = *(const MeshOptimizer::OptimizeStatistics*)cookedMesh.GetSectionData(*section);
+
+	//the cooked model is already optimized, running it again still walks every triangle so the timing is representative
+	double optimizeTime = BestOf(3, [&]() { IndexedModel copy = model; MeshOptimizer::Optimize(copy); });
+
+	Report("Vertex cache: %s, %u triangles, ACMR %.3f -> %.3f, ATVR %.3f -> %.3f, optimize %.2f ms\n",
+		filename, statistics.After.TriangleCount, statistics.Before.ACMR(), statistics.After.ACMR(),
+		statistics.Before.ATVR(), statistics.After.ATVR(), optimizeTime);
+}
+
+void Benchmark::CompressedVertices(const char * filename)
+{
+	IndexedModel model = OBJLoader::Load(filename, true);
+	if (model.Vertices.empty())
+	{
+		Report("Vertex compression: %s not found, skipped\n", filename);
+		return;
+	}
+
+	VertexCompression::CompressedModel compressed;
+	double compressTime = BestOf(3, [&]() { compressed = VertexCompression::Compress(model); });
+
+	VertexCompression::CompressionError error = VertexCompression::MeasureError(model, compressed);
+	bool withinBounds = VertexCompression::IsWithinErrorBounds(model, compressed, error);
+
+	//shadow, SSAO normal depth and the main pass all fetch every vertex
+	const unsigned int passes = 3;
+	unsigned int fullBytes = model.Vertices.size() * sizeof(SimpleVertex) * passes;
+	unsigned int compressedBytes = compressed.Vertices.size() * sizeof(VertexCompression::CompressedVertex) * passes;
+
+	Report("Vertex compression: %s, %u vertices, %u -> %u bytes per frame (%.2fx), compress %.2f ms, "
+		"max error position %g normal %.4f deg tangent %.4f deg uv %g, %s\n",
+		filename, (unsigned int)model.Vertices.size(), fullBytes, compressedBytes, (double)fullBytes / compressedBytes, compressTime,
+		error.Position, error.NormalDegrees, error.TangentDegrees, error.Tex, withinBounds ? "within bounds" : "OUT OF BOUNDS");
+}
+
+void Benchmark::LODChain(const char * filename)
+{
+	MeshCache::CookedMesh cookedMesh;
+	IndexedModel model;
+	if (!OBJLoader::LoadCooked(filename, true, 0.0f, cookedMesh, model) || !cookedMesh.ReadModel(model.Vertices, model.Indices))
+	{
+		Report("LOD chain: %s has no cooked file, skipped\n", filename);
+		return;
+	}
+
+	std::vector<UINT> lodIndices;
+	std::vector<MeshLOD> lods;
+	double buildTime = BestOf(3, [&]() { MeshSimplifier::GenerateLODChain(model.Vertices, model.Indices, lodIndices, lods); });
+
+	Report("LOD chain: %s, %u levels, built in %.2f ms\n", filename, cookedMesh.GetLODCount(), buildTime);
+
+	//1080 lines with the 45 degree vertical field of view the camera uses
+	const float pixelsPerUnit = 1080.0f / (2.0f * tanf(XM_PI * 0.125f));
+
+	for (UINT level = 0; level < cookedMesh.GetLODCount(); level++)
+	{
+		MeshLOD lod = cookedMesh.GetLOD(level);
+
+		//the distance at which this level's error shrinks to a pixel
+		Report("  LOD %u: %u triangles (%.1f%%), error %g, used from %.1f units\n", level, lod.IndexCount / 3,
+			100.0 * lod.IndexCount / cookedMesh.GetLOD(0).IndexCount, lod.Error, lod.Error * pixelsPerUnit);
+	}
+}
+
+void Benchmark::DepthOnlyStreams(const char * filename)
+{
+	MeshCache::CookedMesh cookedMesh;
+	IndexedModel model;
+	if (!OBJLoader::LoadCooked(filename, true, 0.0f, cookedMesh, model) || !cookedMesh.ReadModel(model.Vertices, model.Indices))
+	{
+		Report("Depth streams: %s has no cooked file, skipped\n", filename);
+		return;
+	}
+
+	DepthStreams::DepthModel depth;
+	DepthStreams::NormalDepthModel normalDepth;
+	double buildTime = BestOf(3, [&]() { DepthStreams::Build(model, depth, normalDepth); });
+
+	DepthStreams::DepthStreamStatistics statistics = DepthStreams::Measure(model, depth, normalDepth);
+
+	Report("Depth streams: %s, built in %.2f ms\n", filename, buildTime);
+
+	const char* passNames[DepthStreams::Stream_Count] = { "shadow", "SSAO normal depth" };
+	for (int pass = 0; pass < DepthStreams::Stream_Count; pass++)
+	{
+		const DepthStreams::PassStatistics& passStatistics = statistics.Passes[pass];
+
+		Report("  %s pass: %u of %u vertices, %u of %u vertex bytes, %u byte indices instead of %u, fetches %u bytes per draw instead of %u\n",
+			passNames[pass], passStatistics.VertexCount, statistics.Full.VertexCount,
+			(unsigned int)passStatistics.VertexBytes(), (unsigned int)statistics.Full.VertexBytes(),
+			passStatistics.IndexSize, statistics.Full.IndexSize,
+			(unsigned int)passStatistics.FetchedBytes(), (unsigned int)statistics.Full.FetchedBytes());
+	}
+}
+
+void Benchmark::MeshletCulling(const char * filename)
+{
+	MeshCache::CookedMesh cookedMesh;
+	IndexedModel model;
+	if (!OBJLoader::LoadCooked(filename, true, 0.0f, cookedMesh, model) || !cookedMesh.ReadModel(model.Vertices, model.Indices))
+	{
+		Report("Meshlets: %s has no cooked file, skipped\n", filename);
+		return;
+	}
+
+	Meshlets::MeshletModel meshlets;
+	double buildTime = BestOf(3, [&]() { Meshlets::Build(model.Vertices, model.Indices, meshlets); });
+
+	UINT triangleCount = model.Indices.size() / 3;
+	UINT meshletCount = meshlets.Meshlets.size();
+	UINT vertexTotal = 0;
+	for (const Meshlets::Meshlet& meshlet : meshlets.Meshlets)
+	{
+		vertexTotal += meshlet.VertexCount;
+	}
+
+	Report("Meshlets: %s, %u triangles in %u meshlets, %.1f vertices and %.1f triangles each, built in %.2f ms\n", filename,
+		triangleCount, meshletCount, (double)vertexTotal / meshletCount, (double)triangleCount / meshletCount, buildTime);
+
+	XMVECTOR minimum = XMVectorReplicate(FLT_MAX);
+	XMVECTOR maximum = XMVectorReplicate(-FLT_MAX);
+	for (const SimpleVertex& vertex : model.Vertices)
+	{
+		minimum = XMVectorMin(minimum, XMLoadFloat3(&vertex.PosL));
+		maximum = XMVectorMax(maximum, XMLoadFloat3(&vertex.PosL));
+	}
+
+	XMVECTOR center = (minimum + maximum) * 0.5f;
+	float radius = XMVectorGetX(XMVector3Length(maximum - minimum)) * 0.5f;
+	XMVECTOR up = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+
+	std::vector<UINT> culledIndices;
+	XMMATRIX world = XMMatrixIdentity();
+
+	//the main camera circles the mesh close enough that part of it is off screen, with the application's projection
+	const int mainViews = 8;
+	XMMATRIX projection = XMMatrixPerspectiveFovLH(XM_PI * 0.25f, 1920.0f / 1080.0f, 0.01f, radius * 10.0f);
+
+	Meshlets::CullStatistics mainTotal;
+	double mainTime = 0.0;
+
+	for (int i = 0; i < mainViews; i++)
+	{
+		float angle = XM_2PI * i / mainViews;
+		XMVECTOR eye = center + XMVectorSet(cosf(angle), 0.25f, sinf(angle), 0.0f) * (radius * 1.5f);
+
+		Meshlets::CullView view = Meshlets::MakeCullView(world, XMMatrixLookAtLH(eye, center, up), projection, false);
+
+		Meshlets::CullStatistics statistics;
+		mainTime += BestOf(3, [&]() { statistics = Meshlets::Cull(meshlets, view, culledIndices); });
+
+		mainTotal.FrustumCulled += statistics.FrustumCulled;
+		mainTotal.ConeCulled += statistics.ConeCulled;
+		mainTotal.Triangles += statistics.Triangles;
+		mainTotal.TrianglesEmitted += statistics.TrianglesEmitted;
+	}
+
+	Report("  Main view: %.1f%% of triangles culled, %.1f%% of meshlets by the frustum and %.1f%% by their cones, %.3f ms per view\n",
+		100.0 - 100.0 * mainTotal.TrianglesEmitted / mainTotal.Triangles, 100.0 * mainTotal.FrustumCulled / (meshletCount * mainViews),
+		100.0 * mainTotal.ConeCulled / (meshletCount * mainViews), mainTime / mainViews);
+
+	//the shadow map looks down the application's light direction with an orthographic projection fitted around the mesh
+	XMVECTOR lightDirection = XMVector3Normalize(XMVectorSet(10.0f, 10.0f, -10.0f, 0.0f));
+	XMMATRIX shadowView = XMMatrixLookAtLH(center + lightDirection * (radius * 2.0f), center, up);
+	XMMATRIX shadowProjection = XMMatrixOrthographicLH(radius * 2.0f, radius * 2.0f, 0.0f, radius * 4.0f);
+
+	Meshlets::CullView view = Meshlets::MakeCullView(world, shadowView, shadowProjection, true);
+
+	Meshlets::CullStatistics shadow;
+	double shadowTime = BestOf(3, [&]() { shadow = Meshlets::Cull(meshlets, view, culledIndices); });
+
+	Report("  Shadow view: %.1f%% of triangles culled, %.1f%% of meshlets by the frustum and %.1f%% by their cones, %.3f ms\n",
+		100.0 - 100.0 * shadow.TrianglesEmitted / shadow.Triangles, 100.0 * shadow.FrustumCulled / meshletCount,
+		100.0 * shadow.ConeCulled / meshletCount, shadowTime);
+}
+
+void Benchmark::ColladaImport(const char * filename)
+{
+	//the first import cooks the file if it is missing or stale so the cached runs all hit it
+	ColladaLoader::ColladaScene scene = ColladaLoader::Import(filename, 4);
+	MappedFile source;
+	if (!scene.Loaded || !source.Open(filename))
+	{
+		Report("Collada import: %s not found or has no skin, skipped\n", filename);
+		return;
+	}
+
+	//keeps the phases of the fastest run together rather than mixing the best of each
+	ColladaLoader::ImportTimings parsed;
+	ColladaLoader::ImportTimings cooked;
+	for (int i = 0; i < 3; i++)
+	{
+		ColladaLoader::ImportTimings timings = ColladaLoader::Parse(source.GetData(), source.GetSize(), 4).Timings;
+		if (i == 0 || timings.Total < parsed.Total)
+			parsed = timings;
+
+		timings = ColladaLoader::Import(filename, 4).Timings;
+		if (i == 0 || timings.Total < cooked.Total)
+			cooked = timings;
+	}
+
+	size_t keyframes = 0;
+	for (const AnimationData& clip : scene.Clips)
+	{
+		keyframes += clip.keyframes.size();
+	}
+
+	Report("Collada import: %s, %d joints, %u vertices, %u clips with %u keyframes, parsed %.2f ms, cooked %.2f ms (%.1fx)\n",
+		filename, scene.Model.joints.jointCount, (unsigned int)scene.Model.meshData.Vertices.size(),
+		(unsigned int)scene.Clips.size(), (unsigned int)keyframes, parsed.Total, cooked.Total,
+		cooked.Total > 0.0 ? parsed.Total / cooked.Total : 0.0);
+	Report("  parse %.2f ms, skin %.2f ms, skeleton %.2f ms, geometry %.2f ms, optimize %.2f ms, animations %.2f ms\n",
+		parsed.Parse, parsed.Skin, parsed.Skeleton, parsed.Geometry, parsed.Optimize, parsed.Animations);
+	Report("  hash and validate the cooked file %.2f ms, read into the loader's types %.2f ms\n", cooked.Cache, cooked.Read);
+}
+
+void Benchmark::MorphTargetBlending(const char * filename)
+{
+	ColladaLoader::ColladaScene scene = ColladaLoader::Import(filename, 4);
+	if (!scene.Loaded)
+	{
+		Report("Morph targets: %s not found or has no skin, skipped\n", filename);
+		return;
+	}
+
+	const std::vector<SkeletalVertex>& vertices = scene.Model.meshData.Vertices;
+	const int updates = 100;
+
+	//alternates between two sets of weights so every update has something to blend
+	auto timeUpdates = [&](MorphTargets::Blender& blender, const std::vector<float>& weights, const std::vector<float>& otherWeights)
+	{
+		return BestOf(3, [&]()
+		{
+			for (int i = 0; i < updates; i++)
+			{
+				blender.Apply(i % 2 ? otherWeights.data() : weights.data());
+			}
+		}) / updates;
+	};
+
+	size_t deltaCount = 0;
+	for (const MorphTargetData& target : scene.Model.morphTargets)
+	{
+		deltaCount += target.vertices.size();
+	}
+
+	if (!scene.Model.morphTargets.empty())
+	{
+		MorphTargets::Blender blender(vertices, scene.Model.morphTargets);
+		std::vector<float> weights(blender.GetTargetCount(), 0.5f), otherWeights(blender.GetTargetCount(), 0.25f);
+
+		Report("Morph targets: %s, %u targets moving %u of %u vertices, every target on %.4f ms per update\n", filename,
+			(unsigned int)blender.GetTargetCount(), (unsigned int)deltaCount, (unsigned int)vertices.size(), timeUpdates(blender, weights, otherWeights));
+	}
+
+	//synthetic targets over the same vertices show how the cost follows the target count and how much each covers.
+	//Half the weights are zero and are skipped. The baseline copies every vertex and applies every target, zero or not
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> offset(-0.01f, 0.01f);
+
+	const int targetCounts[] = { 4, 16, 64 };
+	const float coverages[] = { 0.01f, 0.1f, 0.5f };
+
+	for (int targetCount : targetCounts)
+	{
+		for (float coverage : coverages)
+		{
+			std::vector<MorphTargetData> targets(targetCount);
+			for (MorphTargetData& target : targets)
+			{
+				for (UINT vertex = 0; vertex < (UINT)vertices.size(); vertex++)
+				{
+					if (random() % 1000 < (unsigned int)(coverage * 1000.0f))
+					{
+						MorphDelta delta = { XMFLOAT4(offset(random), offset(random), offset(random), 0.0f), XMFLOAT4(offset(random), offset(random), offset(random), 0.0f) };
+						target.vertices.push_back(vertex);
+						target.deltas.push_back(delta);
+					}
+				}
+			}
+
+			std::vector<float> weights(targetCount), otherWeights(targetCount);
+			for (int i = 0; i < targetCount; i++)
+			{
+				weights[i] = i % 2 ? 0.0f : 0.5f;
+				otherWeights[i] = i % 2 ? 0.0f : 0.75f;
+			}
+
+			MorphTargets::Blender blender(vertices, targets);
+			double sparseTime = timeUpdates(blender, weights, otherWeights);
+			size_t touched = blender.GetVerticesTouched();
+
+			std::vector<SkeletalVertex> dense;
+			double denseTime = BestOf(3, [&]()
+			{
+				for (int i = 0; i < updates; i++)
+				{
+					dense = vertices;
+					for (int target = 0; target < targetCount; target++)
+					{
+						float weight = i % 2 ? otherWeights[target] : weights[target];
+						for (size_t delta = 0; delta < targets[target].vertices.size(); delta++)
+						{
+							SkeletalVertex& vertex = dense[targets[target].vertices[delta]];
+							vertex.PosL.x += weight * targets[target].deltas[delta].position.x;
+							vertex.PosL.y += weight * targets[target].deltas[delta].position.y;
+							vertex.PosL.z += weight * targets[target].deltas[delta].position.z;
+							vertex.NormL.x += weight * targets[target].deltas[delta].normal.x;
+							vertex.NormL.y += weight * targets[target].deltas[delta].normal.y;
+							vertex.NormL.z += weight * targets[target].deltas[delta].normal.z;
+						}
+					}
+				}
+			}) / updates;
+
+			Report("  %d targets covering %.0f%% of the vertices, %u vertex updates, %.4f ms per update, copying everything %.4f ms (%.1fx)\n",
+				targetCount, coverage * 100.0f, (unsigned int)touched, sparseTime, denseTime, sparseTime > 0.0 ? denseTime / sparseTime : 0.0);
+		}
+	}
+}
+
+void Benchmark::AnimationStreaming(const char * filename, float lengthSeconds)
+{
+	ColladaLoader::ColladaScene scene = ColladaLoader::Import(filename, 4);
+	if (!scene.Loaded || scene.Clips.empty() || scene.Clips[0].keyframes.size() < 2)
+	{
+		Report("Animation streaming: %s not found or has no clip, skipped\n", filename);
+		return;
+	}
+
+	//the file's first clip looped end to end until it is as long as a mocap take
+	const AnimationData& source = scene.Clips[0];
+	std::vector<AnimationData> clips(1);
+	AnimationData& clip = clips[0];
+
+	for (float offset = 0.0f; offset < lengthSeconds; offset += source.lengthSeconds)
+	{
+		for (const KeyFrameData& keyframe : source.keyframes)
+		{
+			if (clip.keyframes.empty() || keyframe.time + offset > clip.keyframes.back().time)
+			{
+				clip.keyframes.push_back(keyframe);
+				clip.keyframes.back().time += offset;
+			}
+		}
+	}
+	clip.lengthSeconds = clip.keyframes.back().time;
+
+	std::string cookedFilename = std::string(filename) + ".streamCooked";
+	MeshCache::Writer writer;
+	MeshCache::CookedMesh cookedMesh;
+	AnimationCache::CookedAnimatedModel view;
+
+	if (!writer.AddModel(scene.Model.meshData.Vertices, scene.Model.meshData.Indices) || !AnimationCache::AddAnimatedModel(writer, scene.Model.joints, clips) ||
+		!writer.Write(cookedFilename.c_str(), 0) || !cookedMesh.Open(cookedFilename.c_str(), 0) || !AnimationCache::GetAnimatedModel(cookedMesh, view))
+	{
+		Report("Animation streaming: couldn't cook %s, skipped\n", cookedFilename.c_str());
+		return;
+	}
+
+	//plays the clip at 60 frames a second, sleeping a millisecond a frame to stand in for the rest of the frame's work
+	//so the worker gets the time it would have in the application. The time reported is just sampling the pose
+	const float frameSeconds = 1.0f / 60.0f;
+	std::vector<Vector3D> translations(view.Skeleton->JointCount);
+	std::vector<Quaternion> rotations(view.Skeleton->JointCount);
+
+	auto play = [&](auto sample, double& averageTime, double& worstTime)
+	{
+		averageTime = worstTime = 0.0;
+		int frames = 0;
+		for (float time = 0.0f; time <= clip.lengthSeconds; time += frameSeconds, frames++)
+		{
+			Clock::time_point start = Clock::now();
+			sample(time);
+			double frameTime = MillisecondsSince(start);
+
+			averageTime += frameTime;
+			worstTime = std::max(worstTime, frameTime);
+			Sleep(1);
+		}
+		averageTime /= frames;
+	};
+
+	double workingSetBefore, privateBefore, workingSetAfter, privateAfter;
+	double fullPrivate, streamPrivate, fullAverage, fullWorst, streamAverage, streamWorst;
+	double fullTime, streamTime;
+	UINT stalls;
+	{
+		GetMemoryUsage(workingSetBefore, privateBefore);
+		Clock::time_point start = Clock::now();
+		Animation animation(AnimationCache::ReadClips(view)[0], scene.Model.joints);
+		fullTime = MillisecondsSince(start);
+		GetMemoryUsage(workingSetAfter, privateAfter);
+		fullPrivate = privateAfter - privateBefore;
+
+		play([&](float time) { animation.Sample(time, translations.data(), rotations.data()); }, fullAverage, fullWorst);
+	}
+	{
+		GetMemoryUsage(workingSetBefore, privateBefore);
+		Clock::time_point start = Clock::now();
+		AnimationStream stream(view, 0);
+		streamTime = MillisecondsSince(start);
+		GetMemoryUsage(workingSetAfter, privateAfter);
+		streamPrivate = privateAfter - privateBefore;
+
+		play([&](float time) { stream.GetChunk(time).Sample(time, translations.data(), rotations.data()); }, streamAverage, streamWorst);
+		stalls = stream.GetStalls();
+	}
+
+	cookedMesh.Close();
+	DeleteFileA(cookedFilename.c_str());
+
+	Report("Animation streaming: %s looped to %u s, %u keyframes of %u joints in %u chunks of %u s\n", filename, (unsigned int)clip.lengthSeconds,
+		(unsigned int)clip.keyframes.size(), view.Clips[0].TrackCount, view.Clips[0].ChunkCount, (unsigned int)AnimationCache::c_ChunkSeconds);
+	Report("  whole clip decoded in %.2f ms holding %.0f KB private, frames %.4f ms worst %.4f ms\n", fullTime, fullPrivate, fullAverage, fullWorst);
+	Report("  streamed ready in %.2f ms holding %.0f KB private, frames %.4f ms worst %.4f ms, %u stalls\n", streamTime, streamPrivate, streamAverage, streamWorst, stalls);
+}
+
+void Benchmark::KeyframeLookup(int keyframeCount)
+{
+	//a chain of joints each turning about z, keyed at uneven intervals averaging 30 a second like a trimmed mocap take
+	const int jointCount = 16;
+	std::vector<JointData*> joints;
+	for (int i = 0; i < jointCount; i++)
+	{
+		XMFLOAT4X4 bindLocalTransform;
+		XMStoreFloat4x4(&bindLocalTransform, XMMatrixIdentity());
+		joints.push_back(new JointData(i, "joint" + std::to_string(i), bindLocalTransform));
+		if (i > 0)
+		{
+			joints[i - 1]->AddChild(joints[i]);
+		}
+	}
+	SkeletonData skeleton(jointCount, *joints[0]);
+
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> interval(0.5f / 30.0f, 1.5f / 30.0f), angle(-XM_PI, XM_PI);
+
+	AnimationData data;
+	float time = 0.0f;
+	for (int keyframe = 0; keyframe < keyframeCount; keyframe++, time += interval(random))
+	{
+		KeyFrameData keyframeData;
+		keyframeData.time = time;
+		for (int joint = 0; joint < jointCount; joint++)
+		{
+			XMFLOAT4X4 localTransform;
+			XMStoreFloat4x4(&localTransform, XMMatrixTranspose(XMMatrixRotationZ(angle(random)) * XMMatrixTranslation(0.0f, 1.0f, 0.0f)));
+			keyframeData.jointTransforms.emplace(joints[joint]->nameID, localTransform);
+		}
+		data.keyframes.push_back(keyframeData);
+	}
+	data.lengthSeconds = data.keyframes.back().time;
+
+	Animation uneven(data, skeleton);
+	Animation even(AnimationCache::ResampleClip(data, skeleton, 30.0f), skeleton);
+
+	//the skeleton holds a copy of the root, so every joint here can go once the clips are built
+	for (JointData* joint : joints)
+	{
+		delete joint;
+	}
+
+	//one playthrough at 60 frames a second, and the same number of random seeks
+	std::vector<float> playback, seeks;
+	for (float frameTime = 0.0f; frameTime < data.lengthSeconds; frameTime += 1.0f / 60.0f)
+	{
+		playback.push_back(frameTime);
+	}
+	std::uniform_real_distribution<float> seek(0.0f, data.lengthSeconds);
+	for (size_t i = 0; i < playback.size(); i++)
+	{
+		seeks.push_back(seek(random));
+	}
+
+	UINT checksum = 0;
+	auto nanosecondsPerLookup = [&](const std::vector<float>& times, auto lookup)
+	{
+		return BestOf(3, [&]()
+		{
+			for (float lookupTime : times)
+			{
+				checksum += lookup(lookupTime);
+			}
+		}) * 1e6 / times.size();
+	};
+
+	//how AnimatedModel found its keyframes before, scanning from the start every update
+	auto linearScan = [&](float lookupTime)
+	{
+		const std::vector<float>& times = uneven.GetTimes();
+		UINT keyframe = 0;
+		while (keyframe + 1 < times.size() && times[keyframe + 1] <= lookupTime)
+		{
+			keyframe++;
+		}
+		return keyframe;
+	};
+
+	UINT cursor = 0;
+	auto withCursor = [&](const Animation& clip)
+	{
+		return [&](float lookupTime) { return clip.FindKeyFrame(lookupTime, cursor); };
+	};
+	auto binarySearch = [&](float lookupTime)
+	{
+		UINT freshCursor = 0;
+		return uneven.FindKeyFrame(lookupTime, freshCursor);
+	};
+
+	double scanTime = nanosecondsPerLookup(playback, linearScan);
+	double searchTime = nanosecondsPerLookup(playback, binarySearch);
+	double cursorTime = nanosecondsPerLookup(playback, withCursor(uneven));
+	double evenTime = nanosecondsPerLookup(playback, withCursor(even));
+	double seekTime = nanosecondsPerLookup(seeks, withCursor(uneven));
+	double evenSeekTime = nanosecondsPerLookup(seeks, withCursor(even));
+
+	std::vector<Vector3D> translations(jointCount);
+	std::vector<Quaternion> rotations(jointCount);
+	double sampleTime = nanosecondsPerLookup(playback, [&](float lookupTime)
+	{
+		even.Sample(lookupTime, cursor, translations.data(), rotations.data());
+		return cursor;
+	});
+
+	Report("Keyframe lookup: %d keyframes over %u s, %u played frames, checksum %u\n", keyframeCount, (unsigned int)data.lengthSeconds,
+		(unsigned int)playback.size(), checksum);
+	Report("  scanning from the start %.1f ns, binary search %.1f ns, cursor %.1f ns, cursor resampled to 30 a second %.1f ns\n",
+		scanTime, searchTime, cursorTime, evenTime);
+	Report("  random seeks with the cursor %.1f ns, resampled %.1f ns, sampling %d joints %.1f ns a frame\n", seekTime, evenSeekTime, jointCount, sampleTime);
+}
+
+void Benchmark::AnimationScaling(const char * filename)
+{
+	ColladaLoader::ColladaScene scene = ColladaLoader::Import(filename, 4);
+	if (!scene.Loaded || scene.Clips.empty() || scene.Clips[0].keyframes.size() < 2)
+	{
+		Report("Animation scaling: %s not found or has no clip, skipped\n", filename);
+		return;
+	}
+
+	Animation animation(scene.Clips[0], scene.Model.joints);
+
+	std::vector<unsigned int> threadCounts;
+	for (unsigned int threadCount = 1; threadCount < Parallel::WorkerCount(); threadCount *= 2)
+	{
+		threadCounts.push_back(threadCount);
+	}
+	threadCounts.push_back(Parallel::WorkerCount());
+
+	Report("Animation scaling: %s, %u joints sampled, posed and skinned a character, up to %u threads\n", filename,
+		(unsigned int)animation.GetJointCount(), Parallel::WorkerCount());
+
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> startTime(0.0f, animation.GetLength());
+
+	const int characterCounts[] = { 100, 1000, 10000 };
+	for (int characterCount : characterCounts)
+	{
+		//headless models on a grid, each advanced to a different point in the clip so they don't all share keyframes
+		AnimationSystem system;
+		for (int character = 0; character < characterCount; character++)
+		{
+			AnimatedModel* model = system.GetModel(system.Add(new AnimatedModel(scene.Model, nullptr, nullptr)));
+			model->GetTransform()->_position = Vector3D((float)(character % 100), 0.0f, (float)(character / 100));
+			model->DoAnimation(&animation);
+			model->Update(startTime(random));
+		}
+
+		//the threads are started and joined every update as the application would, so that cost is in the times
+		double singleTime = 0.0;
+		for (unsigned int threadCount : threadCounts)
+		{
+			system.SetThreadCount(threadCount);
+			double time = BestOf(10, [&]() { system.Update(1.0f / 60.0f); });
+			if (threadCount == 1)
+				singleTime = time;
+
+			Report("  %5d characters on %2u threads %.3f ms, %.2f us a character, %.2fx one thread\n", characterCount, threadCount, time,
+				time * 1000.0 / characterCount, singleTime / time);
+		}
+	}
+}
+
+void Benchmark::LayeredBlending(int jointCount)
+{
+	//a chain of joints a unit apart, the top half of it masked like an upper body
+	std::vector<JointData*> joints;
+	for (int i = 0; i < jointCount; i++)
+	{
+		XMFLOAT4X4 bindLocalTransform;
+		XMStoreFloat4x4(&bindLocalTransform, XMMatrixTranspose(XMMatrixTranslation(0.0f, 1.0f, 0.0f)));
+		joints.push_back(new JointData(i, "joint" + std::to_string(i), bindLocalTransform));
+		if (i > 0)
+		{
+			joints[i - 1]->AddChild(joints[i]);
+		}
+	}
+	SkeletonData skeletonData(jointCount, *joints[0]);
+	Skeleton skeleton(skeletonData);
+
+	//three one second clips keyed 30 times a second with every joint turning and moving at random
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> angle(-XM_PIDIV2, XM_PIDIV2), offset(-0.2f, 0.2f);
+
+	std::vector<Animation> clips;
+	for (int clip = 0; clip < 3; clip++)
+	{
+		AnimationData data;
+		for (int keyframe = 0; keyframe <= 30; keyframe++)
+		{
+			KeyFrameData keyframeData;
+			keyframeData.time = keyframe / 30.0f;
+			for (int joint = 0; joint < jointCount; joint++)
+			{
+				XMMATRIX localTransform = XMMatrixRotationRollPitchYaw(angle(random), angle(random), angle(random)) *
+					XMMatrixTranslation(offset(random), 1.0f + offset(random), offset(random));
+				XMFLOAT4X4 transposed;
+				XMStoreFloat4x4(&transposed, XMMatrixTranspose(localTransform));
+				keyframeData.jointTransforms.emplace(joints[joint]->nameID, transposed);
+			}
+			data.keyframes.push_back(keyframeData);
+		}
+		data.lengthSeconds = 1.0f;
+		clips.emplace_back(data, skeletonData);
+	}
+
+	for (JointData* joint : joints)
+	{
+		delete joint;
+	}
+
+	std::vector<float> mask = Animator::CreateMask(skeleton, jointCount / 2);
+
+	std::vector<Vector3D> bindTranslations(jointCount), translations[3];
+	std::vector<Quaternion> bindRotations(jointCount), rotations[3];
+	for (int joint = 0; joint < jointCount; joint++)
+	{
+		JointTransform bindPose = JointTransform::Decompose(skeleton.GetBindLocalTransforms()[joint]);
+		bindTranslations[joint] = bindPose._position;
+		bindRotations[joint] = bindPose._rotation;
+	}
+	for (int clip = 0; clip < 3; clip++)
+	{
+		translations[clip] = bindTranslations;
+		rotations[clip] = bindRotations;
+		clips[clip].Sample(0.55f, translations[clip].data(), rotations[clip].data());
+	}
+
+	//the three layers over poses already sampled, so only the blending is timed
+	const int blends = 2000;
+	std::vector<Vector3D> simdTranslations(jointCount), scalarTranslations(jointCount);
+	std::vector<Quaternion> simdRotations(jointCount), scalarRotations(jointCount);
+
+	double simdTime = BestOf(5, [&]()
+	{
+		for (int blend = 0; blend < blends; blend++)
+		{
+			std::copy(translations[0].begin(), translations[0].end(), simdTranslations.begin());
+			std::copy(rotations[0].begin(), rotations[0].end(), simdRotations.begin());
+			PoseBlending::Blend(simdTranslations.data(), simdRotations.data(), translations[1].data(), rotations[1].data(), 0.5f, mask.data(),
+				jointCount, simdTranslations.data(), simdRotations.data());
+			PoseBlending::Add(simdTranslations.data(), simdRotations.data(), translations[2].data(), rotations[2].data(), bindTranslations.data(),
+				bindRotations.data(), 0.5f, nullptr, jointCount, simdTranslations.data(), simdRotations.data());
+		}
+	}) * 1e6 / ((double)blends * jointCount);
+
+	//the same layers a joint at a time with the quaternion class, how they would be blended without the kernels
+	double scalarTime = BestOf(5, [&]()
+	{
+		for (int blend = 0; blend < blends; blend++)
+		{
+			for (int joint = 0; joint < jointCount; joint++)
+			{
+				Vector3D translation;
+				Quaternion rotation;
+				JointTransform::Interpolate(translations[0][joint], rotations[0][joint], translations[1][joint], rotations[1][joint], 0.5f * mask[joint],
+					translation, rotation);
+
+				Quaternion delta = bindRotations[joint].Conjugate() * rotations[2][joint];
+				scalarRotations[joint] = rotation * Quaternion::Nlerp(Quaternion(1.0f, 0.0f, 0.0f, 0.0f), delta, 0.5f);
+				scalarTranslations[joint].x = translation.x + (translations[2][joint].x - bindTranslations[joint].x) * 0.5f;
+				scalarTranslations[joint].y = translation.y + (translations[2][joint].y - bindTranslations[joint].y) * 0.5f;
+				scalarTranslations[joint].z = translation.z + (translations[2][joint].z - bindTranslations[joint].z) * 0.5f;
+			}
+		}
+	}) * 1e6 / ((double)blends * jointCount);
+
+	float worstError = 0.0f;
+	for (int joint = 0; joint < jointCount; joint++)
+	{
+		worstError = std::max(worstError, 1.0f - std::fabs(Quaternion::Dot(simdRotations[joint], scalarRotations[joint])));
+		worstError = std::max(worstError, std::fabs(simdTranslations[joint].y - scalarTranslations[joint].y));
+	}
+
+	//the same three layers as an Animator plays them, the base a blend space of two clips, sampling included
+	Animator animator(skeleton);
+	animator.Play(0, Motion::BlendSpace1D({ { &clips[0], 0.0f, 0.0f }, { &clips[1], 1.0f, 0.0f } }));
+	animator.SetParameters(0, 0.5f);
+	animator.Play(animator.AddLayer(Animator::Layer_Override, 0.5f, mask), Motion(&clips[1]));
+	animator.Play(animator.AddLayer(Animator::Layer_Additive, 0.5f), Motion(&clips[2]));
+
+	const int updates = 1000;
+	std::vector<Vector3D> poseTranslations(jointCount);
+	std::vector<Quaternion> poseRotations(jointCount);
+	double animatorTime = BestOf(5, [&]()
+	{
+		for (int update = 0; update < updates; update++)
+		{
+			animator.Update(1.0f / 60.0f, poseTranslations.data(), poseRotations.data());
+		}
+	}) * 1e6 / ((double)updates * jointCount);
+
+	Report("Layered blending: %d joints, a base, a masked override and an additive layer\n", jointCount);
+	Report("  blending a joint at a time %.2f ns a joint, SSE kernels %.2f ns a joint, %.2fx, worst difference %g\n", scalarTime, simdTime,
+		scalarTime / simdTime, worstError);
+	Report("  animator update sampling four clips and blending them %.2f ns a joint\n", animatorTime);
+}
+
+void Benchmark::XMLLoading(const char * filename)
+{
+	MappedFile source;
+	if (!source.Open(filename))
+	{
+		Report("XML loading: %s not found, skipped\n", filename);
+		return;
+	}
+
+	//Windows can't reset the peak working set, so what each document holds is measured while it is still alive.
+	//The mapped document goes first so the file's pages are already cached when LoadFile reads it
+	double workingSetBefore, privateBefore, workingSetAfter, privateAfter;
+	double mappedWorkingSet, mappedPrivate, loadedWorkingSet, loadedPrivate;
+	{
+		GetMemoryUsage(workingSetBefore, privateBefore);
+		tinyxml2::XMLDocument document;
+		if (ParseMapped(document, source) != tinyxml2::XML_SUCCESS)
+		{
+			Report("XML loading: %s failed to parse, %s\n", filename, document.ErrorStr());
+			return;
+		}
+		GetMemoryUsage(workingSetAfter, privateAfter);
+		mappedWorkingSet = workingSetAfter - workingSetBefore;
+		mappedPrivate = privateAfter - privateBefore;
+	}
+	{
+		GetMemoryUsage(workingSetBefore, privateBefore);
+		tinyxml2::XMLDocument document;
+		document.LoadFile(filename);
+		GetMemoryUsage(workingSetAfter, privateAfter);
+		loadedWorkingSet = workingSetAfter - workingSetBefore;
+		loadedPrivate = privateAfter - privateBefore;
+	}
+
+	double loadTime = BestOf(3, [&]()
+	{
+		tinyxml2::XMLDocument document;
+		document.LoadFile(filename);
+	});
+
+	double mappedTime = BestOf(3, [&]()
+	{
+		tinyxml2::XMLDocument document;
+		ParseMapped(document, source);
+	});
+
+	Report("XML loading: %s, %u KB, LoadFile %.2f ms, mapped %s %.2f ms (%.1fx)\n", filename, (unsigned int)(source.GetSize() / 1024),
+		loadTime, source.IsNullTerminated() ? "in situ" : "with a copy", mappedTime, mappedTime > 0.0 ? loadTime / mappedTime : 0.0);
+	Report("  document holds %.0f KB working set and %.0f KB private with LoadFile, %.0f KB and %.0f KB mapped\n",
+		loadedWorkingSet, loadedPrivate, mappedWorkingSet, mappedPrivate);
+}
+
+void Benchmark::XMLBatchLoading(const char * const * filenames, int count, int passes)
+{
+	std::vector<MappedFile> sources(count);
+	for (int i = 0; i < count; i++)
+	{
+		if (!sources[i].Open(filenames[i]))
+		{
+			Report("XML batch loading: %s not found, skipped\n", filenames[i]);
+			return;
+		}
+	}
+
+	//a fresh document per file allocates its nodes from the heap all over again
+	double freshTime = BestOf(3, [&]()
+	{
+		for (int pass = 0; pass < passes; pass++)
+		{
+			for (const MappedFile& source : sources)
+			{
+				tinyxml2::XMLDocument document;
+				ParseMapped(document, source);
+			}
+		}
+	});
+
+	//one arena sized for the biggest file is warmed by the first load and only rewound after each of the others
+	tinyxml2::XMLArena arena(1024 * 1024);
+	tinyxml2::XMLDocument document;
+	document.SetArena(&arena);
+
+	tinyxml2::XMLAllocationStats largest = {};
+	double arenaTime = BestOf(3, [&]()
+	{
+		for (int pass = 0; pass < passes; pass++)
+		{
+			for (const MappedFile& source : sources)
+			{
+				ParseMapped(document, source);
+
+				tinyxml2::XMLAllocationStats stats;
+				document.GetAllocationStats(&stats);
+				if (stats.arenaUsed > largest.arenaUsed)
+					largest = stats;
+
+				document.Clear();
+				arena.Reset();
+			}
+		}
+	});
+
+	Report("XML batch loading: %d files, fresh documents %.2f ms, one warmed arena %.2f ms (%.1fx)\n",
+		count * passes, freshTime, arenaTime, arenaTime > 0.0 ? freshTime / arenaTime : 0.0);
+	Report("  largest document: %d elements, %d attributes, %d texts, %d node allocations, %u KB of a %u KB arena in %d chunks\n",
+		largest.elements, largest.attributes, largest.texts, largest.nodeAllocations,
+		(unsigned int)(largest.arenaUsed / 1024), (unsigned int)(largest.arenaCapacity / 1024), largest.arenaChunks);
+}
+
+void Benchmark::Report(const char * format, ...)
+{
+	char buffer[1024];
+
+	va_list args;
+	va_start(args, format);
+	vsnprintf(buffer, sizeof(buffer), format, args);
+	va_end(args);
+
+	OutputDebugStringA(buffer);
+
+	if (s_log.is_open())
+	{
+		s_log << buffer;
+		s_log.flush();
+	}
+}
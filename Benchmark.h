@@ -0,0 +1,67 @@
+#pragma once
+
+//Headless timing runs for the asset pipeline, started by passing -benchmark on the command line.
+//Results go to the debug output and to Benchmark.log next to the executable
+namespace Benchmark
+{
+	void RunAll();
+
+	//Times the memory mapped OBJ parser against the original stream parser on the same file
+	void OBJParsing(const char* filename);
+
+	//Times opening the cooked mesh, which hashes the source and checks the file, and copying it out into an IndexedModel
+	void MeshCacheLoading(const char* filename);
+
+	//Reports the ACMR and ATVR stored when the mesh was cooked and times the optimizer
+	void VertexCacheOptimization(const char* filename);
+
+	//Checks the compressed vertex format's error against its bounds and reports the vertex bandwidth saved per frame
+	void CompressedVertices(const char* filename);
+
+	//Reports the triangle count and error of every LOD in the cooked file, the distance each starts being used at and
+	//times building the chain
+	void LODChain(const char* filename);
+
+	//Times building the shadow and SSAO normal depth streams for the cooked mesh and reports the vertices and bytes each
+	//pass fetches against drawing with the full vertex buffer
+	void DepthOnlyStreams(const char* filename);
+
+	//Builds meshlets for the cooked mesh and reports how many triangles frustum and cone culling remove for the main
+	//camera orbiting the mesh and for the orthographic shadow map view
+	void MeshletCulling(const char* filename);
+
+	//Times each phase of parsing a Collada file against reading it back from the cooked file and reports the joints,
+	//vertices and clips it holds
+	void ColladaImport(const char* filename);
+
+	//Times blending the file's morph targets, then synthetic ones over its vertices for a range of target counts and
+	//coverages against copying every vertex and applying every target whatever its weight
+	void MorphTargetBlending(const char* filename);
+
+	//Loops the file's first clip to the given length, cooks it in chunks and plays it decoded whole and then streamed,
+	//reporting the memory each holds, the time spent sampling the pose each frame and how often streaming fell behind
+	void AnimationStreaming(const char* filename, float lengthSeconds);
+
+	//Times finding the keyframes either side of the playhead in a clip of the given length by scanning from the start,
+	//by binary search and with a playback cursor, and with the clip resampled to an even rate, for playback and seeks
+	void KeyframeLookup(int keyframeCount);
+
+	//Times the animation system updating 100, 1000 and 10000 copies of the file's character, each at its own point in
+	//the first clip, on one thread and then doubling up to one per core, and reports the speedup over one thread
+	void AnimationScaling(const char* filename);
+
+	//Times a three layer blend over a chain of the given number of joints, a full weight base, a half weight override
+	//masked to the top half of the chain and a half weight additive layer, with the SSE kernels against blending a
+	//joint at a time, and the whole of an Animator update sampling the clips too, all in nanoseconds a joint
+	void LayeredBlending(int jointCount);
+
+	//Times TinyXML2's LoadFile against parsing the memory mapped file in situ and reports how much memory each
+	//document holds once parsed
+	void XMLLoading(const char* filename);
+
+	//Loads the files the given number of times with a fresh document each, then with one document reusing a warmed
+	//arena, and reports the node and arena statistics of the largest
+	void XMLBatchLoading(const char* const* filenames, int count, int passes);
+
+	void Report(const char* format, ...);
+}
@@ -1,706 +1,1374 @@
 #include "ColladaLoader.h"
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+
+#include "AnimationCache.h"
+#include "MappedFile.h"
 #include "Quaternion.h"
+#include "MeshOptimizer.h"
+#include "TangentGenerator.h"
+#include "Utilities.h"
 
-AnimatedModelData ColladaLoader::LoadModel(const char * filename, int maxWeights)
+namespace
 {
-	tinyxml2::XMLDocument doc;
+	typedef std::chrono::high_resolution_clock Clock;
 
-	if (doc.LoadFile(filename) == 0)
+	//milliseconds since the lap started, the lap then restarts from now
+	double Lap(Clock::time_point& lapStart)
 	{
-		tinyxml2::XMLElement* pRoot;
-
-		pRoot = doc.FirstChildElement("COLLADA");
-
-		tinyxml2::XMLElement* pNode = pRoot->FirstChildElement("library_controllers");
-		if (pNode)
-		{
-			SkinningData skinningData = LoadSkin(pNode, maxWeights);
+		Clock::time_point now = Clock::now();
+		double time = std::chrono::duration<double, std::milli>(now - lapStart).count();
+		lapStart = now;
+		return time;
+	}
 
-			pNode = pRoot->FirstChildElement("library_visual_scenes");
-			SkeletonData skeletonData = LoadSkeleton(pNode, skinningData.jointOrder, skinningData.bindMatrices);
+	typedef tinyxml2::XMLPullReader Reader;
 
-			pNode = pRoot->FirstChildElement("library_geometries");
-			IndexedSkeletalModel meshData = LoadGeometry(pNode, skinningData.verticesSkinData);
+	std::string ToString(const tinyxml2::XMLSpan& span)
+	{
+		return span.Start() ? std::string(span.Start(), span.End()) : std::string();
+	}
 
-			return AnimatedModelData(skeletonData, meshData);
+	//urls and sources refer to ids with a # in front
+	std::string ReadReference(const Reader& reader, const char* attribute)
+	{
+		tinyxml2::XMLSpan reference = reader.Attribute(attribute);
+		if (reference.Start() && !reference.Empty() && *reference.Start() == '#')
+		{
+			reference = tinyxml2::XMLSpan(reference.Start() + 1, reference.End());
 		}
+		return ToString(reference);
 	}
 
-	return AnimatedModelData();
-}
+	//Calls visit on every child element of the element the reader has just started and leaves the reader on that
+	//element's end. Children the visitor doesn't read to their end are skipped whole
+	template<typename Visitor>
+	void ForEachChild(Reader& reader, Visitor visit)
+	{
+		int depth = reader.Depth();
 
-AnimationData ColladaLoader::LoadAnimation(const char * filename)
-{
-	AnimationData returnAnimationData;
+		while (reader.Next() != Reader::PULL_END_DOCUMENT && reader.CurrentEvent() != Reader::PULL_ERROR)
+		{
+			if (reader.CurrentEvent() == Reader::PULL_END_ELEMENT && reader.Depth() < depth)
+			{
+				return;
+			}
 
-	std::vector<KeyFrameData> keyFramesData;
-	std::vector<float> keyFrameTimes;
+			if (reader.CurrentEvent() == Reader::PULL_START_ELEMENT)
+			{
+				visit();
 
-	tinyxml2::XMLDocument doc;
+				if (reader.CurrentEvent() == Reader::PULL_START_ELEMENT)
+				{
+					reader.SkipElement();
+				}
+			}
+		}
+	}
 
-	if (doc.LoadFile(filename) == 0)
+	ColladaLoader::Input ReadInput(const Reader& reader)
 	{
-		tinyxml2::XMLElement* pRoot;
-
-		pRoot = doc.FirstChildElement("COLLADA");
-		tinyxml2::XMLElement* pNode;
-
-		std::string rootJointName;
-
-		pNode = pRoot->FirstChildElement("library_visual_scenes")->FirstChildElement("visual_scene")->FirstChildElement("node");
+		ColladaLoader::Input input;
+		input.Semantic = ToString(reader.Attribute("semantic"));
+		input.Source = ReadReference(reader, "source");
+		return input;
+	}
 
-		while (pNode)
+	const std::string* FindInputSource(const std::vector<ColladaLoader::Input>& inputs, const char* semantic)
+	{
+		for (const ColladaLoader::Input& input : inputs)
 		{
-			if (strcmp(pNode->Attribute("id"), "Armature") == 0)
+			if (input.Semantic == semantic)
 			{
-				pNode = pNode->FirstChildElement("node");
-				rootJointName = pNode->Attribute("id");
-				break;
+				return &input.Source;
 			}
-
-			pNode = pNode->NextSiblingElement("node");
 		}
+		return nullptr;
+	}
 
-		pNode = pRoot->FirstChildElement("library_animations");
-
-		
+	void IndexSource(Reader& reader, ColladaLoader::DocumentIndex& index)
+	{
+		ColladaLoader::SourceArray source;
+		std::string id = ToString(reader.Attribute("id"));
 
-		if (pNode)
+		ForEachChild(reader, [&]()
 		{
-			tinyxml2::XMLElement* pAnimation = pNode->FirstChildElement("animation");
-
-			while (pAnimation)
+			if (reader.NameIs("float_array") || reader.NameIs("Name_array") || reader.NameIs("IDREF_array"))
+			{
+				source.Count = reader.UnsignedAttribute("count");
+				source.Text = reader.ReadElementText();
+			}
+			else if (reader.NameIs("technique_common"))
 			{
-				std::string inputID, outputID;
+				ForEachChild(reader, [&]()
+				{
+					if (reader.NameIs("accessor"))
+					{
+						source.AccessorCount = reader.UnsignedAttribute("count");
+					}
+				});
+			}
+		});
 
-				tinyxml2::XMLElement* pSampler = pAnimation->FirstChildElement("sampler");
+		index.Sources[id] = source;
+	}
 
-				tinyxml2::XMLElement* pInput = pSampler->FirstChildElement("input");
+	void IndexGeometries(Reader& reader, ColladaLoader::DocumentIndex& index)
+	{
+		ForEachChild(reader, [&]()
+		{
+			if (!reader.NameIs("geometry"))
+			{
+				return;
+			}
 
-				//get joint name
-				tinyxml2::XMLElement* pChannel = pAnimation->FirstChildElement("channel");
+			std::string id = ToString(reader.Attribute("id"));
+			std::string name = ToString(reader.Attribute("name"));
+
+			ForEachChild(reader, [&]()
+			{
+				if (!reader.NameIs("mesh"))
+				{
+					return;
+				}
 
-				std::string jointName = Util::SplitString(pChannel->Attribute("target"), '/')[0];
+				ColladaLoader::Geometry& geometry = index.Geometries[id];
+				geometry.Name = name;
 
-				//get input and output IDs
-				while (pInput)
+				ForEachChild(reader, [&]()
 				{
-					if (strcmp(pInput->Attribute("semantic"), "INPUT") == 0)
+					if (reader.NameIs("source"))
+					{
+						IndexSource(reader, index);
+					}
+					else if (reader.NameIs("vertices"))
 					{
-						inputID = pInput->Attribute("source");
-						inputID.erase(inputID.begin());
+						ForEachChild(reader, [&]()
+						{
+							if (reader.NameIs("input") && reader.Attribute("semantic").Equals("POSITION"))
+							{
+								geometry.PositionsSource = ReadReference(reader, "source");
+							}
+						});
 					}
-					else if(strcmp(pInput->Attribute("semantic"), "OUTPUT") == 0)
+					//polylists and triangles are the only primitives read, both list their corners one after another in <p>
+					else if (reader.NameIs("polylist") || reader.NameIs("triangles"))
 					{
-						outputID = pInput->Attribute("source");
-						outputID.erase(outputID.begin());
+						ColladaLoader::Primitive primitive;
+						primitive.Material = ToString(reader.Attribute("material"));
+						primitive.Count = reader.UnsignedAttribute("count");
+
+						ForEachChild(reader, [&]()
+						{
+							if (reader.NameIs("input"))
+							{
+								primitive.Inputs.push_back(ReadInput(reader));
+							}
+							else if (reader.NameIs("vcount"))
+							{
+								primitive.VertexCounts = reader.ReadElementText();
+							}
+							else if (reader.NameIs("p"))
+							{
+								primitive.Indices = reader.ReadElementText();
+							}
+						});
+
+						geometry.Primitives.push_back(std::move(primitive));
 					}
+				});
+			});
+		});
+	}
 
-					pInput = pInput->NextSiblingElement("input");
+	void IndexControllers(Reader& reader, ColladaLoader::DocumentIndex& index)
+	{
+		ForEachChild(reader, [&]()
+		{
+			if (!reader.NameIs("controller"))
+			{
+				return;
+			}
+
+			std::string id = ToString(reader.Attribute("id"));
+
+			ForEachChild(reader, [&]()
+			{
+				if (reader.NameIs("morph"))
+				{
+					ColladaLoader::Morph morph;
+					morph.Id = id;
+					morph.Geometry = ReadReference(reader, "source");
+
+					ForEachChild(reader, [&]()
+					{
+						if (reader.NameIs("source"))
+						{
+							IndexSource(reader, index);
+						}
+						else if (reader.NameIs("targets"))
+						{
+							ForEachChild(reader, [&]()
+							{
+								if (reader.NameIs("input"))
+								{
+									morph.TargetInputs.push_back(ReadInput(reader));
+								}
+							});
+						}
+					});
+
+					index.Morphs.push_back(std::move(morph));
+					return;
 				}
 
-				std::vector<std::string> rawtimesData;
-				std::vector<std::string> rawMatricesData;
+				if (!reader.NameIs("skin"))
+				{
+					return;
+				}
 
-				tinyxml2::XMLElement* pSource = pAnimation->FirstChildElement("source");
+				ColladaLoader::Skin skin;
+				skin.Geometry = ReadReference(reader, "source");
 
-				while (pSource)
+				ForEachChild(reader, [&]()
 				{
-					if (strcmp(pSource->Attribute("id"), inputID.c_str()) == 0)
+					if (reader.NameIs("source"))
+					{
+						IndexSource(reader, index);
+					}
+					else if (reader.NameIs("joints"))
 					{
-						rawtimesData = Util::SplitString(pSource->FirstChildElement("float_array")->GetText(), ' ');
+						ForEachChild(reader, [&]()
+						{
+							if (reader.NameIs("input"))
+							{
+								skin.JointInputs.push_back(ReadInput(reader));
+							}
+						});
 					}
-					else if (strcmp(pSource->Attribute("id"), outputID.c_str()) == 0)
+					else if (reader.NameIs("vertex_weights"))
 					{
-						rawMatricesData = Util::SplitString(pSource->FirstChildElement("float_array")->GetText(), ' ');
+						skin.VertexCount = reader.UnsignedAttribute("count");
+
+						ForEachChild(reader, [&]()
+						{
+							if (reader.NameIs("input"))
+							{
+								skin.WeightInputs.push_back(ReadInput(reader));
+							}
+							else if (reader.NameIs("vcount"))
+							{
+								skin.InfluenceCounts = reader.ReadElementText();
+							}
+							else if (reader.NameIs("v"))
+							{
+								skin.Influences = reader.ReadElementText();
+							}
+						});
 					}
-					pSource = pSource->NextSiblingElement("source");
+				});
 
-				}
+				index.Skins.push_back(std::move(skin));
+			});
+		});
+	}
+
+	//some exporters group the channels in animations inside the one a clip refers to, only the first channel and
+	//sampler of each animation are read
+	void IndexAnimation(Reader& reader, ColladaLoader::DocumentIndex& index)
+	{
+		size_t slot = index.Animations.size();
+		index.Animations.emplace_back();
+		index.Animations[slot].Id = ToString(reader.Attribute("id"));
+
+		bool hasSampler = false;
 
-				//if this is the root bone then load the keyframe times
-				if (strcmp(jointName.c_str(), rootJointName.c_str()) == 0)
+		ForEachChild(reader, [&]()
+		{
+			if (reader.NameIs("source"))
+			{
+				IndexSource(reader, index);
+			}
+			else if (reader.NameIs("sampler") && !hasSampler)
+			{
+				hasSampler = true;
+				ForEachChild(reader, [&]()
 				{
-					for (std::string time : rawtimesData)
+					if (reader.NameIs("input"))
 					{
-						keyFrameTimes.push_back(atof(time.c_str()));
+						index.Animations[slot].SamplerInputs.push_back(ReadInput(reader));
 					}
+				});
+			}
+			else if (reader.NameIs("channel") && index.Animations[slot].Target.empty())
+			{
+				index.Animations[slot].Target = ToString(reader.Attribute("target"));
+			}
+			else if (reader.NameIs("animation"))
+			{
+				IndexAnimation(reader, index);
+			}
+		});
 
-					returnAnimationData.lengthSeconds = keyFrameTimes.back();
+		index.Animations[slot].End = (int)index.Animations.size();
+	}
 
-					keyFramesData.resize(keyFrameTimes.size());
+	void IndexAnimationClips(Reader& reader, ColladaLoader::DocumentIndex& index)
+	{
+		ForEachChild(reader, [&]()
+		{
+			if (!reader.NameIs("animation_clip"))
+			{
+				return;
+			}
 
-					for (int i = 0; i< keyFramesData.size(); i++)
-					{
-						keyFramesData[i].time = keyFrameTimes[i];
-					}
+			ColladaLoader::AnimationClip clip;
+			clip.Start = reader.FloatAttribute("start");
+			clip.End = reader.FloatAttribute("end", FLT_MAX);
+
+			ForEachChild(reader, [&]()
+			{
+				if (reader.NameIs("instance_animation"))
+				{
+					clip.Animations.push_back(ReadReference(reader, "url"));
 				}
+			});
 
+			index.Clips.push_back(std::move(clip));
+		});
+	}
 
-				for (int i = 0; i < keyFramesData.size(); i++)
+	void IndexNode(Reader& reader, int parent, ColladaLoader::DocumentIndex& index)
+	{
+		int slot = (int)index.Nodes.size();
+		index.Nodes.emplace_back();
+		index.Nodes[slot].Id = ToString(reader.Attribute("id"));
+		index.Nodes[slot].Parent = parent;
+
+		ForEachChild(reader, [&]()
+		{
+			if (reader.NameIs("matrix") && !index.Nodes[slot].Matrix.Start())
+			{
+				index.Nodes[slot].Matrix = reader.ReadElementText();
+			}
+			else if (reader.NameIs("node"))
+			{
+				IndexNode(reader, slot, index);
+			}
+		});
+
+		index.Nodes[slot].End = (int)index.Nodes.size();
+	}
+
+	//only the first visual scene is read
+	void IndexVisualScenes(Reader& reader, ColladaLoader::DocumentIndex& index)
+	{
+		bool sceneRead = false;
+
+		ForEachChild(reader, [&]()
+		{
+			if (!reader.NameIs("visual_scene") || sceneRead)
+			{
+				return;
+			}
+
+			sceneRead = true;
+			ForEachChild(reader, [&]()
+			{
+				if (reader.NameIs("node"))
 				{
-					
-					//convert the raw data into a matrix
-					XMMATRIX matrix = XMMATRIX(atof(rawMatricesData[i * 16 + 0].c_str()), atof(rawMatricesData[i * 16 + 1].c_str()), atof(rawMatricesData[i * 16 + 2].c_str()), atof(rawMatricesData[i * 16 + 3].c_str()),
-						atof(rawMatricesData[i * 16 + 4].c_str()), atof(rawMatricesData[i * 16 + 5].c_str()), atof(rawMatricesData[i * 16 + 6].c_str()), atof(rawMatricesData[i * 16 + 7].c_str()),
-						atof(rawMatricesData[i * 16 + 8].c_str()), atof(rawMatricesData[i * 16 + 9].c_str()), atof(rawMatricesData[i * 16 + 10].c_str()), atof(rawMatricesData[i * 16 + 11].c_str()),
-						atof(rawMatricesData[i * 16 + 12].c_str()), atof(rawMatricesData[i * 16 + 13].c_str()), atof(rawMatricesData[i * 16 + 14].c_str()), atof(rawMatricesData[i * 16 + 15].c_str()));
-
-				
-					XMFLOAT4X4 matrixAsFloats;
-					XMStoreFloat4x4(&matrixAsFloats, matrix);
-
-					//Quaternion qat = Quaternion(matrixAsFloats);
-					//
-					//qat.Normalize();
-					//
-					//XMStoreFloat4x4(&matrixAsFloats, CalculateTransformMatrix(qat));
-
-					keyFramesData[i].jointTransforms.insert(std::pair<std::string, XMFLOAT4X4> (jointName, matrixAsFloats));
+					IndexNode(reader, -1, index);
 				}
+			});
+		});
+	}
 
-				pAnimation = pAnimation->NextSiblingElement("animation");
+	//the skeleton's root joint is the first node under the armature, -1 if there isn't one
+	int FindRootJointNode(const ColladaLoader::DocumentIndex& index)
+	{
+		for (int node = 0; node < (int)index.Nodes.size(); node = index.Nodes[node].End)
+		{
+			if (index.Nodes[node].Id == "Armature")
+			{
+				return node + 1 < index.Nodes[node].End ? node + 1 : -1;
 			}
-			
 		}
+
+		return -1;
 	}
 
-	returnAnimationData.keyframes = keyFramesData;
-	return returnAnimationData;
-}
+	const ColladaLoader::SourceArray* FindSource(const ColladaLoader::DocumentIndex& index, const std::string* id)
+	{
+		if (!id)
+		{
+			return nullptr;
+		}
 
-SkinningData ColladaLoader::LoadSkin(tinyxml2::XMLElement * node, int maxWeights)
-{
-	//find the skin node
-	tinyxml2::XMLElement * pSkinNode = node->FirstChildElement("controller")->FirstChildElement("skin");
+		auto it = index.Sources.find(*id);
+		return it != index.Sources.end() ? &it->second : nullptr;
+	}
 
-	tinyxml2::XMLElement * pJointsNode = pSkinNode->FirstChildElement("joints");
+	//One joint's keyframes, the times and a row major matrix per time
+	struct AnimationChannel
+	{
+		std::string JointName;
+		std::vector<float> Times;
+		std::vector<float> Matrices;
+	};
 
-	tinyxml2::XMLElement * pInputNode = pJointsNode->FirstChildElement("input");
+	//Fills values straight from the source text. Returns how many were read, which is less than count if the text ran out
+	size_t ReadFloats(const tinyxml2::XMLSpan& text, float* values, size_t count)
+	{
+		return text.Start() ? Util::ParseFloatArray(text.Start(), text.End(), values, count) : 0;
+	}
 
-	std::string inverseBindId;
+	size_t ReadInts(const tinyxml2::XMLSpan& text, int* values, size_t count)
+	{
+		return text.Start() ? Util::ParseIntArray(text.Start(), text.End(), values, count) : 0;
+	}
 
-	while (pInputNode)
+	//Reads a source's <float_array> into values, sized from its count attribute
+	void ReadFloatArray(const ColladaLoader::SourceArray* source, std::vector<float>& values)
 	{
-		if (strcmp(pInputNode->Attribute("semantic"), "INV_BIND_MATRIX") == 0)
+		values.clear();
+		if (source)
 		{
-			inverseBindId = pInputNode->Attribute("source");
-			inverseBindId.erase(inverseBindId.begin());
+			values.resize(source->Count);
+			values.resize(ReadFloats(source->Text, values.data(), values.size()));
 		}
-
-		pInputNode = pInputNode->NextSiblingElement("input");
 	}
 
+	void ReadNameArray(const ColladaLoader::SourceArray* source, std::vector<std::string>& names)
+	{
+		names.clear();
+		if (!source || !source->Text.Start())
+		{
+			return;
+		}
 
+		names.reserve(source->Count);
 
-	//find the vertex weights node
-	tinyxml2::XMLElement * pVertexWeightsNode = pSkinNode->FirstChildElement("vertex_weights");
+		const char* first = source->Text.Start();
+		const char* last = source->Text.End();
 
-	std::string jointDataId;
-	std::string weightDataId;
-	std::vector<std::string> jointNames;
-	std::vector<float> weights;
-	std::vector<int> effectorJointCounts;
-	std::vector<VertexSkinData> vertexWeights;
-	std::vector<XMFLOAT4X4> bindMatrices;
+		first = Util::SkipWhitespaceRun(first, last);
+		while (first < last)
+		{
+			const char* nameEnd = first;
+			while (nameEnd < last && !Util::IsSpace(*nameEnd))
+			{
+				nameEnd++;
+			}
 
-	pInputNode = pVertexWeightsNode->FirstChildElement("input");
+			names.emplace_back(first, nameEnd);
+			first = Util::SkipWhitespaceRun(nameEnd, last);
+		}
+	}
+
+	//A geometry and the weights its controller gives each of its positions, remapped into the merged joint list
+	struct SkinnedPiece
+	{
+		const ColladaLoader::Geometry* Geometry;
+		const ColladaLoader::Morph* Morph; //null when nothing morphs the geometry
+		std::vector<VertexSkinData> Skin;
+	};
 
-	//get the data IDs
-	while (pInputNode)
+	//A morph on the geometry, found by its controller id or by the geometry it morphs
+	const ColladaLoader::Morph* FindMorph(const ColladaLoader::DocumentIndex& index, const std::string& id)
 	{
-		if (strcmp(pInputNode->Attribute("semantic"), "JOINT") == 0)
+		for (const ColladaLoader::Morph& morph : index.Morphs)
 		{
-			jointDataId = pInputNode->Attribute("source");
-			//remove the # from the start
-			jointDataId.erase(jointDataId.begin());
+			if (morph.Id == id || morph.Geometry == id)
+			{
+				return &morph;
+			}
 		}
-		else if (strcmp(pInputNode->Attribute("semantic"), "WEIGHT") == 0)
+		return nullptr;
+	}
+
+	//Every skin on a mesh geometry becomes a piece. Their joint lists are merged into one so that the whole model can
+	//be drawn with a single palette, a joint bound by several skins keeps the inverse bind of the first one
+	std::vector<SkinnedPiece> LoadSkins(const ColladaLoader::DocumentIndex& index, int maxWeights, SkinningData& mergedSkin)
+	{
+		std::vector<SkinnedPiece> pieces;
+		ColladaLoader::JointIndices mergedIndices;
+
+		for (const ColladaLoader::Skin& skinIndex : index.Skins)
 		{
-			weightDataId = pInputNode->Attribute("source");
-			//remove the # from the start
-			weightDataId.erase(weightDataId.begin());
+			//a skin over a morph deforms the morph's geometry
+			const ColladaLoader::Morph* morph = FindMorph(index, skinIndex.Geometry);
+			auto geometry = index.Geometries.find(morph ? morph->Geometry : skinIndex.Geometry);
+			if (geometry == index.Geometries.end())
+			{
+				continue;
+			}
+
+			SkinningData skin = ColladaLoader::LoadSkin(index, skinIndex, maxWeights);
+
+			std::vector<unsigned short> remap(skin.jointOrder.size());
+			for (size_t i = 0; i < skin.jointOrder.size(); i++)
+			{
+				auto inserted = mergedIndices.emplace(skin.jointOrder[i], (int)mergedSkin.jointOrder.size());
+				if (inserted.second)
+				{
+					XMFLOAT4X4 identity;
+					XMStoreFloat4x4(&identity, XMMatrixIdentity());
+
+					mergedSkin.jointOrder.push_back(skin.jointOrder[i]);
+					mergedSkin.bindMatrices.push_back(i < skin.bindMatrices.size() ? skin.bindMatrices[i] : identity);
+				}
+				remap[i] = (unsigned short)inserted.first->second;
+			}
+
+			for (VertexSkinData& vertex : skin.verticesSkinData)
+			{
+				for (int i = 0; i < vertex.count; i++)
+				{
+					vertex.jointIds[i] = vertex.jointIds[i] < remap.size() ? remap[vertex.jointIds[i]] : 0;
+				}
+			}
+
+			SkinnedPiece piece;
+			piece.Geometry = &geometry->second;
+			piece.Morph = morph;
+			piece.Skin = std::move(skin.verticesSkinData);
+			pieces.push_back(std::move(piece));
 		}
 
-		pInputNode = pInputNode->NextSiblingElement("input");
+		return pieces;
 	}
 
-	tinyxml2::XMLElement * pSourceNode = pSkinNode->FirstChildElement("source");
-
-	//get the data
-	while (pSourceNode)
+	//Appends every piece's vertices into one buffer and regroups the indices by material, so each material is one
+	//submesh however many geometries used it
+	IndexedSkeletalModel MergeGeometry(const std::vector<IndexedSkeletalModel>& pieces, size_t materialCount)
 	{
-		if (strcmp(pSourceNode->Attribute("id"), jointDataId.c_str()) == 0)
+		IndexedSkeletalModel merged;
+
+		std::vector<UINT> firstVertices;
+		for (const IndexedSkeletalModel& piece : pieces)
 		{
-			jointNames = Util::SplitString(pSourceNode->FirstChildElement("Name_array")->GetText(), ' ');
+			firstVertices.push_back((UINT)merged.Vertices.size());
+			merged.Vertices.insert(merged.Vertices.end(), piece.Vertices.begin(), piece.Vertices.end());
 		}
-		else if (strcmp(pSourceNode->Attribute("id"), inverseBindId.c_str()) == 0)
+
+		for (UINT material = 0; material < materialCount; material++)
 		{
-			std::vector<std::string> rawData = Util::SplitString(pSourceNode->FirstChildElement("float_array")->GetText(), ' ');
+			Submesh submesh;
+			submesh.StartIndex = (UINT)merged.Indices.size();
+			submesh.MaterialId = material;
 
-			int boneCount = atoi(pSourceNode->FirstChildElement("technique_common")->FirstChildElement("accessor")->Attribute("count"));
+			for (size_t i = 0; i < pieces.size(); i++)
+			{
+				for (const Submesh& range : pieces[i].Submeshes)
+				{
+					if (range.MaterialId != material)
+					{
+						continue;
+					}
 
-			
+					for (UINT index = range.StartIndex; index < range.StartIndex + range.IndexCount; index++)
+					{
+						merged.Indices.push_back(pieces[i].Indices[index] + firstVertices[i]);
+					}
+				}
+			}
 
-			for (int i = 0; i < boneCount; i++)
+			submesh.IndexCount = (UINT)merged.Indices.size() - submesh.StartIndex;
+			if (submesh.IndexCount > 0)
 			{
-				bindMatrices.push_back(XMFLOAT4X4(atof(rawData[i * 16 + 0].c_str()), atof(rawData[i * 16 + 1].c_str()), atof(rawData[i * 16 + 2].c_str()), atof(rawData[i * 16 + 3].c_str()),
-					atof(rawData[i * 16 + 4].c_str()), atof(rawData[i * 16 + 5].c_str()), atof(rawData[i * 16 + 6].c_str()), atof(rawData[i * 16 + 7].c_str()),
-					atof(rawData[i * 16 + 8].c_str()), atof(rawData[i * 16 + 9].c_str()), atof(rawData[i * 16 + 10].c_str()), atof(rawData[i * 16 + 11].c_str()),
-					atof(rawData[i * 16 + 12].c_str()), atof(rawData[i * 16 + 13].c_str()), atof(rawData[i * 16 + 14].c_str()), atof(rawData[i * 16 + 15].c_str())));
+				merged.Submeshes.push_back(submesh);
 			}
 		}
-		else if (strcmp(pSourceNode->Attribute("id"), weightDataId.c_str()) == 0)
+
+		return merged;
+	}
+
+	//Moves the morph targets' vertices to where the optimizer put them, keeping each target in ascending vertex order
+	void RemapMorphTargets(std::vector<MorphTargetData>& targets, const std::vector<UINT>& remap)
+	{
+		std::vector<std::pair<UINT, MorphDelta>> sorted;
+
+		for (MorphTargetData& target : targets)
 		{
-			std::vector<std::string> rawData = Util::SplitString(pSourceNode->FirstChildElement("float_array")->GetText(), ' ');
+			sorted.resize(target.vertices.size());
+			for (size_t i = 0; i < target.vertices.size(); i++)
+			{
+				sorted[i] = std::make_pair(remap[target.vertices[i]], target.deltas[i]);
+			}
+
+			std::sort(sorted.begin(), sorted.end(), [](const std::pair<UINT, MorphDelta>& a, const std::pair<UINT, MorphDelta>& b) { return a.first < b.first; });
 
-			for (int i = 0; i < rawData.size(); i++)
+			for (size_t i = 0; i < sorted.size(); i++)
 			{
-				weights.push_back(atof(rawData[i].c_str()));
+				target.vertices[i] = sorted[i].first;
+				target.deltas[i] = sorted[i].second;
 			}
 		}
-		pSourceNode = pSourceNode->NextSiblingElement("source");
 	}
 
-	//get the effective vertex counts data
-	std::vector<std::string> rawData = Util::SplitString(pVertexWeightsNode->FirstChildElement("vcount")->GetText(), ' ');
-
-	for (int i = 0; i < rawData.size(); i++)
+	bool LoadChannel(const ColladaLoader::DocumentIndex& index, const ColladaLoader::Animation& animation, AnimationChannel& channel)
 	{
-		effectorJointCounts.push_back(atoi(rawData[i].c_str()));
+		if (animation.Target.empty())
+		{
+			return false;
+		}
+
+		//the target is the joint id followed by the transform it animates
+		size_t slash = animation.Target.find('/');
+		channel.JointName = animation.Target.substr(0, slash);
+
+		ReadFloatArray(FindSource(index, FindInputSource(animation.SamplerInputs, "INPUT")), channel.Times);
+		ReadFloatArray(FindSource(index, FindInputSource(animation.SamplerInputs, "OUTPUT")), channel.Matrices);
+
+		return true;
 	}
 
-	//get the vertex weights
-	rawData = Util::SplitString(pVertexWeightsNode->FirstChildElement("v")->GetText(), ' ');
-	int pointer = 0;
-	for (int count : effectorJointCounts)
+	//an animation's channel followed by those of every animation nested in it
+	void LoadChannels(const ColladaLoader::DocumentIndex& index, int animation, std::vector<AnimationChannel>& channels)
 	{
-		VertexSkinData skinData;
-		skinData.SetNumberOfEffects(count);
-		for (int i = 0; i < count; i++)
+		for (int i = animation; i < index.Animations[animation].End; i++)
 		{
-			int jointId = atoi(rawData[pointer++].c_str());
-			int weightId = atoi(rawData[pointer++].c_str());
-			skinData.AddJointEffect(jointId, weights[weightId]);
+			AnimationChannel channel;
+			if (LoadChannel(index, index.Animations[i], channel))
+			{
+				channels.push_back(std::move(channel));
+			}
 		}
-		skinData.LimitJointNumber(maxWeights);
-		vertexWeights.push_back(skinData);
 	}
 
-	return SkinningData(jointNames, vertexWeights, bindMatrices);
+	//Keyframes are taken from the root joint's times between start and end and moved to begin at offset zero. Every
+	//other joint is expected to be keyed at the same times
+	AnimationData BuildClip(const std::vector<AnimationChannel>& channels, const std::string& rootJointName, float start, float end, float offset)
+	{
+		AnimationData clip;
+		clip.lengthSeconds = 0.0f;
+
+		const AnimationChannel* rootChannel = nullptr;
+		for (const AnimationChannel& channel : channels)
+		{
+			if (channel.JointName == rootJointName)
+			{
+				rootChannel = &channel;
+				break;
+			}
+		}
+
+		if (!rootChannel)
+		{
+			return clip;
+		}
+
+		const float epsilon = 1e-4f;
+
+		size_t firstKey = 0;
+		while (firstKey < rootChannel->Times.size() && rootChannel->Times[firstKey] < start - epsilon)
+		{
+			firstKey++;
+		}
+
+		size_t lastKey = firstKey;
+		while (lastKey < rootChannel->Times.size() && rootChannel->Times[lastKey] <= end + epsilon)
+		{
+			lastKey++;
+		}
+
+		clip.keyframes.resize(lastKey - firstKey);
+		for (size_t i = firstKey; i < lastKey; i++)
+		{
+			clip.keyframes[i - firstKey].time = rootChannel->Times[i] - offset;
+		}
+
+		if (!clip.keyframes.empty())
+		{
+			clip.lengthSeconds = clip.keyframes.back().time;
+		}
+
+		for (const AnimationChannel& channel : channels)
+		{
+			for (size_t i = firstKey; i < lastKey && (i + 1) * 16 <= channel.Matrices.size(); i++)
+			{
+				clip.keyframes[i - firstKey].jointTransforms.insert(std::pair<std::string, XMFLOAT4X4>(channel.JointName, XMFLOAT4X4(&channel.Matrices[i * 16])));
+			}
+		}
+
+		return clip;
+	}
 }
 
-SkeletonData ColladaLoader::LoadSkeleton(tinyxml2::XMLElement * node, std::vector<std::string> jointOrder, std::vector<XMFLOAT4X4> inverseBindTransforms)
+ColladaLoader::ColladaScene ColladaLoader::Import(const char * filename, int maxWeights)
 {
-	tinyxml2::XMLElement * pVisualSceneNode = node->FirstChildElement("visual_scene");
+	Clock::time_point importStart = Clock::now();
 
-	//find the armature node
-	tinyxml2::XMLElement * pArmatureNode = pVisualSceneNode->FirstChildElement("node");
-	
-	while (pArmatureNode)
+	MeshCache::CookedMesh cookedMesh;
+	ColladaScene scene;
+
+	//a scene that is already loaded was just parsed and cooked, so there's nothing to read back
+	AnimationCache::CookedAnimatedModel view;
+	if (LoadCooked(filename, maxWeights, cookedMesh, scene) && !scene.Loaded && AnimationCache::GetAnimatedModel(cookedMesh, view))
 	{
-		if (strcmp(pArmatureNode->Attribute("id"), "Armature") == 0)
+		Clock::time_point readStart = Clock::now();
+
+		IndexedSkeletalModel meshData;
+		std::vector<std::string> materials;
+		std::vector<MorphTargetData> morphTargets;
+		bool read = cookedMesh.ReadModel(meshData.Vertices, meshData.Indices) &&
+			cookedMesh.ReadSubmeshes(meshData.Submeshes, materials) &&
+			AnimationCache::ReadMorphTargets(cookedMesh, (UINT)meshData.Vertices.size(), morphTargets);
+
+		if (read)
+		{
+			scene.Model = AnimatedModelData(AnimationCache::ReadSkeleton(view), meshData);
+			scene.Model.materials = std::move(materials);
+			scene.Model.morphTargets = std::move(morphTargets);
+			scene.Clips = AnimationCache::ReadClips(view);
+			scene.Loaded = true;
+			scene.Cooked = true;
+
+			scene.Timings.Read = Lap(readStart);
+		}
+		else
 		{
-			break;
+			//a file that validates but can't be read back, such as one with another vertex stride, is treated as stale
+			DBG_OUTPUT(L"Failed to read the cooked Collada file, cooking it again\n");
+
+			cookedMesh.Close();
+			scene = ColladaScene();
+			LoadCooked(filename, maxWeights, cookedMesh, scene, true);
 		}
-		pArmatureNode = pArmatureNode->NextSiblingElement("node");
 	}
-	tinyxml2::XMLElement * pHeadNode = pArmatureNode->FirstChildElement("node");
 
-	JointData* rootJoint = LoadJointData(pHeadNode, true, jointOrder, inverseBindTransforms);
+	scene.Timings.Total = std::chrono::duration<double, std::milli>(Clock::now() - importStart).count();
 
-	return SkeletonData(jointOrder.size(), *rootJoint);
+	return scene;
 }
 
-JointData* ColladaLoader::LoadJointData(tinyxml2::XMLElement * node, bool isRoot, std::vector<std::string> jointOrder, std::vector<XMFLOAT4X4> inverseBindTransforms)
+bool ColladaLoader::LoadCooked(const char * filename, int maxWeights, MeshCache::CookedMesh & cookedMesh, ColladaScene & builtScene, bool recook)
 {
-	std::string nameId = node->Attribute("id");
-	auto it = std::find(jointOrder.begin(), jointOrder.end(), nameId);
-	int index = std::distance(jointOrder.begin(), it);
+	Clock::time_point lapStart = Clock::now();
+
+	MappedFile source;
 
-	//load the raw data as a list of strings
-	std::vector<std::string> matrixRawData = Util::SplitString(node->FirstChildElement("matrix")->GetText(), ' ');
+	if (!source.Open(filename))
+	{
+		DBG_OUTPUT(L"Failed to open the Collada file\n");
+		return false;
+	}
 
-	//convert the raw data into a matrix
-	XMMATRIX matrix = XMMATRIX(atof(matrixRawData[0].c_str()), atof(matrixRawData[1].c_str()), atof(matrixRawData[2].c_str()), atof(matrixRawData[3].c_str()),
-		atof(matrixRawData[4].c_str()), atof(matrixRawData[5].c_str()), atof(matrixRawData[6].c_str()), atof(matrixRawData[7].c_str()),
-		atof(matrixRawData[8].c_str()), atof(matrixRawData[9].c_str()), atof(matrixRawData[10].c_str()), atof(matrixRawData[11].c_str()),
-		atof(matrixRawData[12].c_str()), atof(matrixRawData[13].c_str()), atof(matrixRawData[14].c_str()), atof(matrixRawData[15].c_str()));
+	//the weight limit changes the cooked skin so it is folded into the hash along with the source bytes
+	UINT64 sourceHash = Util::HashBytes(source.GetData(), source.GetSize(), (UINT64)maxWeights);
 
-	//XMMatrixTranspose(matrix);
-	if (isRoot)
+	std::string cookedFilename = filename;
+	cookedFilename.append("Cooked");
+
+	AnimationCache::CookedAnimatedModel view;
+	if (!recook && cookedMesh.Open(cookedFilename.c_str(), sourceHash) && AnimationCache::GetAnimatedModel(cookedMesh, view))
 	{
-		//rotate the root bone so that it is facing upwards
-		//matrix = matrix * XMMatrixRotationX(-XM_PIDIV2);
+		builtScene.Timings.Cache = Lap(lapStart);
+		return true;
 	}
 
-	XMFLOAT4X4 matrixAsFloats;
-	XMStoreFloat4x4(&matrixAsFloats, matrix);
-	JointData* joint = new JointData(index, nameId, matrixAsFloats);
+	cookedMesh.Close();
+
+	double cacheTime = Lap(lapStart);
+
+	builtScene = Parse(source.GetData(), source.GetSize(), maxWeights);
 
-	joint->inverseBindTransform = inverseBindTransforms[index];
+	lapStart = Clock::now();
 
-	tinyxml2::XMLElement * childNode = node->FirstChildElement("node");
-	while (childNode)
+	if (!builtScene.Loaded)
 	{
-		joint->AddChild(LoadJointData(childNode, false, jointOrder, inverseBindTransforms));
-		childNode = childNode->NextSiblingElement("node");
+		return false;
 	}
 
-	return joint;
+	MeshCache::Writer writer;
+	bool written = writer.AddModel(builtScene.Model.meshData.Vertices, builtScene.Model.meshData.Indices) &&
+		writer.AddSubmeshes(builtScene.Model.meshData.Submeshes, builtScene.Model.materials) &&
+		AnimationCache::AddAnimatedModel(writer, builtScene.Model.joints, builtScene.Clips) &&
+		AnimationCache::AddMorphTargets(writer, builtScene.Model.morphTargets) &&
+		writer.Write(cookedFilename.c_str(), sourceHash);
+
+	if (!written)
+	{
+		DBG_OUTPUT(L"Failed to write the cooked Collada file\n");
+		return false;
+	}
+
+	bool opened = cookedMesh.Open(cookedFilename.c_str(), sourceHash);
+
+	builtScene.Timings.Cache = cacheTime + Lap(lapStart);
+
+	return opened;
 }
 
-IndexedSkeletalModel ColladaLoader::LoadGeometry(tinyxml2::XMLElement * node, std::vector<VertexSkinData> vertexSkinData)
+ColladaLoader::ColladaScene ColladaLoader::Parse(const char * data, size_t size, int maxWeights)
 {
-	std::vector<VertexData> verts;
-	std::vector<XMFLOAT3> normals;
-	std::vector<XMFLOAT2> TexCoords;
-	std::vector<int> indices;
+	ColladaScene scene;
 
+	Clock::time_point parseStart = Clock::now();
+	Clock::time_point lapStart = parseStart;
 
-	tinyxml2::XMLElement * pMeshNode = node->FirstChildElement("geometry")->FirstChildElement("mesh");
+	DocumentIndex index;
 
-	//read the raw data ----------------------------------------------------------------------------------------------
+	if (!IndexDocument(data, size, index))
+	{
+		return scene;
+	}
 
-	//read in the Ids
-	std::string positionsId = pMeshNode->FirstChildElement("vertices")->FirstChildElement("input")->Attribute("source");
-	//remove the # from the begining
-	positionsId.erase(positionsId.begin());
+	scene.Timings.Parse = Lap(lapStart);
 
-	std::string normalsId;
-	std::string texCoordsId;
+	std::string rootJointName;
+	int rootJointNode = FindRootJointNode(index);
 
-	tinyxml2::XMLElement * pPolyNode = pMeshNode->FirstChildElement("polylist");
+	SkinningData mergedSkin;
+	std::vector<SkinnedPiece> pieces = LoadSkins(index, maxWeights, mergedSkin);
 
-	if (!pPolyNode)
+	if (!pieces.empty() && rootJointNode >= 0)
 	{
-		pPolyNode = pMeshNode->FirstChildElement("triangles");
+		scene.Timings.Skin = Lap(lapStart);
+
+		SkeletonData skeletonData = LoadSkeleton(index, rootJointNode, mergedSkin.jointOrder, mergedSkin.bindMatrices);
+		rootJointName = skeletonData.rootJoint.nameID;
+		scene.Timings.Skeleton = Lap(lapStart);
+
+		std::vector<std::string> materials;
+		std::vector<IndexedSkeletalModel> pieceModels;
+		std::vector<MorphTargetData> morphTargets;
+		UINT firstVertex = 0;
+		for (const SkinnedPiece& piece : pieces)
+		{
+			pieceModels.push_back(LoadGeometry(index, *piece.Geometry, piece.Skin, materials));
+
+			//the pieces' vertices are merged in order, so each target only needs moving past the pieces before its own
+			if (piece.Morph)
+			{
+				for (MorphTargetData& target : LoadMorphTargets(index, *piece.Morph, pieceModels.back(), piece.Skin))
+				{
+					for (UINT& vertex : target.vertices)
+					{
+						vertex += firstVertex;
+					}
+					morphTargets.push_back(std::move(target));
+				}
+			}
+
+			firstVertex += (UINT)pieceModels.back().Vertices.size();
+		}
+
+		IndexedSkeletalModel meshData = MergeGeometry(pieceModels, materials.size());
+		scene.Timings.Geometry = Lap(lapStart);
+
+		std::vector<UINT> vertexRemap;
+		MeshOptimizer::OutputStatistics(L"Collada", MeshOptimizer::Optimize(meshData, &vertexRemap));
+		RemapMorphTargets(morphTargets, vertexRemap);
+		scene.Timings.Optimize = Lap(lapStart);
+
+		scene.Model = AnimatedModelData(skeletonData, meshData);
+		scene.Model.materials = std::move(materials);
+		scene.Model.morphTargets = std::move(morphTargets);
+		scene.Loaded = true;
+	}
+	else if (rootJointNode >= 0)
+	{
+		rootJointName = index.Nodes[rootJointNode].Id;
 	}
 
-	tinyxml2::XMLElement * pInputNode = pPolyNode->FirstChildElement("input");
+	scene.Clips = LoadAnimations(index, rootJointName);
+	scene.Timings.Animations = Lap(lapStart);
 
-	int typeCount = 0;
+	scene.Timings.Total = std::chrono::duration<double, std::milli>(Clock::now() - parseStart).count();
 
-	while (pInputNode)
+	return scene;
+}
+
+bool ColladaLoader::IndexDocument(const char * data, size_t size, DocumentIndex & index)
+{
+	Reader reader(data, size);
+
+	while (reader.Next() == Reader::PULL_TEXT)
+	{
+	}
+
+	if (reader.CurrentEvent() != Reader::PULL_START_ELEMENT || !reader.NameIs("COLLADA"))
 	{
-		typeCount++;
-		if (strcmp(pInputNode->Attribute("semantic"), "NORMAL") == 0)
+		DBG_OUTPUT(L"Collada file has no COLLADA root element\n");
+		return false;
+	}
+
+	ForEachChild(reader, [&]()
+	{
+		if (reader.NameIs("library_geometries"))
 		{
-			normalsId = pInputNode->Attribute("source");
-			normalsId.erase(normalsId.begin());
+			IndexGeometries(reader, index);
 		}
-		else if (strcmp(pInputNode->Attribute("semantic"), "TEXCOORD") == 0)
+		else if (reader.NameIs("library_controllers"))
 		{
-			texCoordsId = pInputNode->Attribute("source");
-			texCoordsId.erase(texCoordsId.begin());
+			IndexControllers(reader, index);
 		}
-		pInputNode = pInputNode->NextSiblingElement("input");
-	}
-	
-	
-	tinyxml2::XMLElement * pSourceNode = pMeshNode->FirstChildElement("source");
+		else if (reader.NameIs("library_animations"))
+		{
+			ForEachChild(reader, [&]()
+			{
+				if (reader.NameIs("animation"))
+				{
+					IndexAnimation(reader, index);
+				}
+			});
+		}
+		else if (reader.NameIs("library_animation_clips"))
+		{
+			IndexAnimationClips(reader, index);
+		}
+		else if (reader.NameIs("library_visual_scenes"))
+		{
+			IndexVisualScenes(reader, index);
+		}
+	});
 
-	while (pSourceNode)
+	if (reader.ErrorID() != tinyxml2::XML_SUCCESS)
 	{
-		//read the positions
-		if (strcmp(pSourceNode->Attribute("id"), positionsId.c_str()) == 0)
-		{
-			tinyxml2::XMLElement * pPositionData = pSourceNode->FirstChildElement("float_array");
+		DBG_OUTPUT(L"Collada file is malformed, error %d at byte %u\n", (int)reader.ErrorID(), (UINT)reader.ErrorOffset());
+		return false;
+	}
 
-			int count = atoi(pPositionData->Attribute("count"));
+	return true;
+}
 
-			std::vector<std::string> positionRawData = Util::SplitString(pPositionData->GetText(), ' ');
+void ColladaLoader::OutputTimings(const WCHAR * label, const ImportTimings & timings)
+{
+	//wvsprintf has no floating point so the times are written in microseconds as fixed point
+	auto ms = [](double time) { return (UINT)(time * 1000.0 + 0.5); };
+
+	DBG_OUTPUT(L"%s imported in %u.%03u ms, cache %u.%03u, read %u.%03u, parse %u.%03u, skin %u.%03u, skeleton %u.%03u, geometry %u.%03u, optimize %u.%03u, animations %u.%03u\n",
+		label, ms(timings.Total) / 1000, ms(timings.Total) % 1000,
+		ms(timings.Cache) / 1000, ms(timings.Cache) % 1000,
+		ms(timings.Read) / 1000, ms(timings.Read) % 1000,
+		ms(timings.Parse) / 1000, ms(timings.Parse) % 1000,
+		ms(timings.Skin) / 1000, ms(timings.Skin) % 1000,
+		ms(timings.Skeleton) / 1000, ms(timings.Skeleton) % 1000,
+		ms(timings.Geometry) / 1000, ms(timings.Geometry) % 1000,
+		ms(timings.Optimize) / 1000, ms(timings.Optimize) % 1000,
+		ms(timings.Animations) / 1000, ms(timings.Animations) % 1000);
+}
 
-			for (int i = 0; i < count / 3; i++)
-			{
-				float x = atof(positionRawData[i * 3].c_str());
-				float y = atof(positionRawData[i * 3 + 1].c_str());
-				float z = atof(positionRawData[i * 3 + 2].c_str());
+std::vector<MorphTargetData> ColladaLoader::LoadMorphTargets(const DocumentIndex & index, const Morph & morph, const IndexedSkeletalModel & base, const std::vector<VertexSkinData>& vertexSkinData)
+{
+	std::vector<MorphTargetData> targets;
 
-				Vector3D position = { x,y,z };
+	auto baseGeometry = index.Geometries.find(morph.Geometry);
+	if (baseGeometry == index.Geometries.end())
+	{
+		return targets;
+	}
 
-				Quaternion rotation = Quaternion(-XM_PIDIV2, 0, 0);
+	const SourceArray* basePositions = FindSource(index, &baseGeometry->second.PositionsSource);
 
-				//rotation.RotateVectorByQuaternion(position);
-				verts.push_back(VertexData(verts.size(), position, vertexSkinData[verts.size()]));
-			}
-		}
-		//read the normals
-		else if (strcmp(pSourceNode->Attribute("id"), normalsId.c_str()) == 0)
+	std::vector<std::string> targetIds;
+	ReadNameArray(FindSource(index, FindInputSource(morph.TargetInputs, "MORPH_TARGET")), targetIds);
+
+	//anything smaller than this is export noise rather than part of the shape
+	const float epsilon = 1e-6f;
+
+	for (const std::string& targetId : targetIds)
+	{
+		auto geometry = index.Geometries.find(targetId);
+		if (geometry == index.Geometries.end())
 		{
-			tinyxml2::XMLElement * pNormalData = pSourceNode->FirstChildElement("float_array");
+			continue;
+		}
 
-			int count = atoi(pNormalData->Attribute("count"));
+		//building the target like the base only lines up vertex for vertex if it has the same positions and corners
+		const SourceArray* positions = FindSource(index, &geometry->second.PositionsSource);
+		if (!basePositions || !positions || positions->Count != basePositions->Count)
+		{
+			DBG_OUTPUT(L"Collada morph target doesn't have the same positions as its base, skipped\n");
+			continue;
+		}
 
-			std::vector<std::string> normalRawData = Util::SplitString(pNormalData->GetText(), ' ');
+		std::vector<std::string> materials;
+		IndexedSkeletalModel targetModel = LoadGeometry(index, geometry->second, vertexSkinData, materials);
 
-			for (int i = 0; i < count / 3; i++)
-			{
-				float x = atof(normalRawData[i * 3].c_str());
-				float y = atof(normalRawData[i * 3 + 1].c_str());
-				float z = atof(normalRawData[i * 3 + 2].c_str());
-				Vector3D normal = { x,y,z };
-				Quaternion rotation = Quaternion(-XM_PIDIV2, 0, 0);
-				//rotation.RotateVectorByQuaternion(normal);
-				normals.push_back(XMFLOAT3(normal.x, normal.y, normal.z));
-			}
+		if (targetModel.Vertices.size() != base.Vertices.size() || targetModel.Indices != base.Indices)
+		{
+			DBG_OUTPUT(L"Collada morph target doesn't have the same topology as its base, skipped\n");
+			continue;
 		}
-		//read texture coordinates
-		else if (strcmp(pSourceNode->Attribute("id"), texCoordsId.c_str()) == 0)
+
+		MorphTargetData target;
+		target.name = geometry->second.Name.empty() ? targetId : geometry->second.Name;
+
+		for (UINT vertex = 0; vertex < (UINT)base.Vertices.size(); vertex++)
 		{
-			tinyxml2::XMLElement * ptexCoordData = pSourceNode->FirstChildElement("float_array");
+			const SkeletalVertex& from = base.Vertices[vertex];
+			const SkeletalVertex& to = targetModel.Vertices[vertex];
 
-			int count = atoi(ptexCoordData->Attribute("count"));
+			MorphDelta delta;
+			delta.position = XMFLOAT4(to.PosL.x - from.PosL.x, to.PosL.y - from.PosL.y, to.PosL.z - from.PosL.z, 0.0f);
+			delta.normal = XMFLOAT4(to.NormL.x - from.NormL.x, to.NormL.y - from.NormL.y, to.NormL.z - from.NormL.z, 0.0f);
 
-			std::vector<std::string> texCoordsRawData = Util::SplitString(ptexCoordData->GetText(), ' ');
+			float largest = 0.0f;
+			for (float component : { delta.position.x, delta.position.y, delta.position.z, delta.normal.x, delta.normal.y, delta.normal.z })
+			{
+				largest = std::max(largest, std::abs(component));
+			}
 
-			for (int i = 0; i < count / 2; i++)
+			if (largest > epsilon)
 			{
-				float u = atof(texCoordsRawData[i * 2].c_str());
-				float v = atof(texCoordsRawData[i * 2 + 1].c_str());
-				TexCoords.push_back(XMFLOAT2(u, v));
+				target.vertices.push_back(vertex);
+				target.deltas.push_back(delta);
 			}
 		}
 
-		pSourceNode = pSourceNode->NextSiblingElement("source");
+		targets.push_back(std::move(target));
 	}
 
-	//Assemble the vertices--------------------------------------------------------------------------------------------------------
+	return targets;
+}
 
-	std::vector<std::string> indexRawData = Util::SplitString(pPolyNode->FirstChildElement("p")->GetText(), ' ');
+std::vector<AnimationData> ColladaLoader::LoadAnimations(const DocumentIndex & index, const std::string & rootJointName)
+{
+	std::vector<AnimationData> clips;
 
-	for (int i = 0; i < indexRawData.size() / typeCount; i++)
+	if (index.Animations.empty() || rootJointName.empty())
 	{
-		int positionIndex = atoi(indexRawData[i * typeCount].c_str());
-		int normalIndex = atoi(indexRawData[i * typeCount + 1].c_str());
-		int texCoordIndex = atoi(indexRawData[i * typeCount + 2].c_str());
+		return clips;
+	}
+
+	if (index.Clips.empty())
+	{
+		std::vector<AnimationChannel> channels;
 
-		VertexData* currentVertex = &verts.at(positionIndex);
-		if (!currentVertex->IsSet())
+		for (int animation = 0; animation < (int)index.Animations.size(); animation = index.Animations[animation].End)
 		{
-			currentVertex->textureIndex = texCoordIndex;
-			currentVertex->normalIndex = normalIndex;
-			indices.push_back(positionIndex);
+			LoadChannels(index, animation, channels);
 		}
-		else
+
+		clips.push_back(BuildClip(channels, rootJointName, -FLT_MAX, FLT_MAX, 0.0f));
+		return clips;
+	}
+
+	//clips refer to the top level animations by id and several may share the same ones, so each is only read once
+	std::unordered_map<std::string, std::vector<AnimationChannel>> animations;
+
+	for (int animation = 0; animation < (int)index.Animations.size(); animation = index.Animations[animation].End)
+	{
+		if (!index.Animations[animation].Id.empty())
 		{
-			DealWithAlreadyProcessedVertex(currentVertex, texCoordIndex, normalIndex, indices, verts);
+			LoadChannels(index, animation, animations[index.Animations[animation].Id]);
 		}
 	}
 
-	//Remove unused vertices -------------------------------------------------------------------------------------------------------
-	for (VertexData vertex : verts)
+	for (const AnimationClip& clipIndex : index.Clips)
 	{
-		vertex.AverageTangents();
+		std::vector<AnimationChannel> channels;
 
-		if (!vertex.IsSet())
+		for (const std::string& url : clipIndex.Animations)
 		{
-			vertex.textureIndex = 0;
-			vertex.normalIndex = 0;
+			auto it = animations.find(url);
+			if (it != animations.end())
+			{
+				channels.insert(channels.end(), it->second.begin(), it->second.end());
+			}
 		}
-	}	
 
-	SkeletalVertex* finalVerts = new SkeletalVertex[verts.size()];
+		clips.push_back(BuildClip(channels, rootJointName, clipIndex.Start, clipIndex.End, clipIndex.Start));
+	}
 
-	for (int i = 0; i < verts.size(); i++)
-	{
-		VertexData currentVertex = verts.at(i);
+	return clips;
+}
 
-		finalVerts[i].PosL.x = verts.at(i).position.x;
-		finalVerts[i].PosL.y = verts.at(i).position.y;
-		finalVerts[i].PosL.z = verts.at(i).position.z;
+SkinningData ColladaLoader::LoadSkin(const DocumentIndex & index, const Skin & skin, int maxWeights)
+{
+	std::vector<std::string> jointNames;
+	std::vector<float> weights;
+	std::vector<int> effectorJointCounts;
+	std::vector<VertexSkinData> vertexWeights;
+	std::vector<XMFLOAT4X4> bindMatrices;
 
-		finalVerts[i].NormL = normals.at(currentVertex.normalIndex);
+	ReadNameArray(FindSource(index, FindInputSource(skin.WeightInputs, "JOINT")), jointNames);
+	ReadFloatArray(FindSource(index, FindInputSource(skin.WeightInputs, "WEIGHT")), weights);
 
-		XMFLOAT2 textureCoord = TexCoords.at(currentVertex.textureIndex);
-		finalVerts[i].Tex.x = textureCoord.x;
-		finalVerts[i].Tex.y = 1 - textureCoord.y;
+	const SourceArray* pInverseBindSource = FindSource(index, FindInputSource(skin.JointInputs, "INV_BIND_MATRIX"));
+	if (pInverseBindSource)
+	{
+		std::vector<float> rawData;
+		ReadFloatArray(pInverseBindSource, rawData);
 
-		finalVerts[i].Weights = currentVertex.weightsData.GetWeights();
+		int boneCount = (int)pInverseBindSource->AccessorCount;
 
-		finalVerts[i].BoneIndices = currentVertex.weightsData.GetBoneIndices();
+		for (int i = 0; i < boneCount && (i + 1) * 16 <= (int)rawData.size(); i++)
+		{
+			bindMatrices.push_back(XMFLOAT4X4(&rawData[i * 16]));
+		}
 	}
 
-	
+	//get the effective vertex counts data
+	effectorJointCounts.resize(skin.VertexCount);
+	effectorJointCounts.resize(ReadInts(skin.InfluenceCounts, effectorJointCounts.data(), effectorJointCounts.size()));
 
-	unsigned short* indicesArray = new unsigned short[indices.size()];
-	unsigned int numMeshIndices = indices.size();
-	for (unsigned int i = 0; i < numMeshIndices; ++i)
+	//get the vertex weights, a joint and weight index pair for every effect
+	size_t effectCount = 0;
+	for (int count : effectorJointCounts)
 	{
-		indicesArray[i] = indices[i];
+		effectCount += count;
 	}
-	
-	InsertTangentsIntoArray(finalVerts, indicesArray, verts.size());
 
-	IndexedSkeletalModel indexedSkeletalModel;
+	std::vector<int> rawData(effectCount * 2);
+	rawData.resize(ReadInts(skin.Influences, rawData.data(), rawData.size()));
 
-	indexedSkeletalModel.Vertices.assign(&finalVerts[0], &finalVerts[verts.size()]);
-	indexedSkeletalModel.Indices.assign(&indicesArray[0], &indicesArray[numMeshIndices]);
+	vertexWeights.reserve(effectorJointCounts.size());
 
-	return indexedSkeletalModel;
+	int pointer = 0;
+	for (int count : effectorJointCounts)
+	{
+		VertexSkinData skinData;
+		for (int i = 0; i < count && pointer + 1 < (int)rawData.size(); i++)
+		{
+			int jointId = rawData[pointer++];
+			int weightId = rawData[pointer++];
+			skinData.AddJointEffect(jointId, weights[weightId]);
+		}
+		skinData.LimitJointNumber(maxWeights);
+		vertexWeights.push_back(skinData);
+	}
+
+	return SkinningData(std::move(jointNames), std::move(vertexWeights), std::move(bindMatrices));
 }
 
-void ColladaLoader::DealWithAlreadyProcessedVertex(VertexData *previousVertex, int newTextureIndex, int newNormalIndex, std::vector<int> &indices, std::vector<VertexData> &verts)
+SkeletonData ColladaLoader::LoadSkeleton(const DocumentIndex & index, int rootJointNode, const std::vector<std::string>& jointOrder, const std::vector<XMFLOAT4X4>& inverseBindTransforms)
 {
-	//vertex has already been processed
-	if (previousVertex->HasSameTextureAndNormal(newTextureIndex, newNormalIndex))
+	JointIndices jointIndices;
+	jointIndices.reserve(jointOrder.size());
+	for (size_t i = 0; i < jointOrder.size(); i++)
+	{
+		jointIndices.emplace(jointOrder[i], (int)i);
+	}
+
+	JointData* rootJoint = LoadJointData(index, rootJointNode, true, jointIndices, inverseBindTransforms);
+
+	return SkeletonData(jointOrder.size(), *rootJoint);
+}
+
+JointData* ColladaLoader::LoadJointData(const DocumentIndex & index, int node, bool isRoot, const JointIndices& jointIndices, const std::vector<XMFLOAT4X4>& inverseBindTransforms)
+{
+	const SceneNode& sceneNode = index.Nodes[node];
+	const std::string& nameId = sceneNode.Id;
+
+	//nodes the skin doesn't bind are given the index after the last joint and an identity inverse bind
+	auto it = jointIndices.find(nameId);
+	int jointIndex = it != jointIndices.end() ? it->second : (int)jointIndices.size();
+
+	//read the matrix straight from the text, anything missing is left as identity
+	XMFLOAT4X4 matrixRawData;
+	XMStoreFloat4x4(&matrixRawData, XMMatrixIdentity());
+	ReadFloats(sceneNode.Matrix, &matrixRawData._11, 16);
+
+	XMMATRIX matrix = XMLoadFloat4x4(&matrixRawData);
+
+	//XMMatrixTranspose(matrix);
+	if (isRoot)
+	{
+		//rotate the root bone so that it is facing upwards
+		//matrix = matrix * XMMatrixRotationX(-XM_PIDIV2);
+	}
+
+	XMFLOAT4X4 matrixAsFloats;
+	XMStoreFloat4x4(&matrixAsFloats, matrix);
+	JointData* joint = new JointData(jointIndex, nameId, matrixAsFloats);
+
+	if (jointIndex < (int)inverseBindTransforms.size())
 	{
-		indices.push_back(previousVertex->index);
+		joint->inverseBindTransform = inverseBindTransforms[jointIndex];
 	}
 	else
 	{
-		VertexData* anotherVertex = previousVertex->GetDuplicateVertex();
-		if (anotherVertex != nullptr)
-		{
-			return DealWithAlreadyProcessedVertex(anotherVertex, newTextureIndex, newNormalIndex, indices, verts);
-		}
-		else
-		{
-			VertexData* duplicateVertex = new VertexData(verts.size(), previousVertex->position, previousVertex->weightsData);
-			duplicateVertex->textureIndex = newTextureIndex;
-			duplicateVertex->normalIndex = newNormalIndex;
-			previousVertex->duplicateVertex = duplicateVertex;
-			verts.push_back(*duplicateVertex);
-			indices.push_back(duplicateVertex->index);
-		}
+		XMStoreFloat4x4(&joint->inverseBindTransform, XMMatrixIdentity());
 	}
-}
 
-void ColladaLoader::InsertTangentsIntoArray(SkeletalVertex * vertices, unsigned short* indices, int vertexCount)
-{
-	int faceCount, i, index;
-	SkeletalVertex vertex1, vertex2, vertex3;
-	XMFLOAT3 tangent;
-
-
-	// Calculate the number of faces in the model.
-	faceCount = vertexCount / 3;
-
-	// Initialize the index to the model data.
-	index = 0;
-
-	// Go through all the faces and calculate the the tangent, binormal, and normal vectors.
-	for (i = 0; i < faceCount; i++)
-	{
-		// Get the three vertices for this face from the model.
-		vertex1.PosL.x = vertices[indices[index]].PosL.x;
-		vertex1.PosL.y = vertices[indices[index]].PosL.y;
-		vertex1.PosL.z = vertices[indices[index]].PosL.z;
-		vertex1.Tex.x = vertices[indices[index]].Tex.x;
-		vertex1.Tex.y = vertices[indices[index]].Tex.y;
-		vertex1.NormL.x = vertices[indices[index]].NormL.x;
-		vertex1.NormL.y = vertices[indices[index]].NormL.y;
-		vertex1.NormL.z = vertices[indices[index]].NormL.z;
-		index++;
-
-		vertex2.PosL.x = vertices[indices[index]].PosL.x;
-		vertex2.PosL.y = vertices[indices[index]].PosL.y;
-		vertex2.PosL.z = vertices[indices[index]].PosL.z;
-		vertex2.Tex.x = vertices[indices[index]].Tex.x;
-		vertex2.Tex.y = vertices[indices[index]].Tex.y;
-		vertex2.NormL.x = vertices[indices[index]].NormL.x;
-		vertex2.NormL.y = vertices[indices[index]].NormL.y;
-		vertex2.NormL.z = vertices[indices[index]].NormL.z;
-		index++;
-
-		vertex3.PosL.x = vertices[indices[index]].PosL.x;
-		vertex3.PosL.y = vertices[indices[index]].PosL.y;
-		vertex3.PosL.z = vertices[indices[index]].PosL.z;
-		vertex3.Tex.x = vertices[indices[index]].Tex.x;
-		vertex3.Tex.y = vertices[indices[index]].Tex.y;
-		vertex3.NormL.x = vertices[indices[index]].NormL.x;
-		vertex3.NormL.y = vertices[indices[index]].NormL.y;
-		vertex3.NormL.z = vertices[indices[index]].NormL.z;
-		index++;
-
-		tangent = CalculateTangent(vertex1, vertex2, vertex3);
-
-		// Store the tangent for this face back in the model structure.
-
-		vertices[indices[index - 1]].Tangent.x = tangent.x;
-		vertices[indices[index - 1]].Tangent.y = tangent.y;
-		vertices[indices[index - 1]].Tangent.z = tangent.z;
-								   
-		vertices[indices[index - 2]].Tangent.x = tangent.x;
-		vertices[indices[index - 2]].Tangent.y = tangent.y;
-		vertices[indices[index - 2]].Tangent.z = tangent.z;
-								   
-		vertices[indices[index - 3]].Tangent.x = tangent.x;
-		vertices[indices[index - 3]].Tangent.y = tangent.y;
-		vertices[indices[index - 3]].Tangent.z = tangent.z;
+	for (int childNode = node + 1; childNode < sceneNode.End; childNode = index.Nodes[childNode].End)
+	{
+		joint->AddChild(LoadJointData(index, childNode, false, jointIndices, inverseBindTransforms));
 	}
+
+	return joint;
 }
 
-XMFLOAT3 ColladaLoader::CalculateTangent(SkeletalVertex v0, SkeletalVertex v1, SkeletalVertex v2)
+IndexedSkeletalModel ColladaLoader::LoadGeometry(const DocumentIndex & index, const Geometry & geometry, const std::vector<VertexSkinData>& vertexSkinData, std::vector<std::string>& materials)
 {
-	XMVECTOR vv0 = XMLoadFloat3(&v0.PosL);
-	XMVECTOR vv1 = XMLoadFloat3(&v1.PosL);
-	XMVECTOR vv2 = XMLoadFloat3(&v2.PosL);
-
-	XMVECTOR e0 = vv1 - vv0;
-	XMVECTOR e1 = vv2 - vv0;
+	std::vector<VertexData> verts;
+	std::vector<XMFLOAT3> normals;
+	std::vector<XMFLOAT2> TexCoords;
+	std::vector<UINT> indices;
+	std::vector<Submesh> submeshes;
 
-	//using Eric Lengyel's approach with a few modifications
-	//from Mathematics for 3D Game Programmming and Computer Graphics
-	// want to be able to trasform a vector in Object Space to Tangent Space
-	// such that the x-axis cooresponds to the 's' direction and the
-	// y-axis corresponds to the 't' direction, and the z-axis corresponds
-	// to <0,0,1>, straight up out of the texture map
+	if (geometry.Primitives.empty())
+	{
+		return IndexedSkeletalModel();
+	}
 
-	//let P = v1 - v0
-	XMVECTOR P = vv1 - vv0;
-	//let Q = v2 - v0
-	XMVECTOR Q = vv2 - vv0;
-	float s1 = v1.Tex.x - v0.Tex.x;
-	float t1 = v1.Tex.y - v0.Tex.y;
-	float s2 = v2.Tex.x - v0.Tex.x;
-	float t2 = v2.Tex.y - v0.Tex.y;
+	//read the raw data ----------------------------------------------------------------------------------------------
 
+	//every primitive is expected to index the same sources, so they are found from the first one
+	const std::vector<Input>& inputs = geometry.Primitives.front().Inputs;
 
-	//we need to solve the equation
-	// P = s1*T + t1*B
-	// Q = s2*T + t2*B
-	// for T and B
+	//read the positions
+	std::vector<float> positionRawData;
+	ReadFloatArray(FindSource(index, &geometry.PositionsSource), positionRawData);
 
+	size_t positionCount = positionRawData.size() / 3;
+	verts.reserve(positionCount);
 
-	//this is a linear system with six unknowns and six equatinos, for TxTyTz BxByBz
-	//[px,py,pz] = [s1,t1] * [Tx,Ty,Tz]
-	// qx,qy,qz     s2,t2     Bx,By,Bz
+	for (size_t i = 0; i < positionCount; i++)
+	{
+		Vector3D position = { positionRawData[i * 3], positionRawData[i * 3 + 1], positionRawData[i * 3 + 2] };
 
-	//multiplying both sides by the inverse of the s,t matrix gives
-	//[Tx,Ty,Tz] = 1/(s1t2-s2t1) *  [t2,-t1] * [px,py,pz]
-	// Bx,By,Bz                      -s2,s1	    qx,qy,qz  
+		verts.push_back(VertexData(verts.size(), position, vertexSkinData[verts.size()]));
+	}
 
-	//solve this for the unormalized T and B to get from tangent to object space
+	//read the normals and texture coordinates straight into place
+	if (const SourceArray* pNormalData = FindSource(index, FindInputSource(inputs, "NORMAL")))
+	{
+		normals.resize(pNormalData->Count / 3);
+		normals.resize(ReadFloats(pNormalData->Text, &normals.data()->x, normals.size() * 3) / 3);
+	}
 
-	float tmp = 0.0f;
-	if (fabsf(s1*t2 - s2 * t1) <= 0.0001f)
+	if (const SourceArray* pTexCoordData = FindSource(index, FindInputSource(inputs, "TEXCOORD")))
 	{
-		tmp = 1.0f;
+		TexCoords.resize(pTexCoordData->Count / 2);
+		TexCoords.resize(ReadFloats(pTexCoordData->Text, &TexCoords.data()->x, TexCoords.size() * 2) / 2);
 	}
-	else
+
+	//Assemble the vertices--------------------------------------------------------------------------------------------------------
+
+	//each primitive becomes a submesh drawn with its own material
+	for (const Primitive& primitive : geometry.Primitives)
 	{
-		tmp = 1.0f / (s1*t2 - s2 * t1);
+		int typeCount = (int)primitive.Inputs.size();
+		if (typeCount < 3)
+		{
+			continue;
+		}
+
+		//a polylist gives each polygon's corner count, triangles always have three
+		size_t cornerCount = 0;
+		if (primitive.VertexCounts.Start())
+		{
+			std::vector<int> vertexCounts(primitive.Count);
+			vertexCounts.resize(ReadInts(primitive.VertexCounts, vertexCounts.data(), vertexCounts.size()));
+
+			for (int count : vertexCounts)
+			{
+				cornerCount += count;
+			}
+		}
+		else
+		{
+			cornerCount = primitive.Count * 3;
+		}
+
+		std::vector<int> indexRawData(cornerCount * typeCount);
+		indexRawData.resize(ReadInts(primitive.Indices, indexRawData.data(), indexRawData.size()));
+
+		auto materialIt = std::find(materials.begin(), materials.end(), primitive.Material);
+		if (materialIt == materials.end())
+		{
+			materialIt = materials.insert(materials.end(), primitive.Material);
+		}
+
+		Submesh submesh;
+		submesh.StartIndex = (UINT)indices.size();
+		submesh.MaterialId = (UINT)(materialIt - materials.begin());
+
+		indices.reserve(indices.size() + indexRawData.size() / typeCount);
+
+		for (size_t i = 0; i < indexRawData.size() / typeCount; i++)
+		{
+			int positionIndex = indexRawData[i * typeCount];
+			int normalIndex = indexRawData[i * typeCount + 1];
+			int texCoordIndex = indexRawData[i * typeCount + 2];
+
+			VertexData* currentVertex = &verts.at(positionIndex);
+			if (!currentVertex->IsSet())
+			{
+				currentVertex->textureIndex = texCoordIndex;
+				currentVertex->normalIndex = normalIndex;
+				indices.push_back(positionIndex);
+			}
+			else
+			{
+				DealWithAlreadyProcessedVertex(positionIndex, texCoordIndex, normalIndex, indices, verts);
+			}
+		}
+
+		submesh.IndexCount = (UINT)indices.size() - submesh.StartIndex;
+		submeshes.push_back(submesh);
 	}
 
-	XMFLOAT3 PF3, QF3;
-	XMStoreFloat3(&PF3, P);
-	XMStoreFloat3(&QF3, Q);
+	//Remove unused vertices -------------------------------------------------------------------------------------------------------
+	for (VertexData& vertex : verts)
+	{
+		if (!vertex.IsSet())
+		{
+			vertex.textureIndex = 0;
+			vertex.normalIndex = 0;
+		}
+	}	
+
+	//built straight into the model so nothing is left to free on the way out
+	IndexedSkeletalModel indexedSkeletalModel;
+	std::vector<SkeletalVertex>& finalVerts = indexedSkeletalModel.Vertices;
+	finalVerts.resize(verts.size());
+
+	for (int i = 0; i < verts.size(); i++)
+	{
+		const VertexData& currentVertex = verts.at(i);
+
+		finalVerts[i].PosL.x = verts.at(i).position.x;
+		finalVerts[i].PosL.y = verts.at(i).position.y;
+		finalVerts[i].PosL.z = verts.at(i).position.z;
+
+		finalVerts[i].NormL = normals.at(currentVertex.normalIndex);
+
+		XMFLOAT2 textureCoord = TexCoords.at(currentVertex.textureIndex);
+		finalVerts[i].Tex.x = textureCoord.x;
+		finalVerts[i].Tex.y = 1 - textureCoord.y;
+
+		finalVerts[i].Weights = currentVertex.weightsData.GetWeights();
+
+		finalVerts[i].BoneIndices = currentVertex.weightsData.GetBoneIndices();
+	}
 
-	XMFLOAT3 tangent;
-	tangent.x = (t2*PF3.x - t1 * QF3.x);
-	tangent.y = (t2*PF3.y - t1 * QF3.y);
-	tangent.z = (t2*PF3.z - t1 * QF3.z);
+	indexedSkeletalModel.Indices = std::move(indices);
 
-	tangent.x = tangent.x*tmp;
-	tangent.y = tangent.y*tmp;
-	tangent.z = tangent.z*tmp;
+	TangentGenerator::OutputStatistics(L"Collada", TangentGenerator::Generate(indexedSkeletalModel.Vertices, indexedSkeletalModel.Indices));
 
-	XMVECTOR vt = XMLoadFloat3(&tangent);
+	indexedSkeletalModel.Submeshes = std::move(submeshes);
 
-	vt = XMVector3Normalize(vt);
+	return indexedSkeletalModel;
+}
 
-	XMStoreFloat3(&tangent, vt);
+void ColladaLoader::DealWithAlreadyProcessedVertex(int previousIndex, int newTextureIndex, int newNormalIndex, std::vector<UINT> &indices, std::vector<VertexData> &verts)
+{
+	VertexData& previousVertex = verts[previousIndex];
 
-	return tangent;
+	//vertex has already been processed
+	if (previousVertex.HasSameTextureAndNormal(newTextureIndex, newNormalIndex))
+	{
+		indices.push_back(previousVertex.index);
+	}
+	else if (previousVertex.duplicateIndex != -1)
+	{
+		return DealWithAlreadyProcessedVertex(previousVertex.duplicateIndex, newTextureIndex, newNormalIndex, indices, verts);
+	}
+	else
+	{
+		//chained by index rather than pointer as growing verts moves the vertices
+		VertexData duplicateVertex(verts.size(), previousVertex.position, previousVertex.weightsData);
+		duplicateVertex.textureIndex = newTextureIndex;
+		duplicateVertex.normalIndex = newNormalIndex;
+		previousVertex.duplicateIndex = duplicateVertex.index;
+		verts.push_back(duplicateVertex);
+		indices.push_back(duplicateVertex.index);
+	}
 }
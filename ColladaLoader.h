@@ -1,27 +1,166 @@
 #pragma once
 
+#include <unordered_map>
+
 #include "Commons.h"
 #include "Vector.h"
 #include "AnimatedModelData.h"
 #include "TinyXML2.h"
+#include "MeshCache.h"
 
 namespace ColladaLoader
 {
-	AnimatedModelData LoadModel(const char* filename, int maxWeights);
+	//How long each part of an import took in milliseconds
+	struct ImportTimings
+	{
+		double Cache = 0.0; //hashing the source and opening the cooked file, plus writing it again when it was stale
+		double Read = 0.0; //copying the cooked data out into the loader's types
+		double Parse = 0.0; //reading through the XML to index it, the rest are only spent when the source is parsed
+		double Skin = 0.0;
+		double Skeleton = 0.0;
+		double Geometry = 0.0;
+		double Optimize = 0.0;
+		double Animations = 0.0;
+		double Total = 0.0;
+	};
+
+	//Everything the importer takes from one .dae, the skinned model and every animation clip in it
+	struct ColladaScene
+	{
+		bool Loaded = false; //false when the file couldn't be parsed or has no skin, the clips may still have been read
+		bool Cooked = false; //read from the cooked file rather than parsed
+		AnimatedModelData Model;
+		std::vector<AnimationData> Clips;
+		ImportTimings Timings;
+	};
+
+	//Joint ids to their position in the skin's joint list
+	typedef std::unordered_map<std::string, int> JointIndices;
+
+	//An <input>, its source without the # in front
+	struct Input
+	{
+		std::string Semantic;
+		std::string Source;
+	};
+
+	//A <source>'s <float_array>, <Name_array> or <IDREF_array>, left as text until the values are needed
+	struct SourceArray
+	{
+		tinyxml2::XMLSpan Text;
+		UINT Count = 0; //values the array says it holds
+		UINT AccessorCount = 0; //elements its accessor reads from them
+	};
+
+	//A <polylist> or <triangles>, VertexCounts is a null span for triangles
+	struct Primitive
+	{
+		std::string Material;
+		UINT Count = 0;
+		std::vector<Input> Inputs;
+		tinyxml2::XMLSpan VertexCounts;
+		tinyxml2::XMLSpan Indices;
+	};
+
+	struct Geometry
+	{
+		std::string Name;
+		std::string PositionsSource;
+		std::vector<Primitive> Primitives;
+	};
+
+	struct Skin
+	{
+		std::string Geometry; //id of the geometry it deforms
+		std::vector<Input> JointInputs;
+		std::vector<Input> WeightInputs;
+		UINT VertexCount = 0;
+		tinyxml2::XMLSpan InfluenceCounts; //<vcount>
+		tinyxml2::XMLSpan Influences; //<v>
+	};
+
+	//A <morph> controller. Its targets are whole geometries with the same topology as the one it morphs
+	struct Morph
+	{
+		std::string Id; //of the controller, a skin may name it as its source instead of the geometry
+		std::string Geometry;
+		std::vector<Input> TargetInputs;
+	};
+
+	//Nodes and animations are flattened depth first, End is one past the last of their descendants so the first child
+	//is the next element and each sibling starts at the End of the one before it
+	struct SceneNode
+	{
+		std::string Id;
+		int Parent = -1;
+		int End = 0;
+		tinyxml2::XMLSpan Matrix;
+	};
+
+	struct Animation
+	{
+		std::string Id;
+		int End = 0;
+		std::string Target; //of its first channel, empty when it has none
+		std::vector<Input> SamplerInputs; //of its first sampler
+	};
+
+	struct AnimationClip
+	{
+		float Start = 0.0f;
+		float End = 0.0f;
+		std::vector<std::string> Animations; //ids of the top level animations it plays
+	};
+
+	//What a single streaming pass over a .dae keeps of it. There's no DOM, just the structure of the parts the loader
+	//reads with every array left as a span of the source text, so the source has to stay loaded while this is used
+	struct DocumentIndex
+	{
+		std::unordered_map<std::string, SourceArray> Sources; //by id
+		std::unordered_map<std::string, Geometry> Geometries; //by id, only those with a <mesh>
+		std::vector<Skin> Skins; //in document order
+		std::vector<Morph> Morphs;
+		std::vector<SceneNode> Nodes; //of the first visual scene
+		std::vector<Animation> Animations;
+		std::vector<AnimationClip> Clips;
+	};
+
+	//Reads the cooked file next to the .dae when it is up to date, otherwise parses the source and cooks it again
+	ColladaScene Import(const char* filename, int maxWeights);
+
+	//Opens the cooked file next to the .dae if it was cooked from the same source with the same weight limit and returns
+	//true. Otherwise the source is parsed into builtScene and cooked again, then the new file is opened. False is
+	//returned if the source has no skin or the cooked file couldn't be written, leaving builtScene as the only copy.
+	//recook skips the existing file even if it is up to date
+	bool LoadCooked(const char* filename, int maxWeights, MeshCache::CookedMesh& cookedMesh, ColladaScene& builtScene, bool recook = false);
+
+	//Reads the .dae text once for the skin, skeleton, geometry and animations without building a DOM, so the memory used
+	//follows the size of the model rather than the file. Every skinned geometry is merged into one model with a submesh
+	//per material, and the targets of any morph on them become morph targets of the model. Each <animation_clip> becomes
+	//a clip of its own, a file without any has its whole animation library returned as a single clip
+	ColladaScene Parse(const char* data, size_t size, int maxWeights);
+
+	//Writes the time each phase of an import took to the debug output
+	void OutputTimings(const WCHAR* label, const ImportTimings& timings);
 
-	AnimationData LoadAnimation(const char* filename);
+	//Walks the text with a pull reader, false if it is malformed or has no COLLADA root
+	bool IndexDocument(const char* data, size_t size, DocumentIndex& index);
 
-	SkinningData LoadSkin(tinyxml2::XMLElement* node, int maxWeights);
+	//Reads one skin's joint list, inverse binds and the weights of each of its geometry's positions
+	SkinningData LoadSkin(const DocumentIndex& index, const Skin& skin, int maxWeights);
 
-	SkeletonData LoadSkeleton(tinyxml2::XMLElement* node, std::vector<std::string> jointOrder, std::vector<XMFLOAT4X4> inverseBindTransforms);
+	SkeletonData LoadSkeleton(const DocumentIndex& index, int rootJointNode, const std::vector<std::string>& jointOrder, const std::vector<XMFLOAT4X4>& inverseBindTransforms);
 
-	JointData* LoadJointData(tinyxml2::XMLElement * node, bool isRoot, std::vector<std::string> jointOrder, std::vector<XMFLOAT4X4> inverseBindTransforms);
+	JointData* LoadJointData(const DocumentIndex& index, int node, bool isRoot, const JointIndices& jointIndices, const std::vector<XMFLOAT4X4>& inverseBindTransforms);
 
-	IndexedSkeletalModel LoadGeometry(tinyxml2::XMLElement* node, std::vector<VertexSkinData> vertexSkinData);
+	//Reads a geometry with a submesh for each of its primitives, adding any material it uses that isn't in materials yet
+	IndexedSkeletalModel LoadGeometry(const DocumentIndex& index, const Geometry& geometry, const std::vector<VertexSkinData>& vertexSkinData, std::vector<std::string>& materials);
 
-	void DealWithAlreadyProcessedVertex(VertexData* previousVertex, int newTextureIndex, int newNormalIndex, std::vector<int> &indices, std::vector<VertexData> &verts);
+	//Builds each of the morph's targets the same way as the base geometry and keeps the vertices that move. Targets whose
+	//geometry doesn't match the base's are skipped
+	std::vector<MorphTargetData> LoadMorphTargets(const DocumentIndex& index, const Morph& morph, const IndexedSkeletalModel& base, const std::vector<VertexSkinData>& vertexSkinData);
 
-	void InsertTangentsIntoArray(SkeletalVertex* vertices, unsigned short* indices, int vertexCount);
+	std::vector<AnimationData> LoadAnimations(const DocumentIndex& index, const std::string& rootJointName);
 
-	XMFLOAT3 CalculateTangent(SkeletalVertex v0, SkeletalVertex v1, SkeletalVertex v2);
-}
\ No newline at end of file
+	void DealWithAlreadyProcessedVertex(int previousIndex, int newTextureIndex, int newNormalIndex, std::vector<UINT> &indices, std::vector<VertexData> &verts);
+}
@@ -12,17 +12,18 @@ struct SimpleVertex
 {
 	XMFLOAT3 PosL;
 	XMFLOAT3 NormL;
-	XMFLOAT3 Tangent;
+	XMFLOAT4 Tangent; //w is the handedness, the shaders rebuild the bitangent as cross(normal, tangent) * w
 	XMFLOAT2 Tex;
 
 	SimpleVertex() {};
+	//The tangent constructors give a handedness of +1
 	SimpleVertex(XMFLOAT3 position, XMFLOAT3 normal, XMFLOAT3 tangent, XMFLOAT2 uv)
-		:PosL(position), NormL(normal), Tangent(tangent), Tex(uv) {}
+		:PosL(position), NormL(normal), Tangent(tangent.x, tangent.y, tangent.z, 1.0f), Tex(uv) {}
 	SimpleVertex(XMVECTOR position, XMVECTOR normal, XMVECTOR tangent, XMVECTOR uv)
 	{
 		XMStoreFloat3(&PosL, position);
 		XMStoreFloat3(&NormL, normal);
-		XMStoreFloat3(&Tangent, tangent);
+		XMStoreFloat4(&Tangent, XMVectorSetW(tangent, 1.0f));
 		XMStoreFloat2(&Tex, uv);
 	}
 	SimpleVertex(
@@ -31,7 +32,7 @@ struct SimpleVertex
 		float tx, float ty, float tz,
 		float u, float v)
 		: PosL(px, py, pz), NormL(nx, ny, nz),
-		Tangent(tx, ty, tz), Tex(u, v) {}
+		Tangent(tx, ty, tz, 1.0f), Tex(u, v) {}
 
 	bool operator<(const SimpleVertex other)const
 	{
@@ -49,13 +50,20 @@ struct TerrainVertex
 struct SkeletalVertex
 {
 	XMFLOAT3 PosL;
-	XMFLOAT3 Tangent;
+	XMFLOAT4 Tangent; //w is the handedness, as in SimpleVertex
 	XMFLOAT3 NormL;
 	XMFLOAT2 Tex;
 	XMFLOAT4 Weights;
 	XMUINT4 BoneIndices;
 };
 
+//Just what the SSAO normal depth pass reads, laid out like the start of SimpleVertex so either can be bound to its input layout
+struct NormalDepthVertex
+{
+	XMFLOAT3 PosL;
+	XMFLOAT3 NormL;
+};
+
 struct SurfaceInfo
 {
 	XMFLOAT4 AmbientMtrl;
@@ -92,6 +100,12 @@ __declspec(align(16)) struct ConstantBuffer
 	int MinSamples;
 };
 
+__declspec(align(16)) struct DecodeConstantBuffer
+{
+	XMFLOAT4 DecodeScale;
+	XMFLOAT4 DecodeOffset;
+};
+
 __declspec(align(16)) struct TerrainConstantBuffer
 {
 	XMFLOAT3 EyePosW;
@@ -185,16 +199,52 @@ __declspec(align(16)) struct SkinnedConstantBuffer
 	XMMATRIX ShadowTransform;
 };
 
+//Maps an index type to the DXGI format the input assembler reads it with
+template<typename IndexType> struct IndexFormat;
+template<> struct IndexFormat<WORD> { static const DXGI_FORMAT Format = DXGI_FORMAT_R16_UINT; };
+template<> struct IndexFormat<UINT> { static const DXGI_FORMAT Format = DXGI_FORMAT_R32_UINT; };
+
+//16 bit indices halve the index bandwidth so they are used whenever they can address every vertex
+inline DXGI_FORMAT GetIndexFormatForVertexCount(size_t vertexCount)
+{
+	return vertexCount <= 0xFFFF ? IndexFormat<WORD>::Format : IndexFormat<UINT>::Format;
+}
+
+//Indices are always held as 32 bit on the CPU, the narrower type is only picked when the GPU copy is made
 struct IndexedModel
 {
 	std::vector<SimpleVertex> Vertices;
-	std::vector<WORD> Indices;
+	std::vector<UINT> Indices;
+
+	DXGI_FORMAT GetIndexFormat() const { return GetIndexFormatForVertexCount(Vertices.size()); }
+};
+
+//A range of a shared index buffer drawn as one level of detail. Error is how far, in object space units, the surface
+//has moved from the full resolution mesh, level 0 is the full mesh itself with an error of 0
+struct MeshLOD
+{
+	UINT StartIndex;
+	UINT IndexCount;
+	float Error;
+};
+
+//A range of a shared index buffer drawn with one material. MaterialId indexes the material names the model was loaded with
+struct Submesh
+{
+	UINT StartIndex;
+	UINT IndexCount;
+	UINT MaterialId;
 };
 
 struct IndexedSkeletalModel
 {
 	std::vector<SkeletalVertex> Vertices;
-	std::vector<WORD> Indices;
+	std::vector<UINT> Indices;
+
+	//Empty when the whole index buffer is drawn in one go
+	std::vector<Submesh> Submeshes;
+
+	DXGI_FORMAT GetIndexFormat() const { return GetIndexFormatForVertexCount(Vertices.size()); }
 };
 
 namespace Debug
@@ -51,11 +51,28 @@ cbuffer ConstantBuffer : register( b0 )
 	int MinSamples;
 }
 
+//Only used by CompressedNormalVS, turns positions stored as fractions of the mesh bounds back into object space
+cbuffer DecodeBuffer : register( b2 )
+{
+	float4 DecodeScale;
+	float4 DecodeOffset;
+}
+
 struct VS_INPUT
 {
 	float4 PosL : POSITION;
 	float3 NormL : NORMAL;
-	float3 TangentL : TANGENT;
+	float4 TangentL : TANGENT; //w is the handedness the bitangent is multiplied by
+	float2 Tex : TEXCOORD;
+};
+
+//Matches VertexCompression::c_InputLayout, the normal and tangent are octahedral encoded and the position's w is the
+//tangent's handedness mapped to 0 or 1
+struct VS_INPUT_COMPRESSED
+{
+	float4 PosL : POSITION;
+	float2 NormL : NORMAL;
+	float2 TangentL : TANGENT;
 	float2 Tex : TEXCOORD;
 };
 
@@ -111,24 +128,52 @@ VS_OUTPUT_NORMAL NormalVS(VS_INPUT input)
 	float3 normalW = mul(float4(input.NormL, 0.0f), World).xyz;
 	output.NormW = normalize(normalW);
 
-	float4 tangentW = mul(float4(input.TangentL, 0.0f), World);
-	output.TangentW = normalize(tangentW);
+	float3 tangentW = mul(float4(input.TangentL.xyz, 0.0f), World).xyz;
+	output.TangentW = float4(normalize(tangentW), input.TangentL.w);
 
 	output.ShadowPosH = mul(posW, ShadowTransform);
 
     return output;
 }
 
+//Same as VertexCompression::DecodeOctahedral
+float3 OctahedralDecode(float2 encoded)
+{
+	float3 direction = float3(encoded, 1.0f - abs(encoded.x) - abs(encoded.y));
+
+	if (direction.z < 0.0f)
+	{
+		direction.xy = (1.0f - abs(encoded.yx)) * (encoded >= 0.0f ? 1.0f : -1.0f);
+	}
+
+	return normalize(direction);
+}
+
+//--------------------------------------------------------------------------------------
+// Compressed Vertex Shader
+//--------------------------------------------------------------------------------------
+VS_OUTPUT_NORMAL CompressedNormalVS(VS_INPUT_COMPRESSED input)
+{
+	//the directions are decoded in object space so only the world matrix acts on them, as it does for uncompressed meshes
+	VS_INPUT decoded;
+	decoded.PosL = float4(input.PosL.xyz * DecodeScale.xyz + DecodeOffset.xyz, 1.0f);
+	decoded.NormL = OctahedralDecode(input.NormL);
+	decoded.TangentL = float4(OctahedralDecode(input.TangentL), input.PosL.w * 2.0f - 1.0f);
+	decoded.Tex = input.Tex;
+
+	return NormalVS(decoded);
+}
+
 //Helper function to convert tex tangent normal to world space
-float3 NormalSampleToWorldSpace(float3 normalMapSample, float3 unitNormalW, float3 tangentW)
+float3 NormalSampleToWorldSpace(float3 normalMapSample, float3 unitNormalW, float4 tangentW)
 {
 	//Build orthonormal basis
 	//ensure T is orthonormal to w as PS interpolation may have affected this
 	float3 N = unitNormalW;
-	float3 T = normalize(tangentW - dot(tangentW, N)*N);
+	float3 T = normalize(tangentW.xyz - dot(tangentW.xyz, N)*N);
 
-	//create binormal from N and T
-	float3 B = cross(N, T);
+	//create binormal from N and T, flipped where the texture is mirrored
+	float3 B = cross(N, T) * tangentW.w;
 	float3x3 TBN = float3x3(T, B, N);
 
 	//Transform from tangent space to world space
@@ -205,7 +250,7 @@ float4 NormalPS(VS_OUTPUT_NORMAL input) : SV_Target
 
 	//Expand the range of the normal value from (0, +1) to (-1, +1)
 	bumpMap = (bumpMap * 2.0f) -1.0f;
-	float3 bumpedNormalW = NormalSampleToWorldSpace(bumpMap.xyz, input.NormW, input.TangentW.xyz);
+	float3 bumpedNormalW = NormalSampleToWorldSpace(bumpMap.xyz, input.NormW, input.TangentW);
 
     if(HasTexture == 0.0f)
     {
@@ -286,8 +331,8 @@ VS_OUTPUT_SIMPLE_PARRALAX SimpleParralaxVS(VS_INPUT input)
 	output.PosH = mul(output.PosH, Projection);
 
 	float3x3 tbnMatrix;
-	tbnMatrix[0] = normalize(mul(float4(input.TangentL, 0.0f), World).xyz);
-	tbnMatrix[1] = normalize(mul(float4(cross(input.NormL, input.TangentL), 0.0f), World).xyz);
+	tbnMatrix[0] = normalize(mul(float4(input.TangentL.xyz, 0.0f), World).xyz);
+	tbnMatrix[1] = normalize(mul(float4(cross(input.NormL, input.TangentL.xyz) * input.TangentL.w, 0.0f), World).xyz);
 	tbnMatrix[2] = normalize(mul(float4(input.NormL, 0.0f), World).xyz);
 
 	output.Tex = input.Tex;
@@ -377,8 +422,8 @@ VS_OUTPUT_PARRALAX ParralaxVS(VS_INPUT input)
 	output.PosH = mul(output.PosH, Projection);
 	
 	float3x3 tbnMatrix;
-	tbnMatrix[0] = normalize(mul(float4(input.TangentL, 0.0f), World).xyz);
-	tbnMatrix[1] = normalize(mul(float4(cross(input.NormL, input.TangentL), 0.0f), World).xyz);
+	tbnMatrix[0] = normalize(mul(float4(input.TangentL.xyz, 0.0f), World).xyz);
+	tbnMatrix[1] = normalize(mul(float4(cross(input.NormL, input.TangentL.xyz) * input.TangentL.w, 0.0f), World).xyz);
 	tbnMatrix[2] = normalize(mul(float4(input.NormL, 0.0f), World).xyz);
 
 	output.Tex = input.Tex;
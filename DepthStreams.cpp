@@ -0,0 +1,64 @@
+#include "DepthStreams.h"
+
+#include "MeshOptimizer.h"
+#include "VertexWelder.h"
+
+namespace
+{
+	UINT GetIndexSize(size_t vertexCount)
+	{
+		return GetIndexFormatForVertexCount(vertexCount) == IndexFormat<WORD>::Format ? sizeof(WORD) : sizeof(UINT);
+	}
+
+	DepthStreams::PassStatistics MeasurePass(const std::vector<UINT>& indices, size_t vertexCount, UINT vertexStride)
+	{
+		DepthStreams::PassStatistics statistics;
+		statistics.VertexCount = (UINT)vertexCount;
+		statistics.VertexStride = vertexStride;
+		statistics.VerticesTransformed = MeshOptimizer::AnalyzeVertexCache(indices, vertexCount).VerticesTransformed;
+		statistics.IndexSize = GetIndexSize(vertexCount);
+		return statistics;
+	}
+
+	void RemapIndices(const std::vector<UINT>& indices, const std::vector<unsigned int>& remap, std::vector<UINT>& outIndices)
+	{
+		outIndices.resize(indices.size());
+		for (size_t i = 0; i < indices.size(); i++)
+		{
+			outIndices[i] = remap[indices[i]];
+		}
+	}
+}
+
+void DepthStreams::Build(const std::vector<SimpleVertex>& vertices, const std::vector<UINT>& indices, DepthModel & depth, NormalDepthModel & normalDepth)
+{
+	std::vector<XMFLOAT3> positions(vertices.size());
+	std::vector<NormalDepthVertex> normalDepthVertices(vertices.size());
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		positions[i] = vertices[i].PosL;
+		normalDepthVertices[i].PosL = vertices[i].PosL;
+		normalDepthVertices[i].NormL = vertices[i].NormL;
+	}
+
+	//welding exactly keeps every position bit for bit the same as the full vertex buffer's, so depth written by these
+	//passes still matches the shaded pass. The welded vertices keep the order they are first used in if the full
+	//vertex buffer had it, so there's no need to optimize them for fetching again
+	std::vector<unsigned int> remap;
+
+	VertexWelder::WeldPositions(positions, 0.0f, depth.Vertices, remap);
+	RemapIndices(indices, remap, depth.Indices);
+
+	VertexWelder::Weld(normalDepthVertices, 0.0f, normalDepth.Vertices, remap);
+	RemapIndices(indices, remap, normalDepth.Indices);
+}
+
+DepthStreams::DepthStreamStatistics DepthStreams::Measure(const IndexedModel & model, const DepthModel & depth, const NormalDepthModel & normalDepth)
+{
+	DepthStreamStatistics statistics;
+	statistics.Full = MeasurePass(model.Indices, model.Vertices.size(), sizeof(SimpleVertex));
+	statistics.Passes[Stream_Depth] = MeasurePass(depth.Indices, depth.Vertices.size(), sizeof(XMFLOAT3));
+	statistics.Passes[Stream_NormalDepth] = MeasurePass(normalDepth.Indices, normalDepth.Vertices.size(), sizeof(NormalDepthVertex));
+
+	return statistics;
+}
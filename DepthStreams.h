@@ -0,0 +1,73 @@
+#pragma once
+
+#include <vector>
+
+#include "Commons.h"
+
+//Cut down copies of a mesh for the passes that don't shade it. The shadow map only needs positions and the SSAO normal
+//depth pass positions and normals, so each gets its own vertex buffer welded on just those attributes and the texture
+//seams that split the full vertex buffer disappear from it
+namespace DepthStreams
+{
+	enum Stream
+	{
+		Stream_Depth = 0, //XMFLOAT3 positions, for the shadow map
+		Stream_NormalDepth, //NormalDepthVertex, for the SSAO normal depth pass
+
+		Stream_Count
+	};
+
+	const D3D11_INPUT_ELEMENT_DESC c_DepthInputLayout[] =
+	{
+		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 }
+	};
+
+	const D3D11_INPUT_ELEMENT_DESC c_NormalDepthInputLayout[] =
+	{
+		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 }
+	};
+
+	//The index buffers hold exactly as many indices as the one they were built from, each remapped to the welded
+	//vertices, so any LOD ranges into the full index buffer address the same triangles in these
+	struct DepthModel
+	{
+		std::vector<XMFLOAT3> Vertices;
+		std::vector<UINT> Indices;
+	};
+
+	struct NormalDepthModel
+	{
+		std::vector<NormalDepthVertex> Vertices;
+		std::vector<UINT> Indices;
+	};
+
+	//What drawing the mesh costs one pass in vertex data
+	struct PassStatistics
+	{
+		UINT VertexCount = 0;
+		UINT VertexStride = 0;
+		UINT VerticesTransformed = 0; //through the simulated post-transform cache
+		UINT IndexSize = 0;
+
+		UINT64 VertexBytes() const { return (UINT64)VertexCount * VertexStride; }
+		UINT64 FetchedBytes() const { return (UINT64)VerticesTransformed * VertexStride; }
+	};
+
+	struct DepthStreamStatistics
+	{
+		PassStatistics Full;
+		PassStatistics Passes[Stream_Count];
+	};
+
+	void Build(const std::vector<SimpleVertex>& vertices, const std::vector<UINT>& indices, DepthModel& depth, NormalDepthModel& normalDepth);
+
+	inline void Build(const IndexedModel& model, DepthModel& depth, NormalDepthModel& normalDepth)
+	{
+		Build(model.Vertices, model.Indices, depth, normalDepth);
+	}
+
+	//Runs every index buffer through the simulated post-transform cache, too slow for loading so only the benchmark
+	//calls it. The indices should be a single level of detail, as drawn
+	DepthStreamStatistics Measure(const IndexedModel& model, const DepthModel& depth, const NormalDepthModel& normalDepth);
+}
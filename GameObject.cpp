@@ -1,4 +1,7 @@
 #include "GameObject.h"
+#include <algorithm>
+
+#include "MeshSimplifier.h"
 
 GameObject::GameObject(string type, Transform* transform, Mesh geometry, Material material) 
 	: _transform (transform), _geometry(geometry), _type(type), _material(material)
@@ -31,7 +34,52 @@ void GameObject::Draw(ID3D11DeviceContext * pImmediateContext)
 
 	// Set vertex and index buffers
 	pImmediateContext->IASetVertexBuffers(0, 1, &_geometry._vertexBuffer, &_geometry._vertexBufferStride, &_geometry._vertexBufferOffset);
-	pImmediateContext->IASetIndexBuffer(_geometry._indexBuffer, DXGI_FORMAT_R16_UINT, 0);
+	pImmediateContext->IASetIndexBuffer(_geometry._indexBuffer, _geometry._indexFormat, 0);
+
+	if (_lod < _geometry._lods.size())
+	{
+		pImmediateContext->DrawIndexed(_geometry._lods[_lod].IndexCount, _geometry._lods[_lod].StartIndex, 0);
+	}
+	else
+	{
+		pImmediateContext->DrawIndexed(_geometry._numberOfIndices, 0, 0);
+	}
+}
+
+void GameObject::DrawDepth(ID3D11DeviceContext * pImmediateContext, DepthStreams::Stream stream)
+{
+	if (!_geometry.HasDepthStream(stream))
+	{
+		Draw(pImmediateContext);
+		return;
+	}
+
+	const MeshStream& meshStream = _geometry._depthStreams[stream];
+
+	pImmediateContext->IASetVertexBuffers(0, 1, &meshStream.VertexBuffer, &meshStream.VertexBufferStride, &meshStream.VertexBufferOffset);
+	pImmediateContext->IASetIndexBuffer(meshStream.IndexBuffer, meshStream.IndexFormat, 0);
+
+	if (_lod < _geometry._lods.size())
+	{
+		pImmediateContext->DrawIndexed(_geometry._lods[_lod].IndexCount, _geometry._lods[_lod].StartIndex, 0);
+	}
+	else
+	{
+		pImmediateContext->DrawIndexed(_geometry._numberOfIndices, 0, 0);
+	}
+}
+
+void GameObject::SelectLOD(XMFLOAT3 eyePosition, float pixelsPerUnit)
+{
+	XMFLOAT4X4 world = _transform->GetWorldMatrix4x4();
+
+	//the errors are in object space so they grow with the largest scale on the world matrix
+	float scale = std::max(XMVectorGetX(XMVector3Length(XMVectorSet(world._11, world._12, world._13, 0.0f))),
+		std::max(XMVectorGetX(XMVector3Length(XMVectorSet(world._21, world._22, world._23, 0.0f))),
+			XMVectorGetX(XMVector3Length(XMVectorSet(world._31, world._32, world._33, 0.0f)))));
+
+	XMVECTOR offset = XMVectorSet(world._41, world._42, world._43, 0.0f) - XMLoadFloat3(&eyePosition);
+	float distance = XMVectorGetX(XMVector3Length(offset));
 
-	pImmediateContext->DrawIndexed(_geometry._numberOfIndices, 0, 0);
+	_lod = MeshSimplifier::SelectLOD(_geometry._lods, distance, pixelsPerUnit * scale);
 }
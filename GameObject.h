@@ -30,7 +30,8 @@ enum Shader
 	FX_GEOMETRY,
 	FX_TERRAIN,
 	FX_SKY,
-	FX_SKELETAL
+	FX_SKELETAL,
+	FX_COMPRESSED
 };
 
 struct Material
@@ -51,7 +52,7 @@ public:
 
 	string GetType() const { return _type; }
 
-	Mesh GetGeometryData() const { return _geometry; }
+	const Mesh& GetGeometryData() const { return _geometry; }
 
 	Material GetMaterial() const { return _material; }
 
@@ -67,6 +68,15 @@ public:
 	void Update(float deltaTime);
 	virtual void Draw(ID3D11DeviceContext * pImmediateContext);
 
+	//Draws the selected level of detail from the mesh's cut down stream for a depth only pass. Meshes without the stream
+	//fall back to the full vertex buffer, SimpleVertex starts with the same position and normal so the pass's input layout still fits
+	void DrawDepth(ID3D11DeviceContext * pImmediateContext, DepthStreams::Stream stream);
+
+	//Picks the level of detail Draw uses from how far the world matrix puts the object from the eye. pixelsPerUnit is the
+	//render height divided by 2 tan(fovY / 2)
+	void SelectLOD(XMFLOAT3 eyePosition, float pixelsPerUnit);
+	UINT GetLOD() const { return _lod; }
+
 private:
 
 	string _type;
@@ -78,6 +88,8 @@ private:
 
 	Shader _shaderToUse = FX_NORMAL;
 
+	UINT _lod = 0;
+
 	ID3D11ShaderResourceView * _textureRV[TX_NUMBER_OF_TEXTURES];
 
 	GameObject * _parent;
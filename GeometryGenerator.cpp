@@ -1,5 +1,6 @@
 #include "GeometryGenerator.h"
 #include "Vector.h"
+#include "TangentGenerator.h"
 
 IndexedModel GeometryGenerator::CreateCube(float width, float height, float depth)
 {
@@ -117,14 +118,6 @@ IndexedModel GeometryGenerator::CreateSphere(float radius, unsigned int longitud
 			v.PosL.y = radius * cosf(phi);
 			v.PosL.z = radius * sinf(phi)*sinf(theta);
 
-			// Partial derivative of P with respect to theta
-			v.Tangent.x = -radius * sinf(phi)*sinf(theta);
-			v.Tangent.y = 0.0f;
-			v.Tangent.z = +radius * sinf(phi)*cosf(theta);
-
-			XMVECTOR T = XMLoadFloat3(&v.Tangent);
-			XMStoreFloat3(&v.Tangent, XMVector3Normalize(T));
-
 			XMVECTOR p = XMLoadFloat3(&v.PosL);
 			XMStoreFloat3(&v.NormL, XMVector3Normalize(p));
 
@@ -142,7 +135,7 @@ IndexedModel GeometryGenerator::CreateSphere(float radius, unsigned int longitud
 	// and connects the top pole to the first ring.
 	//
 
-	for (WORD i = 1; i <= longitudeLines; ++i)
+	for (UINT i = 1; i <= longitudeLines; ++i)
 	{
 		returnGeometry.Indices.push_back(0);
 		returnGeometry.Indices.push_back(i + 1);
@@ -155,11 +148,11 @@ IndexedModel GeometryGenerator::CreateSphere(float radius, unsigned int longitud
 
 	// Offset the indices to the index of the first vertex in the first ring.
 	// This is just skipping the top pole vertex.
-	WORD baseIndex = 1;
-	WORD ringVertexCount = longitudeLines + 1;
-	for (WORD i = 0; i < latitudeLines - 2; ++i)
+	UINT baseIndex = 1;
+	UINT ringVertexCount = longitudeLines + 1;
+	for (UINT i = 0; i < latitudeLines - 2; ++i)
 	{
-		for (WORD j = 0; j < longitudeLines; ++j)
+		for (UINT j = 0; j < longitudeLines; ++j)
 		{
 			returnGeometry.Indices.push_back(baseIndex + i * ringVertexCount + j);
 			returnGeometry.Indices.push_back(baseIndex + i * ringVertexCount + j + 1);
@@ -189,6 +182,9 @@ IndexedModel GeometryGenerator::CreateSphere(float radius, unsigned int longitud
 		returnGeometry.Indices.push_back(baseIndex + i + 1);
 	}
 
+	//the poles share one vertex between every longitude so they get the average of the triangles around them
+	TangentGenerator::Generate(returnGeometry.Vertices, returnGeometry.Indices);
+
 	return returnGeometry;
 }
 
@@ -228,7 +224,6 @@ IndexedModel GeometryGenerator::CreateGrid(float width, float length, unsigned i
 
 			returnModel.Vertices[i*lengthLines + j].PosL = XMFLOAT3(x, 0.0f, z);
 			returnModel.Vertices[i*lengthLines + j].NormL = XMFLOAT3(0.0f, 1.0f, 0.0f);
-			returnModel.Vertices[i*lengthLines + j].Tangent = XMFLOAT3(1.0f, 0.0f, 0.0f);
 
 			// Stretch texture over grid.
 			returnModel.Vertices[i*lengthLines + j].Tex.x = j * du;
@@ -243,10 +238,10 @@ IndexedModel GeometryGenerator::CreateGrid(float width, float length, unsigned i
 	returnModel.Indices.resize(faceCount * 3); // 3 indices per face
 
 												// Iterate over each quad and compute indices.
-	WORD k = 0;
-	for (WORD i = 0; i < lengthLines - 1; ++i)
+	UINT k = 0;
+	for (UINT i = 0; i < lengthLines - 1; ++i)
 	{
-		for (WORD j = 0; j < widthLines - 1; ++j)
+		for (UINT j = 0; j < widthLines - 1; ++j)
 		{
 			returnModel.Indices[k] = i * lengthLines + j;
 			returnModel.Indices[k + 1] = i * lengthLines + j + 1;
@@ -260,6 +255,8 @@ IndexedModel GeometryGenerator::CreateGrid(float width, float length, unsigned i
 		}
 	}
 
+	TangentGenerator::Generate(returnModel.Vertices, returnModel.Indices);
+
 	return returnModel;
 }
 
@@ -359,12 +356,12 @@ IndexedModel GeometryGenerator::CreateCylinder(float bottomRadius, float topRadi
 			//  dz/dv = (r0-r1)*sin(t)
 
 			// This is unit length.
-			vertex.Tangent = XMFLOAT3(-s, 0.0f, c);
+			XMFLOAT3 tangent(-s, 0.0f, c);
 
 			float dr = bottomRadius - topRadius;
 			XMFLOAT3 bitangent(dr*c, -height, dr*s);
 
-			XMVECTOR T = XMLoadFloat3(&vertex.Tangent);
+			XMVECTOR T = XMLoadFloat3(&tangent);
 			XMVECTOR B = XMLoadFloat3(&bitangent);
 			XMVECTOR N = XMVector3Normalize(XMVector3Cross(T, B));
 			XMStoreFloat3(&vertex.NormL, N);
@@ -378,9 +375,9 @@ IndexedModel GeometryGenerator::CreateCylinder(float bottomRadius, float topRadi
 	unsigned int ringVertexCount = sliceCount + 1;
 
 	// Compute indices for each stack.
-	for (WORD i = 0; i < stackCount; ++i)
+	for (UINT i = 0; i < stackCount; ++i)
 	{
-		for (WORD j = 0; j < sliceCount; ++j)
+		for (UINT j = 0; j < sliceCount; ++j)
 		{
 			returnGeometry.Indices.push_back(i*ringVertexCount + j);
 			returnGeometry.Indices.push_back((i + 1)*ringVertexCount + j);
@@ -394,7 +391,7 @@ IndexedModel GeometryGenerator::CreateCylinder(float bottomRadius, float topRadi
 
 	//build top cap
 
-	WORD baseIndex = (WORD)returnGeometry.Vertices.size();
+	UINT baseIndex = (UINT)returnGeometry.Vertices.size();
 
 	float y = 0.5f*height;
 	float dTheta = 2.0f*XM_PI / sliceCount;
@@ -417,9 +414,9 @@ IndexedModel GeometryGenerator::CreateCylinder(float bottomRadius, float topRadi
 	returnGeometry.Vertices.push_back(SimpleVertex(0.0f, y, 0.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.5f, 0.5f));
 
 	// Index of center vertex.
-	WORD centerIndex = (WORD)returnGeometry.Vertices.size() - 1;
+	UINT centerIndex = (UINT)returnGeometry.Vertices.size() - 1;
 
-	for (WORD i = 0; i < sliceCount; ++i)
+	for (UINT i = 0; i < sliceCount; ++i)
 	{
 		returnGeometry.Indices.push_back(centerIndex);
 		returnGeometry.Indices.push_back(baseIndex + i + 1);
@@ -428,7 +425,7 @@ IndexedModel GeometryGenerator::CreateCylinder(float bottomRadius, float topRadi
 
 	//build bottom cap
 
-	baseIndex = (WORD)returnGeometry.Vertices.size();
+	baseIndex = (UINT)returnGeometry.Vertices.size();
 	y = -0.5f*height;
 
 	// vertices of ring
@@ -450,15 +447,17 @@ IndexedModel GeometryGenerator::CreateCylinder(float bottomRadius, float topRadi
 	returnGeometry.Vertices.push_back(SimpleVertex(0.0f, y, 0.0f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.5f, 0.5f));
 
 	// Cache the index of center vertex.
-	centerIndex = (WORD)returnGeometry.Vertices.size() - 1;
+	centerIndex = (UINT)returnGeometry.Vertices.size() - 1;
 
-	for (WORD i = 0; i < sliceCount; ++i)
+	for (UINT i = 0; i < sliceCount; ++i)
 	{
 		returnGeometry.Indices.push_back(centerIndex);
 		returnGeometry.Indices.push_back(baseIndex + i);
 		returnGeometry.Indices.push_back(baseIndex + i + 1);
 	}
 
+	TangentGenerator::Generate(returnGeometry.Vertices, returnGeometry.Indices);
+
 	return returnGeometry;
 }
 
@@ -489,15 +488,13 @@ IndexedModel GeometryGenerator::CreateTorus(float diameter, float thickness, int
 			XMScalarSinCos(&dy, &dx, innerAngle);
 
 			XMVECTOR normal = XMVectorSet(dx, dy, 0, 0);
-			XMVECTOR tangent = XMVectorSet(dy, -dx, 0, 0);
 			XMVECTOR position = XMVectorScale(normal, thickness / 2);
 			XMVECTOR texCoord = XMVectorSet(u, v, 0, 0);
 
 			position = XMVector3Transform(position, transform);
 			normal = XMVector3TransformNormal(normal, transform);
-			tangent = XMVector3TransformNormal(tangent, transform);
 
-			returnGeometry.Vertices.push_back(SimpleVertex(position,normal,tangent, texCoord));
+			returnGeometry.Vertices.push_back(SimpleVertex(position, normal, XMVectorZero(), texCoord));
 
 			// And create indices for two triangles.
 			size_t nextI = (i + 1) % stride;
@@ -512,5 +509,8 @@ IndexedModel GeometryGenerator::CreateTorus(float diameter, float thickness, int
 			returnGeometry.Indices.push_back(i * stride + nextJ);
 		}
 	}
+
+	TangentGenerator::Generate(returnGeometry.Vertices, returnGeometry.Indices);
+
 	return returnGeometry;
 }
@@ -21,26 +21,40 @@ public:
 
 	XMFLOAT4X4 GetLocalTransform()
 	{
-		XMMATRIX transform = XMMatrixIdentity();
-		XMMATRIX translation = XMMatrixTranslation(_position.x, _position.y, _position.z);
+		XMStoreFloat4x4(&_localTransform, CalculateLocalTransform(_position, _rotation));
+		return _localTransform;
+	}
+
+	static XMMATRIX CalculateLocalTransform(const Vector3D& position, const Quaternion& rotation)
+	{
+		XMMATRIX translation = XMMatrixTranslation(position.x, position.y, position.z);
 
 		translation = XMMatrixTranspose(translation);
-		transform = translation * CalculateTransformMatrix(_rotation);
+		return translation * CalculateTransformMatrix(rotation);
+	}
 
-		XMStoreFloat4x4(&_localTransform, transform);
-		return _localTransform;
+	//Splits a local joint matrix into the translation and rotation keyframes interpolate between
+	static JointTransform Decompose(const XMFLOAT4X4& localTransform)
+	{
+		return JointTransform(Vector3D(localTransform._14, localTransform._24, localTransform._34), Quaternion(localTransform));
 	}
 
 	static JointTransform interpolate(JointTransform frameA, JointTransform frameB, float alpha)
 	{
-		//return (alpha < 0.5f) ? frameA : frameB;
-
-		Vector3D pos = Vector3D::Lerp(frameA._position, frameB._position, alpha);
-		Quaternion rot = Quaternion::Nlerp(frameA._rotation, frameB._rotation, alpha);
+		JointTransform result;
+		Interpolate(frameA._position, frameA._rotation, frameB._position, frameB._rotation, alpha, result._position, result._rotation);
+		return result;
+	}
 
-		//rot.Normalize();
+	static void Interpolate(const Vector3D& positionA, const Quaternion& rotationA, const Vector3D& positionB, const Quaternion& rotationB,
+		float alpha, Vector3D& position, Quaternion& rotation)
+	{
+		//Vector3D::Lerp weights its ends the other way round
+		position.x = positionA.x + (positionB.x - positionA.x) * alpha;
+		position.y = positionA.y + (positionB.y - positionA.y) * alpha;
+		position.z = positionA.z + (positionB.z - positionA.z) * alpha;
 
-		return JointTransform(pos, rot);
+		rotation = Quaternion::Nlerp(rotationA, rotationB, alpha);
 	}
 private:
 	XMFLOAT4X4 _localTransform;
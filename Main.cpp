@@ -1,5 +1,6 @@
 #include "Application.h"
 #include "Commons.h"
+#include "Benchmark.h"
 
 long long Milliseconds_now();
 
@@ -8,7 +9,13 @@ int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR lpCmdLi
 	srand(Milliseconds_now());
 
 	UNREFERENCED_PARAMETER(hPrevInstance);
-	UNREFERENCED_PARAMETER(lpCmdLine);
+
+	//run the asset pipeline benchmarks without creating a window or device
+	if (wcsstr(lpCmdLine, L"-benchmark"))
+	{
+		Benchmark::RunAll();
+		return 0;
+	}
 
 	float DesiredFPS = 60.0f;
 
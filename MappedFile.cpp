@@ -0,0 +1,82 @@
+#include "MappedFile.h"
+
+MappedFile::MappedFile()
+	:_file(INVALID_HANDLE_VALUE), _mapping(nullptr), _data(nullptr), _size(0)
+{
+}
+
+MappedFile::MappedFile(const char * filename)
+	:MappedFile()
+{
+	Open(filename);
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+bool MappedFile::Open(const char * filename)
+{
+	Close();
+
+	_file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+	if (_file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(_file, &fileSize) || fileSize.QuadPart == 0)
+	{
+		//an empty file can't be mapped
+		Close();
+		return false;
+	}
+
+	_mapping = CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+	if (!_mapping)
+	{
+		Close();
+		return false;
+	}
+
+	_data = (const char*)MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0);
+
+	if (!_data)
+	{
+		Close();
+		return false;
+	}
+
+	_size = (size_t)fileSize.QuadPart;
+
+	return true;
+}
+
+bool MappedFile::IsNullTerminated() const
+{
+	if (!_data)
+	{
+		return false;
+	}
+
+	SYSTEM_INFO systemInfo;
+	GetSystemInfo(&systemInfo);
+
+	return _size % systemInfo.dwPageSize != 0;
+}
+
+void MappedFile::Close()
+{
+	if (_data) UnmapViewOfFile(_data);
+	if (_mapping) CloseHandle(_mapping);
+	if (_file != INVALID_HANDLE_VALUE) CloseHandle(_file);
+
+	_file = INVALID_HANDLE_VALUE;
+	_mapping = nullptr;
+	_data = nullptr;
+	_size = 0;
+}
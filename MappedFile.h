@@ -0,0 +1,36 @@
+#pragma once
+
+#include <Windows.h>
+#include <cstddef>
+
+//Read only view of a whole file mapped into the address space, the OS pages the data in on demand so nothing is copied
+class MappedFile
+{
+public:
+	MappedFile();
+	MappedFile(const char* filename);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool Open(const char* filename);
+	void Close();
+
+	bool IsOpen() const { return _data != nullptr; }
+
+	const char* GetData() const { return _data; }
+	const char* GetEnd() const { return _data + _size; }
+	size_t GetSize() const { return _size; }
+
+	//True when the byte at GetEnd() can be read and is zero, which is the case whenever the file doesn't fill its last
+	//page exactly as the rest of the page is zero filled
+	bool IsNullTerminated() const;
+
+private:
+	HANDLE _file;
+	HANDLE _mapping;
+
+	const char* _data;
+	size_t _size;
+};
@@ -3,72 +3,181 @@
 
 Mesh::Mesh(IndexedModel model, ID3D11Device* d3dDevice)
 {
-	//Vertex Buffer
-	D3D11_BUFFER_DESC bd;
-	ZeroMemory(&bd, sizeof(bd));
-	bd.Usage = D3D11_USAGE_DEFAULT;
-	bd.ByteWidth = sizeof(SimpleVertex) * model.Vertices.size();
-	bd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-	bd.CPUAccessFlags = 0;
+	CreateBuffers(&model.Vertices[0], sizeof(SimpleVertex), model.Vertices.size(), model.Indices, d3dDevice);
+	CreateDepthStreams(model, d3dDevice);
+}
 
-	D3D11_SUBRESOURCE_DATA InitData;
-	ZeroMemory(&InitData, sizeof(InitData));
-	InitData.pSysMem = &model.Vertices[0];
+Mesh::Mesh(IndexedSkeletalModel model, ID3D11Device * d3dDevice, bool dynamicVertices)
+{
+	CreateBuffers(&model.Vertices[0], sizeof(SkeletalVertex), model.Vertices.size(), model.Indices, d3dDevice, dynamicVertices);
+	_submeshes = model.Submeshes;
+}
 
-	d3dDevice->CreateBuffer(&bd, &InitData, &_vertexBuffer);
+Mesh::Mesh(const VertexCompression::CompressedModel & model, ID3D11Device * d3dDevice)
+	:_compressed(true), _decodeScale(model.BoundsExtent.x, model.BoundsExtent.y, model.BoundsExtent.z, 1.0f),
+	_decodeOffset(model.BoundsMin.x, model.BoundsMin.y, model.BoundsMin.z, 0.0f)
+{
+	CreateBuffers(&model.Vertices[0], sizeof(VertexCompression::CompressedVertex), model.Vertices.size(), model.Indices, d3dDevice);
 
-	//Index Buffer
-	ZeroMemory(&bd, sizeof(bd));
-	bd.Usage = D3D11_USAGE_DEFAULT;
-	bd.ByteWidth = sizeof(WORD) * model.Indices.size();
-	bd.BindFlags = D3D11_BIND_INDEX_BUFFER;
-	bd.CPUAccessFlags = 0;
+	//the depth passes use the plain float layouts, so their streams come from the decoded vertices
+	IndexedModel decoded;
+	VertexCompression::Decompress(model, decoded.Vertices);
+	decoded.Indices = model.Indices;
+	CreateDepthStreams(decoded, d3dDevice);
+}
 
-	ZeroMemory(&InitData, sizeof(InitData));
-	InitData.pSysMem = &model.Indices[0];
-	d3dDevice->CreateBuffer(&bd, &InitData, &_indexBuffer);
+Mesh::Mesh(const MeshCache::CookedMesh & cookedMesh, ID3D11Device * d3dDevice)
+{
+	CreateVertexBuffer(cookedMesh.GetVertices(), cookedMesh.GetVertexStride(), cookedMesh.GetVertexCount(), d3dDevice);
 
-	_numberOfIndices = model.Indices.size();
+	//the cooker already narrowed the indices so the mapped bytes can go straight to the device
+	_indexFormat = cookedMesh.GetIndexFormat();
+	CreateIndexBuffer(cookedMesh.GetIndices(), _indexFormat, cookedMesh.GetIndexCount(), d3dDevice, &_indexBuffer);
 
-	_vertexBufferOffset = 0;
-	_vertexBufferStride = sizeof(SimpleVertex);
+	for (UINT level = 0; level < cookedMesh.GetLODCount(); level++)
+	{
+		_lods.push_back(cookedMesh.GetLOD(level));
+	}
+
+	_numberOfIndices = _lods[0].IndexCount;
+
+	const UINT streamSections[DepthStreams::Stream_Count][2] =
+	{
+		{ MeshCache::Section_DepthVertices, MeshCache::Section_DepthIndices },
+		{ MeshCache::Section_NormalDepthVertices, MeshCache::Section_NormalDepthIndices }
+	};
+
+	for (int stream = 0; stream < DepthStreams::Stream_Count; stream++)
+	{
+		MeshCache::StreamView view;
+		if (cookedMesh.GetStream(streamSections[stream][0], streamSections[stream][1], view))
+		{
+			CreateDepthStream((DepthStreams::Stream)stream, view.Vertices, view.VertexStride, view.VertexCount, view.Indices, view.IndexFormat, view.IndexCount, d3dDevice);
+		}
+	}
 }
 
-Mesh::Mesh(IndexedSkeletalModel model, ID3D11Device * d3dDevice)
+Mesh::~Mesh()
 {
-	//VertexBuffer
+	//if(_vertexBuffer) _vertexBuffer->Release();
+	//if(_indexBuffer) _indexBuffer->Release();
+}
+
+DXGI_FORMAT Mesh::CreateIndexBuffer(const std::vector<UINT>& indices, size_t vertexCount, ID3D11Device * d3dDevice, ID3D11Buffer ** indexBuffer)
+{
+	DXGI_FORMAT format = GetIndexFormatForVertexCount(vertexCount);
+
+	if (format == IndexFormat<WORD>::Format)
+	{
+		CreateIndexBuffer<WORD>(indices, d3dDevice, indexBuffer);
+	}
+	else
+	{
+		CreateIndexBuffer<UINT>(indices, d3dDevice, indexBuffer);
+	}
+
+	return format;
+}
+
+void Mesh::CreateIndexBuffer(const void * indices, DXGI_FORMAT indexFormat, size_t indexCount, ID3D11Device * d3dDevice, ID3D11Buffer ** indexBuffer)
+{
+	UINT indexSize = indexFormat == IndexFormat<WORD>::Format ? sizeof(WORD) : sizeof(UINT);
+
 	D3D11_BUFFER_DESC bd;
 	ZeroMemory(&bd, sizeof(bd));
-	bd.Usage = D3D11_USAGE_DEFAULT;
-	bd.ByteWidth = sizeof(SkeletalVertex) * model.Vertices.size();
-	bd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	bd.Usage = D3D11_USAGE_IMMUTABLE;
+	bd.ByteWidth = indexSize * indexCount;
+	bd.BindFlags = D3D11_BIND_INDEX_BUFFER;
 	bd.CPUAccessFlags = 0;
 
 	D3D11_SUBRESOURCE_DATA InitData;
 	ZeroMemory(&InitData, sizeof(InitData));
-	InitData.pSysMem = &model.Vertices[0];
-
-	d3dDevice->CreateBuffer(&bd, &InitData, &_vertexBuffer);
+	InitData.pSysMem = indices;
+	d3dDevice->CreateBuffer(&bd, &InitData, indexBuffer);
+}
 
-	//Index Buffer
+void Mesh::CreateVertexBuffer(const void * vertices, UINT vertexStride, size_t vertexCount, ID3D11Device * d3dDevice, ID3D11Buffer ** vertexBuffer, bool dynamic)
+{
+	D3D11_BUFFER_DESC bd;
 	ZeroMemory(&bd, sizeof(bd));
-	bd.Usage = D3D11_USAGE_DEFAULT;
-	bd.ByteWidth = sizeof(WORD) * model.Indices.size();
-	bd.BindFlags = D3D11_BIND_INDEX_BUFFER;
-	bd.CPUAccessFlags = 0;
+	bd.Usage = dynamic ? D3D11_USAGE_DYNAMIC : D3D11_USAGE_DEFAULT;
+	bd.ByteWidth = vertexStride * vertexCount;
+	bd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	bd.CPUAccessFlags = dynamic ? D3D11_CPU_ACCESS_WRITE : 0;
 
+	D3D11_SUBRESOURCE_DATA InitData;
 	ZeroMemory(&InitData, sizeof(InitData));
-	InitData.pSysMem = &model.Indices[0];
-	d3dDevice->CreateBuffer(&bd, &InitData, &_indexBuffer);
+	InitData.pSysMem = vertices;
+
+	d3dDevice->CreateBuffer(&bd, &InitData, vertexBuffer);
+}
 
-	_numberOfIndices = model.Indices.size();
+void Mesh::CreateVertexBuffer(const void * vertices, UINT vertexStride, size_t vertexCount, ID3D11Device * d3dDevice, bool dynamic)
+{
+	CreateVertexBuffer(vertices, vertexStride, vertexCount, d3dDevice, &_vertexBuffer, dynamic);
 
 	_vertexBufferOffset = 0;
-	_vertexBufferStride = sizeof(SkeletalVertex);
+	_vertexBufferStride = vertexStride;
 }
 
-Mesh::~Mesh()
+void Mesh::CreateDepthStreams(const IndexedModel & model, ID3D11Device * d3dDevice)
 {
-	//if(_vertexBuffer) _vertexBuffer->Release();
-	//if(_indexBuffer) _indexBuffer->Release();
-}
\ No newline at end of file
+	DepthStreams::DepthModel depth;
+	DepthStreams::NormalDepthModel normalDepth;
+	DepthStreams::Build(model, depth, normalDepth);
+
+	CreateDepthStream(DepthStreams::Stream_Depth, depth.Vertices, depth.Indices, d3dDevice);
+	CreateDepthStream(DepthStreams::Stream_NormalDepth, normalDepth.Vertices, normalDepth.Indices, d3dDevice);
+}
+
+void Mesh::CreateDepthStream(DepthStreams::Stream stream, const void * vertices, UINT vertexStride, size_t vertexCount,
+	const void * indices, DXGI_FORMAT indexFormat, size_t indexCount, ID3D11Device * d3dDevice)
+{
+	MeshStream& meshStream = _depthStreams[stream];
+
+	CreateVertexBuffer(vertices, vertexStride, vertexCount, d3dDevice, &meshStream.VertexBuffer);
+	CreateIndexBuffer(indices, indexFormat, indexCount, d3dDevice, &meshStream.IndexBuffer);
+
+	meshStream.VertexBufferStride = vertexStride;
+	meshStream.VertexBufferOffset = 0;
+	meshStream.IndexFormat = indexFormat;
+}
+
+void Mesh::CreateBuffers(const void * vertices, UINT vertexStride, size_t vertexCount, const std::vector<UINT>& indices, ID3D11Device * d3dDevice,
+	bool dynamicVertices)
+{
+	CreateVertexBuffer(vertices, vertexStride, vertexCount, d3dDevice, dynamicVertices);
+
+	_indexFormat = CreateIndexBuffer(indices, vertexCount, d3dDevice, &_indexBuffer);
+
+	_numberOfIndices = indices.size();
+	_lods.assign(1, { 0, (UINT)indices.size(), 0.0f });
+}
+
+template<typename IndexType>
+void Mesh::CreateIndexBuffer(const std::vector<UINT>& indices, ID3D11Device * d3dDevice, ID3D11Buffer ** indexBuffer)
+{
+	//the indices are held as 32 bit so only the narrower types need converting
+	std::vector<IndexType> narrowedIndices;
+	const void* indexData = &indices[0];
+
+	if (sizeof(IndexType) != sizeof(UINT))
+	{
+		narrowedIndices.assign(indices.begin(), indices.end());
+		indexData = &narrowedIndices[0];
+	}
+
+	CreateIndexBuffer(indexData, IndexFormat<IndexType>::Format, indices.size(), d3dDevice, indexBuffer);
+}
+
+template<typename VertexType>
+void Mesh::CreateDepthStream(DepthStreams::Stream stream, const std::vector<VertexType>& vertices, const std::vector<UINT>& indices, ID3D11Device * d3dDevice)
+{
+	MeshStream& meshStream = _depthStreams[stream];
+
+	CreateVertexBuffer(vertices.data(), sizeof(VertexType), vertices.size(), d3dDevice, &meshStream.VertexBuffer);
+	meshStream.IndexFormat = CreateIndexBuffer(indices, vertices.size(), d3dDevice, &meshStream.IndexBuffer);
+
+	meshStream.VertexBufferStride = sizeof(VertexType);
+	meshStream.VertexBufferOffset = 0;
+}
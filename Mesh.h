@@ -6,9 +6,23 @@
 
 #include "Commons.h"
 #include "AnimatedModelData.h"
+#include "MeshCache.h"
+#include "VertexCompression.h"
+#include "DepthStreams.h"
 
 using namespace DirectX;
 
+//One of the cut down vertex buffers the depth only passes draw with. Its index buffer is laid out like the full one so
+//the mesh's LOD ranges apply to it unchanged
+struct MeshStream
+{
+	ID3D11Buffer* VertexBuffer = nullptr;
+	ID3D11Buffer* IndexBuffer = nullptr;
+	UINT VertexBufferStride = 0;
+	UINT VertexBufferOffset = 0;
+	DXGI_FORMAT IndexFormat = DXGI_FORMAT_UNKNOWN;
+};
+
 class Mesh
 {
 public:
@@ -19,8 +33,53 @@ public:
 	UINT _vertexBufferStride;
 	UINT _vertexBufferOffset;
 
+	DXGI_FORMAT _indexFormat;
+
+	//Ranges of the index buffer, _lods[0] is the full mesh and any coarser levels follow it
+	std::vector<MeshLOD> _lods;
+
+	//Ranges of the full mesh drawn with their own material, empty when it is drawn in one go
+	std::vector<Submesh> _submeshes;
+
+	//Only meshes made from SimpleVertex or compressed data have these, the others leave the buffers null
+	MeshStream _depthStreams[DepthStreams::Stream_Count];
+
+	//Set for meshes made from a CompressedModel, whose positions CompressedNormalVS scales by _decodeScale and offsets
+	//by _decodeOffset
+	bool _compressed = false;
+	XMFLOAT4 _decodeScale;
+	XMFLOAT4 _decodeOffset;
+
 	Mesh() {};
 	Mesh(IndexedModel model, ID3D11Device* d3dDevice);
-	Mesh(IndexedSkeletalModel model, ID3D11Device* d3dDevice);
+	//A dynamic vertex buffer can be rewritten with Map, for models whose vertices are changed on the CPU
+	Mesh(IndexedSkeletalModel model, ID3D11Device* d3dDevice, bool dynamicVertices = false);
+	//Draws with VertexCompression::c_InputLayout and CompressedNormalVS, the depth streams are built from the decoded vertices
+	Mesh(const VertexCompression::CompressedModel& model, ID3D11Device* d3dDevice);
+	//Creates the buffers straight from the mapped cache file, nothing is copied on the CPU
+	Mesh(const MeshCache::CookedMesh& cookedMesh, ID3D11Device* d3dDevice);
 	~Mesh();
-};
\ No newline at end of file
+
+	bool HasDepthStream(DepthStreams::Stream stream) const { return _depthStreams[stream].VertexBuffer != nullptr; }
+
+	//Creates an index buffer with 16 bit indices if vertexCount allows it and 32 bit otherwise, returns the format used
+	static DXGI_FORMAT CreateIndexBuffer(const std::vector<UINT>& indices, size_t vertexCount, ID3D11Device* d3dDevice, ID3D11Buffer** indexBuffer);
+	//Creates an index buffer from indices that are already laid out in the given format
+	static void CreateIndexBuffer(const void* indices, DXGI_FORMAT indexFormat, size_t indexCount, ID3D11Device* d3dDevice, ID3D11Buffer** indexBuffer);
+	static void CreateVertexBuffer(const void* vertices, UINT vertexStride, size_t vertexCount, ID3D11Device* d3dDevice, ID3D11Buffer** vertexBuffer,
+		bool dynamic = false);
+
+private:
+	void CreateVertexBuffer(const void* vertices, UINT vertexStride, size_t vertexCount, ID3D11Device* d3dDevice, bool dynamic = false);
+	void CreateDepthStreams(const IndexedModel& model, ID3D11Device* d3dDevice);
+	void CreateDepthStream(DepthStreams::Stream stream, const void* vertices, UINT vertexStride, size_t vertexCount,
+		const void* indices, DXGI_FORMAT indexFormat, size_t indexCount, ID3D11Device* d3dDevice);
+	void CreateBuffers(const void* vertices, UINT vertexStride, size_t vertexCount, const std::vector<UINT>& indices, ID3D11Device* d3dDevice,
+		bool dynamicVertices = false);
+
+	template<typename IndexType>
+	static void CreateIndexBuffer(const std::vector<UINT>& indices, ID3D11Device* d3dDevice, ID3D11Buffer** indexBuffer);
+
+	template<typename VertexType>
+	void CreateDepthStream(DepthStreams::Stream stream, const std::vector<VertexType>& vertices, const std::vector<UINT>& indices, ID3D11Device* d3dDevice);
+};
@@ -0,0 +1,326 @@
+#include "MeshCache.h"
+#include <cstring>
+#include <fstream>
+
+#include "Utilities.h"
+
+namespace
+{
+	UINT64 AlignUp(UINT64 value, UINT64 alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	const UINT64 c_HeaderSize = AlignUp(sizeof(MeshCache::Header), MeshCache::c_SectionAlignment);
+}
+
+bool MeshCache::Writer::AddSection(UINT type, const void * data, UINT elementStride, UINT elementCount, DXGI_FORMAT format)
+{
+	if (_sections.size() >= c_MaxSections)
+	{
+		return false;
+	}
+
+	//every section starts aligned relative to the file, the header is padded to the same alignment
+	_payload.resize((size_t)AlignUp(_payload.size(), c_SectionAlignment));
+
+	Section section;
+	section.Type = type;
+	section.ElementStride = elementStride;
+	section.ElementCount = elementCount;
+	section.Format = format;
+	section.Offset = c_HeaderSize + _payload.size();
+	section.Size = (UINT64)elementStride * elementCount;
+
+	const char* bytes = (const char*)data;
+	_payload.insert(_payload.end(), bytes, bytes + section.Size);
+
+	_sections.push_back(section);
+
+	return true;
+}
+
+bool MeshCache::Writer::AddSubmeshes(const std::vector<Submesh>& submeshes, const std::vector<std::string>& materials)
+{
+	if (submeshes.empty())
+	{
+		return true;
+	}
+
+	std::vector<char> names;
+	for (const std::string& material : materials)
+	{
+		names.insert(names.end(), material.begin(), material.end());
+		names.push_back('\0');
+	}
+
+	return AddSection(Section_Submeshes, submeshes.data(), sizeof(Submesh), submeshes.size()) &&
+		AddSection(Section_MaterialNames, names.data(), sizeof(char), names.size());
+}
+
+bool MeshCache::Writer::Write(const char * filename, UINT64 sourceHash) const
+{
+	std::vector<char> headerBytes((size_t)c_HeaderSize, 0);
+	Header* header = (Header*)headerBytes.data();
+
+	header->Magic = c_Magic;
+	header->Version = c_Version;
+	header->EndianMarker = c_EndianMarker;
+	header->HeaderSize = (UINT)c_HeaderSize;
+	header->SourceHash = sourceHash;
+	header->Checksum = Util::HashBytes(_payload.data(), _payload.size());
+	header->FileSize = c_HeaderSize + _payload.size();
+	header->SectionCount = _sections.size();
+
+	for (size_t i = 0; i < _sections.size(); i++)
+	{
+		header->Sections[i] = _sections[i];
+	}
+
+	std::ofstream outFile(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+
+	if (!outFile.good())
+	{
+		return false;
+	}
+
+	outFile.write(headerBytes.data(), headerBytes.size());
+	outFile.write(_payload.data(), _payload.size());
+
+	return outFile.good();
+}
+
+bool MeshCache::CookedMesh::Open(const char * filename, UINT64 expectedSourceHash)
+{
+	Close();
+
+	if (!_file.Open(filename))
+	{
+		return false;
+	}
+
+	if (!Validate(expectedSourceHash))
+	{
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void MeshCache::CookedMesh::Close()
+{
+	_file.Close();
+	_header = nullptr;
+	_vertices = nullptr;
+	_indices = nullptr;
+	_lods = nullptr;
+}
+
+MeshLOD MeshCache::CookedMesh::GetLOD(UINT level) const
+{
+	if (!_lods)
+	{
+		return { 0, GetIndexCount(), 0.0f };
+	}
+
+	return ((const MeshLOD*)GetSectionData(*_lods))[level];
+}
+
+bool MeshCache::CookedMesh::GetStream(UINT vertexSection, UINT indexSection, StreamView & view) const
+{
+	if (!IsOpen())
+	{
+		return false;
+	}
+
+	const Section* vertices = FindSection(vertexSection);
+	const Section* indices = FindSection(indexSection);
+
+	if (!vertices || !indices || vertices->ElementCount == 0 || indices->ElementCount != GetIndexCount())
+	{
+		return false;
+	}
+
+	bool wordIndices = indices->Format == IndexFormat<WORD>::Format && indices->ElementStride == sizeof(WORD);
+	bool uintIndices = indices->Format == IndexFormat<UINT>::Format && indices->ElementStride == sizeof(UINT);
+
+	if (!wordIndices && !uintIndices)
+	{
+		return false;
+	}
+
+	view.Vertices = GetSectionData(*vertices);
+	view.VertexStride = vertices->ElementStride;
+	view.VertexCount = vertices->ElementCount;
+	view.Indices = GetSectionData(*indices);
+	view.IndexFormat = (DXGI_FORMAT)indices->Format;
+	view.IndexCount = indices->ElementCount;
+
+	return true;
+}
+
+bool MeshCache::CookedMesh::ReadSubmeshes(std::vector<Submesh>& submeshes, std::vector<std::string>& materials) const
+{
+	submeshes.clear();
+	materials.clear();
+
+	const Section* submeshSection = IsOpen() ? FindSection(Section_Submeshes) : nullptr;
+	if (!submeshSection)
+	{
+		return true;
+	}
+
+	const Section* namesSection = FindSection(Section_MaterialNames);
+	if (submeshSection->ElementStride != sizeof(Submesh) || !namesSection || namesSection->ElementStride != sizeof(char))
+	{
+		return false;
+	}
+
+	const char* names = (const char*)GetSectionData(*namesSection);
+	const char* namesEnd = names + namesSection->ElementCount;
+	while (names < namesEnd)
+	{
+		const char* nameEnd = (const char*)memchr(names, '\0', namesEnd - names);
+		if (!nameEnd)
+		{
+			return false;
+		}
+
+		materials.emplace_back(names, nameEnd);
+		names = nameEnd + 1;
+	}
+
+	MeshLOD fullMesh = GetLOD(0);
+	const Submesh* cookedSubmeshes = (const Submesh*)GetSectionData(*submeshSection);
+
+	for (UINT i = 0; i < submeshSection->ElementCount; i++)
+	{
+		const Submesh& submesh = cookedSubmeshes[i];
+		if (submesh.StartIndex > fullMesh.IndexCount || submesh.IndexCount > fullMesh.IndexCount - submesh.StartIndex || submesh.MaterialId >= materials.size())
+		{
+			submeshes.clear();
+			materials.clear();
+			return false;
+		}
+	}
+
+	submeshes.assign(cookedSubmeshes, cookedSubmeshes + submeshSection->ElementCount);
+	return true;
+}
+
+const MeshCache::Section * MeshCache::CookedMesh::FindSection(UINT type) const
+{
+	for (UINT i = 0; i < _header->SectionCount; i++)
+	{
+		if (_header->Sections[i].Type == type)
+		{
+			return &_header->Sections[i];
+		}
+	}
+
+	return nullptr;
+}
+
+bool MeshCache::CookedMesh::Validate(UINT64 expectedSourceHash)
+{
+	//the mapping starts on a page boundary so the header can be read in place
+	if (_file.GetSize() < c_HeaderSize)
+	{
+		DBG_OUTPUT(L"Mesh cache is too small to hold a header\n");
+		return false;
+	}
+
+	_header = (const Header*)_file.GetData();
+
+	if (_header->Magic != c_Magic)
+	{
+		DBG_OUTPUT(L"Mesh cache has the wrong magic number\n");
+		return false;
+	}
+
+	if (_header->EndianMarker != c_EndianMarker)
+	{
+		DBG_OUTPUT(L"Mesh cache was written with a different byte order\n");
+		return false;
+	}
+
+	if (_header->Version != c_Version || _header->HeaderSize != c_HeaderSize)
+	{
+		DBG_OUTPUT(L"Mesh cache version %u is out of date\n", _header->Version);
+		return false;
+	}
+
+	if (_header->SourceHash != expectedSourceHash)
+	{
+		DBG_OUTPUT(L"Mesh cache is stale, the source has changed since it was cooked\n");
+		return false;
+	}
+
+	if (_header->FileSize != _file.GetSize() || _header->SectionCount > c_MaxSections)
+	{
+		DBG_OUTPUT(L"Mesh cache is truncated\n");
+		return false;
+	}
+
+	for (UINT i = 0; i < _header->SectionCount; i++)
+	{
+		const Section& section = _header->Sections[i];
+
+		bool inBounds = section.Offset >= c_HeaderSize && section.Offset <= _header->FileSize && section.Size <= _header->FileSize - section.Offset;
+
+		if (!inBounds || section.Offset % c_SectionAlignment != 0 || section.Size != (UINT64)section.ElementStride * section.ElementCount)
+		{
+			DBG_OUTPUT(L"Mesh cache section %u is malformed\n", i);
+			return false;
+		}
+	}
+
+	if (Util::HashBytes(_file.GetData() + c_HeaderSize, _file.GetSize() - (size_t)c_HeaderSize) != _header->Checksum)
+	{
+		DBG_OUTPUT(L"Mesh cache checksum doesn't match, the file is corrupt\n");
+		return false;
+	}
+
+	_vertices = FindSection(Section_Vertices);
+	_indices = FindSection(Section_Indices);
+
+	if (!_vertices || !_indices || _vertices->ElementCount == 0)
+	{
+		DBG_OUTPUT(L"Mesh cache is missing its vertex or index data\n");
+		return false;
+	}
+
+	bool wordIndices = _indices->Format == IndexFormat<WORD>::Format && _indices->ElementStride == sizeof(WORD);
+	bool uintIndices = _indices->Format == IndexFormat<UINT>::Format && _indices->ElementStride == sizeof(UINT);
+
+	if (!wordIndices && !uintIndices)
+	{
+		DBG_OUTPUT(L"Mesh cache has an unknown index format\n");
+		return false;
+	}
+
+	_lods = FindSection(Section_LODs);
+
+	if (_lods)
+	{
+		if (_lods->ElementStride != sizeof(MeshLOD) || _lods->ElementCount == 0)
+		{
+			DBG_OUTPUT(L"Mesh cache has a malformed LOD table\n");
+			return false;
+		}
+
+		const MeshLOD* lods = (const MeshLOD*)GetSectionData(*_lods);
+
+		for (UINT level = 0; level < _lods->ElementCount; level++)
+		{
+			if (lods[level].StartIndex > _indices->ElementCount || lods[level].IndexCount > _indices->ElementCount - lods[level].StartIndex)
+			{
+				DBG_OUTPUT(L"Mesh cache LOD %u is outside the index data\n", level);
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,193 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Commons.h"
+#include "MappedFile.h"
+
+//Cooked mesh container. A fixed size header is followed by a table of sections that each start on an aligned offset,
+//so the vertex and index data can be handed to D3D straight out of the file mapping without being copied first
+namespace MeshCache
+{
+	const UINT c_Magic = 'M' | ('E' << 8) | ('S' << 16) | ('H' << 24);
+	//bumped whenever the cooker's output changes so older files get rebuilt
+	const UINT c_Version = 9;
+
+	//written as a single UINT, a file from a machine with the other byte order reads it back reversed
+	const UINT c_EndianMarker = 0x01020304;
+
+	const UINT c_SectionAlignment = 64;
+	const UINT c_MaxSections = 24;
+
+	enum SectionType : UINT
+	{
+		Section_Vertices = 1,
+		Section_Indices = 2,
+		Section_OptimizeStatistics = 3, //MeshOptimizer::OptimizeStatistics from when the mesh was cooked
+		Section_LODs = 4, //MeshLOD ranges into the index section, the first is the full mesh and the rest follow it in the same section
+		Section_DepthVertices = 5, //DepthStreams::Stream_Depth positions
+		Section_DepthIndices = 6, //as many indices as the index section, so the LOD ranges apply to them too
+		Section_NormalDepthVertices = 7, //DepthStreams::Stream_NormalDepth vertices
+		Section_NormalDepthIndices = 8,
+		Section_Skeleton = 9, //AnimationCache::CookedSkeleton, the counts for the sections below
+		Section_Joints = 10, //AnimationCache::CookedJoint
+		Section_JointNames = 11, //null terminated, one after another
+		Section_Clips = 12, //AnimationCache::CookedClip
+		Section_Tracks = 13, //AnimationCache::CookedTrack
+		Section_ClipChunks = 14, //AnimationCache::CookedChunk, each clip's in time order
+		Section_ChunkData = 15, //the keyframe times and transforms of every chunk, each starting 16 byte aligned
+		Section_Submeshes = 16, //Submesh ranges into the index section
+		Section_MaterialNames = 17, //null terminated, one after another in material id order
+		Section_MorphTargets = 18, //AnimationCache::CookedMorphTarget
+		Section_MorphVertices = 19, //UINT vertex indices, each target's ascending
+		Section_MorphDeltas = 20, //MorphDelta for each of the morph vertices
+		Section_MorphNames = 21, //null terminated, one after another
+	};
+
+	struct Section
+	{
+		UINT Type;
+		UINT ElementStride;
+		UINT ElementCount;
+		UINT Format; //DXGI format of index sections, DXGI_FORMAT_UNKNOWN for everything else
+		UINT64 Offset; //from the start of the file
+		UINT64 Size;
+	};
+
+	struct Header
+	{
+		UINT Magic;
+		UINT Version;
+		UINT EndianMarker;
+		UINT HeaderSize;
+		UINT64 SourceHash;
+		UINT64 Checksum; //hash of every byte after the header
+		UINT64 FileSize;
+		UINT SectionCount;
+		UINT Reserved;
+		Section Sections[c_MaxSections];
+	};
+
+	//A vertex section and the index section drawn with it, straight out of the mapping
+	struct StreamView
+	{
+		const void* Vertices;
+		UINT VertexStride;
+		UINT VertexCount;
+		const void* Indices;
+		DXGI_FORMAT IndexFormat;
+		UINT IndexCount;
+	};
+
+	//Collects the sections in memory and writes the header and padded payload out in one go
+	class Writer
+	{
+	public:
+		bool AddSection(UINT type, const void* data, UINT elementStride, UINT elementCount, DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN);
+
+		//Adds the vertices and the indices, narrowed to 16 bit when the vertex count allows it
+		template<typename VertexType>
+		bool AddModel(const std::vector<VertexType>& vertices, const std::vector<UINT>& indices,
+			UINT vertexSection = Section_Vertices, UINT indexSection = Section_Indices);
+
+		//Adds nothing when the model is drawn in one go
+		bool AddSubmeshes(const std::vector<Submesh>& submeshes, const std::vector<std::string>& materials);
+
+		bool Write(const char* filename, UINT64 sourceHash) const;
+
+	private:
+		std::vector<Section> _sections;
+		std::vector<char> _payload;
+	};
+
+	//A validated cooked file, the section pointers stay valid for as long as it is open
+	class CookedMesh
+	{
+	public:
+		CookedMesh() : _header(nullptr), _vertices(nullptr), _indices(nullptr), _lods(nullptr) {}
+
+		//Fails if the file is missing, truncated, corrupt, from another version or was cooked from a different source
+		bool Open(const char* filename, UINT64 expectedSourceHash);
+		void Close();
+
+		bool IsOpen() const { return _file.IsOpen(); }
+
+		const Section* FindSection(UINT type) const;
+		const void* GetSectionData(const Section& section) const { return _file.GetData() + section.Offset; }
+
+		const void* GetVertices() const { return GetSectionData(*_vertices); }
+		UINT GetVertexStride() const { return _vertices->ElementStride; }
+		UINT GetVertexCount() const { return _vertices->ElementCount; }
+
+		const void* GetIndices() const { return GetSectionData(*_indices); }
+		DXGI_FORMAT GetIndexFormat() const { return (DXGI_FORMAT)_indices->Format; }
+		UINT GetIndexCount() const { return _indices->ElementCount; }
+
+		//Files without a LOD section are treated as having only the full mesh
+		UINT GetLODCount() const { return _lods ? _lods->ElementCount : 1; }
+		MeshLOD GetLOD(UINT level) const;
+
+		//For the extra streams written alongside the full one, false if the file doesn't have them or their index
+		//section doesn't line up with the full one
+		bool GetStream(UINT vertexSection, UINT indexSection, StreamView& view) const;
+
+		//Copies the mapped data out into a model, widening the indices of the full mesh back to 32 bit
+		template<typename VertexType>
+		bool ReadModel(std::vector<VertexType>& vertices, std::vector<UINT>& indices) const;
+
+		//Leaves both empty for files without submeshes, false if a range is outside the full mesh or a material is missing
+		bool ReadSubmeshes(std::vector<Submesh>& submeshes, std::vector<std::string>& materials) const;
+
+	private:
+		bool Validate(UINT64 expectedSourceHash);
+
+		MappedFile _file;
+		const Header* _header;
+		const Section* _vertices;
+		const Section* _indices;
+		const Section* _lods;
+	};
+
+	template<typename VertexType>
+	bool Writer::AddModel(const std::vector<VertexType>& vertices, const std::vector<UINT>& indices, UINT vertexSection, UINT indexSection)
+	{
+		if (!AddSection(vertexSection, vertices.data(), sizeof(VertexType), vertices.size()))
+			return false;
+
+		DXGI_FORMAT indexFormat = GetIndexFormatForVertexCount(vertices.size());
+
+		if (indexFormat == IndexFormat<WORD>::Format)
+		{
+			std::vector<WORD> narrowedIndices(indices.begin(), indices.end());
+			return AddSection(indexSection, narrowedIndices.data(), sizeof(WORD), narrowedIndices.size(), indexFormat);
+		}
+
+		return AddSection(indexSection, indices.data(), sizeof(UINT), indices.size(), indexFormat);
+	}
+
+	template<typename VertexType>
+	bool CookedMesh::ReadModel(std::vector<VertexType>& vertices, std::vector<UINT>& indices) const
+	{
+		if (!IsOpen() || GetVertexStride() != sizeof(VertexType))
+			return false;
+
+		const VertexType* vertexData = (const VertexType*)GetVertices();
+		vertices.assign(vertexData, vertexData + GetVertexCount());
+
+		MeshLOD fullMesh = GetLOD(0);
+
+		if (GetIndexFormat() == IndexFormat<WORD>::Format)
+		{
+			const WORD* indexData = (const WORD*)GetIndices() + fullMesh.StartIndex;
+			indices.assign(indexData, indexData + fullMesh.IndexCount);
+		}
+		else
+		{
+			const UINT* indexData = (const UINT*)GetIndices() + fullMesh.StartIndex;
+			indices.assign(indexData, indexData + fullMesh.IndexCount);
+		}
+
+		return true;
+	}
+}
@@ -0,0 +1,360 @@
+#include "MeshOptimizer.h"
+#include <algorithm>
+
+namespace
+{
+	const UINT c_Unused = 0xffffffff;
+
+	//Triangle lists for every vertex packed into one array, the triangles of vertex v are
+	//triangles[offsets[v]] up to triangles[offsets[v] + counts[v]]
+	struct Adjacency
+	{
+		std::vector<UINT> counts;
+		std::vector<UINT> offsets;
+		std::vector<UINT> triangles;
+	};
+
+	void BuildAdjacency(const std::vector<UINT>& indices, size_t vertexCount, Adjacency& adjacency)
+	{
+		size_t triangleCount = indices.size() / 3;
+
+		adjacency.counts.assign(vertexCount, 0);
+		adjacency.offsets.resize(vertexCount);
+		adjacency.triangles.resize(triangleCount * 3);
+
+		for (UINT index : indices)
+		{
+			adjacency.counts[index]++;
+		}
+
+		UINT offset = 0;
+		for (size_t v = 0; v < vertexCount; v++)
+		{
+			adjacency.offsets[v] = offset;
+			offset += adjacency.counts[v];
+		}
+
+		//fill using the offsets as cursors then put them back
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			for (int corner = 0; corner < 3; corner++)
+			{
+				UINT vertex = indices[t * 3 + corner];
+				adjacency.triangles[adjacency.offsets[vertex]++] = (UINT)t;
+			}
+		}
+
+		for (size_t v = 0; v < vertexCount; v++)
+		{
+			adjacency.offsets[v] -= adjacency.counts[v];
+		}
+	}
+
+	//Looks back through the vertices of recent triangles for one that still has work left, then falls back to scanning forward
+	int SkipDeadEnd(const std::vector<UINT>& liveTriangles, std::vector<UINT>& deadEndStack, UINT& cursor, size_t vertexCount)
+	{
+		while (!deadEndStack.empty())
+		{
+			UINT vertex = deadEndStack.back();
+			deadEndStack.pop_back();
+
+			if (liveTriangles[vertex] > 0)
+				return (int)vertex;
+		}
+
+		while (cursor < vertexCount)
+		{
+			if (liveTriangles[cursor] > 0)
+				return (int)cursor;
+			cursor++;
+		}
+
+		return -1;
+	}
+
+	//Picks the candidate that will still be in the cache after its remaining triangles are emitted, preferring the oldest
+	int GetNextVertex(const std::vector<UINT>& candidates, const std::vector<UINT>& liveTriangles, const std::vector<UINT>& cacheTimestamps,
+		UINT timestamp, UINT cacheSize)
+	{
+		int bestVertex = -1;
+		int bestPriority = -1;
+
+		for (UINT vertex : candidates)
+		{
+			if (liveTriangles[vertex] == 0)
+				continue;
+
+			int priority = 0;
+			if (timestamp - cacheTimestamps[vertex] + 2 * liveTriangles[vertex] <= cacheSize)
+			{
+				priority = timestamp - cacheTimestamps[vertex];
+			}
+
+			if (priority > bestPriority)
+			{
+				bestPriority = priority;
+				bestVertex = (int)vertex;
+			}
+		}
+
+		return bestVertex;
+	}
+}
+
+MeshOptimizer::CacheStatistics MeshOptimizer::AnalyzeVertexCache(const std::vector<UINT>& indices, size_t vertexCount, UINT cacheSize)
+{
+	CacheStatistics statistics;
+	statistics.TriangleCount = indices.size() / 3;
+	statistics.VertexCount = vertexCount;
+
+	//a vertex is in the FIFO if it was added within the last cacheSize misses
+	std::vector<UINT> cacheTimestamps(vertexCount, 0);
+	UINT timestamp = cacheSize + 1;
+
+	for (UINT index : indices)
+	{
+		if (timestamp - cacheTimestamps[index] > cacheSize)
+		{
+			cacheTimestamps[index] = timestamp++;
+			statistics.VerticesTransformed++;
+		}
+	}
+
+	return statistics;
+}
+
+void MeshOptimizer::OptimizeVertexCache(std::vector<UINT>& indices, size_t vertexCount, std::vector<UINT>& clusterStarts, UINT cacheSize)
+{
+	//Sander, Nehab and Barczak, "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw", 2007
+	size_t triangleCount = indices.size() / 3;
+
+	Adjacency adjacency;
+	BuildAdjacency(indices, vertexCount, adjacency);
+
+	std::vector<UINT> liveTriangles(adjacency.counts);
+	std::vector<UINT> cacheTimestamps(vertexCount, 0);
+	std::vector<bool> emitted(triangleCount, false);
+
+	std::vector<UINT> deadEndStack;
+	std::vector<UINT> candidates;
+
+	std::vector<UINT> outIndices;
+	outIndices.reserve(triangleCount * 3);
+
+	clusterStarts.clear();
+
+	UINT timestamp = cacheSize + 1;
+	UINT cursor = 0;
+
+	int fanningVertex = SkipDeadEnd(liveTriangles, deadEndStack, cursor, vertexCount);
+	bool startedCluster = true;
+
+	while (fanningVertex >= 0)
+	{
+		if (startedCluster)
+		{
+			clusterStarts.push_back(outIndices.size() / 3);
+			startedCluster = false;
+		}
+
+		candidates.clear();
+
+		UINT first = adjacency.offsets[fanningVertex];
+		UINT last = first + adjacency.counts[fanningVertex];
+
+		for (UINT i = first; i < last; i++)
+		{
+			UINT triangle = adjacency.triangles[i];
+
+			if (emitted[triangle])
+				continue;
+
+			for (int corner = 0; corner < 3; corner++)
+			{
+				UINT vertex = indices[triangle * 3 + corner];
+
+				outIndices.push_back(vertex);
+				deadEndStack.push_back(vertex);
+				candidates.push_back(vertex);
+
+				liveTriangles[vertex]--;
+
+				if (timestamp - cacheTimestamps[vertex] > cacheSize)
+				{
+					cacheTimestamps[vertex] = timestamp++;
+				}
+			}
+
+			emitted[triangle] = true;
+		}
+
+		fanningVertex = GetNextVertex(candidates, liveTriangles, cacheTimestamps, timestamp, cacheSize);
+
+		if (fanningVertex < 0)
+		{
+			//nothing nearby is left so the next triangles won't share anything with the cache, which makes it a hard boundary
+			fanningVertex = SkipDeadEnd(liveTriangles, deadEndStack, cursor, vertexCount);
+			startedCluster = true;
+		}
+	}
+
+	indices.swap(outIndices);
+}
+
+void MeshOptimizer::OptimizeOverdraw(std::vector<UINT>& indices, const std::vector<XMFLOAT3>& positions, const std::vector<UINT>& clusterStarts,
+	float threshold, UINT cacheSize)
+{
+	size_t triangleCount = indices.size() / 3;
+
+	if (clusterStarts.empty())
+		return;
+
+	//split the hard clusters wherever the part so far is cache efficient enough to stand on its own, more clusters gives the sort more freedom
+	float meshACMR = AnalyzeVertexCache(indices, positions.size(), cacheSize).ACMR();
+
+	std::vector<UINT> splitStarts;
+	std::vector<UINT> cacheTimestamps(positions.size(), 0);
+	UINT timestamp = cacheSize + 1;
+
+	for (size_t c = 0; c < clusterStarts.size(); c++)
+	{
+		UINT first = clusterStarts[c];
+		UINT last = c + 1 < clusterStarts.size() ? clusterStarts[c + 1] : (UINT)triangleCount;
+
+		UINT subStart = first;
+		UINT misses = 0;
+
+		splitStarts.push_back(first);
+		//starting a cluster assumes a cold cache, which is what it will see once it has been moved somewhere else
+		timestamp += cacheSize + 1;
+
+		for (UINT t = first; t < last; t++)
+		{
+			for (int corner = 0; corner < 3; corner++)
+			{
+				UINT vertex = indices[t * 3 + corner];
+				if (timestamp - cacheTimestamps[vertex] > cacheSize)
+				{
+					cacheTimestamps[vertex] = timestamp++;
+					misses++;
+				}
+			}
+
+			UINT subTriangles = t - subStart + 1;
+
+			if (t + 1 < last && (float)misses / (float)subTriangles <= meshACMR * threshold)
+			{
+				splitStarts.push_back(t + 1);
+				subStart = t + 1;
+				misses = 0;
+				timestamp += cacheSize + 1;
+			}
+		}
+	}
+
+	struct Cluster
+	{
+		UINT First;
+		UINT Last;
+		float Sort;
+	};
+
+	std::vector<Cluster> clusters(splitStarts.size());
+	std::vector<XMFLOAT3> clusterCentroids(splitStarts.size());
+	std::vector<XMFLOAT3> clusterNormals(splitStarts.size());
+
+	//centroid of the whole mesh weighted by triangle area
+	XMVECTOR meshCentroid = XMVectorZero();
+	float meshArea = 0.0f;
+
+	for (size_t c = 0; c < splitStarts.size(); c++)
+	{
+		clusters[c].First = splitStarts[c];
+		clusters[c].Last = c + 1 < splitStarts.size() ? splitStarts[c + 1] : (UINT)triangleCount;
+
+		XMVECTOR centroid = XMVectorZero();
+		XMVECTOR normal = XMVectorZero();
+		float area = 0.0f;
+
+		for (UINT t = clusters[c].First; t < clusters[c].Last; t++)
+		{
+			XMVECTOR p0 = XMLoadFloat3(&positions[indices[t * 3 + 0]]);
+			XMVECTOR p1 = XMLoadFloat3(&positions[indices[t * 3 + 1]]);
+			XMVECTOR p2 = XMLoadFloat3(&positions[indices[t * 3 + 2]]);
+
+			//the cross product's length is twice the area, so summing them weights each normal and centroid by area
+			XMVECTOR crossProduct = XMVector3Cross(p1 - p0, p2 - p0);
+			float triangleArea = XMVectorGetX(XMVector3Length(crossProduct));
+
+			normal += crossProduct;
+			centroid += (p0 + p1 + p2) * (triangleArea / 3.0f);
+			area += triangleArea;
+		}
+
+		XMStoreFloat3(&clusterCentroids[c], area > 0.0f ? centroid / area : XMVectorZero());
+		XMStoreFloat3(&clusterNormals[c], XMVector3Normalize(normal));
+
+		meshCentroid += centroid;
+		meshArea += area;
+	}
+
+	if (meshArea > 0.0f)
+	{
+		meshCentroid = meshCentroid / meshArea;
+	}
+
+	//clusters that face away from the centre are likely to be in front of the rest of the mesh, so they get drawn first
+	for (size_t c = 0; c < clusters.size(); c++)
+	{
+		XMVECTOR offset = XMLoadFloat3(&clusterCentroids[c]) - meshCentroid;
+		clusters[c].Sort = XMVectorGetX(XMVector3Dot(offset, XMLoadFloat3(&clusterNormals[c])));
+	}
+
+	std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b) { return a.Sort > b.Sort; });
+
+	std::vector<UINT> outIndices;
+	outIndices.reserve(indices.size());
+
+	for (const Cluster& cluster : clusters)
+	{
+		outIndices.insert(outIndices.end(), indices.begin() + cluster.First * 3, indices.begin() + cluster.Last * 3);
+	}
+
+	indices.swap(outIndices);
+}
+
+void MeshOptimizer::OptimizeVertexFetch(std::vector<UINT>& indices, size_t vertexCount, std::vector<UINT>& remap)
+{
+	remap.assign(vertexCount, c_Unused);
+
+	UINT nextVertex = 0;
+
+	for (UINT& index : indices)
+	{
+		if (remap[index] == c_Unused)
+		{
+			remap[index] = nextVertex++;
+		}
+
+		index = remap[index];
+	}
+
+	for (UINT& newIndex : remap)
+	{
+		if (newIndex == c_Unused)
+		{
+			newIndex = nextVertex++;
+		}
+	}
+}
+
+void MeshOptimizer::OutputStatistics(const WCHAR * label, const OptimizeStatistics & statistics)
+{
+	//wvsprintf has no floating point support so the ratios are printed as fixed point
+	UINT before[2] = { (UINT)(statistics.Before.ACMR() * 1000.0f), (UINT)(statistics.Before.ATVR() * 1000.0f) };
+	UINT after[2] = { (UINT)(statistics.After.ACMR() * 1000.0f), (UINT)(statistics.After.ATVR() * 1000.0f) };
+
+	DBG_OUTPUT(L"%s vertex cache optimized %u triangles, ACMR %u.%03u -> %u.%03u, ATVR %u.%03u -> %u.%03u\n", label, statistics.After.TriangleCount,
+		before[0] / 1000, before[0] % 1000, after[0] / 1000, after[0] % 1000,
+		before[1] / 1000, before[1] % 1000, after[1] / 1000, after[1] % 1000);
+}
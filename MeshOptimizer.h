@@ -0,0 +1,177 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include "Commons.h"
+
+//Reorders triangles and vertices after loading so the GPU does less work drawing the same mesh.
+//Triangles are ordered for the post-transform vertex cache with Tipsify, the resulting clusters are then sorted so
+//the ones facing outwards are drawn first to cut down overdraw, and finally the vertices are renumbered in the order
+//the index buffer first uses them so vertex fetches walk forward through memory
+namespace MeshOptimizer
+{
+	//Size of the simulated FIFO post-transform cache, small enough to hold on any hardware this runs on
+	const UINT c_VertexCacheSize = 16;
+
+	//Clusters are split further as long as they stay within this factor of the whole mesh's cache miss ratio
+	const float c_OverdrawThreshold = 1.05f;
+
+	struct CacheStatistics
+	{
+		UINT TriangleCount = 0;
+		UINT VertexCount = 0;
+		UINT VerticesTransformed = 0;
+
+		//Average cache miss ratio, vertices transformed per triangle. 0.5 is the best possible on a large regular grid and 3 is the worst
+		float ACMR() const { return TriangleCount ? (float)VerticesTransformed / (float)TriangleCount : 0.0f; }
+
+		//Average transform to vertex ratio, 1 means every vertex is only transformed once
+		float ATVR() const { return VertexCount ? (float)VerticesTransformed / (float)VertexCount : 0.0f; }
+	};
+
+	struct OptimizeStatistics
+	{
+		CacheStatistics Before;
+		CacheStatistics After;
+	};
+
+	//Runs the index buffer through a FIFO cache of the given size and counts the misses
+	CacheStatistics AnalyzeVertexCache(const std::vector<UINT>& indices, size_t vertexCount, UINT cacheSize = c_VertexCacheSize);
+
+	//Tipsify triangle ordering. clusterStarts receives the first triangle of every run that had to jump somewhere new
+	void OptimizeVertexCache(std::vector<UINT>& indices, size_t vertexCount, std::vector<UINT>& clusterStarts, UINT cacheSize = c_VertexCacheSize);
+
+	//Splits the clusters where it costs little in cache misses, then sorts them so outward facing clusters far from the
+	//centre of the mesh are drawn first. This is view independent so it only needs doing once
+	void OptimizeOverdraw(std::vector<UINT>& indices, const std::vector<XMFLOAT3>& positions, const std::vector<UINT>& clusterStarts,
+		float threshold = c_OverdrawThreshold, UINT cacheSize = c_VertexCacheSize);
+
+	//Renumbers the indices in the order the vertices are first used and fills remap[old] with each vertex's new position,
+	//unused vertices go at the end
+	void OptimizeVertexFetch(std::vector<UINT>& indices, size_t vertexCount, std::vector<UINT>& remap);
+
+	//Writes the cache statistics before and after optimizing to the debug output
+	void OutputStatistics(const WCHAR* label, const OptimizeStatistics& statistics);
+
+	//Runs all three passes on a model, any vertex type with a PosL member can be used. vertexRemap, if given, receives
+	//each vertex's new position for data that refers to the vertices by index
+	template<typename VertexType>
+	OptimizeStatistics Optimize(std::vector<VertexType>& vertices, std::vector<UINT>& indices, std::vector<UINT>* vertexRemap = nullptr);
+
+	//Same as Optimize except triangles are only reordered within their own range, so submeshes drawn with different
+	//materials stay where they are in the index buffer
+	template<typename VertexType>
+	OptimizeStatistics Optimize(std::vector<VertexType>& vertices, std::vector<UINT>& indices, const std::vector<Submesh>& submeshes,
+		std::vector<UINT>* vertexRemap = nullptr);
+
+	inline OptimizeStatistics Optimize(IndexedModel& model) { return Optimize(model.Vertices, model.Indices); }
+	inline OptimizeStatistics Optimize(IndexedSkeletalModel& model, std::vector<UINT>* vertexRemap = nullptr)
+	{
+		return model.Submeshes.empty() ? Optimize(model.Vertices, model.Indices, vertexRemap) : Optimize(model.Vertices, model.Indices, model.Submeshes, vertexRemap);
+	}
+
+	template<typename VertexType>
+	OptimizeStatistics Optimize(std::vector<VertexType>& vertices, std::vector<UINT>& indices, std::vector<UINT>* vertexRemap)
+	{
+		OptimizeStatistics statistics;
+		statistics.Before = AnalyzeVertexCache(indices, vertices.size());
+
+		if (indices.size() < 3)
+		{
+			if (vertexRemap)
+			{
+				vertexRemap->resize(vertices.size());
+				for (size_t i = 0; i < vertices.size(); i++)
+				{
+					(*vertexRemap)[i] = (UINT)i;
+				}
+			}
+
+			statistics.After = statistics.Before;
+			return statistics;
+		}
+
+		std::vector<UINT> clusterStarts;
+		OptimizeVertexCache(indices, vertices.size(), clusterStarts);
+
+		std::vector<XMFLOAT3> positions(vertices.size());
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			positions[i] = vertices[i].PosL;
+		}
+
+		OptimizeOverdraw(indices, positions, clusterStarts);
+
+		std::vector<UINT> remap;
+		OptimizeVertexFetch(indices, vertices.size(), remap);
+
+		std::vector<VertexType> reorderedVertices(vertices.size());
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			reorderedVertices[remap[i]] = vertices[i];
+		}
+		vertices.swap(reorderedVertices);
+
+		if (vertexRemap)
+		{
+			vertexRemap->swap(remap);
+		}
+
+		statistics.After = AnalyzeVertexCache(indices, vertices.size());
+
+		return statistics;
+	}
+
+	template<typename VertexType>
+	OptimizeStatistics Optimize(std::vector<VertexType>& vertices, std::vector<UINT>& indices, const std::vector<Submesh>& submeshes,
+		std::vector<UINT>* vertexRemap)
+	{
+		OptimizeStatistics statistics;
+		statistics.Before = AnalyzeVertexCache(indices, vertices.size());
+
+		std::vector<XMFLOAT3> positions(vertices.size());
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			positions[i] = vertices[i].PosL;
+		}
+
+		std::vector<UINT> rangeIndices;
+		std::vector<UINT> clusterStarts;
+
+		for (const Submesh& submesh : submeshes)
+		{
+			if (submesh.IndexCount < 3)
+			{
+				continue;
+			}
+
+			rangeIndices.assign(indices.begin() + submesh.StartIndex, indices.begin() + submesh.StartIndex + submesh.IndexCount);
+
+			OptimizeVertexCache(rangeIndices, vertices.size(), clusterStarts);
+			OptimizeOverdraw(rangeIndices, positions, clusterStarts);
+
+			std::copy(rangeIndices.begin(), rangeIndices.end(), indices.begin() + submesh.StartIndex);
+		}
+
+		//renumbering only changes which vertex an index names, so it can run over every range at once
+		std::vector<UINT> remap;
+		OptimizeVertexFetch(indices, vertices.size(), remap);
+
+		std::vector<VertexType> reorderedVertices(vertices.size());
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			reorderedVertices[remap[i]] = vertices[i];
+		}
+		vertices.swap(reorderedVertices);
+
+		if (vertexRemap)
+		{
+			vertexRemap->swap(remap);
+		}
+
+		statistics.After = AnalyzeVertexCache(indices, vertices.size());
+
+		return statistics;
+	}
+}
@@ -0,0 +1,658 @@
+#include "MeshSimplifier.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include "MeshOptimizer.h"
+
+namespace
+{
+	const UINT c_None = 0xffffffff;
+
+	//the vertex has more than one open edge leaving it in the same direction so it can't be classified
+	const UINT c_Conflict = 0xfffffffe;
+
+	//open edges also get a plane through them at right angles to the triangle, weighted so outlines keep their shape
+	const double c_BorderWeight = 10.0;
+
+	//a collapse is refused if it turns a triangle further than this, as the cosine of the angle
+	const double c_MinFlipCosine = 0.25;
+
+	enum VertexKind
+	{
+		Kind_Manifold, //interior vertex with one set of attributes, can collapse onto any neighbour
+		Kind_Border, //on an open edge of the mesh, only collapses along that edge
+		Kind_Seam, //one of a pair at the same position with different attributes, collapses along the seam together with the other
+		Kind_Locked, //anything else, such as corners or where several seams meet, never moves
+	};
+
+	//Sum of squared distances to a set of weighted planes, p'Ap + 2b'p + c
+	struct Quadric
+	{
+		double a00 = 0.0, a11 = 0.0, a22 = 0.0, a01 = 0.0, a02 = 0.0, a12 = 0.0;
+		double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+		double c = 0.0;
+		double weight = 0.0;
+	};
+
+	void AddPlane(Quadric& quadric, double nx, double ny, double nz, double d, double weight)
+	{
+		quadric.a00 += weight * nx * nx;
+		quadric.a11 += weight * ny * ny;
+		quadric.a22 += weight * nz * nz;
+		quadric.a01 += weight * nx * ny;
+		quadric.a02 += weight * nx * nz;
+		quadric.a12 += weight * ny * nz;
+		quadric.b0 += weight * nx * d;
+		quadric.b1 += weight * ny * d;
+		quadric.b2 += weight * nz * d;
+		quadric.c += weight * d * d;
+		quadric.weight += weight;
+	}
+
+	void AddQuadric(Quadric& quadric, const Quadric& other)
+	{
+		quadric.a00 += other.a00;
+		quadric.a11 += other.a11;
+		quadric.a22 += other.a22;
+		quadric.a01 += other.a01;
+		quadric.a02 += other.a02;
+		quadric.a12 += other.a12;
+		quadric.b0 += other.b0;
+		quadric.b1 += other.b1;
+		quadric.b2 += other.b2;
+		quadric.c += other.c;
+		quadric.weight += other.weight;
+	}
+
+	//divided by the total weight so the result is a mean squared distance however much area went into the quadric
+	double EvaluateQuadric(const Quadric& quadric, const XMFLOAT3& point)
+	{
+		double x = point.x, y = point.y, z = point.z;
+
+		double result = quadric.a00 * x * x + quadric.a11 * y * y + quadric.a22 * z * z +
+			2.0 * (quadric.a01 * x * y + quadric.a02 * x * z + quadric.a12 * y * z) +
+			2.0 * (quadric.b0 * x + quadric.b1 * y + quadric.b2 * z) + quadric.c;
+
+		return quadric.weight > 0.0 ? std::max(0.0, result / quadric.weight) : 0.0;
+	}
+
+	struct Vector3d
+	{
+		double x, y, z;
+	};
+
+	Vector3d Subtract(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return { (double)a.x - b.x, (double)a.y - b.y, (double)a.z - b.z };
+	}
+
+	Vector3d Cross(const Vector3d& a, const Vector3d& b)
+	{
+		return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+	}
+
+	double Dot(const Vector3d& a, const Vector3d& b)
+	{
+		return a.x * b.x + a.y * b.y + a.z * b.z;
+	}
+
+	double Length(const Vector3d& a)
+	{
+		return sqrt(Dot(a, a));
+	}
+
+	//Every vertex is mapped to the first vertex with exactly the same position
+	void BuildPositionRemap(const std::vector<XMFLOAT3>& positions, std::vector<UINT>& remap)
+	{
+		std::vector<UINT> order(positions.size());
+		for (size_t i = 0; i < order.size(); i++)
+		{
+			order[i] = (UINT)i;
+		}
+
+		auto less = [&](UINT a, UINT b)
+		{
+			const XMFLOAT3& pa = positions[a];
+			const XMFLOAT3& pb = positions[b];
+
+			if (pa.x != pb.x) return pa.x < pb.x;
+			if (pa.y != pb.y) return pa.y < pb.y;
+			if (pa.z != pb.z) return pa.z < pb.z;
+			return a < b;
+		};
+
+		std::sort(order.begin(), order.end(), less);
+
+		remap.resize(positions.size());
+		for (size_t i = 0; i < order.size(); i++)
+		{
+			UINT vertex = order[i];
+			bool samePosition = i > 0 && memcmp(&positions[vertex], &positions[order[i - 1]], sizeof(XMFLOAT3)) == 0;
+
+			remap[vertex] = samePosition ? remap[order[i - 1]] : vertex;
+		}
+	}
+
+	//Outgoing edges for every vertex packed into one array, the edges leaving v are
+	//targets[offsets[v]] up to targets[offsets[v] + counts[v]]
+	struct EdgeAdjacency
+	{
+		std::vector<UINT> counts;
+		std::vector<UINT> offsets;
+		std::vector<UINT> targets;
+	};
+
+	void BuildEdgeAdjacency(const std::vector<UINT>& indices, size_t vertexCount, EdgeAdjacency& adjacency)
+	{
+		adjacency.counts.assign(vertexCount, 0);
+		adjacency.offsets.resize(vertexCount);
+		adjacency.targets.resize(indices.size());
+
+		for (UINT index : indices)
+		{
+			adjacency.counts[index]++;
+		}
+
+		UINT offset = 0;
+		for (size_t v = 0; v < vertexCount; v++)
+		{
+			adjacency.offsets[v] = offset;
+			offset += adjacency.counts[v];
+		}
+
+		//fill using the offsets as cursors then put them back
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			for (int corner = 0; corner < 3; corner++)
+			{
+				UINT from = indices[i + corner];
+				UINT to = indices[i + (corner + 1) % 3];
+				adjacency.targets[adjacency.offsets[from]++] = to;
+			}
+		}
+
+		for (size_t v = 0; v < vertexCount; v++)
+		{
+			adjacency.offsets[v] -= adjacency.counts[v];
+		}
+	}
+
+	bool HasEdge(const EdgeAdjacency& adjacency, UINT from, UINT to)
+	{
+		UINT first = adjacency.offsets[from];
+		UINT last = first + adjacency.counts[from];
+
+		for (UINT i = first; i < last; i++)
+		{
+			if (adjacency.targets[i] == to)
+				return true;
+		}
+
+		return false;
+	}
+
+	//Triangles around every position, in the same packed layout as the edges
+	struct TriangleAdjacency
+	{
+		std::vector<UINT> counts;
+		std::vector<UINT> offsets;
+		std::vector<UINT> triangles;
+	};
+
+	void BuildTriangleAdjacency(const std::vector<UINT>& indices, const std::vector<UINT>& remap, TriangleAdjacency& adjacency)
+	{
+		size_t vertexCount = remap.size();
+
+		adjacency.counts.assign(vertexCount, 0);
+		adjacency.offsets.resize(vertexCount);
+		adjacency.triangles.resize(indices.size());
+
+		for (UINT index : indices)
+		{
+			adjacency.counts[remap[index]]++;
+		}
+
+		UINT offset = 0;
+		for (size_t v = 0; v < vertexCount; v++)
+		{
+			adjacency.offsets[v] = offset;
+			offset += adjacency.counts[v];
+		}
+
+		for (size_t i = 0; i < indices.size(); i++)
+		{
+			UINT position = remap[indices[i]];
+			adjacency.triangles[adjacency.offsets[position]++] = (UINT)(i / 3);
+		}
+
+		for (size_t v = 0; v < vertexCount; v++)
+		{
+			adjacency.offsets[v] -= adjacency.counts[v];
+		}
+	}
+
+	//Follows the open edges around each vertex. loop[v] is where the open edge leaving v goes and loopback[v] where the
+	//one arriving at v came from, so a border or seam can be walked in either direction
+	void BuildOpenEdgeLoops(const std::vector<UINT>& indices, const EdgeAdjacency& adjacency, std::vector<UINT>& loop, std::vector<UINT>& loopback)
+	{
+		loop.assign(adjacency.counts.size(), c_None);
+		loopback.assign(adjacency.counts.size(), c_None);
+
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			for (int corner = 0; corner < 3; corner++)
+			{
+				UINT from = indices[i + corner];
+				UINT to = indices[i + (corner + 1) % 3];
+
+				//an edge is open if no triangle uses it in the opposite direction
+				if (HasEdge(adjacency, to, from))
+					continue;
+
+				loop[from] = loop[from] == c_None ? to : c_Conflict;
+				loopback[to] = loopback[to] == c_None ? from : c_Conflict;
+			}
+		}
+	}
+
+	bool IsValidLoop(UINT vertex)
+	{
+		return vertex != c_None && vertex != c_Conflict;
+	}
+
+	//wedge links every vertex at a position into a ring, only vertices still used by a triangle take part
+	void ClassifyVertices(const std::vector<UINT>& remap, const std::vector<UINT>& wedge, const std::vector<UINT>& loop,
+		const std::vector<UINT>& loopback, std::vector<unsigned char>& kinds)
+	{
+		kinds.assign(remap.size(), Kind_Locked);
+
+		for (size_t v = 0; v < remap.size(); v++)
+		{
+			UINT other = wedge[v];
+
+			if (other == v)
+			{
+				bool open = loop[v] != c_None || loopback[v] != c_None;
+				bool simple = IsValidLoop(loop[v]) && IsValidLoop(loopback[v]);
+
+				kinds[v] = !open ? Kind_Manifold : simple ? Kind_Border : Kind_Locked;
+			}
+			else if (wedge[other] == v)
+			{
+				//two vertices at one position, a seam if their open edges run alongside each other in opposite directions
+				bool simple = IsValidLoop(loop[v]) && IsValidLoop(loopback[v]) && IsValidLoop(loop[other]) && IsValidLoop(loopback[other]);
+
+				if (simple && remap[loop[v]] == remap[loopback[other]] && remap[loopback[v]] == remap[loop[other]])
+				{
+					kinds[v] = Kind_Seam;
+				}
+			}
+		}
+	}
+
+	//Checks the rules in VertexKind. A seam also needs the other side collapsing, siblingFrom and siblingTo are set to it
+	bool CanCollapse(UINT from, UINT to, const std::vector<unsigned char>& kinds, const std::vector<UINT>& remap, const std::vector<UINT>& wedge,
+		const std::vector<UINT>& loop, const std::vector<UINT>& loopback, UINT& siblingFrom, UINT& siblingTo)
+	{
+		siblingFrom = c_None;
+		siblingTo = c_None;
+
+		switch (kinds[from])
+		{
+		case Kind_Manifold:
+			return true;
+
+		case Kind_Border:
+			return (to == loop[from] || to == loopback[from]) && (kinds[to] == Kind_Border || kinds[to] == Kind_Locked);
+
+		case Kind_Seam:
+		{
+			if ((to != loop[from] && to != loopback[from]) || (kinds[to] != Kind_Seam && kinds[to] != Kind_Locked))
+				return false;
+
+			//the other side of the seam runs the opposite way, so its end of the edge is found by walking back along it
+			siblingFrom = wedge[from];
+			siblingTo = to == loop[from] ? loopback[siblingFrom] : loop[siblingFrom];
+
+			return remap[siblingTo] == remap[to];
+		}
+
+		default:
+			return false;
+		}
+	}
+
+	struct Collapse
+	{
+		UINT From;
+		UINT To;
+		double Cost;
+	};
+
+	//True if moving position from onto to leaves every triangle around it facing roughly the same way
+	bool PreservesOrientation(UINT from, UINT to, const std::vector<XMFLOAT3>& positions, const std::vector<UINT>& indices,
+		const std::vector<UINT>& remap, const TriangleAdjacency& adjacency)
+	{
+		UINT first = adjacency.offsets[from];
+		UINT last = first + adjacency.counts[from];
+
+		for (UINT i = first; i < last; i++)
+		{
+			UINT triangle = adjacency.triangles[i];
+			UINT corners[3] = { remap[indices[triangle * 3]], remap[indices[triangle * 3 + 1]], remap[indices[triangle * 3 + 2]] };
+
+			//triangles on the collapsing edge disappear
+			if (corners[0] == to || corners[1] == to || corners[2] == to)
+				continue;
+
+			UINT moved[3];
+			for (int corner = 0; corner < 3; corner++)
+			{
+				moved[corner] = corners[corner] == from ? to : corners[corner];
+			}
+
+			Vector3d before = Cross(Subtract(positions[corners[1]], positions[corners[0]]), Subtract(positions[corners[2]], positions[corners[0]]));
+			Vector3d after = Cross(Subtract(positions[moved[1]], positions[moved[0]]), Subtract(positions[moved[2]], positions[moved[0]]));
+
+			double lengths = Length(before) * Length(after);
+
+			if (lengths == 0.0 || Dot(before, after) < c_MinFlipCosine * lengths)
+				return false;
+		}
+
+		return true;
+	}
+}
+
+float MeshSimplifier::Simplify(const std::vector<XMFLOAT3>& positions, const std::vector<UINT>& indices, size_t targetIndexCount, float targetError,
+	std::vector<UINT>& outIndices)
+{
+	size_t vertexCount = positions.size();
+	outIndices = indices;
+
+	if (indices.size() <= targetIndexCount || vertexCount == 0)
+		return 0.0f;
+
+	std::vector<UINT> remap;
+	BuildPositionRemap(positions, remap);
+
+	//every position gets the planes of the triangles around it, weighted by area
+	std::vector<Quadric> quadrics(vertexCount);
+
+	EdgeAdjacency edges;
+	BuildEdgeAdjacency(indices, vertexCount, edges);
+
+	for (size_t i = 0; i < indices.size(); i += 3)
+	{
+		UINT corners[3] = { indices[i], indices[i + 1], indices[i + 2] };
+
+		const XMFLOAT3& p0 = positions[corners[0]];
+		Vector3d normal = Cross(Subtract(positions[corners[1]], p0), Subtract(positions[corners[2]], p0));
+		double doubleArea = Length(normal);
+
+		if (doubleArea == 0.0)
+			continue;
+
+		normal = { normal.x / doubleArea, normal.y / doubleArea, normal.z / doubleArea };
+		double d = -(normal.x * p0.x + normal.y * p0.y + normal.z * p0.z);
+
+		for (int corner = 0; corner < 3; corner++)
+		{
+			AddPlane(quadrics[remap[corners[corner]]], normal.x, normal.y, normal.z, d, doubleArea * 0.5);
+		}
+
+		for (int corner = 0; corner < 3; corner++)
+		{
+			UINT from = corners[corner];
+			UINT to = corners[(corner + 1) % 3];
+
+			if (HasEdge(edges, to, from))
+				continue;
+
+			const XMFLOAT3& a = positions[from];
+			Vector3d edge = Subtract(positions[to], a);
+			double edgeLength = Length(edge);
+
+			if (edgeLength == 0.0)
+				continue;
+
+			Vector3d edgeNormal = Cross(edge, normal);
+			double edgeNormalLength = Length(edgeNormal);
+			edgeNormal = { edgeNormal.x / edgeNormalLength, edgeNormal.y / edgeNormalLength, edgeNormal.z / edgeNormalLength };
+
+			double edgeD = -(edgeNormal.x * a.x + edgeNormal.y * a.y + edgeNormal.z * a.z);
+			double weight = edgeLength * edgeLength * c_BorderWeight;
+
+			AddPlane(quadrics[remap[from]], edgeNormal.x, edgeNormal.y, edgeNormal.z, edgeD, weight);
+			AddPlane(quadrics[remap[to]], edgeNormal.x, edgeNormal.y, edgeNormal.z, edgeD, weight);
+		}
+	}
+
+	double maxCost = (double)targetError * targetError;
+	double largestCost = 0.0;
+
+	std::vector<UINT> wedge(vertexCount);
+	std::vector<UINT> head(vertexCount);
+	std::vector<UINT> loop;
+	std::vector<UINT> loopback;
+	std::vector<unsigned char> kinds;
+	std::vector<bool> referenced(vertexCount);
+	std::vector<bool> locked(vertexCount);
+	std::vector<UINT> collapseTo(vertexCount);
+	std::vector<Collapse> collapses;
+	TriangleAdjacency triangles;
+
+	std::vector<UINT> current;
+	current.swap(outIndices);
+
+	//Each pass collapses as many edges as it can without two collapses touching the same triangles, then rebuilds
+	//everything from the new index buffer. That keeps the connectivity simple at the cost of a few more passes
+	while (current.size() > targetIndexCount)
+	{
+		BuildEdgeAdjacency(current, vertexCount, edges);
+		BuildOpenEdgeLoops(current, edges, loop, loopback);
+
+		referenced.assign(vertexCount, false);
+		for (UINT index : current)
+		{
+			referenced[index] = true;
+		}
+
+		//ring of the vertices still in use at each position, remap keeps pointing at the first vertex at a position
+		//even once that vertex is unused as it is only an identifier for the position from then on
+		for (size_t v = 0; v < vertexCount; v++)
+		{
+			wedge[v] = (UINT)v;
+			head[v] = c_None;
+		}
+
+		for (size_t v = 0; v < vertexCount; v++)
+		{
+			UINT position = remap[v];
+
+			if (!referenced[v])
+				continue;
+
+			if (head[position] == c_None)
+			{
+				head[position] = (UINT)v;
+				continue;
+			}
+
+			wedge[v] = wedge[head[position]];
+			wedge[head[position]] = (UINT)v;
+		}
+
+		ClassifyVertices(remap, wedge, loop, loopback, kinds);
+
+		BuildTriangleAdjacency(current, remap, triangles);
+
+		collapses.clear();
+
+		for (size_t i = 0; i < current.size(); i += 3)
+		{
+			for (int corner = 0; corner < 3; corner++)
+			{
+				UINT from = current[i + corner];
+				UINT to = current[i + (corner + 1) % 3];
+
+				for (int direction = 0; direction < 2; direction++)
+				{
+					UINT siblingFrom, siblingTo;
+					if (CanCollapse(from, to, kinds, remap, wedge, loop, loopback, siblingFrom, siblingTo))
+					{
+						collapses.push_back({ from, to, EvaluateQuadric(quadrics[remap[from]], positions[to]) });
+					}
+
+					std::swap(from, to);
+				}
+			}
+		}
+
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.Cost < b.Cost; });
+
+		locked.assign(vertexCount, false);
+		for (size_t v = 0; v < vertexCount; v++)
+		{
+			collapseTo[v] = (UINT)v;
+		}
+
+		size_t triangleCount = current.size() / 3;
+		size_t targetTriangles = targetIndexCount / 3;
+		size_t collapseCount = 0;
+		bool reachedError = false;
+
+		for (const Collapse& collapse : collapses)
+		{
+			if (triangleCount <= targetTriangles)
+				break;
+
+			if (collapse.Cost > maxCost)
+			{
+				reachedError = true;
+				break;
+			}
+
+			UINT fromPosition = remap[collapse.From];
+			UINT toPosition = remap[collapse.To];
+
+			if (locked[fromPosition] || locked[toPosition])
+				continue;
+
+			if (!PreservesOrientation(fromPosition, toPosition, positions, current, remap, triangles))
+				continue;
+
+			UINT siblingFrom, siblingTo;
+			CanCollapse(collapse.From, collapse.To, kinds, remap, wedge, loop, loopback, siblingFrom, siblingTo);
+
+			collapseTo[collapse.From] = collapse.To;
+			if (siblingFrom != c_None)
+			{
+				collapseTo[siblingFrom] = siblingTo;
+			}
+
+			AddQuadric(quadrics[toPosition], quadrics[fromPosition]);
+			largestCost = std::max(largestCost, collapse.Cost);
+
+			//nothing else this pass may touch the triangles around the collapse, as their orientation was only checked for this one
+			UINT first = triangles.offsets[fromPosition];
+			UINT last = first + triangles.counts[fromPosition];
+
+			for (UINT t = first; t < last; t++)
+			{
+				UINT triangle = triangles.triangles[t];
+				bool removed = false;
+
+				for (int corner = 0; corner < 3; corner++)
+				{
+					UINT position = remap[current[triangle * 3 + corner]];
+					locked[position] = true;
+					removed |= position == toPosition;
+				}
+
+				if (removed)
+				{
+					triangleCount--;
+				}
+			}
+
+			collapseCount++;
+		}
+
+		if (collapseCount == 0)
+			break;
+
+		//rewrite the indices, dropping the triangles that collapsed to a line
+		size_t write = 0;
+		for (size_t i = 0; i < current.size(); i += 3)
+		{
+			UINT a = collapseTo[current[i]];
+			UINT b = collapseTo[current[i + 1]];
+			UINT c = collapseTo[current[i + 2]];
+
+			if (remap[a] == remap[b] || remap[b] == remap[c] || remap[a] == remap[c])
+				continue;
+
+			current[write++] = a;
+			current[write++] = b;
+			current[write++] = c;
+		}
+		current.resize(write);
+
+		if (reachedError)
+			break;
+	}
+
+	outIndices.swap(current);
+
+	return (float)sqrt(largestCost);
+}
+
+void MeshSimplifier::GenerateLODChain(const std::vector<XMFLOAT3>& positions, const std::vector<UINT>& indices, const float* ratios, size_t ratioCount,
+	std::vector<UINT>& lodIndices, std::vector<MeshLOD>& lods)
+{
+	lodIndices = indices;
+	lods.assign(1, { 0, (UINT)indices.size(), 0.0f });
+
+	std::vector<UINT> previous = indices;
+	std::vector<UINT> simplified;
+	std::vector<UINT> clusterStarts;
+	float error = 0.0f;
+
+	for (size_t i = 0; i < ratioCount; i++)
+	{
+		size_t targetIndexCount = (size_t)(indices.size() / 3 * ratios[i]) * 3;
+
+		//each level only knows how far it moved from the one before, the sum bounds how far it is from the full mesh
+		error += Simplify(positions, previous, targetIndexCount, FLT_MAX, simplified);
+
+		if (simplified.empty() || simplified.size() > previous.size() * c_MinimumLODReduction)
+			break;
+
+		MeshOptimizer::OptimizeVertexCache(simplified, positions.size(), clusterStarts);
+
+		lods.push_back({ (UINT)lodIndices.size(), (UINT)simplified.size(), error });
+		lodIndices.insert(lodIndices.end(), simplified.begin(), simplified.end());
+
+		previous.swap(simplified);
+	}
+}
+
+UINT MeshSimplifier::SelectLOD(const std::vector<MeshLOD>& lods, float distance, float pixelsPerUnit, float maxPixelError)
+{
+	if (lods.empty())
+		return 0;
+
+	//inside the bounds or behind the camera the full mesh is always used
+	if (distance <= 0.0f)
+		return 0;
+
+	for (UINT level = (UINT)lods.size() - 1; level > 0; level--)
+	{
+		if (lods[level].Error * pixelsPerUnit / distance <= maxPixelError)
+			return level;
+	}
+
+	return 0;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <vector>
+
+#include "Commons.h"
+
+//Quadric error metric edge collapse (Garland and Heckbert) used to build a chain of lower detail index buffers that all
+//draw from the mesh's original vertex buffer. Vertices that share a position but differ in normal or texture coordinate
+//are treated as one point, so a seam is only collapsed along itself with both sides moving together and never tears open
+namespace MeshSimplifier
+{
+	//Triangle counts of each level relative to the full mesh
+	const float c_DefaultLODRatios[] = { 0.5f, 0.25f, 0.125f };
+
+	//A level that can't get below this fraction of the previous one is too constrained to be worth keeping
+	const float c_MinimumLODReduction = 0.9f;
+
+	//Collapses edges until there are at most targetIndexCount indices left or the next collapse would move the surface
+	//further than targetError. Returns the largest distance the surface has moved
+	float Simplify(const std::vector<XMFLOAT3>& positions, const std::vector<UINT>& indices, size_t targetIndexCount, float targetError,
+		std::vector<UINT>& outIndices);
+
+	//Fills lodIndices with the full mesh followed by each level, every level is simplified from the one before it and has
+	//its triangles ordered for the vertex cache. lods[0] is always the full mesh
+	void GenerateLODChain(const std::vector<XMFLOAT3>& positions, const std::vector<UINT>& indices, const float* ratios, size_t ratioCount,
+		std::vector<UINT>& lodIndices, std::vector<MeshLOD>& lods);
+
+	//Any vertex type with a PosL member can be used
+	template<typename VertexType>
+	void GenerateLODChain(const std::vector<VertexType>& vertices, const std::vector<UINT>& indices, std::vector<UINT>& lodIndices, std::vector<MeshLOD>& lods)
+	{
+		std::vector<XMFLOAT3> positions(vertices.size());
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			positions[i] = vertices[i].PosL;
+		}
+
+		GenerateLODChain(positions, indices, c_DefaultLODRatios, ARRAYSIZE(c_DefaultLODRatios), lodIndices, lods);
+	}
+
+	//Picks the coarsest level whose error projects to no more than maxPixelError pixels. pixelsPerUnit is the screen height
+	//divided by 2 tan(fovY / 2), i.e. how many pixels one unit covers at a distance of one
+	UINT SelectLOD(const std::vector<MeshLOD>& lods, float distance, float pixelsPerUnit, float maxPixelError = 1.0f);
+}
@@ -0,0 +1,367 @@
+#include "Meshlets.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include "VertexWelder.h"
+
+namespace
+{
+	const UINT c_Unused = 0xffffffff;
+
+	//Triangle lists for every vertex packed into one array, the triangles of vertex v are
+	//triangles[offsets[v]] up to triangles[offsets[v] + counts[v]]
+	struct Adjacency
+	{
+		std::vector<UINT> counts;
+		std::vector<UINT> offsets;
+		std::vector<UINT> triangles;
+	};
+
+	void BuildAdjacency(const std::vector<UINT>& indices, size_t vertexCount, Adjacency& adjacency)
+	{
+		size_t triangleCount = indices.size() / 3;
+
+		adjacency.counts.assign(vertexCount, 0);
+		adjacency.offsets.resize(vertexCount);
+		adjacency.triangles.resize(triangleCount * 3);
+
+		for (UINT index : indices)
+		{
+			adjacency.counts[index]++;
+		}
+
+		UINT offset = 0;
+		for (size_t v = 0; v < vertexCount; v++)
+		{
+			adjacency.offsets[v] = offset;
+			offset += adjacency.counts[v];
+		}
+
+		//fill using the offsets as cursors then put them back
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			for (int corner = 0; corner < 3; corner++)
+			{
+				UINT vertex = indices[t * 3 + corner];
+				adjacency.triangles[adjacency.offsets[vertex]++] = (UINT)t;
+			}
+		}
+
+		for (size_t v = 0; v < vertexCount; v++)
+		{
+			adjacency.offsets[v] -= adjacency.counts[v];
+		}
+	}
+
+	//unit normal of every triangle, zero for degenerate ones so they never narrow or widen a cone
+	void ComputeTriangleNormals(const std::vector<XMFLOAT3>& positions, const std::vector<UINT>& indices, std::vector<XMFLOAT3>& normals)
+	{
+		normals.resize(indices.size() / 3);
+
+		for (size_t t = 0; t < normals.size(); t++)
+		{
+			XMVECTOR p0 = XMLoadFloat3(&positions[indices[t * 3 + 0]]);
+			XMVECTOR p1 = XMLoadFloat3(&positions[indices[t * 3 + 1]]);
+			XMVECTOR p2 = XMLoadFloat3(&positions[indices[t * 3 + 2]]);
+
+			XMVECTOR normal = XMVector3Cross(p1 - p0, p2 - p0);
+			float length = XMVectorGetX(XMVector3Length(normal));
+
+			XMStoreFloat3(&normals[t], length > 0.0f ? normal / length : XMVectorZero());
+		}
+	}
+
+	Meshlets::MeshletBounds ComputeBounds(const Meshlets::MeshletModel& model, const Meshlets::Meshlet& meshlet, const std::vector<XMFLOAT3>& positions,
+		const std::vector<XMFLOAT3>& triangleNormals, const std::vector<UINT>& meshletTriangles)
+	{
+		Meshlets::MeshletBounds bounds;
+
+		XMVECTOR minimum = XMVectorReplicate(FLT_MAX);
+		XMVECTOR maximum = XMVectorReplicate(-FLT_MAX);
+
+		for (UINT v = 0; v < meshlet.VertexCount; v++)
+		{
+			XMVECTOR position = XMLoadFloat3(&positions[model.VertexIndices[meshlet.VertexOffset + v]]);
+			minimum = XMVectorMin(minimum, position);
+			maximum = XMVectorMax(maximum, position);
+		}
+
+		XMStoreFloat3(&bounds.BoxMin, minimum);
+		XMStoreFloat3(&bounds.BoxMax, maximum);
+
+		//the box centre is close enough to the smallest sphere for clusters this size
+		XMVECTOR center = (minimum + maximum) * 0.5f;
+		float radiusSquared = 0.0f;
+
+		for (UINT v = 0; v < meshlet.VertexCount; v++)
+		{
+			XMVECTOR position = XMLoadFloat3(&positions[model.VertexIndices[meshlet.VertexOffset + v]]);
+			radiusSquared = std::max(radiusSquared, XMVectorGetX(XMVector3LengthSq(position - center)));
+		}
+
+		XMStoreFloat3(&bounds.Center, center);
+		bounds.Radius = sqrtf(radiusSquared);
+
+		XMVECTOR normalSum = XMVectorZero();
+		for (UINT triangle : meshletTriangles)
+		{
+			normalSum += XMLoadFloat3(&triangleNormals[triangle]);
+		}
+
+		float sumLength = XMVectorGetX(XMVector3Length(normalSum));
+		XMVECTOR axis = sumLength > 0.0f ? normalSum / sumLength : XMVectorZero();
+
+		float minimumDot = sumLength > 0.0f ? 1.0f : -1.0f;
+		for (UINT triangle : meshletTriangles)
+		{
+			minimumDot = std::min(minimumDot, XMVectorGetX(XMVector3Dot(axis, XMLoadFloat3(&triangleNormals[triangle]))));
+		}
+
+		XMStoreFloat3(&bounds.ConeAxis, axis);
+
+		//a view direction has to be within 90 degrees of every normal, which leaves a cone of 90 degrees minus the spread of
+		//the normals around the axis, so the cutoff is the cosine of that or the sine of the spread
+		bounds.ConeCutoff = minimumDot > 0.0f ? sqrtf(1.0f - minimumDot * minimumDot) : Meshlets::c_DisabledConeCutoff;
+
+		return bounds;
+	}
+}
+
+void Meshlets::Build(const std::vector<XMFLOAT3>& positions, const std::vector<UINT>& indices, MeshletModel & model)
+{
+	size_t vertexCount = positions.size();
+	size_t triangleCount = indices.size() / 3;
+
+	model.Meshlets.clear();
+	model.Bounds.clear();
+	model.VertexIndices.clear();
+	model.Triangles.clear();
+
+	//neighbours are found through shared positions rather than shared vertices, or a mesh split up by normal and texture
+	//seams would give every meshlet only a few triangles
+	std::vector<XMFLOAT3> uniquePositions;
+	std::vector<UINT> positionRemap;
+	VertexWelder::WeldPositions(positions, 0.0f, uniquePositions, positionRemap);
+
+	std::vector<UINT> positionIndices(indices.size());
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		positionIndices[i] = positionRemap[indices[i]];
+	}
+
+	Adjacency adjacency;
+	BuildAdjacency(positionIndices, uniquePositions.size(), adjacency);
+
+	//the meshlet each position last added its triangles to the candidates for
+	std::vector<UINT> positionMeshlet(uniquePositions.size(), c_Unused);
+
+	std::vector<XMFLOAT3> triangleNormals;
+	ComputeTriangleNormals(positions, indices, triangleNormals);
+
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<UINT> localIndex(vertexCount, c_Unused);
+	std::vector<UINT> candidates;
+	std::vector<UINT> meshletTriangles;
+
+	UINT cursor = 0;
+
+	while (true)
+	{
+		while (cursor < triangleCount && emitted[cursor])
+		{
+			cursor++;
+		}
+
+		if (cursor == triangleCount)
+			break;
+
+		Meshlet meshlet;
+		meshlet.VertexOffset = (UINT)model.VertexIndices.size();
+		meshlet.TriangleOffset = (UINT)(model.Triangles.size() / 3);
+		meshlet.VertexCount = 0;
+		meshlet.TriangleCount = 0;
+
+		XMVECTOR normalSum = XMVectorZero();
+		UINT triangle = cursor;
+
+		candidates.clear();
+		meshletTriangles.clear();
+
+		while (triangle != c_Unused)
+		{
+			for (int corner = 0; corner < 3; corner++)
+			{
+				UINT vertex = indices[triangle * 3 + corner];
+
+				if (localIndex[vertex] == c_Unused)
+				{
+					localIndex[vertex] = meshlet.VertexCount++;
+					model.VertexIndices.push_back(vertex);
+				}
+
+				//everything touching a new position is a neighbour of the meshlet
+				UINT position = positionRemap[vertex];
+				if (positionMeshlet[position] != model.Meshlets.size())
+				{
+					positionMeshlet[position] = (UINT)model.Meshlets.size();
+
+					UINT first = adjacency.offsets[position];
+					UINT last = first + adjacency.counts[position];
+					candidates.insert(candidates.end(), adjacency.triangles.begin() + first, adjacency.triangles.begin() + last);
+				}
+
+				model.Triangles.push_back((BYTE)localIndex[vertex]);
+			}
+
+			emitted[triangle] = true;
+			meshletTriangles.push_back(triangle);
+			meshlet.TriangleCount++;
+			normalSum += XMLoadFloat3(&triangleNormals[triangle]);
+
+			if (meshlet.TriangleCount == c_MaxTriangles)
+				break;
+
+			XMVECTOR averageNormal = XMVector3Normalize(normalSum);
+
+			//pick the neighbour that adds the fewest vertices, using how far it faces away as the tie breaker
+			triangle = c_Unused;
+			float bestScore = FLT_MAX;
+			size_t write = 0;
+
+			for (size_t i = 0; i < candidates.size(); i++)
+			{
+				UINT candidate = candidates[i];
+
+				if (emitted[candidate])
+					continue;
+
+				candidates[write++] = candidate;
+
+				UINT newVertices = 0;
+				for (int corner = 0; corner < 3; corner++)
+				{
+					newVertices += localIndex[indices[candidate * 3 + corner]] == c_Unused ? 1 : 0;
+				}
+
+				if (meshlet.VertexCount + newVertices > c_MaxVertices)
+					continue;
+
+				float facing = XMVectorGetX(XMVector3Dot(averageNormal, XMLoadFloat3(&triangleNormals[candidate])));
+				float score = (float)newVertices + (1.0f - facing) * c_ConeWeight;
+
+				if (score < bestScore)
+				{
+					bestScore = score;
+					triangle = candidate;
+				}
+			}
+
+			candidates.resize(write);
+		}
+
+		for (UINT v = 0; v < meshlet.VertexCount; v++)
+		{
+			localIndex[model.VertexIndices[meshlet.VertexOffset + v]] = c_Unused;
+		}
+
+		model.Meshlets.push_back(meshlet);
+		model.Bounds.push_back(ComputeBounds(model, meshlet, positions, triangleNormals, meshletTriangles));
+	}
+}
+
+Meshlets::CullView Meshlets::MakeCullView(CXMMATRIX world, CXMMATRIX view, CXMMATRIX projection, bool orthographic)
+{
+	CullView cullView;
+
+	//Gribb and Hartmann, the planes are sums and differences of the columns of the combined matrix. D3D clips z to [0, w]
+	XMMATRIX columns = XMMatrixTranspose(world * view * projection);
+
+	XMVECTOR planes[6] =
+	{
+		columns.r[3] + columns.r[0],
+		columns.r[3] - columns.r[0],
+		columns.r[3] + columns.r[1],
+		columns.r[3] - columns.r[1],
+		columns.r[2],
+		columns.r[3] - columns.r[2],
+	};
+
+	for (int i = 0; i < 6; i++)
+	{
+		XMStoreFloat4(&cullView.Planes[i], XMPlaneNormalize(planes[i]));
+	}
+
+	XMMATRIX viewToObject = XMMatrixInverse(nullptr, world * view);
+
+	XMStoreFloat3(&cullView.EyePosition, XMVector3TransformCoord(XMVectorZero(), viewToObject));
+	XMStoreFloat3(&cullView.ViewDirection, XMVector3Normalize(XMVector3TransformNormal(XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f), viewToObject)));
+	cullView.Orthographic = orthographic;
+
+	return cullView;
+}
+
+Meshlets::CullStatistics Meshlets::Cull(const MeshletModel & model, const CullView & view, std::vector<UINT>& outIndices)
+{
+	CullStatistics statistics;
+	statistics.Meshlets = (UINT)model.Meshlets.size();
+
+	outIndices.clear();
+
+	XMVECTOR eye = XMLoadFloat3(&view.EyePosition);
+	XMVECTOR viewDirection = XMLoadFloat3(&view.ViewDirection);
+
+	for (size_t m = 0; m < model.Meshlets.size(); m++)
+	{
+		const Meshlet& meshlet = model.Meshlets[m];
+		const MeshletBounds& bounds = model.Bounds[m];
+
+		statistics.Triangles += meshlet.TriangleCount;
+
+		XMVECTOR center = XMLoadFloat3(&bounds.Center);
+
+		bool outside = false;
+		for (int i = 0; i < 6 && !outside; i++)
+		{
+			outside = XMVectorGetX(XMPlaneDotCoord(XMLoadFloat4(&view.Planes[i]), center)) < -bounds.Radius;
+		}
+
+		if (outside)
+		{
+			statistics.FrustumCulled++;
+			continue;
+		}
+
+		XMVECTOR axis = XMLoadFloat3(&bounds.ConeAxis);
+		bool backFacing;
+
+		if (view.Orthographic)
+		{
+			//every ray is parallel so only the direction matters
+			backFacing = XMVectorGetX(XMVector3Dot(viewDirection, axis)) > bounds.ConeCutoff;
+		}
+		else
+		{
+			XMVECTOR offset = center - eye;
+			backFacing = XMVectorGetX(XMVector3Dot(offset, axis)) > bounds.ConeCutoff * XMVectorGetX(XMVector3Length(offset)) + bounds.Radius;
+		}
+
+		if (backFacing)
+		{
+			statistics.ConeCulled++;
+			continue;
+		}
+
+		const UINT* vertices = &model.VertexIndices[meshlet.VertexOffset];
+		const BYTE* triangles = &model.Triangles[meshlet.TriangleOffset * 3];
+
+		for (UINT i = 0; i < meshlet.TriangleCount * 3; i++)
+		{
+			outIndices.push_back(vertices[triangles[i]]);
+		}
+
+		statistics.TrianglesEmitted += meshlet.TriangleCount;
+	}
+
+	return statistics;
+}
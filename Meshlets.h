@@ -0,0 +1,90 @@
+#pragma once
+
+#include <vector>
+
+#include "Commons.h"
+
+//Splits a mesh into small clusters of triangles that can each be culled on their own, so the parts of a large mesh that
+//are off screen or facing away are dropped before the GPU sees them rather than the whole mesh being drawn or not
+namespace Meshlets
+{
+	//The limits mesh shader hardware is built around, 124 rather than 128 triangles keeps the local index data in 372 bytes
+	const UINT c_MaxVertices = 64;
+	const UINT c_MaxTriangles = 124;
+
+	//How much a triangle facing away from the rest of the cluster counts against it compared to one extra vertex, keeps
+	//the normal cones narrow enough to cull
+	const float c_ConeWeight = 2.0f;
+
+	//Above the largest dot product of two unit vectors so the cone test never passes, with room for rounding
+	const float c_DisabledConeCutoff = 2.0f;
+
+	struct Meshlet
+	{
+		UINT VertexOffset; //into MeshletModel::VertexIndices
+		UINT TriangleOffset; //into MeshletModel::Triangles, in triangles
+		UINT VertexCount;
+		UINT TriangleCount;
+	};
+
+	//Every triangle in the cluster faces away from an eye where dot(Center - eye, ConeAxis) > ConeCutoff * |Center - eye| + Radius.
+	//A cluster whose triangles face too many ways has a cutoff of c_DisabledConeCutoff so it is never cone culled
+	struct MeshletBounds
+	{
+		XMFLOAT3 Center;
+		float Radius;
+		XMFLOAT3 BoxMin;
+		XMFLOAT3 BoxMax;
+		XMFLOAT3 ConeAxis;
+		float ConeCutoff;
+	};
+
+	struct MeshletModel
+	{
+		std::vector<Meshlet> Meshlets;
+		std::vector<MeshletBounds> Bounds;
+		std::vector<UINT> VertexIndices; //each meshlet's vertices in the mesh's vertex buffer
+		std::vector<BYTE> Triangles; //three indices into the meshlet's vertices per triangle
+	};
+
+	//A camera in the mesh's object space
+	struct CullView
+	{
+		XMFLOAT4 Planes[6]; //a point is inside when dot(plane.xyz, point) + plane.w >= 0 for all of them
+		XMFLOAT3 EyePosition;
+		XMFLOAT3 ViewDirection; //used in place of the eye by orthographic views such as the shadow map
+		bool Orthographic;
+	};
+
+	struct CullStatistics
+	{
+		UINT Meshlets = 0;
+		UINT FrustumCulled = 0;
+		UINT ConeCulled = 0;
+		UINT Triangles = 0;
+		UINT TrianglesEmitted = 0;
+	};
+
+	//Greedily grows each meshlet from the triangles around it, preferring ones that add the fewest new vertices and face
+	//the same way as what is already there. Works best on an index buffer that has been through MeshOptimizer
+	void Build(const std::vector<XMFLOAT3>& positions, const std::vector<UINT>& indices, MeshletModel& model);
+
+	//Any vertex type with a PosL member can be used
+	template<typename VertexType>
+	void Build(const std::vector<VertexType>& vertices, const std::vector<UINT>& indices, MeshletModel& model)
+	{
+		std::vector<XMFLOAT3> positions(vertices.size());
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			positions[i] = vertices[i].PosL;
+		}
+
+		Build(positions, indices, model);
+	}
+
+	//Brings the planes of view * projection and the eye back into the object space of world
+	CullView MakeCullView(CXMMATRIX world, CXMMATRIX view, CXMMATRIX projection, bool orthographic);
+
+	//Writes the triangles of every meshlet that survives the frustum and cone tests to outIndices as one index list
+	CullStatistics Cull(const MeshletModel& model, const CullView& view, std::vector<UINT>& outIndices);
+}
@@ -0,0 +1,116 @@
+#include "MorphTargets.h"
+#include <cmath>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+MorphTargets::Blender::Blender(const std::vector<SkeletalVertex>& baseVertices, std::vector<MorphTargetData> targets)
+	:_vertices(baseVertices), _targets(std::move(targets)), _appliedWeights(_targets.size(), 0.0f)
+{
+	_basePose.resize(baseVertices.size());
+	for (size_t i = 0; i < baseVertices.size(); i++)
+	{
+		_basePose[i].PosL = baseVertices[i].PosL;
+		_basePose[i].NormL = baseVertices[i].NormL;
+	}
+}
+
+bool MorphTargets::Blender::Apply(const float * weights)
+{
+	bool changed = false;
+	for (size_t target = 0; target < _targets.size(); target++)
+	{
+		float weight = std::fabs(weights[target]) < c_MinWeight ? 0.0f : weights[target];
+		changed |= weight != _appliedWeights[target];
+	}
+
+	if (!changed)
+	{
+		return false;
+	}
+
+	_verticesTouched = 0;
+
+	//targets overlap, so everything moved last time goes back before any target is added again
+	for (size_t target = 0; target < _targets.size(); target++)
+	{
+		if (_appliedWeights[target] == 0.0f)
+		{
+			continue;
+		}
+
+		for (UINT vertex : _targets[target].vertices)
+		{
+			_vertices[vertex].PosL = _basePose[vertex].PosL;
+			_vertices[vertex].NormL = _basePose[vertex].NormL;
+		}
+		_verticesTouched += _targets[target].vertices.size();
+	}
+
+	for (size_t target = 0; target < _targets.size(); target++)
+	{
+		float weight = std::fabs(weights[target]) < c_MinWeight ? 0.0f : weights[target];
+		_appliedWeights[target] = weight;
+
+		if (weight != 0.0f)
+		{
+			AddTarget(_vertices.data(), _targets[target], weight);
+			_verticesTouched += _targets[target].vertices.size();
+		}
+	}
+
+	return true;
+}
+
+int MorphTargets::Blender::FindTarget(const std::string & name) const
+{
+	for (size_t target = 0; target < _targets.size(); target++)
+	{
+		if (_targets[target].name == name)
+		{
+			return (int)target;
+		}
+	}
+	return -1;
+}
+
+void MorphTargets::AddTarget(SkeletalVertex * vertices, const MorphTargetData & target, float weight)
+{
+	const UINT* indices = target.vertices.data();
+	const MorphDelta* deltas = target.deltas.data();
+	size_t count = target.vertices.size();
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+	//the deltas' fourth lane is zero, so the float after the position and after the normal come back unchanged and the
+	//whole of each can be read and written as one register
+	__m128 scale = _mm_set1_ps(weight);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		SkeletalVertex& vertex = vertices[indices[i]];
+
+		__m128 position = _mm_loadu_ps(&vertex.PosL.x);
+		__m128 normal = _mm_loadu_ps(&vertex.NormL.x);
+
+		position = _mm_add_ps(position, _mm_mul_ps(scale, _mm_loadu_ps(&deltas[i].position.x)));
+		normal = _mm_add_ps(normal, _mm_mul_ps(scale, _mm_loadu_ps(&deltas[i].normal.x)));
+
+		_mm_storeu_ps(&vertex.PosL.x, position);
+		_mm_storeu_ps(&vertex.NormL.x, normal);
+	}
+#else
+	for (size_t i = 0; i < count; i++)
+	{
+		SkeletalVertex& vertex = vertices[indices[i]];
+
+		vertex.PosL.x += weight * deltas[i].position.x;
+		vertex.PosL.y += weight * deltas[i].position.y;
+		vertex.PosL.z += weight * deltas[i].position.z;
+
+		vertex.NormL.x += weight * deltas[i].normal.x;
+		vertex.NormL.y += weight * deltas[i].normal.y;
+		vertex.NormL.z += weight * deltas[i].normal.z;
+	}
+#endif
+}
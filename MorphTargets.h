@@ -0,0 +1,47 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Commons.h"
+#include "AnimatedModelData.h"
+
+//Blends morph targets into a copy of a skinned model's bind pose on the CPU, before the vertices are uploaded and
+//skinned on the GPU. Only the vertices the active targets move are touched, so the cost follows how much of the model
+//the targets cover rather than its size
+namespace MorphTargets
+{
+	//Targets with a weight closer to zero than this are left out altogether
+	const float c_MinWeight = 1e-3f;
+
+	class Blender
+	{
+	public:
+		Blender() = default;
+		Blender(const std::vector<SkeletalVertex>& baseVertices, std::vector<MorphTargetData> targets);
+
+		//Takes one weight per target. The vertices the last call moved are put back to the bind pose and every target
+		//with a weight is added on top. Returns false without touching anything if the result would be the same as last time
+		bool Apply(const float* weights);
+
+		const std::vector<SkeletalVertex>& GetVertices() const { return _vertices; }
+		size_t GetTargetCount() const { return _targets.size(); }
+		const MorphTargetData& GetTarget(size_t target) const { return _targets[target]; }
+
+		//-1 if none of the targets has the name
+		int FindTarget(const std::string& name) const;
+
+		//Vertex updates the last Apply made, restoring and adding both count
+		size_t GetVerticesTouched() const { return _verticesTouched; }
+
+	private:
+		std::vector<NormalDepthVertex> _basePose; //just what the targets change
+		std::vector<SkeletalVertex> _vertices;
+		std::vector<MorphTargetData> _targets;
+		std::vector<float> _appliedWeights; //zero for the targets left out
+		size_t _verticesTouched = 0;
+	};
+
+	//Adds a target's deltas scaled by weight to the vertices it moves
+	void AddTarget(SkeletalVertex* vertices, const MorphTargetData& target, float weight);
+}
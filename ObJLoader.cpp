@@ -1,404 +1,605 @@
 #include "ObJLoader.h"
 #include <fstream>
 
-IndexedModel OBJLoader::Load(const char * filename, bool invertCoordinates)
+#include "MappedFile.h"
+#include "Parallel.h"
+#include "Utilities.h"
+#include "MeshCache.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "TangentGenerator.h"
+#include "DepthStreams.h"
+
+namespace
 {
-	std::string binaryFilename = filename;
-	binaryFilename.append("Binary");
-	std::ifstream binaryInFile;
-	binaryInFile.open(binaryFilename, std::ios::in | std::ios::binary);
+	//Files smaller than this are parsed on the calling thread, splitting them up costs more than it saves
+	const size_t c_MinBytesPerChunk = 1024 * 1024;
 
-	if (!binaryInFile.good())
+	//Negative OBJ indices are relative to the end of the attribute list so far. A chunk only knows its own counts, so those
+	//corners are resolved against the chunk and remembered here so the merge can add on the counts of the earlier chunks
+	struct OBJChunk
 	{
-		std::ifstream inFile;
-		inFile.open(filename);
+		OBJLoader::OBJData Data;
 
-		if (!inFile.good())
+		std::vector<size_t> RelativePositions;
+		std::vector<size_t> RelativeTexCoords;
+		std::vector<size_t> RelativeNormals;
+	};
+
+	int ResolveIndex(int objIndex, size_t count, size_t corner, std::vector<size_t>& relativeCorners)
+	{
+		if (objIndex > 0)
 		{
-			return IndexedModel();
+			return objIndex - 1;
 		}
-		else
+		else if (objIndex < 0)
 		{
-			//Vectors to store the vertex positions, normals and texture coordinates. Need to use vectors since they're resizeable and we have
-			//no way of knowing ahead of time how large these meshes will be
-			std::vector<XMFLOAT3> verts;
-			std::vector<XMFLOAT3> normals;
-			std::vector<XMFLOAT2> TexCoords;
-
-			//DirectX uses 1 index buffer, OBJ is optimized for storage and not rendering and so uses 3 smaller index buffers.....great...
-			//We'll have to merge this into 1 index buffer which we'll do after loading in all of the required data.
-			std::vector<unsigned short> vertIndices;
-			std::vector<unsigned short> normalIndices;
-			std::vector<unsigned short> textureIndices;
-
-			std::string input;
-
-			XMFLOAT3 vert;
-			XMFLOAT2 TexCoord;
-			XMFLOAT3 normal;
-			unsigned short vInd[3]; //indices for the vertex position
-			unsigned short tInd[3]; //indices for the texture coordinate
-			unsigned short nInd[3]; //indices for the normal
-			std::string beforeFirstSlash;
-			std::string afterFirstSlash;
-			std::string afterSecondSlash;
-
-			while (!inFile.eof()) //While we have yet to reach the end of the file...
+			relativeCorners.push_back(corner);
+			return (int)count + objIndex;
+		}
+		return -1;
+	}
+
+	//reads a face corner in any of the forms v, v/t, v//n or v/t/n
+	const char* ParseFaceCorner(const char* current, const char* end, int corner[3])
+	{
+		corner[0] = corner[1] = corner[2] = 0;
+
+		const char* next = Util::ParseInt(current, end, corner[0]);
+		if (next == current)
+			return current;
+		current = next;
+
+		for (int attribute = 1; attribute < 3 && current < end && *current == '/'; attribute++)
+		{
+			current++;
+			current = Util::ParseInt(current, end, corner[attribute]);
+		}
+
+		return current;
+	}
+
+	//Adds the attributes of the earlier chunks to the corners that were relative. False if any still lands before the first
+	//attribute, as one resolving to exactly -1 would otherwise pass as an attribute the corner left out
+	bool OffsetRelativeIndices(int* indices, const std::vector<size_t>& relativeCorners, size_t base)
+	{
+		bool resolved = true;
+		for (size_t corner : relativeCorners)
+		{
+			indices[corner] += (int)base;
+			resolved &= indices[corner] >= 0;
+		}
+		return resolved;
+	}
+
+	//Position indices have to name a position, the others can be -1 for an attribute the corner left out
+	bool IndicesInRange(const int* indices, size_t cornerCount, size_t attributeCount, bool required)
+	{
+		for (size_t corner = 0; corner < cornerCount; corner++)
+		{
+			if (indices[corner] >= (int)attributeCount || indices[corner] < (required ? 0 : -1))
 			{
-				inFile >> input; //Get the next input from the file
+				return false;
+			}
+		}
+		return true;
+	}
 
-								 //Check what type of input it was, we are only interested in vertex positions, texture coordinates, normals and indices, nothing else
-				if (input.compare("v") == 0) //Vertex position
-				{
-					inFile >> vert.x;
-					inFile >> vert.y;
-					inFile >> vert.z;
+	const char* ParseFloats(const char* current, const char* end, float* values, int count)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			values[i] = 0.0f;
+			current = Util::SkipBlanks(current, end);
+			current = Util::ParseFloat(current, end, values[i]);
+		}
+		return current;
+	}
+
+	void ParseChunk(const char* current, const char* end, bool invertCoordinates, OBJChunk& chunk)
+	{
+		OBJLoader::OBJData& data = chunk.Data;
+
+		//three indices per corner, kept between faces so a polygon of any size only allocates once
+		std::vector<int> corners;
 
-					verts.push_back(vert);
+		while (current < end)
+		{
+			current = Util::SkipWhitespace(current, end);
+
+			if (current >= end)
+				break;
+
+			if (current[0] == 'v' && current + 1 < end)
+			{
+				if (current[1] == ' ' || current[1] == '\t') //Vertex position
+				{
+					XMFLOAT3 position;
+					current = ParseFloats(current + 2, end, &position.x, 3);
+					data.Positions.push_back(position);
 				}
-				else if (input.compare("vt") == 0) //Texture coordinate
+				else if (current[1] == 't') //Texture coordinate
 				{
-					inFile >> TexCoord.x;
-					inFile >> TexCoord.y;
+					XMFLOAT2 texCoord;
+					current = ParseFloats(current + 2, end, &texCoord.x, 2);
 
 					//diferent modeling software stores the texture coordinates differently
-
 					if (invertCoordinates)
 					{
-						TexCoord.y = 1.0f - TexCoord.y;
+						texCoord.y = 1.0f - texCoord.y;
 					}
 
-					TexCoords.push_back(TexCoord);
+					data.TexCoords.push_back(texCoord);
 				}
-				else if (input.compare("vn") == 0) //Normal
+				else if (current[1] == 'n') //Normal
 				{
-					inFile >> normal.x;
-					inFile >> normal.y;
-					inFile >> normal.z;
+					XMFLOAT3 normal;
+					current = ParseFloats(current + 2, end, &normal.x, 3);
+					data.Normals.push_back(normal);
+				}
+			}
+			else if (current[0] == 'f' && current + 1 < end && (current[1] == ' ' || current[1] == '\t')) //Face
+			{
+				current += 2;
 
-					normals.push_back(normal);
+				corners.clear();
+				int cornerCount = 0;
+				for (;;)
+				{
+					int corner[3];
+					current = Util::SkipBlanks(current, end);
+					const char* next = ParseFaceCorner(current, end, corner);
+					if (next == current)
+						break;
+					current = next;
+					corners.insert(corners.end(), corner, corner + 3);
+					cornerCount++;
 				}
-				else if (input.compare("f") == 0) //Face
+
+				//polygons are split into a fan of triangles
+				for (int triangle = 1; triangle + 1 < cornerCount; triangle++)
 				{
-					for (int i = 0; i < 3; ++i)
+					const int fan[3] = { 0, triangle, triangle + 1 };
+					for (int i = 0; i < 3; i++)
 					{
-						inFile >> input;
-						int slash = input.find("/"); //Find first forward slash
-						int secondSlash = input.find("/", slash + 1); //Find second forward slash
-
-																	  //Extract from string
-						beforeFirstSlash = input.substr(0, slash); //The vertex position index
-						afterFirstSlash = input.substr(slash + 1, secondSlash - slash - 1); //The texture coordinate index
-						afterSecondSlash = input.substr(secondSlash + 1); //The normal index
-
-																		  //Parse into int
-						vInd[i] = (unsigned short)atoi(beforeFirstSlash.c_str()); //atoi = "ASCII to int"
-						tInd[i] = (unsigned short)atoi(afterFirstSlash.c_str());
-						nInd[i] = (unsigned short)atoi(afterSecondSlash.c_str());
-					}
+						const int* corner = &corners[fan[i] * 3];
+						size_t cornerIndex = data.PositionIndices.size();
 
-					//Place into vectors
-					for (int i = 0; i < 3; ++i)
-					{
-						vertIndices.push_back(vInd[i] - 1);		//Minus 1 from each as these as OBJ indexes start from 1 whereas C++ arrays start from 0
-						textureIndices.push_back(tInd[i] - 1);	//which is really annoying. Apart from Lua and SQL, there's not much else that has indexing 
-						normalIndices.push_back(nInd[i] - 1);	//starting at 1. So many more languages index from 0, the .OBJ people screwed up there.
+						data.PositionIndices.push_back(ResolveIndex(corner[0], data.Positions.size(), cornerIndex, chunk.RelativePositions));
+						data.TexCoordIndices.push_back(ResolveIndex(corner[1], data.TexCoords.size(), cornerIndex, chunk.RelativeTexCoords));
+						data.NormalIndices.push_back(ResolveIndex(corner[2], data.Normals.size(), cornerIndex, chunk.RelativeNormals));
 					}
 				}
 			}
-			inFile.close(); //Finished with input file now, all the data we need has now been loaded in
 
-			std::vector<XMFLOAT3> expandedVertices;
-			std::vector<XMFLOAT3> expandedNormals;
-			std::vector<XMFLOAT2> expandedTexCoords;
-			unsigned int numIndices = vertIndices.size();
-			for (unsigned int i = 0; i < numIndices; i++)
-			{
-				expandedVertices.push_back(verts[vertIndices[i]]);
-				expandedTexCoords.push_back(TexCoords[textureIndices[i]]);
-				expandedNormals.push_back(normals[normalIndices[i]]);
-			}
+			//anything else (comments, groups, materials) is skipped along with whatever is left of the line
+			current = Util::SkipLine(current, end);
+		}
+	}
 
-			//Now to (finally) form the final vertex, texture coord, normal list and single index buffer using the above expanded vectors
-			std::vector<unsigned short> meshIndices;
-			meshIndices.reserve(numIndices);
-			std::vector<XMFLOAT3> meshVertices;
-			meshVertices.reserve(expandedVertices.size());
-			std::vector<XMFLOAT3> meshNormals;
-			meshNormals.reserve(expandedNormals.size());
-			std::vector<XMFLOAT2> meshTexCoords;
-			meshTexCoords.reserve(expandedTexCoords.size());
+	//SimpleVertex as the old dumps wrote it, before the tangent carried its handedness
+	struct LegacyVertex
+	{
+		XMFLOAT3 PosL;
+		XMFLOAT3 NormL;
+		XMFLOAT3 Tangent;
+		XMFLOAT2 Tex;
+	};
+}
 
-			CreateIndices(expandedVertices, expandedTexCoords, expandedNormals, meshIndices, meshVertices, meshTexCoords, meshNormals);
+IndexedModel OBJLoader::Load(const char * filename, bool invertCoordinates, float weldEpsilon)
+{
+	MeshCache::CookedMesh cookedMesh;
+	IndexedModel returnGeometry;
 
+	if (LoadCooked(filename, invertCoordinates, weldEpsilon, cookedMesh, returnGeometry))
+	{
+		cookedMesh.ReadModel(returnGeometry.Vertices, returnGeometry.Indices);
+	}
 
-			//Turn data from vector form to arrays
-			SimpleVertex* finalVerts = new SimpleVertex[meshVertices.size()];
-			unsigned int numMeshVertices = meshVertices.size();
-			for (unsigned int i = 0; i < numMeshVertices; ++i)
-			{
-				finalVerts[i].PosL = meshVertices[i];
-				finalVerts[i].NormL = meshNormals[i];
-				finalVerts[i].Tex = meshTexCoords[i];
-			}
+	return returnGeometry;
+}
 
-			unsigned short* indicesArray = new unsigned short[meshIndices.size()];
-			unsigned int numMeshIndices = meshIndices.size();
-			for (unsigned int i = 0; i < numMeshIndices; ++i)
-			{
-				indicesArray[i] = meshIndices[i];
-			}
+Mesh OBJLoader::LoadMesh(const char * filename, bool invertCoordinates, ID3D11Device * d3dDevice, float weldEpsilon)
+{
+	MeshCache::CookedMesh cookedMesh;
+	IndexedModel builtGeometry;
 
-			InsertTangentsIntoArray(finalVerts, indicesArray, numMeshVertices);
+	if (LoadCooked(filename, invertCoordinates, weldEpsilon, cookedMesh, builtGeometry))
+	{
+		return Mesh(cookedMesh, d3dDevice);
+	}
 
-			//Create the indexed model
-			IndexedModel returnGeometry;
+	return Mesh(builtGeometry, d3dDevice);
+}
 
-			returnGeometry.Vertices.assign(&finalVerts[0], &finalVerts[numMeshVertices]);
-			returnGeometry.Indices.assign(&indicesArray[0], &indicesArray[numMeshIndices]);
+bool OBJLoader::LoadCooked(const char * filename, bool invertCoordinates, float weldEpsilon, MeshCache::CookedMesh & cookedMesh, IndexedModel & builtGeometry)
+{
+	//builds that only shipped the old binary dump have no OBJ, so that is treated as the source instead
+	std::string legacyFilename = filename;
+	legacyFilename.append("Binary");
+
+	MappedFile source;
+	bool legacySource = false;
+
+	if (!source.Open(filename))
+	{
+		if (!source.Open(legacyFilename.c_str()))
+		{
+			DBG_OUTPUT(L"Failed to open the OBJ file or its binary\n");
+			return false;
+		}
+		legacySource = true;
+	}
+
+	//the load settings change the cooked output so they are folded into the hash along with the source bytes
+	UINT epsilonBits;
+	memcpy(&epsilonBits, &weldEpsilon, sizeof(epsilonBits));
+	UINT64 settings = ((UINT64)epsilonBits << 32) | (invertCoordinates ? 1 : 0) | (legacySource ? 2 : 0);
+
+	UINT64 sourceHash = Util::HashBytes(source.GetData(), source.GetSize(), settings);
+
+	std::string cookedFilename = filename;
+	cookedFilename.append("Cooked");
 
-			//Output data into binary file, the next time you run this function, the binary file will exist and will load that instead which is much quicker than parsing into vectors
-			std::ofstream outbin(binaryFilename.c_str(), std::ios::out | std::ios::binary);
-			outbin.write((char*)&numMeshVertices, sizeof(unsigned int));
-			outbin.write((char*)&numMeshIndices, sizeof(unsigned int));
-			outbin.write((char*)finalVerts, sizeof(SimpleVertex) * numMeshVertices);
-			outbin.write((char*)indicesArray, sizeof(unsigned short) * numMeshIndices);
-			outbin.close();
+	if (cookedMesh.Open(cookedFilename.c_str(), sourceHash))
+	{
+		return true;
+	}
 
-			delete[] indicesArray;
-			delete[] finalVerts;
+	if (legacySource)
+	{
+		if (!ReadLegacyBinary(source.GetData(), source.GetSize(), builtGeometry))
+		{
+			DBG_OUTPUT(L"OBJ binary file is malformed\n");
+			return false;
+		}
 
-			return returnGeometry;
+		//the old dumps were written before welding so every triangle has its own vertices, which leaves the simplifier
+		//no shared edges to collapse. They are welded like a parsed OBJ and the tangents rebuilt for the shared vertices
+		std::vector<SimpleVertex> expandedVertices(builtGeometry.Indices.size());
+		for (size_t i = 0; i < builtGeometry.Indices.size(); i++)
+		{
+			expandedVertices[i] = builtGeometry.Vertices[builtGeometry.Indices[i]];
 		}
+
+		VertexWelder::WeldStatistics statistics = CreateIndices(expandedVertices, weldEpsilon, builtGeometry.Vertices, builtGeometry.Indices);
+
+		DBG_OUTPUT(L"OBJ binary welded %u face corners into %u vertices\n", statistics.InputVertices, statistics.OutputVertices);
+
+		TangentGenerator::OutputStatistics(L"OBJ binary", TangentGenerator::Generate(builtGeometry.Vertices, builtGeometry.Indices));
 	}
 	else
 	{
-		IndexedModel returnGeometry;
+		OBJData data;
 
-		unsigned int numVertices;
-		unsigned int numIndices;
+		if (!ParseMapped(source.GetData(), source.GetEnd(), invertCoordinates, data))
+		{
+			return false;
+		}
+
+		//Create the indexed model
+		builtGeometry = BuildModel(data, weldEpsilon);
+	}
+
+	//Reordering is too slow to do on every load but the cooked file only has to be made once
+	MeshOptimizer::OptimizeStatistics statistics = MeshOptimizer::Optimize(builtGeometry);
 
-		//Read in array sizes
-		binaryInFile.read((char*)&numVertices, sizeof(unsigned int));
-		binaryInFile.read((char*)&numIndices, sizeof(unsigned int));
+	MeshOptimizer::OutputStatistics(L"OBJ", statistics);
 
-		//Read in data from binary file
-		SimpleVertex* finalVerts = new SimpleVertex[numVertices];
-		unsigned short* indices = new unsigned short[numIndices];
-		binaryInFile.read((char*)finalVerts, sizeof(SimpleVertex) * numVertices);
-		binaryInFile.read((char*)indices, sizeof(unsigned short) * numIndices);
+	//the lower detail levels go after the full mesh in the same index buffer and share its vertices
+	std::vector<UINT> lodIndices;
+	std::vector<MeshLOD> lods;
+	MeshSimplifier::GenerateLODChain(builtGeometry.Vertices, builtGeometry.Indices, lodIndices, lods);
 
-		returnGeometry.Vertices.assign(&finalVerts[0], &finalVerts[numVertices]);
-		returnGeometry.Indices.assign(&indices[0], &indices[numIndices]);
+	//the shadow and SSAO passes get their own streams, every level is remapped so the LOD ranges work for them as well
+	DepthStreams::DepthModel depthModel;
+	DepthStreams::NormalDepthModel normalDepthModel;
+	DepthStreams::Build(builtGeometry.Vertices, lodIndices, depthModel, normalDepthModel);
 
-		delete[] indices;
-		delete[] finalVerts;
+	//Output data into the cooked file, the next time you run this function it will be mapped instead which is much quicker than parsing into vectors
+	MeshCache::Writer writer;
+	writer.AddModel(builtGeometry.Vertices, lodIndices);
+	writer.AddSection(MeshCache::Section_OptimizeStatistics, &statistics, sizeof(statistics), 1);
+	writer.AddSection(MeshCache::Section_LODs, lods.data(), sizeof(MeshLOD), lods.size());
+	writer.AddModel(depthModel.Vertices, depthModel.Indices, MeshCache::Section_DepthVertices, MeshCache::Section_DepthIndices);
+	writer.AddModel(normalDepthModel.Vertices, normalDepthModel.Indices, MeshCache::Section_NormalDepthVertices, MeshCache::Section_NormalDepthIndices);
 
-		return returnGeometry;
+	if (!writer.Write(cookedFilename.c_str(), sourceHash))
+	{
+		DBG_OUTPUT(L"Failed to write the cooked mesh file\n");
+		return false;
 	}
-			
+
+	//only the cooked file carries the LODs, so it is used straight away rather than the model that was just built
+	return cookedMesh.Open(cookedFilename.c_str(), sourceHash);
 }
 
-bool OBJLoader::FindSimilarVertex(const SimpleVertex & vertex, std::map<SimpleVertex, unsigned short>& vertToIndexMap, unsigned short & index)
+bool OBJLoader::ReadLegacyBinary(const char * data, size_t size, IndexedModel & model)
 {
-	auto it = vertToIndexMap.find(vertex);
+	//two counts followed by the raw vertex and index arrays, indices are 16 bit whenever the vertex count allows it
+	unsigned int counts[2];
 
-	if (it == vertToIndexMap.end())
+	if (size < sizeof(counts))
 	{
 		return false;
 	}
+
+	memcpy(counts, data, sizeof(counts));
+
+	unsigned int numVertices = counts[0];
+	unsigned int numIndices = counts[1];
+
+	size_t indexSize = GetIndexFormatForVertexCount(numVertices) == IndexFormat<WORD>::Format ? sizeof(WORD) : sizeof(UINT);
+
+	if (size != sizeof(counts) + (size_t)numVertices * sizeof(LegacyVertex) + (size_t)numIndices * indexSize)
+	{
+		return false;
+	}
+
+	const char* vertexData = data + sizeof(counts);
+	const char* indexData = vertexData + (size_t)numVertices * sizeof(LegacyVertex);
+
+	model.Vertices.resize(numVertices);
+	for (unsigned int i = 0; i < numVertices; i++)
+	{
+		LegacyVertex vertex;
+		memcpy(&vertex, vertexData + i * sizeof(LegacyVertex), sizeof(LegacyVertex));
+		model.Vertices[i] = SimpleVertex(vertex.PosL, vertex.NormL, vertex.Tangent, vertex.Tex);
+	}
+
+	model.Indices.resize(numIndices);
+
+	if (indexSize == sizeof(WORD))
+	{
+		for (unsigned int i = 0; i < numIndices; i++)
+		{
+			WORD index;
+			memcpy(&index, indexData + i * sizeof(WORD), sizeof(WORD));
+			model.Indices[i] = index;
+		}
+	}
 	else
 	{
-		index = it->second;
-		return true;
+		memcpy(model.Indices.data(), indexData, (size_t)numIndices * sizeof(UINT));
 	}
+
+	return true;
 }
 
-void OBJLoader::CreateIndices(const std::vector<XMFLOAT3>& inVertices, 
-	const std::vector<XMFLOAT2>& inTexCoords, 
-	const std::vector<XMFLOAT3>& inNormals, 
-	std::vector<unsigned short>& outIndices, 
-	std::vector<XMFLOAT3>& outVertices, 
-	std::vector<XMFLOAT2>& outTexCoords, 
-	std::vector<XMFLOAT3>& outNormals)
+bool OBJLoader::ParseMapped(const char * filename, bool invertCoordinates, OBJData & data)
 {
-	// Mapping from an already-existing SimpleVertex to its corresponding index
-	std::map<SimpleVertex, unsigned short> vertToIndexMap;
+	MappedFile file;
 
-	std::pair<SimpleVertex, unsigned short> pair;
+	if (!file.Open(filename))
+	{
+		return false;
+	}
 
-	int numVertices = inVertices.size();
+	return ParseMapped(file.GetData(), file.GetEnd(), invertCoordinates, data);
+}
 
-	for (int i = 0; i < numVertices; ++i) //For each vertex
+bool OBJLoader::ParseMapped(const char * begin, const char * end, bool invertCoordinates, OBJData & data)
+{
+	size_t fileSize = end - begin;
+
+	//split the file into roughly equal chunks and move each split point forward to the start of the next line
+	size_t chunkCount = std::min<size_t>(Parallel::WorkerCount(), fileSize / c_MinBytesPerChunk + 1);
+
+	std::vector<const char*> chunkStarts(chunkCount + 1);
+	chunkStarts[0] = begin;
+	chunkStarts[chunkCount] = end;
+
+	for (size_t i = 1; i < chunkCount; i++)
 	{
-		SimpleVertex vertex = { inVertices[i], inNormals[i], XMFLOAT3(), inTexCoords[i] };
+		const char* split = std::max(chunkStarts[i - 1], begin + (fileSize / chunkCount) * i);
+		chunkStarts[i] = Util::SkipLine(split, end);
+	}
+
+	std::vector<OBJChunk> chunks(chunkCount);
 
-		unsigned short index;
-		// See if a vertex already exists in the buffer that has the same attributes as this one
-		bool found = FindSimilarVertex(vertex, vertToIndexMap, index);
-		
-		if (found) //if found, re-use it's index for the index buffer
+	Parallel::For(chunkCount, 1, [&](size_t first, size_t last, unsigned int)
+	{
+		for (size_t i = first; i < last; i++)
 		{
-			outIndices.push_back(index);
+			ParseChunk(chunkStarts[i], chunkStarts[i + 1], invertCoordinates, chunks[i]);
 		}
-		else //if not found, add it to the buffer
+	});
+
+	//work out where each chunk lands in the merged arrays
+	std::vector<size_t> positionBase(chunkCount), texCoordBase(chunkCount), normalBase(chunkCount), cornerBase(chunkCount);
+	size_t positionCount = 0, texCoordCount = 0, normalCount = 0, cornerCount = 0;
+
+	for (size_t i = 0; i < chunkCount; i++)
+	{
+		positionBase[i] = positionCount;
+		texCoordBase[i] = texCoordCount;
+		normalBase[i] = normalCount;
+		cornerBase[i] = cornerCount;
+
+		positionCount += chunks[i].Data.Positions.size();
+		texCoordCount += chunks[i].Data.TexCoords.size();
+		normalCount += chunks[i].Data.Normals.size();
+		cornerCount += chunks[i].Data.PositionIndices.size();
+	}
+
+	data.Positions.resize(positionCount);
+	data.TexCoords.resize(texCoordCount);
+	data.Normals.resize(normalCount);
+	data.PositionIndices.resize(cornerCount);
+	data.TexCoordIndices.resize(cornerCount);
+	data.NormalIndices.resize(cornerCount);
+
+	//every chunk writes to its own slice of the output so the merge can run in parallel too, and checks the indices
+	//it wrote now that they are relative to the whole file
+	std::vector<char> chunkValid(chunkCount, 0);
+
+	Parallel::For(chunkCount, 1, [&](size_t first, size_t last, unsigned int)
+	{
+		for (size_t i = first; i < last; i++)
 		{
-			outVertices.push_back(vertex.PosL);
-			outTexCoords.push_back(vertex.Tex);
-			outNormals.push_back(vertex.NormL);
+			OBJChunk& chunk = chunks[i];
+
+			std::copy(chunk.Data.Positions.begin(), chunk.Data.Positions.end(), data.Positions.begin() + positionBase[i]);
+			std::copy(chunk.Data.TexCoords.begin(), chunk.Data.TexCoords.end(), data.TexCoords.begin() + texCoordBase[i]);
+			std::copy(chunk.Data.Normals.begin(), chunk.Data.Normals.end(), data.Normals.begin() + normalBase[i]);
+
+			int* positionIndices = &data.PositionIndices[cornerBase[i]];
+			int* texCoordIndices = &data.TexCoordIndices[cornerBase[i]];
+			int* normalIndices = &data.NormalIndices[cornerBase[i]];
 
-			unsigned short newIndex = (unsigned short)outVertices.size() - 1;
+			std::copy(chunk.Data.PositionIndices.begin(), chunk.Data.PositionIndices.end(), positionIndices);
+			std::copy(chunk.Data.TexCoordIndices.begin(), chunk.Data.TexCoordIndices.end(), texCoordIndices);
+			std::copy(chunk.Data.NormalIndices.begin(), chunk.Data.NormalIndices.end(), normalIndices);
 
-			outIndices.push_back(newIndex);
+			bool relativeResolved = OffsetRelativeIndices(positionIndices, chunk.RelativePositions, positionBase[i]);
+			relativeResolved &= OffsetRelativeIndices(texCoordIndices, chunk.RelativeTexCoords, texCoordBase[i]);
+			relativeResolved &= OffsetRelativeIndices(normalIndices, chunk.RelativeNormals, normalBase[i]);
 
-			//Add it to the map
-			pair.first = vertex;
-			pair.second = newIndex;
+			size_t chunkCorners = chunk.Data.PositionIndices.size();
+			chunkValid[i] = relativeResolved &&
+				IndicesInRange(positionIndices, chunkCorners, positionCount, true) &&
+				IndicesInRange(texCoordIndices, chunkCorners, texCoordCount, false) &&
+				IndicesInRange(normalIndices, chunkCorners, normalCount, false);
 
-			//vertToIndexMap.insert(pair);
+			chunk.Data = OBJData();
 		}
+	});
+
+	if (std::find(chunkValid.begin(), chunkValid.end(), 0) != chunkValid.end())
+	{
+		DBG_OUTPUT(L"OBJ face references a vertex attribute that isn't in the file\n");
+		return false;
 	}
+
+	return true;
 }
 
-void OBJLoader::InsertTangentsIntoArray(SimpleVertex* vertices, unsigned short* indices, int vertexCount)
+bool OBJLoader::ParseStream(const char * filename, bool invertCoordinates, OBJData & data)
 {
-	int faceCount, i, index;
-	SimpleVertex vertex1, vertex2, vertex3;
-	XMFLOAT3 tangent;
+	std::ifstream inFile;
+	inFile.open(filename);
 
+	if (!inFile.good())
+	{
+		return false;
+	}
 
-	// Calculate the number of faces in the model.
-	faceCount = vertexCount / 3;
+	std::string input;
 
-	// Initialize the index to the model data.
-	index = 0;
+	XMFLOAT3 vert;
+	XMFLOAT2 TexCoord;
+	XMFLOAT3 normal;
+	int vInd[3]; //indices for the vertex position
+	int tInd[3]; //indices for the texture coordinate
+	int nInd[3]; //indices for the normal
+	std::string beforeFirstSlash;
+	std::string afterFirstSlash;
+	std::string afterSecondSlash;
 
-	// Go through all the faces and calculate the the tangent, binormal, and normal vectors.
-	for (i = 0; i<faceCount; i++)
+	while (!inFile.eof()) //While we have yet to reach the end of the file...
 	{
-		if (i == 8)
-		{
-			int x = 1;
-		}
-		// Get the three vertices for this face from the model.
-		vertex1.PosL.x = vertices[indices[index]].PosL.x;
-		vertex1.PosL.y = vertices[indices[index]].PosL.y;
-		vertex1.PosL.z = vertices[indices[index]].PosL.z;
-		vertex1.Tex.x = vertices[indices[index]].Tex.x;
-		vertex1.Tex.y = vertices[indices[index]].Tex.y;
-		vertex1.NormL.x = vertices[indices[index]].NormL.x;
-		vertex1.NormL.y = vertices[indices[index]].NormL.y;
-		vertex1.NormL.z = vertices[indices[index]].NormL.z;
-		index++;
-
-		vertex2.PosL.x = vertices[indices[index]].PosL.x;
-		vertex2.PosL.y = vertices[indices[index]].PosL.y;
-		vertex2.PosL.z = vertices[indices[index]].PosL.z;
-		vertex2.Tex.x = vertices[indices[index]].Tex.x;
-		vertex2.Tex.y = vertices[indices[index]].Tex.y;
-		vertex2.NormL.x = vertices[indices[index]].NormL.x;
-		vertex2.NormL.y = vertices[indices[index]].NormL.y;
-		vertex2.NormL.z = vertices[indices[index]].NormL.z;
-		index++;
-
-		vertex3.PosL.x = vertices[indices[index]].PosL.x;
-		vertex3.PosL.y = vertices[indices[index]].PosL.y;
-		vertex3.PosL.z = vertices[indices[index]].PosL.z;
-		vertex3.Tex.x = vertices[indices[index]].Tex.x;
-		vertex3.Tex.y = vertices[indices[index]].Tex.y;
-		vertex3.NormL.x = vertices[indices[index]].NormL.x;
-		vertex3.NormL.y = vertices[indices[index]].NormL.y;
-		vertex3.NormL.z = vertices[indices[index]].NormL.z;
-		index++;
-
-		tangent = CalculateTangent(vertex1, vertex2, vertex3);
-
-		// Store the normal, tangent, and binormal for this face back in the model structure.
-		
-		vertices[indices[index - 1]].Tangent.x = tangent.x;
-		vertices[indices[index - 1]].Tangent.y = tangent.y;
-		vertices[indices[index - 1]].Tangent.z = tangent.z;
-
-		vertices[indices[index - 2]].Tangent.x = tangent.x;
-		vertices[indices[index - 2]].Tangent.y = tangent.y;
-		vertices[indices[index - 2]].Tangent.z = tangent.z;
-
-		vertices[indices[index - 3]].Tangent.x = tangent.x;
-		vertices[indices[index - 3]].Tangent.y = tangent.y;
-		vertices[indices[index - 3]].Tangent.z = tangent.z;
-	}
-}
+		inFile >> input; //Get the next input from the file
 
-XMFLOAT3 OBJLoader::CalculateTangent(SimpleVertex v0, SimpleVertex v1, SimpleVertex v2)
-{
-	XMVECTOR vv0 = XMLoadFloat3(&v0.PosL);
-	XMVECTOR vv1 = XMLoadFloat3(&v1.PosL);
-	XMVECTOR vv2 = XMLoadFloat3(&v2.PosL);
+						 //Check what type of input it was, we are only interested in vertex positions, texture coordinates, normals and indices, nothing else
+		if (input.compare("v") == 0) //Vertex position
+		{
+			inFile >> vert.x;
+			inFile >> vert.y;
+			inFile >> vert.z;
 
-	XMVECTOR e0 = vv1 - vv0;
-	XMVECTOR e1 = vv2 - vv0;
+			data.Positions.push_back(vert);
+		}
+		else if (input.compare("vt") == 0) //Texture coordinate
+		{
+			inFile >> TexCoord.x;
+			inFile >> TexCoord.y;
 
-	//using Eric Lengyel's approach with a few modifications
-	//from Mathematics for 3D Game Programmming and Computer Graphics
-	// want to be able to trasform a vector in Object Space to Tangent Space
-	// such that the x-axis cooresponds to the 's' direction and the
-	// y-axis corresponds to the 't' direction, and the z-axis corresponds
-	// to <0,0,1>, straight up out of the texture map
+			//diferent modeling software stores the texture coordinates differently
 
-	//let P = v1 - v0
-	XMVECTOR P = vv1 - vv0;
-	//let Q = v2 - v0
-	XMVECTOR Q = vv2 - vv0;
-	float s1 = v1.Tex.x - v0.Tex.x;
-	float t1 = v1.Tex.y - v0.Tex.y;
-	float s2 = v2.Tex.x - v0.Tex.x;
-	float t2 = v2.Tex.y - v0.Tex.y;
+			if (invertCoordinates)
+			{
+				TexCoord.y = 1.0f - TexCoord.y;
+			}
 
+			data.TexCoords.push_back(TexCoord);
+		}
+		else if (input.compare("vn") == 0) //Normal
+		{
+			inFile >> normal.x;
+			inFile >> normal.y;
+			inFile >> normal.z;
 
-	//we need to solve the equation
-	// P = s1*T + t1*B
-	// Q = s2*T + t2*B
-	// for T and B
+			data.Normals.push_back(normal);
+		}
+		else if (input.compare("f") == 0) //Face
+		{
+			for (int i = 0; i < 3; ++i)
+			{
+				inFile >> input;
+				int slash = input.find("/"); //Find first forward slash
+				int secondSlash = input.find("/", slash + 1); //Find second forward slash
+
+															  //Extract from string
+				beforeFirstSlash = input.substr(0, slash); //The vertex position index
+				afterFirstSlash = input.substr(slash + 1, secondSlash - slash - 1); //The texture coordinate index
+				afterSecondSlash = input.substr(secondSlash + 1); //The normal index
+
+																  //Parse into int
+				vInd[i] = atoi(beforeFirstSlash.c_str()); //atoi = "ASCII to int"
+				tInd[i] = atoi(afterFirstSlash.c_str());
+				nInd[i] = atoi(afterSecondSlash.c_str());
+			}
 
+			//Place into vectors
+			for (int i = 0; i < 3; ++i)
+			{
+				data.PositionIndices.push_back(vInd[i] - 1);	//Minus 1 from each as these as OBJ indexes start from 1 whereas C++ arrays start from 0
+				data.TexCoordIndices.push_back(tInd[i] - 1);	//which is really annoying. Apart from Lua and SQL, there's not much else that has indexing 
+				data.NormalIndices.push_back(nInd[i] - 1);		//starting at 1. So many more languages index from 0, the .OBJ people screwed up there.
+			}
+		}
+	}
+	inFile.close(); //Finished with input file now, all the data we need has now been loaded in
 
-	//this is a linear system with six unknowns and six equatinos, for TxTyTz BxByBz
-	//[px,py,pz] = [s1,t1] * [Tx,Ty,Tz]
-	// qx,qy,qz     s2,t2     Bx,By,Bz
+	return true;
+}
 
-	//multiplying both sides by the inverse of the s,t matrix gives
-	//[Tx,Ty,Tz] = 1/(s1t2-s2t1) *  [t2,-t1] * [px,py,pz]
-	// Bx,By,Bz                      -s2,s1	    qx,qy,qz  
+IndexedModel OBJLoader::BuildModel(const OBJData & data, float weldEpsilon)
+{
+	unsigned int numIndices = data.PositionIndices.size();
 
-	//solve this for the unormalized T and B to get from tangent to object space
+	std::vector<SimpleVertex> expandedVertices(numIndices);
 
-	float tmp = 0.0f;
-	if (fabsf(s1*t2 - s2 * t1) <= 0.0001f)
-	{
-		tmp = 1.0f;
-	}
-	else
+	for (unsigned int i = 0; i < numIndices; i++)
 	{
-		tmp = 1.0f / (s1*t2 - s2 * t1);
+		//faces that leave out texture coordinates or normals get zeroed ones
+		int texCoordIndex = data.TexCoordIndices[i];
+		int normalIndex = data.NormalIndices[i];
+
+		expandedVertices[i].PosL = data.Positions[data.PositionIndices[i]];
+		expandedVertices[i].NormL = normalIndex >= 0 ? data.Normals[normalIndex] : XMFLOAT3(0.0f, 0.0f, 0.0f);
+		expandedVertices[i].Tangent = XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
+		expandedVertices[i].Tex = texCoordIndex >= 0 ? data.TexCoords[texCoordIndex] : XMFLOAT2(0.0f, 0.0f);
 	}
 
-	XMFLOAT3 PF3, QF3;
-	XMStoreFloat3(&PF3, P);
-	XMStoreFloat3(&QF3, Q);
-
-	XMFLOAT3 tangent;
-	tangent.x = (t2*PF3.x - t1 * QF3.x);
-	tangent.y = (t2*PF3.y - t1 * QF3.y);
-	tangent.z = (t2*PF3.z - t1 * QF3.z);
+	//Now to (finally) form the final vertex list and single index buffer using the above expanded vertices
+	IndexedModel returnGeometry;
 
-	tangent.x = tangent.x*tmp;
-	tangent.y = tangent.y*tmp;
-	tangent.z = tangent.z*tmp;
+	VertexWelder::WeldStatistics statistics = CreateIndices(expandedVertices, weldEpsilon, returnGeometry.Vertices, returnGeometry.Indices);
 
-	XMVECTOR vt = XMLoadFloat3(&tangent);
+	DBG_OUTPUT(L"OBJ welded %u face corners into %u vertices, reuse ratio %u.%02u\n", statistics.InputVertices, statistics.OutputVertices,
+		(unsigned int)statistics.ReuseRatio(), (unsigned int)(statistics.ReuseRatio() * 100.0f) % 100);
 
-	vt = XMVector3Normalize(vt);
+	TangentGenerator::OutputStatistics(L"OBJ", TangentGenerator::Generate(returnGeometry.Vertices, returnGeometry.Indices));
 
-	XMStoreFloat3(&tangent, vt);
+	return returnGeometry;
+}
 
-	return tangent;
+VertexWelder::WeldStatistics OBJLoader::CreateIndices(const std::vector<SimpleVertex>& expandedVertices, float weldEpsilon,
+	std::vector<SimpleVertex>& outVertices,
+	std::vector<UINT>& outIndices)
+{
+	//every corner was expanded in face order, so the remap table is the index buffer
+	return VertexWelder::Weld(expandedVertices, weldEpsilon, outVertices, outIndices);
 }
@@ -1,29 +1,56 @@
 #pragma once
 #include <string>
-#include <map>			//For fast searching when re-creating the index buffer
 
 
 #include "Commons.h"
 #include "Vector.h"
+#include "VertexWelder.h"
+#include "MeshCache.h"
+#include "Mesh.h"
 
 namespace OBJLoader
 {
-	IndexedModel Load(const char* filename, bool invertCoordinates);
+	//The attribute streams and the 3 separate index streams exactly as they are laid out in the OBJ file.
+	//Indices are 0 based and -1 marks an attribute that the face corner didn't reference
+	struct OBJData
+	{
+		std::vector<XMFLOAT3> Positions;
+		std::vector<XMFLOAT2> TexCoords;
+		std::vector<XMFLOAT3> Normals;
 
-	//searches to see if a similar vertex already exists in the buffer
-	bool FindSimilarVertex(const SimpleVertex& vertex, std::map<SimpleVertex, unsigned short>& vertToIndexMap, unsigned short& index);
+		std::vector<int> PositionIndices;
+		std::vector<int> TexCoordIndices;
+		std::vector<int> NormalIndices;
+	};
 
-	//Re-Creates a single index buffer from the 3 given in the OBJ file
-	void CreateIndices(const std::vector<XMFLOAT3>& inVertices, 
-		const std::vector<XMFLOAT2>& inTexCoords, 
-		const std::vector<XMFLOAT3>& inNormals, 
-		std::vector<unsigned short>& outIndices, 
-		std::vector<XMFLOAT3>& outVertices, 
-		std::vector<XMFLOAT2>& outTexCoords, 
-		std::vector<XMFLOAT3>& outNormals);
+	//weldEpsilon is the grid size vertex attributes are snapped to before welding, 0 only welds identical vertices
+	IndexedModel Load(const char* filename, bool invertCoordinates, float weldEpsilon = 0.0f);
 
-	//Creates the tangents from the normals and texture coordinates
-	void InsertTangentsIntoArray(SimpleVertex* vertices, unsigned short* indices, int vertexCount);
+	//Same as Load but creates the GPU buffers straight from the mapped cooked file when it is up to date
+	Mesh LoadMesh(const char* filename, bool invertCoordinates, ID3D11Device* d3dDevice, float weldEpsilon = 0.0f);
 
-	XMFLOAT3 CalculateTangent(SimpleVertex v0, SimpleVertex v1, SimpleVertex v2);
+	//Opens the cooked file next to the OBJ if it was cooked from the same source with the same settings and returns true.
+	//Otherwise the model is rebuilt into builtGeometry and cooked again, then the new file is opened. False is returned
+	//when the cooked file couldn't be written, leaving builtGeometry as the only copy, and also when neither the OBJ nor
+	//its old binary could be opened or the source failed to parse, leaving builtGeometry empty
+	bool LoadCooked(const char* filename, bool invertCoordinates, float weldEpsilon, MeshCache::CookedMesh& cookedMesh, IndexedModel& builtGeometry);
+
+	//Reads the unversioned dump of two counts and the raw arrays that older builds wrote next to the OBJ
+	bool ReadLegacyBinary(const char* data, size_t size, IndexedModel& model);
+
+	//Memory maps the file and parses it in place, large files are split into line aligned chunks that are parsed on worker threads and merged in order.
+	//Fails if a face references a position, texture coordinate or normal the file doesn't have
+	bool ParseMapped(const char* filename, bool invertCoordinates, OBJData& data);
+	bool ParseMapped(const char* begin, const char* end, bool invertCoordinates, OBJData& data);
+
+	//The original ifstream based parser, only kept around so the benchmark has something to compare against
+	bool ParseStream(const char* filename, bool invertCoordinates, OBJData& data);
+
+	//Expands the OBJ index streams into a single vertex and index buffer
+	IndexedModel BuildModel(const OBJData& data, float weldEpsilon);
+
+	//Re-Creates a single index buffer from the 3 given in the OBJ file by welding the expanded face corners back together
+	VertexWelder::WeldStatistics CreateIndices(const std::vector<SimpleVertex>& expandedVertices, float weldEpsilon,
+		std::vector<SimpleVertex>& outVertices,
+		std::vector<UINT>& outIndices);
 };
\ No newline at end of file
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+namespace Parallel
+{
+	static unsigned int WorkerCount()
+	{
+		unsigned int count = std::thread::hardware_concurrency();
+		return count > 0 ? count : 1;
+	}
+
+	//Splits [0, count) into contiguous ranges of at least minPerTask items and runs function(begin, end, taskIndex) on each range.
+	//The calling thread takes the first range so a single range never spawns a thread. Returns the number of tasks used.
+	//maxTasks caps the ranges below one per core, 0 leaves it at WorkerCount().
+	template<typename Function>
+	unsigned int For(size_t count, size_t minPerTask, Function function, unsigned int maxTasks = 0)
+	{
+		if (count == 0)
+		{
+			return 0;
+		}
+
+		if (minPerTask == 0)
+			minPerTask = 1;
+
+		size_t workerCount = maxTasks > 0 ? maxTasks : WorkerCount();
+		size_t taskCount = std::min<size_t>(workerCount, (count + minPerTask - 1) / minPerTask);
+		size_t perTask = (count + taskCount - 1) / taskCount;
+
+		std::vector<std::thread> threads;
+		threads.reserve(taskCount - 1);
+
+		for (size_t task = 1; task < taskCount; task++)
+		{
+			size_t begin = task * perTask;
+			size_t end = std::min(count, begin + perTask);
+
+			if (begin >= end)
+				break;
+
+			threads.emplace_back(function, begin, end, (unsigned int)task);
+		}
+
+		function((size_t)0, std::min(count, perTask), 0u);
+
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+
+		return (unsigned int)threads.size() + 1;
+	}
+}
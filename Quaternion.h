@@ -127,13 +127,13 @@ public:
 		{
 			float r4 = (float)(sqrt(diagonal + 1.0f) * 2.0f);
 			r = r4 / 4.0f;
-			i = matrix(2, 1) - matrix(1, 2) / r4;
-			j = matrix(0, 2) - matrix(2, 0) / r4;
-			k = matrix(1, 0) - matrix(0, 1) / r4;
+			i = (matrix(2, 1) - matrix(1, 2)) / r4;
+			j = (matrix(0, 2) - matrix(2, 0)) / r4;
+			k = (matrix(1, 0) - matrix(0, 1)) / r4;
 		}
 		else if (matrix(0, 0) > matrix(1, 1) && matrix(0, 0) > matrix(2, 2))
 		{
-			float i4 = (float)sqrt(1.0f + matrix(0, 0) - matrix(1, 1) - matrix(2, 2) * 2.0f);
+			float i4 = (float)(sqrt(1.0f + matrix(0, 0) - matrix(1, 1) - matrix(2, 2)) * 2.0f);
 			r = (matrix(2, 1) - matrix(1, 2)) / i4;
 			i = i4 / 4.0f;
 			j = (matrix(0,1) + matrix(1,0)) / i4;
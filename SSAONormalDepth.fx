@@ -12,12 +12,11 @@ cbuffer ConstantBuffer : register(b0)
     matrix Projection;
 }
 
+//Only the position and normal are read so meshes can be drawn from their normal depth stream
 struct VS_INPUT
 {
     float4 PosL : POSITION;
     float3 NormalL : NORMAL;
-    float3 TangentL : TANGENT;
-    float2 Tex : TEXCOORD;
 };
 
 struct VS_OUTPUT
@@ -25,7 +24,6 @@ struct VS_OUTPUT
     float4 PosH : SV_POSITION;
     float4 PosV : POSITION;
     float3 NormalV : NORMAL;
-    float2 Tex : TEXCOORD0;
 };
 
 VS_OUTPUT SSAONormalDepthVS(VS_INPUT input)
@@ -39,12 +37,9 @@ VS_OUTPUT SSAONormalDepthVS(VS_INPUT input)
 
     //output.PosV.b = output.PosV.b / 100;
 
-    float3x3 tbnMatrix;
-    tbnMatrix[0] = normalize(mul(float4(input.TangentL, 0.0f), World).xyz);
-    tbnMatrix[1] = normalize(mul(float4(cross(input.NormalL, input.TangentL), 0.0f), World).xyz);
-    tbnMatrix[2] = normalize(mul(float4(input.NormalL, 0.0f), World).xyz);
+    float3 normalW = normalize(mul(float4(input.NormalL, 0.0f), World).xyz);
 
-    output.NormalV = mul((float3x3) transpose(View), tbnMatrix[2]);
+    output.NormalV = mul((float3x3) transpose(View), normalW);
 
     //output.NormalV.b = -output.NormalV.b;
 
@@ -26,18 +26,15 @@ cbuffer ConstantBuffer : register(b0)
     float MaxTess;
 }
 
+//Only the position is read so meshes can be drawn from their position only stream
 struct VS_INPUT
 {
-	float4 PosL : POSITION;
-	float3 NormL : NORMAL;
-	float3 TangentL : TANGENT;
-	float2 Tex : TEXCOORD0;
+	float3 PosL : POSITION;
 };
 
 struct VS_OUTPUT
 {
 	float4 PosH :SV_POSITION;
-	float2 Tex : TEXCOORD;
 };
 
 //--------------------------------------------------------------------------------------
@@ -46,12 +43,10 @@ struct VS_OUTPUT
 VS_OUTPUT ShadowMapVS(VS_INPUT input)
 {
 	VS_OUTPUT output = (VS_OUTPUT)0;
-	float4 posW = mul(input.PosL, World);
+	float4 posW = mul(float4(input.PosL, 1.0f), World);
 	output.PosH = mul(posW, View);
 	output.PosH = mul(output.PosH, Projection);
 
-	output.Tex = input.Tex;
-
 	return output;
 }
 
@@ -0,0 +1,112 @@
+#include "Skeleton.h"
+#include "JointTransform.h"
+
+#include <algorithm>
+
+namespace
+{
+	void FlattenWithParents(const JointData& joint, int parent, std::vector<const JointData*>& joints, std::vector<int>& parents)
+	{
+		int index = (int)joints.size();
+		joints.push_back(&joint);
+		parents.push_back(parent);
+
+		for (const JointData* child : joint.children)
+		{
+			FlattenWithParents(*child, index, joints, parents);
+		}
+	}
+}
+
+Skeleton::Skeleton(const SkeletonData& data)
+	:_paletteSize(0)
+{
+	std::vector<const JointData*> joints;
+	FlattenWithParents(data.rootJoint, -1, joints, _parents);
+
+	_inverseBindTransforms.resize(joints.size());
+
+	for (UINT joint = 0; joint < joints.size(); joint++)
+	{
+		_skinIndices.push_back((UINT)joints[joint]->index);
+		_names.push_back(joints[joint]->nameID);
+		_bindLocalTransforms.push_back(joints[joint]->bindLocalTransform);
+		_paletteSize = std::max(_paletteSize, (UINT)joints[joint]->index + 1);
+	}
+
+	//the bind pose in model space is built down the arrays the same way a pose is
+	std::vector<XMFLOAT4X4> bindTransforms(joints.size());
+	for (UINT joint = 0; joint < joints.size(); joint++)
+	{
+		XMMATRIX bindTransform = XMLoadFloat4x4(&_bindLocalTransforms[joint]);
+		if (_parents[joint] >= 0)
+		{
+			bindTransform = XMMatrixMultiply(XMLoadFloat4x4(&bindTransforms[_parents[joint]]), bindTransform);
+		}
+
+		XMStoreFloat4x4(&bindTransforms[joint], bindTransform);
+		XMStoreFloat4x4(&_inverseBindTransforms[joint], XMMatrixInverse(nullptr, bindTransform));
+	}
+}
+
+int Skeleton::FindJoint(const std::string & name) const
+{
+	auto it = std::find(_names.begin(), _names.end(), name);
+	return it != _names.end() ? (int)(it - _names.begin()) : -1;
+}
+
+void Skeleton::ComputeModelTransforms(const Vector3D * translations, const Quaternion * rotations, XMFLOAT4X4 * modelTransforms) const
+{
+	for (size_t joint = 0; joint < _parents.size(); joint++)
+	{
+		XMMATRIX modelTransform = JointTransform::CalculateLocalTransform(translations[joint], rotations[joint]);
+		if (_parents[joint] >= 0)
+		{
+			modelTransform = XMMatrixMultiply(XMLoadFloat4x4(&modelTransforms[_parents[joint]]), modelTransform);
+		}
+
+		XMStoreFloat4x4(&modelTransforms[joint], modelTransform);
+	}
+}
+
+void Skeleton::ComputePalette(const XMFLOAT4X4 * modelTransforms, FXMMATRIX world, XMFLOAT4X4 * palette) const
+{
+	for (size_t joint = 0; joint < _parents.size(); joint++)
+	{
+		if (!modelTransforms)
+		{
+			XMStoreFloat4x4(&palette[_skinIndices[joint]], world);
+			continue;
+		}
+
+		XMMATRIX skinTransform = XMMatrixMultiply(XMLoadFloat4x4(&modelTransforms[joint]), XMLoadFloat4x4(&_inverseBindTransforms[joint]));
+		XMStoreFloat4x4(&palette[_skinIndices[joint]], world * skinTransform);
+	}
+}
+
+Joint * Skeleton::CreateJointTree() const
+{
+	std::vector<Joint*> joints(_parents.size());
+
+	for (size_t joint = 0; joint < _parents.size(); joint++)
+	{
+		joints[joint] = new Joint((int)_skinIndices[joint], _names[joint], _bindLocalTransforms[joint], _inverseBindTransforms[joint]);
+
+		if (_parents[joint] >= 0)
+		{
+			joints[_parents[joint]]->AddChild(joints[joint]);
+		}
+	}
+
+	return joints.empty() ? nullptr : joints[0];
+}
+
+void Skeleton::Flatten(const JointData& joint, std::vector<const JointData*>& joints)
+{
+	joints.push_back(&joint);
+
+	for (const JointData* child : joint.children)
+	{
+		Flatten(*child, joints);
+	}
+}
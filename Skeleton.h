@@ -0,0 +1,58 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "AnimatedModelData.h"
+#include "Joint.h"
+#include "Quaternion.h"
+#include "Vector.h"
+
+//A skeleton flattened into arrays in depth first order, so every parent comes before its children and posing the
+//whole thing is one pass down the arrays. Clips index their tracks in the same order
+class Skeleton
+{
+private:
+	std::vector<int> _parents; //-1 for the root
+	std::vector<UINT> _skinIndices; //the palette slot the skin's bone indices use for each joint
+	std::vector<std::string> _names;
+	std::vector<XMFLOAT4X4> _bindLocalTransforms;
+	std::vector<XMFLOAT4X4> _inverseBindTransforms;
+	UINT _paletteSize;
+
+public:
+	Skeleton()
+		:_paletteSize(0) {}
+
+	//The inverse bind transforms are worked out from the local bind transforms rather than taken from the data
+	explicit Skeleton(const SkeletonData& data);
+
+	UINT GetJointCount() const { return (UINT)_parents.size(); }
+
+	//One more than the highest skin index, joints the skin doesn't bind all share the last slot
+	UINT GetPaletteSize() const { return _paletteSize; }
+
+	int GetParent(UINT joint) const { return _parents[joint]; }
+	UINT GetSkinIndex(UINT joint) const { return _skinIndices[joint]; }
+	const std::string& GetName(UINT joint) const { return _names[joint]; }
+
+	const XMFLOAT4X4* GetBindLocalTransforms() const { return _bindLocalTransforms.data(); }
+	const XMFLOAT4X4* GetInverseBindTransforms() const { return _inverseBindTransforms.data(); }
+
+	//-1 if no joint has the name
+	int FindJoint(const std::string& name) const;
+
+	//Each joint's transform relative to the model from a local translation and rotation per joint, its parent's model
+	//transform times its local one
+	void ComputeModelTransforms(const Vector3D* translations, const Quaternion* rotations, XMFLOAT4X4* modelTransforms) const;
+
+	//Writes world times each joint's model transform times its inverse bind transform to the joint's palette slot.
+	//Without model transforms every slot gets the world transform, which draws the mesh in its bind pose
+	void ComputePalette(const XMFLOAT4X4* modelTransforms, FXMMATRIX world, XMFLOAT4X4* palette) const;
+
+	//A tree of the joints for tools that want to walk it, the caller deletes the root
+	Joint* CreateJointTree() const;
+
+	//The joints of a skeleton still in the loader's form, in the order the arrays use
+	static void Flatten(const JointData& joint, std::vector<const JointData*>& joints);
+};
@@ -19,7 +19,7 @@ cbuffer ConstantBuffer : register(b1)
 struct VS_INPUT
 {
     float4 Pos : POSITION;
-    float3 Tangent : TANGENT;
+    float4 Tangent : TANGENT; //w is the handedness
     float3 Normal : NORMAL;
     float2 Tex0 : TEXCOORD0;
     float4 BlendWeights : BLENDWEIGHT;
@@ -57,7 +57,7 @@ VS_OUTPUT SkinnedVS(VS_INPUT input)
 
         Pos += mul(input.Pos, WorldMatrixArray[input.BlendIndices[iBone]]) * BlendWeightsArray[iBone];
         Normal += mul(input.Normal, (float3x3) WorldMatrixArray[input.BlendIndices[iBone]]) * BlendWeightsArray[iBone];
-        Tangent += mul(input.Tangent, (float3x3) WorldMatrixArray[input.BlendIndices[iBone]]) * BlendWeightsArray[iBone];
+        Tangent += mul(input.Tangent.xyz, (float3x3) WorldMatrixArray[input.BlendIndices[iBone]]) * BlendWeightsArray[iBone];
     }
     
     //Pos = mul(input.Pos, WorldMatrixArray[2]);
@@ -72,7 +72,7 @@ VS_OUTPUT SkinnedVS(VS_INPUT input)
 
     output.NormW = normalize(Normal);
 
-    output.TangentW = float4(normalize(Tangent), 1.0f);
+    output.TangentW = float4(normalize(Tangent), input.Tangent.w);
 
     output.ShadowPosH = mul(posW, ShadowTransform);
     output.Tex = input.Tex0;
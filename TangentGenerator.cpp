@@ -0,0 +1,240 @@
+#include "TangentGenerator.h"
+#include <cmath>
+
+#include "Parallel.h"
+
+namespace
+{
+	//Texture mappings whose uv area is below this are treated as having no direction
+	const float c_MinTexCoordArea = 1e-12f;
+
+	//Triangle corners for every vertex packed into one array, the corners of vertex v are
+	//corners[offsets[v]] up to corners[offsets[v] + counts[v]], a corner being triangle * 3 + its position in the triangle
+	struct Adjacency
+	{
+		std::vector<UINT> counts;
+		std::vector<UINT> offsets;
+		std::vector<UINT> corners;
+	};
+
+	void BuildAdjacency(const UINT* indices, size_t indexCount, size_t vertexCount, Adjacency& adjacency)
+	{
+		adjacency.counts.assign(vertexCount, 0);
+		adjacency.offsets.resize(vertexCount);
+		adjacency.corners.resize(indexCount);
+
+		for (size_t i = 0; i < indexCount; i++)
+		{
+			adjacency.counts[indices[i]]++;
+		}
+
+		UINT offset = 0;
+		for (size_t v = 0; v < vertexCount; v++)
+		{
+			adjacency.offsets[v] = offset;
+			offset += adjacency.counts[v];
+		}
+
+		//fill using the offsets as cursors then put them back
+		for (size_t i = 0; i < indexCount; i++)
+		{
+			adjacency.corners[adjacency.offsets[indices[i]]++] = (UINT)i;
+		}
+
+		for (size_t v = 0; v < vertexCount; v++)
+		{
+			adjacency.offsets[v] -= adjacency.counts[v];
+		}
+	}
+
+	//Unit tangent and bitangent of one triangle plus what each of its corners contributes to the vertex there.
+	//Triangles without a usable mapping have zero weights
+	struct TriangleFrame
+	{
+		XMFLOAT3 Tangent;
+		XMFLOAT3 Bitangent;
+		float CornerWeights[3];
+	};
+
+	inline XMVECTOR LoadPosition(const TangentGenerator::VertexStreams& streams, UINT vertex)
+	{
+		return XMLoadFloat3((const XMFLOAT3*)(streams.Positions + vertex * streams.Stride));
+	}
+
+	inline XMFLOAT2 LoadTexCoord(const TangentGenerator::VertexStreams& streams, UINT vertex)
+	{
+		return *(const XMFLOAT2*)(streams.TexCoords + vertex * streams.Stride);
+	}
+
+	inline float CornerAngle(FXMVECTOR a, FXMVECTOR b)
+	{
+		float lengthA = XMVectorGetX(XMVector3Length(a));
+		float lengthB = XMVectorGetX(XMVector3Length(b));
+		if (lengthA <= 0.0f || lengthB <= 0.0f)
+		{
+			return 0.0f;
+		}
+
+		return XMVectorGetX(XMVector3AngleBetweenNormals(a / lengthA, b / lengthB));
+	}
+
+	TriangleFrame ComputeTriangleFrame(const TangentGenerator::VertexStreams& streams, const UINT* triangle)
+	{
+		TriangleFrame frame = {};
+
+		XMVECTOR p0 = LoadPosition(streams, triangle[0]);
+		XMVECTOR p1 = LoadPosition(streams, triangle[1]);
+		XMVECTOR p2 = LoadPosition(streams, triangle[2]);
+
+		XMFLOAT2 uv0 = LoadTexCoord(streams, triangle[0]);
+		XMFLOAT2 uv1 = LoadTexCoord(streams, triangle[1]);
+		XMFLOAT2 uv2 = LoadTexCoord(streams, triangle[2]);
+
+		XMVECTOR e1 = p1 - p0;
+		XMVECTOR e2 = p2 - p0;
+
+		float s1 = uv1.x - uv0.x;
+		float t1 = uv1.y - uv0.y;
+		float s2 = uv2.x - uv0.x;
+		float t2 = uv2.y - uv0.y;
+
+		//solving e1 = s1 T + t1 B and e2 = s2 T + t2 B, the sign of the determinant is kept so mirrored mappings
+		//still give tangents along increasing u
+		float determinant = s1 * t2 - s2 * t1;
+		float area = 0.5f * XMVectorGetX(XMVector3Length(XMVector3Cross(e1, e2)));
+
+		if (fabsf(determinant) <= c_MinTexCoordArea || area <= 0.0f)
+		{
+			return frame;
+		}
+
+		XMVECTOR tangent = (e1 * t2 - e2 * t1) / determinant;
+		XMVECTOR bitangent = (e2 * s1 - e1 * s2) / determinant;
+
+		//only the directions are kept, otherwise how densely the texture is mapped would decide the weighting
+		float tangentLength = XMVectorGetX(XMVector3Length(tangent));
+		float bitangentLength = XMVectorGetX(XMVector3Length(bitangent));
+		if (tangentLength <= 0.0f || bitangentLength <= 0.0f)
+		{
+			return frame;
+		}
+
+		XMStoreFloat3(&frame.Tangent, tangent / tangentLength);
+		XMStoreFloat3(&frame.Bitangent, bitangent / bitangentLength);
+
+		float angle0 = CornerAngle(e1, e2);
+		float angle1 = CornerAngle(p2 - p1, p0 - p1);
+		float angle2 = XM_PI - angle0 - angle1;
+
+		frame.CornerWeights[0] = area * angle0;
+		frame.CornerWeights[1] = area * angle1;
+		frame.CornerWeights[2] = area * (angle2 > 0.0f ? angle2 : 0.0f);
+
+		return frame;
+	}
+
+	//Any unit vector perpendicular to the normal, for vertices with nothing better to go on
+	XMVECTOR AnyPerpendicular(FXMVECTOR normal)
+	{
+		XMFLOAT3 n;
+		XMStoreFloat3(&n, normal);
+
+		XMVECTOR axis = fabsf(n.x) < 0.9f ? XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f) : XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+		return XMVector3Normalize(axis - normal * XMVector3Dot(normal, axis));
+	}
+}
+
+TangentGenerator::TangentStatistics TangentGenerator::Generate(const VertexStreams& streams, const UINT* indices, size_t indexCount)
+{
+	size_t triangleCount = indexCount / 3;
+
+	std::vector<TriangleFrame> frames(triangleCount);
+
+	Parallel::For(triangleCount, c_MinTrianglesPerTask, [&](size_t begin, size_t end, unsigned int)
+	{
+		for (size_t t = begin; t < end; t++)
+		{
+			frames[t] = ComputeTriangleFrame(streams, &indices[t * 3]);
+		}
+	});
+
+	//gathering from each vertex's own corners rather than scattering from the triangles lets the vertices be split
+	//between threads without any two writing to the same one
+	Adjacency adjacency;
+	BuildAdjacency(indices, triangleCount * 3, streams.Count, adjacency);
+
+	std::vector<TangentStatistics> taskStatistics(Parallel::WorkerCount());
+
+	Parallel::For(streams.Count, c_MinVerticesPerTask, [&](size_t begin, size_t end, unsigned int task)
+	{
+		TangentStatistics& statistics = taskStatistics[task];
+
+		for (size_t v = begin; v < end; v++)
+		{
+			XMVECTOR tangent = XMVectorZero();
+			XMVECTOR bitangent = XMVectorZero();
+
+			for (UINT i = 0; i < adjacency.counts[v]; i++)
+			{
+				UINT corner = adjacency.corners[adjacency.offsets[v] + i];
+				const TriangleFrame& frame = frames[corner / 3];
+				XMVECTOR weight = XMVectorReplicate(frame.CornerWeights[corner % 3]);
+
+				tangent += XMLoadFloat3(&frame.Tangent) * weight;
+				bitangent += XMLoadFloat3(&frame.Bitangent) * weight;
+			}
+
+			XMVECTOR normal = XMVector3Normalize(XMLoadFloat3((const XMFLOAT3*)(streams.Normals + v * streams.Stride)));
+
+			//Gram-Schmidt, whatever of the tangent lies along the normal is removed
+			XMVECTOR orthogonal = tangent - normal * XMVector3Dot(normal, tangent);
+			float length = XMVectorGetX(XMVector3Length(orthogonal));
+			float weightScale = XMVectorGetX(XMVector3Length(tangent));
+
+			if (length <= 1e-6f * weightScale || length <= 0.0f)
+			{
+				//the bitangent may still give a direction when the tangent folded onto the normal
+				XMVECTOR fromBitangent = XMVector3Cross(bitangent, normal);
+				float bitangentLength = XMVectorGetX(XMVector3Length(fromBitangent));
+
+				if (bitangentLength > 0.0f)
+				{
+					orthogonal = fromBitangent / bitangentLength;
+				}
+				else
+				{
+					orthogonal = AnyPerpendicular(normal);
+					statistics.Degenerate++;
+				}
+			}
+			else
+			{
+				orthogonal = orthogonal / length;
+			}
+
+			//where the texture is mirrored cross(normal, tangent) runs against increasing v, so w flips it back
+			float handedness = 1.0f;
+			if (XMVectorGetX(XMVector3Dot(XMVector3Cross(normal, orthogonal), bitangent)) < 0.0f)
+			{
+				handedness = -1.0f;
+				statistics.Mirrored++;
+			}
+
+			XMStoreFloat4((XMFLOAT4*)(streams.Tangents + v * streams.Stride), XMVectorSetW(orthogonal, handedness));
+		}
+	});
+
+	TangentStatistics total;
+	for (const TangentStatistics& statistics : taskStatistics)
+	{
+		total.Degenerate += statistics.Degenerate;
+		total.Mirrored += statistics.Mirrored;
+	}
+
+	return total;
+}
+
+void TangentGenerator::OutputStatistics(const WCHAR * label, const TangentStatistics & statistics)
+{
+	DBG_OUTPUT(L"%s tangents generated, %u vertices mirrored, %u with no usable texture mapping\n", label, statistics.Mirrored, statistics.Degenerate);
+}
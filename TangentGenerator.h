@@ -0,0 +1,65 @@
+#pragma once
+
+#include <vector>
+
+#include "Commons.h"
+
+//Builds per vertex tangent frames from the normals and texture coordinates. Every triangle's tangent and bitangent are
+//weighted by its area and the angle of the corner a vertex sits in, so a vertex shared by many small triangles on one side
+//isn't pulled towards them, then made perpendicular to the vertex normal with Gram-Schmidt
+namespace TangentGenerator
+{
+	//Below this a range isn't worth a thread of its own
+	const size_t c_MinTrianglesPerTask = 4096;
+	const size_t c_MinVerticesPerTask = 4096;
+
+	//Where the vertices live, each stream is read or written every Stride bytes
+	struct VertexStreams
+	{
+		const BYTE* Positions;
+		const BYTE* Normals;
+		const BYTE* TexCoords;
+		BYTE* Tangents; //XMFLOAT4, w receives the handedness
+		size_t Stride;
+		size_t Count;
+	};
+
+	struct TangentStatistics
+	{
+		UINT Degenerate = 0; //vertices whose triangles have no usable texture mapping and were given any tangent perpendicular to the normal
+		UINT Mirrored = 0; //vertices given a handedness of -1 as their texture is mirrored
+	};
+
+	//Overwrites every tangent in the streams. The handedness is +1 where cross(normal, tangent) runs along increasing v
+	//and -1 where the texture is mirrored, so the shaders can multiply the rebuilt bitangent by it
+	TangentStatistics Generate(const VertexStreams& streams, const UINT* indices, size_t indexCount);
+
+	//Writes how many vertices were mirrored or had no usable texture mapping to the debug output
+	void OutputStatistics(const WCHAR* label, const TangentStatistics& statistics);
+
+	//Any vertex type with PosL, NormL, Tex and an XMFLOAT4 Tangent member can be used
+	template<typename VertexType>
+	TangentStatistics Generate(VertexType* vertices, size_t vertexCount, const UINT* indices, size_t indexCount)
+	{
+		if (vertexCount == 0)
+		{
+			return TangentStatistics();
+		}
+
+		VertexStreams streams;
+		streams.Positions = (const BYTE*)&vertices[0].PosL;
+		streams.Normals = (const BYTE*)&vertices[0].NormL;
+		streams.TexCoords = (const BYTE*)&vertices[0].Tex;
+		streams.Tangents = (BYTE*)&vertices[0].Tangent;
+		streams.Stride = sizeof(VertexType);
+		streams.Count = vertexCount;
+
+		return Generate(streams, indices, indexCount);
+	}
+
+	template<typename VertexType>
+	TangentStatistics Generate(std::vector<VertexType>& vertices, const std::vector<UINT>& indices)
+	{
+		return Generate(vertices.data(), vertices.size(), indices.data(), indices.size());
+	}
+}
@@ -164,7 +164,7 @@ void Terrain::Draw(ID3D11DeviceContext * pImmediateContext, Light light, Camera*
 	pImmediateContext->UpdateSubresource(_pConstantBuffer, 0, nullptr, &cb, 0, 0);
 
 	pImmediateContext->IASetVertexBuffers(0, 1, &_quadPatchVertexBuffer, &stride, &offset);
-	pImmediateContext->IASetIndexBuffer(_quadPatchIndexBuffer, DXGI_FORMAT_R16_UINT, 0);
+	pImmediateContext->IASetIndexBuffer(_quadPatchIndexBuffer, _quadPatchIndexFormat, 0);
 
 	pImmediateContext->DrawIndexed(_numPatchQuadFaces * 4, 0, 0);
 }
@@ -195,7 +195,7 @@ void Terrain::DrawToShadowMap(ID3D11DeviceContext * deviceContext, ShadowMapCons
 	deviceContext->UpdateSubresource(_pConstantBuffer, 0, nullptr, &cb, 0, 0);
 
 	deviceContext->IASetVertexBuffers(0, 1, &_quadPatchVertexBuffer, &stride, &offset);
-	deviceContext->IASetIndexBuffer(_quadPatchIndexBuffer, DXGI_FORMAT_R16_UINT, 0);
+	deviceContext->IASetIndexBuffer(_quadPatchIndexBuffer, _quadPatchIndexFormat, 0);
 
 	deviceContext->DrawIndexed(_numPatchQuadFaces * 4, 0, 0);
 }
@@ -349,7 +349,7 @@ void Terrain::BuildQuadPatchVB(ID3D11Device * device)
 
 void Terrain::BuildQuadPatchIB(ID3D11Device * device)
 {
-	std::vector<USHORT> indices(_numPatchQuadFaces * 4); // 4 indices per quad face
+	std::vector<UINT> indices(_numPatchQuadFaces * 4); // 4 indices per quad face
 
 	// Iterate over each quad and compute indices.
 	int k = 0;
@@ -369,17 +369,7 @@ void Terrain::BuildQuadPatchIB(ID3D11Device * device)
 		}
 	}
 
-	D3D11_BUFFER_DESC ibd;
-	ibd.Usage = D3D11_USAGE_IMMUTABLE;
-	ibd.ByteWidth = sizeof(USHORT) * indices.size();
-	ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;
-	ibd.CPUAccessFlags = 0;
-	ibd.MiscFlags = 0;
-	ibd.StructureByteStride = 0;
-
-	D3D11_SUBRESOURCE_DATA iinitData;
-	iinitData.pSysMem = &indices[0];
-	device->CreateBuffer(&ibd, &iinitData, &_quadPatchIndexBuffer);
+	_quadPatchIndexFormat = Mesh::CreateIndexBuffer(indices, _numPatchVertices, device, &_quadPatchIndexBuffer);
 }
 
 void Terrain::BuildHeightMapSRV(ID3D11Device * device, std::vector<float> heightMap)
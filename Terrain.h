@@ -53,6 +53,7 @@ private:
 
 	ID3D11Buffer* _quadPatchVertexBuffer;
 	ID3D11Buffer* _quadPatchIndexBuffer;
+	DXGI_FORMAT _quadPatchIndexFormat;
 
 	ID3D11Buffer*        _pConstantBuffer;
 
@@ -77,7 +77,7 @@ struct VS_INPUT
 {
     float4 PosL : POSITION;
     float3 NormL : NORMAL;
-    float3 Tangent : TANGENT;
+    float4 Tangent : TANGENT; //w is the handedness
     float2 Tex : TEXCOORD0;
 };
 
@@ -86,7 +86,7 @@ struct HS_IO
     float4 Pos : POSITION0;
     float3 worldPos : POSITION1;
     float3 Norm : NORMAL;
-    float3 Tangent : TANGENT;
+    float4 Tangent : TANGENT;
     float2 Tex : TEXCOORD0;
     float TessFactor : TESS;
 };
@@ -142,7 +142,7 @@ HS_IO TesselationVS(VS_INPUT input)
     output.Norm = normalize(normalW);
 
 
-    output.Tangent = mul(input.Tangent, (float3x3) World);
+    output.Tangent = float4(mul(input.Tangent.xyz, (float3x3) World), input.Tangent.w);
 
     output.Tex = input.Tex;
 
@@ -249,9 +249,12 @@ PS_DISPLACEMENT_INPUT DisplacementDS(HS_CONSTANT_DATA_OUTPUT input, float3 Baryc
 		+ BarycentricCoordinates.y * TrianglePatch[1].Norm
 		+ BarycentricCoordinates.z * TrianglePatch[2].Norm;
 
-    float3 Tangent = BarycentricCoordinates.x * TrianglePatch[0].Tangent
-		+ BarycentricCoordinates.y * TrianglePatch[1].Tangent
-		+ BarycentricCoordinates.z * TrianglePatch[2].Tangent;
+    float3 Tangent = BarycentricCoordinates.x * TrianglePatch[0].Tangent.xyz
+		+ BarycentricCoordinates.y * TrianglePatch[1].Tangent.xyz
+		+ BarycentricCoordinates.z * TrianglePatch[2].Tangent.xyz;
+
+    //a triangle's corners share a handedness unless it straddles a mirror seam
+    float handedness = TrianglePatch[0].Tangent.w;
 
     float displacement = txDisplacement.SampleLevel(samLinear, output.Tex, 0.0f).r;
 
@@ -265,7 +268,7 @@ PS_DISPLACEMENT_INPUT DisplacementDS(HS_CONSTANT_DATA_OUTPUT input, float3 Baryc
 
     float3x3 tbnMatrix;
     tbnMatrix[0] = normalize(mul(float4(Tangent, 0.0f), World).xyz);
-    tbnMatrix[1] = normalize(mul(float4(cross(output.NormW, Tangent), 0.0f), World).xyz);
+    tbnMatrix[1] = normalize(mul(float4(cross(output.NormW, Tangent) * handedness, 0.0f), World).xyz);
     tbnMatrix[2] = normalize(output.NormW);
 
     float3 EyeVecW = (EyePosW - output.PosW).xyz;
@@ -212,7 +212,7 @@ namespace tinyxml2
 	}
 
 
-	char* StrPair::ParseName(char* p)
+	char* StrPair::ParseName(char* p, int strFlags)
 	{
 		if (!p || !(*p)) {
 			return 0;
@@ -227,37 +227,42 @@ namespace tinyxml2
 			++p;
 		}
 
-		Set(start, p, 0);
+		Set(start, p, strFlags);
 		return p;
 	}
 
 
-	void StrPair::CollapseWhitespace()
+	bool StrPair::NameEquals(StrPair& other)
 	{
-		// Adjusting _start would cause undefined behavior on delete[]
-		TIXMLASSERT((_flags & NEEDS_DELETE) == 0);
-		// Trim leading space.
-		_start = XMLUtil::SkipWhiteSpace(_start, 0);
+		if ((_flags & NEEDS_FLUSH) && (other._flags & NEEDS_FLUSH)) {
+			const size_t length = _end - _start;
+			return length == (size_t)(other._end - other._start) && memcmp(_start, other._start, length) == 0;
+		}
+		return XMLUtil::StringEqual(GetStr(), other.GetStr());
+	}
 
-		if (*_start) {
-			const char* p = _start;	// the read pointer
-			char* q = _start;	// the write pointer
 
-			while (*p) {
-				if (XMLUtil::IsWhiteSpace(*p)) {
-					p = XMLUtil::SkipWhiteSpace(p, 0);
-					if (*p == 0) {
-						break;    // don't write to q; this trims the trailing space.
-					}
-					*q = ' ';
-					++q;
+	void StrPair::CollapseWhitespace()
+	{
+		// Trim leading space. The characters move rather than _start, which
+		// may have to be deleted if they were copied out of an in situ buffer.
+		const char* p = XMLUtil::SkipWhiteSpace(_start, 0);	// the read pointer
+		char* q = _start;	// the write pointer
+
+		while (*p) {
+			if (XMLUtil::IsWhiteSpace(*p)) {
+				p = XMLUtil::SkipWhiteSpace(p, 0);
+				if (*p == 0) {
+					break;    // don't write to q; this trims the trailing space.
 				}
-				*q = *p;
+				*q = ' ';
 				++q;
-				++p;
 			}
-			*q = 0;
+			*q = *p;
+			++q;
+			++p;
 		}
+		*q = 0;
 	}
 
 
@@ -266,6 +271,15 @@ namespace tinyxml2
 		TIXMLASSERT(_start);
 		TIXMLASSERT(_end);
 		if (_flags & NEEDS_FLUSH) {
+			if (_flags & IN_SITU) {
+				// the buffer is read only, so the characters are processed in a copy of their own
+				const size_t length = _end - _start;
+				char* copy = new char[length + 1];
+				memcpy(copy, _start, length);
+				_start = copy;
+				_end = copy + length;
+				_flags = (_flags & ~IN_SITU) | NEEDS_DELETE;
+			}
 			*_end = 0;
 			_flags ^= NEEDS_FLUSH;
 
@@ -364,6 +378,96 @@ namespace tinyxml2
 
 
 
+	// --------- XMLArena ----------- //
+
+	XMLArena::XMLArena(size_t chunkSize) :
+		_first(0),
+		_current(0),
+		_cursor(0),
+		_chunkSize(chunkSize),
+		_used(0),
+		_capacity(0),
+		_nChunks(0),
+		_nAllocs(0)
+	{
+	}
+
+
+	XMLArena::~XMLArena()
+	{
+		Release();
+	}
+
+
+	char* XMLArena::Begin(Chunk* chunk)
+	{
+		// the chunk's own allocation is only aligned for the header
+		const uintptr_t data = reinterpret_cast<uintptr_t>(chunk + 1);
+		return reinterpret_cast<char*>((data + ALIGNMENT - 1) & ~(uintptr_t)(ALIGNMENT - 1));
+	}
+
+
+	void* XMLArena::Allocate(size_t size)
+	{
+		size = (size + ALIGNMENT - 1) & ~(size_t)(ALIGNMENT - 1);
+
+		while (!_current || size > (size_t)(_current->end - _cursor)) {
+			// move on to the chunk kept from before the last reset, unless it's too small for this
+			Chunk* next = _current ? _current->next : _first;
+			if (!next || size > (size_t)(next->end - Begin(next))) {
+				const size_t chunkSize = size > _chunkSize ? size : _chunkSize;
+				const size_t bytes = sizeof(Chunk) + ALIGNMENT + chunkSize;
+				Chunk* chunk = reinterpret_cast<Chunk*>(new char[bytes]);
+				chunk->end = Begin(chunk) + chunkSize;
+
+				if (_current) {
+					chunk->next = _current->next;
+					_current->next = chunk;
+				}
+				else {
+					chunk->next = _first;
+					_first = chunk;
+				}
+				_capacity += chunkSize;
+				++_nChunks;
+				next = chunk;
+			}
+			_current = next;
+			_cursor = Begin(next);
+		}
+
+		void* result = _cursor;
+		_cursor += size;
+		_used += size;
+		++_nAllocs;
+		return result;
+	}
+
+
+	void XMLArena::Reset()
+	{
+		_current = 0;
+		_cursor = 0;
+		_used = 0;
+		_nAllocs = 0;
+	}
+
+
+	void XMLArena::Release()
+	{
+		while (_first) {
+			Chunk* next = _first->next;
+			delete[] reinterpret_cast<char*>(_first);
+			_first = next;
+		}
+		_capacity = 0;
+		_nChunks = 0;
+		Reset();
+	}
+
+
+
+
 	// --------- XMLUtil ----------- //
 
 	const char* XMLUtil::writeBoolTrue = "true";
@@ -1081,7 +1185,7 @@ namespace tinyxml2
 					if (ele->ClosingType() != XMLElement::OPEN) {
 						mismatch = true;
 					}
-					else if (!XMLUtil::StringEqual(endTag.GetStr(), ele->Name())) {
+					else if (!endTag.NameEquals(ele->_value)) {
 						mismatch = true;
 					}
 				}
@@ -1144,14 +1248,14 @@ namespace tinyxml2
 	char* XMLText::ParseDeep(char* p, StrPair*, int* curLineNumPtr)
 	{
 		if (this->CData()) {
-			p = _value.ParseText(p, "]]>", StrPair::NEEDS_NEWLINE_NORMALIZATION, curLineNumPtr);
+			p = _value.ParseText(p, "]]>", StrPair::NEEDS_NEWLINE_NORMALIZATION | _document->_inSituFlag, curLineNumPtr);
 			if (!p) {
 				_document->SetError(XML_ERROR_PARSING_CDATA, _parseLineNum, 0);
 			}
 			return p;
 		}
 		else {
-			int flags = _document->ProcessEntities() ? StrPair::TEXT_ELEMENT : StrPair::TEXT_ELEMENT_LEAVE_ENTITIES;
+			int flags = (_document->ProcessEntities() ? StrPair::TEXT_ELEMENT : StrPair::TEXT_ELEMENT_LEAVE_ENTITIES) | _document->_inSituFlag;
 			if (_document->WhitespaceMode() == COLLAPSE_WHITESPACE) {
 				flags |= StrPair::NEEDS_WHITESPACE_COLLAPSING;
 			}
@@ -1209,7 +1313,7 @@ namespace tinyxml2
 	char* XMLComment::ParseDeep(char* p, StrPair*, int* curLineNumPtr)
 	{
 		// Comment parses as text.
-		p = _value.ParseText(p, "-->", StrPair::COMMENT, curLineNumPtr);
+		p = _value.ParseText(p, "-->", StrPair::COMMENT | _document->_inSituFlag, curLineNumPtr);
 		if (p == 0) {
 			_document->SetError(XML_ERROR_PARSING_COMMENT, _parseLineNum, 0);
 		}
@@ -1258,7 +1362,7 @@ namespace tinyxml2
 	char* XMLDeclaration::ParseDeep(char* p, StrPair*, int* curLineNumPtr)
 	{
 		// Declaration parses as text.
-		p = _value.ParseText(p, "?>", StrPair::NEEDS_NEWLINE_NORMALIZATION, curLineNumPtr);
+		p = _value.ParseText(p, "?>", StrPair::NEEDS_NEWLINE_NORMALIZATION | _document->_inSituFlag, curLineNumPtr);
 		if (p == 0) {
 			_document->SetError(XML_ERROR_PARSING_DECLARATION, _parseLineNum, 0);
 		}
@@ -1306,7 +1410,7 @@ namespace tinyxml2
 	char* XMLUnknown::ParseDeep(char* p, StrPair*, int* curLineNumPtr)
 	{
 		// Unknown parses as text.
-		p = _value.ParseText(p, ">", StrPair::NEEDS_NEWLINE_NORMALIZATION, curLineNumPtr);
+		p = _value.ParseText(p, ">", StrPair::NEEDS_NEWLINE_NORMALIZATION | _document->_inSituFlag, curLineNumPtr);
 		if (!p) {
 			_document->SetError(XML_ERROR_PARSING_UNKNOWN, _parseLineNum, 0);
 		}
@@ -1350,10 +1454,10 @@ namespace tinyxml2
 		return _value.GetStr();
 	}
 
-	char* XMLAttribute::ParseDeep(char* p, bool processEntities, int* curLineNumPtr)
+	char* XMLAttribute::ParseDeep(char* p, bool processEntities, int inSituFlag, int* curLineNumPtr)
 	{
 		// Parse using the name rules: bug fix, was using ParseText before
-		p = _name.ParseName(p);
+		p = _name.ParseName(p, inSituFlag);
 		if (!p || !*p) {
 			return 0;
 		}
@@ -1373,7 +1477,7 @@ namespace tinyxml2
 		char endTag[2] = { *p, 0 };
 		++p;	// move past opening quote
 
-		p = _value.ParseText(p, endTag, processEntities ? StrPair::ATTRIBUTE_VALUE : StrPair::ATTRIBUTE_VALUE_LEAVE_ENTITIES, curLineNumPtr);
+		p = _value.ParseText(p, endTag, (processEntities ? StrPair::ATTRIBUTE_VALUE : StrPair::ATTRIBUTE_VALUE_LEAVE_ENTITIES) | inSituFlag, curLineNumPtr);
 		return p;
 	}
 
@@ -1829,8 +1933,14 @@ namespace tinyxml2
 
 				int attrLineNum = attrib->_parseLineNum;
 
-				p = attrib->ParseDeep(p, _document->ProcessEntities(), curLineNumPtr);
-				if (!p || Attribute(attrib->Name())) {
+				p = attrib->ParseDeep(p, _document->ProcessEntities(), _document->_inSituFlag, curLineNumPtr);
+
+				// duplicates are found by comparing the names where they are, reading them would copy or write them
+				bool duplicate = false;
+				for (XMLAttribute* a = _rootAttribute; p && a && !duplicate; a = a->_next) {
+					duplicate = a->_name.NameEquals(attrib->_name);
+				}
+				if (!p || duplicate) {
 					DeleteAttribute(attrib);
 					_document->SetError(XML_ERROR_PARSING_ATTRIBUTE, attrLineNum, "XMLElement name=%s", Name());
 					return 0;
@@ -1905,7 +2015,7 @@ namespace tinyxml2
 			++p;
 		}
 
-		p = _value.ParseName(p);
+		p = _value.ParseName(p, _document->_inSituFlag);
 		if (_value.Empty()) {
 			return 0;
 		}
@@ -2009,9 +2119,12 @@ namespace tinyxml2
 		_errorStr(),
 		_errorLineNum(0),
 		_charBuffer(0),
+		_inSituFlag(0),
 		_parseCurLineNum(0),
 		_parsingDepth(0),
 		_unlinked(),
+		_ownArena(),
+		_arena(&_ownArena),
 		_elementPool(),
 		_attributePool(),
 		_textPool(),
@@ -2019,6 +2132,11 @@ namespace tinyxml2
 	{
 		// avoid VC++ C4355 warning about 'this' in initializer list (C4355 is off by default in VS2012+)
 		_document = this;
+
+		_elementPool.SetArena(_arena);
+		_attributePool.SetArena(_arena);
+		_textPool.SetArena(_arena);
+		_commentPool.SetArena(_arena);
 	}
 
 
@@ -2055,6 +2173,7 @@ namespace tinyxml2
 
 		delete[] _charBuffer;
 		_charBuffer = 0;
+		_inSituFlag = 0;
 		_parsingDepth = 0;
 
 #if 0
@@ -2072,6 +2191,41 @@ namespace tinyxml2
 			TIXMLASSERT(_commentPool.CurrentAllocs() == _commentPool.Untracked());
 		}
 #endif
+
+		// every node is gone, so the memory goes back in one step rather than item by item
+		_elementPool.Clear();
+		_attributePool.Clear();
+		_textPool.Clear();
+		_commentPool.Clear();
+		if (_arena == &_ownArena) {
+			_ownArena.Reset();
+		}
+	}
+
+
+	void XMLDocument::SetArena(XMLArena* arena)
+	{
+		Clear();
+
+		_arena = arena ? arena : &_ownArena;
+		_elementPool.SetArena(_arena);
+		_attributePool.SetArena(_arena);
+		_textPool.SetArena(_arena);
+		_commentPool.SetArena(_arena);
+	}
+
+
+	void XMLDocument::GetAllocationStats(XMLAllocationStats* stats) const
+	{
+		TIXMLASSERT(stats);
+		stats->elements = _elementPool.CurrentAllocs();
+		stats->attributes = _attributePool.CurrentAllocs();
+		stats->texts = _textPool.CurrentAllocs();
+		stats->comments = _commentPool.CurrentAllocs();
+		stats->nodeAllocations = _elementPool.TotalAllocs() + _attributePool.TotalAllocs() + _textPool.TotalAllocs() + _commentPool.TotalAllocs();
+		stats->arenaUsed = _arena->Used();
+		stats->arenaCapacity = _arena->Capacity();
+		stats->arenaChunks = _arena->Chunks();
 	}
 
 
@@ -2244,7 +2398,7 @@ namespace tinyxml2
 
 		_charBuffer[size] = 0;
 
-		Parse();
+		Parse(_charBuffer);
 		return _errorID;
 	}
 
@@ -2295,7 +2449,7 @@ namespace tinyxml2
 		memcpy(_charBuffer, p, len);
 		_charBuffer[len] = 0;
 
-		Parse();
+		Parse(_charBuffer);
 		if (Error()) {
 			// clean up now essentially dangling memory.
 			// and the parse fail can put objects in the
@@ -2310,6 +2464,30 @@ namespace tinyxml2
 	}
 
 
+	XMLError XMLDocument::ParseInSitu(const char* xml, size_t nBytes)
+	{
+		Clear();
+
+		if (nBytes == 0 || !xml || !*xml) {
+			SetError(XML_ERROR_EMPTY_DOCUMENT, 0, 0);
+			return _errorID;
+		}
+		TIXMLASSERT(xml[nBytes] == 0);
+
+		// nothing is written through this pointer, the flag makes every string copy itself out before it's processed
+		_inSituFlag = StrPair::IN_SITU;
+		Parse(const_cast<char*>(xml));
+		if (Error()) {
+			DeleteChildren();
+			_elementPool.Clear();
+			_attributePool.Clear();
+			_textPool.Clear();
+			_commentPool.Clear();
+		}
+		return _errorID;
+	}
+
+
 	void XMLDocument::Print(XMLPrinter* streamer) const
 	{
 		if (streamer) {
@@ -2374,13 +2552,12 @@ namespace tinyxml2
 		return ErrorIDToName(_errorID);
 	}
 
-	void XMLDocument::Parse()
+	void XMLDocument::Parse(char* p)
 	{
 		TIXMLASSERT(NoChildren()); // Clear() must have been called previously
-		TIXMLASSERT(_charBuffer);
+		TIXMLASSERT(p);
 		_parseCurLineNum = 1;
 		_parseLineNum = 1;
-		char* p = _charBuffer;
 		p = XMLUtil::SkipWhiteSpace(p, &_parseCurLineNum);
 		p = const_cast<char*>(XMLUtil::ReadBOM(p, &_writeBOM));
 		if (!*p) {
@@ -2831,4 +3008,335 @@ namespace tinyxml2
 		return true;
 	}
 
+
+	bool XMLSpan::Equals(const char* str) const
+	{
+		TIXMLASSERT(str);
+		size_t length = strlen(str);
+		return _start && length == Length() && memcmp(_start, str, length) == 0;
+	}
+
+
+	XMLPullReader::XMLPullReader(const char* xml, size_t nBytes) :
+		_begin(xml),
+		_p(xml),
+		_end(xml + nBytes),
+		_event(PULL_START_ELEMENT),
+		_depth(0),
+		_closeEmptyElement(false),
+		_errorID(XML_SUCCESS)
+	{
+		if (!xml || nBytes == 0) {
+			_end = _begin = _p = 0;
+			SetError(XML_ERROR_EMPTY_DOCUMENT);
+			return;
+		}
+
+		static const char bom[] = { (char)TIXML_UTF_LEAD_0, (char)TIXML_UTF_LEAD_1, (char)TIXML_UTF_LEAD_2 };
+		if (nBytes >= 3 && memcmp(_p, bom, 3) == 0) {
+			_p += 3;
+		}
+	}
+
+
+	XMLPullReader::Event XMLPullReader::SetError(XMLError error)
+	{
+		_errorID = error;
+		_event = PULL_ERROR;
+		return _event;
+	}
+
+
+	const char* XMLPullReader::Find(const char* sequence) const
+	{
+		size_t length = strlen(sequence);
+		for (const char* p = _p; _end - p >= (ptrdiff_t)length; ++p) {
+			p = (const char*)memchr(p, sequence[0], (size_t)(_end - p));
+			if (!p || _end - p < (ptrdiff_t)length) {
+				break;
+			}
+			if (memcmp(p, sequence, length) == 0) {
+				return p;
+			}
+		}
+		return 0;
+	}
+
+
+	const char* XMLPullReader::SkipWhiteSpace(const char* p) const
+	{
+		while (p < _end && XMLUtil::IsWhiteSpace(*p)) {
+			++p;
+		}
+		return p;
+	}
+
+
+	const char* XMLPullReader::ReadName(const char* p) const
+	{
+		if (p >= _end || !XMLUtil::IsNameStartChar((unsigned char)*p)) {
+			return p;
+		}
+		++p;
+		while (p < _end && XMLUtil::IsNameChar((unsigned char)*p)) {
+			++p;
+		}
+		return p;
+	}
+
+
+	XMLPullReader::Event XMLPullReader::Next()
+	{
+		if (_event == PULL_END_DOCUMENT || _event == PULL_ERROR) {
+			return _event;
+		}
+
+		_text = XMLSpan();
+		_attributes = XMLSpan();
+
+		if (_closeEmptyElement) {
+			_closeEmptyElement = false;
+			--_depth;
+			_event = PULL_END_ELEMENT;
+			return _event;
+		}
+
+		while (_p < _end) {
+			if (*_p != '<') {
+				const char* textEnd = (const char*)memchr(_p, '<', (size_t)(_end - _p));
+				if (!textEnd) {
+					textEnd = _end;
+				}
+
+				XMLSpan text(_p, textEnd);
+				_p = textEnd;
+
+				if (SkipWhiteSpace(text.Start()) != text.End()) {
+					_text = text;
+					_event = PULL_TEXT;
+					return _event;
+				}
+				continue;
+			}
+
+			size_t remaining = (size_t)(_end - _p);
+
+			if (remaining >= 4 && memcmp(_p, "<!--", 4) == 0) {
+				const char* commentEnd = Find("-->");
+				if (!commentEnd) {
+					return SetError(XML_ERROR_PARSING_COMMENT);
+				}
+				_p = commentEnd + 3;
+				continue;
+			}
+
+			if (remaining >= 9 && memcmp(_p, "<![CDATA[", 9) == 0) {
+				_p += 9;
+				const char* cdataEnd = Find("]]>");
+				if (!cdataEnd) {
+					return SetError(XML_ERROR_PARSING_CDATA);
+				}
+				_text = XMLSpan(_p, cdataEnd);
+				_p = cdataEnd + 3;
+				_event = PULL_TEXT;
+				return _event;
+			}
+
+			if (remaining >= 2 && _p[1] == '?') {
+				const char* declarationEnd = Find("?>");
+				if (!declarationEnd) {
+					return SetError(XML_ERROR_PARSING_DECLARATION);
+				}
+				_p = declarationEnd + 2;
+				continue;
+			}
+
+			if (remaining >= 2 && _p[1] == '!') {
+				const char* unknownEnd = Find(">");
+				if (!unknownEnd) {
+					return SetError(XML_ERROR_PARSING_UNKNOWN);
+				}
+				_p = unknownEnd + 1;
+				continue;
+			}
+
+			if (remaining >= 2 && _p[1] == '/') {
+				const char* nameStart = _p + 2;
+				const char* nameEnd = ReadName(nameStart);
+				const char* p = SkipWhiteSpace(nameEnd);
+
+				if (nameStart == nameEnd || p >= _end || *p != '>') {
+					return SetError(XML_ERROR_PARSING_ELEMENT);
+				}
+
+				_name = XMLSpan(nameStart, nameEnd);
+				if (_depth == 0 || _openElements[_depth - 1].Length() != _name.Length() ||
+					memcmp(_openElements[_depth - 1].Start(), nameStart, _name.Length()) != 0) {
+					return SetError(XML_ERROR_MISMATCHED_ELEMENT);
+				}
+
+				_p = p + 1;
+				--_depth;
+				_event = PULL_END_ELEMENT;
+				return _event;
+			}
+
+			const char* nameStart = _p + 1;
+			const char* nameEnd = ReadName(nameStart);
+			if (nameStart == nameEnd) {
+				return SetError(XML_ERROR_PARSING_ELEMENT);
+			}
+
+			// the attributes are only checked here, Attribute() finds them again when asked
+			const char* p = nameEnd;
+			bool emptyElement = false;
+			for (;;) {
+				const char* attributeStart = SkipWhiteSpace(p);
+				if (attributeStart >= _end) {
+					return SetError(XML_ERROR_PARSING_ELEMENT);
+				}
+				if (*attributeStart == '>') {
+					_attributes = XMLSpan(nameEnd, attributeStart);
+					p = attributeStart + 1;
+					break;
+				}
+				if (*attributeStart == '/') {
+					if (attributeStart + 1 >= _end || attributeStart[1] != '>') {
+						return SetError(XML_ERROR_PARSING_ELEMENT);
+					}
+					_attributes = XMLSpan(nameEnd, attributeStart);
+					p = attributeStart + 2;
+					emptyElement = true;
+					break;
+				}
+
+				// a value has to be separated from the name or value before it
+				const char* attributeNameEnd = ReadName(attributeStart);
+				if (attributeStart == p || attributeNameEnd == attributeStart) {
+					return SetError(XML_ERROR_PARSING_ATTRIBUTE);
+				}
+
+				const char* equals = SkipWhiteSpace(attributeNameEnd);
+				const char* quote = equals < _end && *equals == '=' ? SkipWhiteSpace(equals + 1) : _end;
+				if (quote >= _end || (*quote != '"' && *quote != '\'')) {
+					return SetError(XML_ERROR_PARSING_ATTRIBUTE);
+				}
+
+				const char* valueEnd = (const char*)memchr(quote + 1, *quote, (size_t)(_end - quote - 1));
+				if (!valueEnd) {
+					return SetError(XML_ERROR_PARSING_ATTRIBUTE);
+				}
+				p = valueEnd + 1;
+			}
+
+			if (_depth >= TINYXML2_MAX_ELEMENT_DEPTH) {
+				return SetError(XML_ELEMENT_DEPTH_EXCEEDED);
+			}
+
+			_name = XMLSpan(nameStart, nameEnd);
+			_openElements[_depth++] = _name;
+			_closeEmptyElement = emptyElement;
+			_p = p;
+			_event = PULL_START_ELEMENT;
+			return _event;
+		}
+
+		if (_depth > 0) {
+			return SetError(XML_ERROR_PARSING);
+		}
+		_event = PULL_END_DOCUMENT;
+		return _event;
+	}
+
+
+	XMLSpan XMLPullReader::Attribute(const char* name) const
+	{
+		if (_event != PULL_START_ELEMENT || !_attributes.Start()) {
+			return XMLSpan();
+		}
+
+		// Next() already checked the attributes so they can be walked without bounds checks
+		const char* p = _attributes.Start();
+		const char* end = _attributes.End();
+		for (;;) {
+			p = SkipWhiteSpace(p);
+			if (p >= end) {
+				return XMLSpan();
+			}
+
+			const char* nameEnd = ReadName(p);
+			XMLSpan attributeName(p, nameEnd);
+
+			const char* quote = SkipWhiteSpace(SkipWhiteSpace(nameEnd) + 1);
+			const char* valueEnd = (const char*)memchr(quote + 1, *quote, (size_t)(end - quote - 1));
+
+			if (attributeName.Equals(name)) {
+				return XMLSpan(quote + 1, valueEnd);
+			}
+			p = valueEnd + 1;
+		}
+	}
+
+
+	unsigned XMLPullReader::UnsignedAttribute(const char* name, unsigned defaultValue) const
+	{
+		// the value is copied out because the conversions need it null terminated and the buffer may not be
+		XMLSpan value = Attribute(name);
+		char buffer[64];
+		if (!value.Start() || value.Length() >= sizeof(buffer)) {
+			return defaultValue;
+		}
+		memcpy(buffer, value.Start(), value.Length());
+		buffer[value.Length()] = 0;
+
+		unsigned result = defaultValue;
+		return XMLUtil::ToUnsigned(buffer, &result) ? result : defaultValue;
+	}
+
+
+	float XMLPullReader::FloatAttribute(const char* name, float defaultValue) const
+	{
+		XMLSpan value = Attribute(name);
+		char buffer[64];
+		if (!value.Start() || value.Length() >= sizeof(buffer)) {
+			return defaultValue;
+		}
+		memcpy(buffer, value.Start(), value.Length());
+		buffer[value.Length()] = 0;
+
+		float result = defaultValue;
+		return XMLUtil::ToFloat(buffer, &result) ? result : defaultValue;
+	}
+
+
+	XMLSpan XMLPullReader::ReadElementText()
+	{
+		TIXMLASSERT(_event == PULL_START_ELEMENT);
+		int depth = _depth;
+		XMLSpan text;
+
+		while (Next() != PULL_END_DOCUMENT && _event != PULL_ERROR) {
+			if (_event == PULL_TEXT && !text.Start()) {
+				text = _text;
+			}
+			else if (_event == PULL_END_ELEMENT && _depth < depth) {
+				break;
+			}
+		}
+		return text;
+	}
+
+
+	void XMLPullReader::SkipElement()
+	{
+		TIXMLASSERT(_event == PULL_START_ELEMENT);
+		int depth = _depth;
+
+		while (Next() != PULL_END_DOCUMENT && _event != PULL_ERROR) {
+			if (_event == PULL_END_ELEMENT && _depth < depth) {
+				break;
+			}
+		}
+	}
+
 }   // namespace tinyxml2
@@ -132,6 +132,8 @@ namespace tinyxml2
 			NEEDS_ENTITY_PROCESSING = 0x01,
 			NEEDS_NEWLINE_NORMALIZATION = 0x02,
 			NEEDS_WHITESPACE_COLLAPSING = 0x04,
+			// the characters are in a buffer the document mustn't write to, so they're copied out when first read
+			IN_SITU = 0x08,
 
 			TEXT_ELEMENT = NEEDS_ENTITY_PROCESSING | NEEDS_NEWLINE_NORMALIZATION,
 			TEXT_ELEMENT_LEAVE_ENTITIES = NEEDS_NEWLINE_NORMALIZATION,
@@ -167,7 +169,11 @@ namespace tinyxml2
 		void SetStr(const char* str, int flags = 0);
 
 		char* ParseText(char* in, const char* endTag, int strFlags, int* curLineNumPtr);
-		char* ParseName(char* in);
+		char* ParseName(char* in, int strFlags = 0);
+
+		// Compares two names. Names that haven't been read yet are compared where they
+		// are, so the parser can match tags without writing to or copying the buffer.
+		bool NameEquals(StrPair& other);
 
 		void TransferTo(StrPair* other);
 		void Reset();
@@ -315,6 +321,76 @@ namespace tinyxml2
 	};
 
 
+	/**
+	A chunked bump allocator that document nodes are carved out of. Chunks are
+	allocated as they're needed and kept until Release(), so Reset() rewinds the
+	whole arena in constant time and the next document reuses the same memory
+	without going back to the heap.
+
+	An arena can be shared by documents that are loaded one after another, see
+	XMLDocument::SetArena(). It doesn't run destructors, so it must only be reset
+	once every document allocating from it has been cleared or destroyed.
+	*/
+	class TINYXML2_LIB XMLArena
+	{
+	public:
+		explicit XMLArena(size_t chunkSize = DEFAULT_CHUNK_SIZE);
+		~XMLArena();
+
+		/// Returns size bytes aligned to ALIGNMENT. Requests bigger than a chunk get a chunk of their own.
+		void* Allocate(size_t size);
+		/// Makes all the memory available again without freeing any of it.
+		void Reset();
+		/// Frees every chunk.
+		void Release();
+
+		/// The size of chunks allocated from now on.
+		void SetChunkSize(size_t chunkSize) {
+			_chunkSize = chunkSize;
+		}
+		size_t ChunkSize() const {
+			return _chunkSize;
+		}
+		/// Bytes handed out since the last Reset().
+		size_t Used() const {
+			return _used;
+		}
+		/// Bytes held in chunks.
+		size_t Capacity() const {
+			return _capacity;
+		}
+		int Chunks() const {
+			return _nChunks;
+		}
+		/// Allocations since the last Reset().
+		int Allocations() const {
+			return _nAllocs;
+		}
+
+		enum { DEFAULT_CHUNK_SIZE = 64 * 1024, ALIGNMENT = 16 };
+
+	private:
+		XMLArena(const XMLArena&); // not supported
+		void operator=(const XMLArena&); // not supported
+
+		struct Chunk {
+			Chunk*	next;
+			char*	end;
+		};
+		static char* Begin(Chunk* chunk);
+
+		Chunk*	_first;
+		Chunk*	_current;	// null before the first allocation after a reset
+		char*	_cursor;
+
+		size_t	_chunkSize;
+		size_t	_used;
+		size_t	_capacity;
+		int		_nChunks;
+		int		_nAllocs;
+	};
+
+
 	/*
 	Parent virtual class of a pool for fast allocation
 	and deallocation of objects.
@@ -334,22 +410,24 @@ namespace tinyxml2
 
 	/*
 	Template child class to create pools of the correct type.
+	Items are carved out of an arena, which owns their memory, and freed
+	items are kept on a list for reuse. Clear() only forgets them.
 	*/
 	template< int ITEM_SIZE >
 	class MemPoolT : public MemPool
 	{
 	public:
-		MemPoolT() : _blockPtrs(), _root(0), _currentAllocs(0), _nAllocs(0), _maxAllocs(0), _nUntracked(0) {}
+		MemPoolT() : _arena(0), _root(0), _currentAllocs(0), _nAllocs(0), _maxAllocs(0), _nUntracked(0) {}
 		~MemPoolT() {
 			MemPoolT< ITEM_SIZE >::Clear();
 		}
 
+		void SetArena(XMLArena* arena) {
+			MemPoolT< ITEM_SIZE >::Clear();
+			_arena = arena;
+		}
+
 		void Clear() {
-			// Delete the blocks.
-			while (!_blockPtrs.Empty()) {
-				Block* lastBlock = _blockPtrs.Pop();
-				delete lastBlock;
-			}
 			_root = 0;
 			_currentAllocs = 0;
 			_nAllocs = 0;
@@ -363,23 +441,23 @@ namespace tinyxml2
 		int CurrentAllocs() const {
 			return _currentAllocs;
 		}
+		int TotalAllocs() const {
+			return _nAllocs;
+		}
+		int MaxAllocs() const {
+			return _maxAllocs;
+		}
 
 		virtual void* Alloc() {
-			if (!_root) {
-				// Need a new block.
-				Block* block = new Block();
-				_blockPtrs.Push(block);
-
-				Item* blockItems = block->items;
-				for (int i = 0; i < ITEMS_PER_BLOCK - 1; ++i) {
-					blockItems[i].next = &(blockItems[i + 1]);
-				}
-				blockItems[ITEMS_PER_BLOCK - 1].next = 0;
-				_root = blockItems;
+			Item* result = _root;
+			if (result) {
+				_root = _root->next;
+			}
+			else {
+				TIXMLASSERT(_arena);
+				result = static_cast<Item*>(_arena->Allocate(sizeof(Item)));
 			}
-			Item* const result = _root;
 			TIXMLASSERT(result != 0);
-			_root = _root->next;
 
 			++_currentAllocs;
 			if (_currentAllocs > _maxAllocs) {
@@ -403,9 +481,9 @@ namespace tinyxml2
 			_root = item;
 		}
 		void Trace(const char* name) {
-			printf("Mempool %s watermark=%d [%dk] current=%d size=%d nAlloc=%d blocks=%d\n",
+			printf("Mempool %s watermark=%d [%dk] current=%d size=%d nAlloc=%d\n",
 				name, _maxAllocs, _maxAllocs * ITEM_SIZE / 1024, _currentAllocs,
-				ITEM_SIZE, _nAllocs, _blockPtrs.Size());
+				ITEM_SIZE, _nAllocs);
 		}
 
 		void SetTracked() {
@@ -416,19 +494,6 @@ namespace tinyxml2
 			return _nUntracked;
 		}
 
-		// This number is perf sensitive. 4k seems like a good tradeoff on my machine.
-		// The test file is large, 170k.
-		// Release:		VS2010 gcc(no opt)
-		//		1k:		4000
-		//		2k:		4000
-		//		4k:		3900	21000
-		//		16k:	5200
-		//		32k:	4300
-		//		64k:	4000	21000
-		// Declared public because some compilers do not accept to use ITEMS_PER_BLOCK
-		// in private part if ITEMS_PER_BLOCK is private
-		enum { ITEMS_PER_BLOCK = (4 * 1024) / ITEM_SIZE };
-
 	private:
 		MemPoolT(const MemPoolT&); // not supported
 		void operator=(const MemPoolT&); // not supported
@@ -437,10 +502,7 @@ namespace tinyxml2
 			Item*   next;
 			char    itemData[ITEM_SIZE];
 		};
-		struct Block {
-			Item items[ITEMS_PER_BLOCK];
-		};
-		DynArray< Block*, 10 > _blockPtrs;
+		XMLArena* _arena;
 		Item* _root;
 
 		int _currentAllocs;
@@ -450,6 +512,20 @@ namespace tinyxml2
 	};
 
 
+	/// Node counts of a document and the memory of the arena they're allocated from.
+	struct XMLAllocationStats
+	{
+		int		elements;		// nodes of each kind currently allocated
+		int		attributes;
+		int		texts;
+		int		comments;		// comments, declarations and unknowns share a pool
+		int		nodeAllocations;	// every node allocated since the document was last cleared
+		size_t	arenaUsed;
+		size_t	arenaCapacity;
+		int		arenaChunks;
+	};
+
+
 
 	/**
 	Implements the interface to the "Visitor pattern" (see the Accept() method.)
@@ -1199,7 +1275,7 @@ namespace tinyxml2
 		void operator=(const XMLAttribute&);	// not supported
 		void SetName(const char* name);
 
-		char* ParseDeep(char* p, bool processEntities, int* curLineNumPtr);
+		char* ParseDeep(char* p, bool processEntities, int inSituFlag, int* curLineNumPtr);
 
 		mutable StrPair _name;
 		mutable StrPair _value;
@@ -1633,6 +1709,20 @@ namespace tinyxml2
 		*/
 		XMLError Parse(const char* xml, size_t nBytes = (size_t)(-1));
 
+		/**
+		Parse an XML buffer where it is, without copying it. The buffer is never
+		written to, so it can be a read only file mapping, but it must stay valid
+		and unchanged until the document is cleared or destroyed, and the byte at
+		xml[nBytes] must be readable and zero. A mapping has that whenever the file
+		doesn't fill its last page exactly.
+
+		Names, values and text are left as ranges of the buffer. Each is copied
+		out, with its entities decoded and newlines normalized, the first time it
+		is read, so a document costs only its nodes plus the strings actually used.
+		Returns XML_SUCCESS (0) on success, or an errorID.
+		*/
+		XMLError ParseInSitu(const char* xml, size_t nBytes);
+
 		/**
 		Load an XML file from disk.
 		Returns XML_SUCCESS (0) on success, or
@@ -1785,6 +1875,20 @@ namespace tinyxml2
 		/// Clear the document, resetting it to the initial state.
 		void Clear();
 
+		/**
+		Allocate nodes from an arena the caller owns instead of the document's
+		own, so a batch of files loaded one after another can share one warmed
+		arena. The document is cleared first. Pass null to go back to its own
+		arena, which is reset whenever the document is cleared. An external
+		arena is only ever reset by its owner.
+		*/
+		void SetArena(XMLArena* arena);
+		/// The arena nodes are allocated from, to size its chunks or read its statistics.
+		XMLArena* Arena() {
+			return _arena;
+		}
+		void GetAllocationStats(XMLAllocationStats* stats) const;
+
 		/**
 		Copies this document to a target document.
 		The target will be completely cleared before the copy.
@@ -1817,6 +1921,7 @@ namespace tinyxml2
 		mutable StrPair	_errorStr;
 		int             _errorLineNum;
 		char*			_charBuffer;
+		int				_inSituFlag;	// StrPair::IN_SITU when parsing a buffer the document doesn't own
 		int				_parseCurLineNum;
 		int				_parsingDepth;
 		// Memory tracking does add some overhead.
@@ -1827,6 +1932,8 @@ namespace tinyxml2
 		// and the performance is the same.
 		DynArray<XMLNode*, 10> _unlinked;
 
+		XMLArena						 _ownArena;
+		XMLArena*						 _arena;
 		MemPoolT< sizeof(XMLElement) >	 _elementPool;
 		MemPoolT< sizeof(XMLAttribute) > _attributePool;
 		MemPoolT< sizeof(XMLText) >		 _textPool;
@@ -1834,7 +1941,7 @@ namespace tinyxml2
 
 		static const char* _errorNames[XML_ERROR_COUNT];
 
-		void Parse();
+		void Parse(char* p);
 
 		void SetError(XMLError error, int lineNum, const char* format, ...);
 
@@ -2224,6 +2331,160 @@ namespace tinyxml2
 	};
 
 
+	/**
+	A range of characters inside the buffer an XMLPullReader is reading. Nothing is
+	copied or decoded, so entities are left as they appear in the source and the
+	span is not null terminated. A span that was never found has a null Start().
+	*/
+	class TINYXML2_LIB XMLSpan
+	{
+	public:
+		XMLSpan() : _start(0), _end(0) {}
+		XMLSpan(const char* start, const char* end) : _start(start), _end(end) {}
+
+		const char* Start() const {
+			return _start;
+		}
+		const char* End() const {
+			return _end;
+		}
+		size_t Length() const {
+			return (size_t)(_end - _start);
+		}
+		bool Empty() const {
+			return _start == _end;
+		}
+
+		/// True if the span holds exactly the characters of the null terminated str.
+		bool Equals(const char* str) const;
+
+	private:
+		const char* _start;
+		const char* _end;
+	};
+
+
+	/**
+	Reads a document one piece at a time without building a DOM. Each call to
+	Next() moves on to the next element start, element end or run of text, and
+	names, attribute values and text come back as spans into the caller's buffer.
+	Memory use is the same however large the document is, the only state kept is
+	the names of the open elements, up to TINYXML2_MAX_ELEMENT_DEPTH of them.
+
+	The buffer must outlive the reader and doesn't need to be null terminated, so
+	a read only file mapping can be read in place. Comments, declarations,
+	processing instructions, DOCTYPEs and whitespace only text are skipped. CDATA
+	sections come back as text. An empty element such as <a/> gives a
+	PULL_START_ELEMENT followed by its PULL_END_ELEMENT.
+	@verbatim
+	XMLPullReader reader( xml, size );
+	while ( reader.Next() != XMLPullReader::PULL_END_DOCUMENT ) {
+		if ( reader.CurrentEvent() == XMLPullReader::PULL_ERROR ) {
+			break;
+		}
+		if ( reader.CurrentEvent() == XMLPullReader::PULL_START_ELEMENT && reader.NameIs( "float_array" ) ) {
+			XMLSpan numbers = reader.ReadElementText();
+		}
+	}
+	@endverbatim
+	*/
+	class TINYXML2_LIB XMLPullReader
+	{
+	public:
+		enum Event {
+			PULL_START_ELEMENT,
+			PULL_END_ELEMENT,
+			PULL_TEXT,
+			PULL_END_DOCUMENT,
+			PULL_ERROR
+		};
+
+		XMLPullReader(const char* xml, size_t nBytes);
+
+		/// Moves to the next event. Once the end of the document or an error is reached it stays there.
+		Event Next();
+
+		Event CurrentEvent() const {
+			return _event;
+		}
+
+		/**
+		How many elements are open. Starting an element counts it, so the root
+		element starts at a depth of 1 and ends at 0.
+		*/
+		int Depth() const {
+			return _depth;
+		}
+
+		/// The name of the element just started or ended.
+		XMLSpan Name() const {
+			return _name;
+		}
+		bool NameIs(const char* name) const {
+			return _name.Equals(name);
+		}
+
+		/// The run of text just read, still with its surrounding whitespace.
+		XMLSpan Text() const {
+			return _text;
+		}
+
+		/**
+		The value of an attribute of the element just started, without its quotes.
+		A null span if the element doesn't have it or the reader isn't on a
+		PULL_START_ELEMENT.
+		*/
+		XMLSpan Attribute(const char* name) const;
+
+		/// The attribute converted, or defaultValue if it is missing or isn't a number.
+		unsigned UnsignedAttribute(const char* name, unsigned defaultValue = 0) const;
+		float FloatAttribute(const char* name, float defaultValue = 0) const;
+
+		/**
+		Called on a PULL_START_ELEMENT, reads up to and including the element's end
+		and returns the first run of text inside it. Any child elements are skipped.
+		*/
+		XMLSpan ReadElementText();
+
+		/// Called on a PULL_START_ELEMENT, reads up to and including the element's end.
+		void SkipElement();
+
+		XMLError ErrorID() const {
+			return _errorID;
+		}
+		/// How far into the buffer the error was found.
+		size_t ErrorOffset() const {
+			return (size_t)(_p - _begin);
+		}
+
+	private:
+		Event SetError(XMLError error);
+		const char* Find(const char* sequence) const;
+		const char* SkipWhiteSpace(const char* p) const;
+		const char* ReadName(const char* p) const;
+
+		const char* _begin;
+		const char* _p;
+		const char* _end;
+
+		Event _event;
+		int _depth;
+		bool _closeEmptyElement;
+		XMLError _errorID;
+
+		XMLSpan _name;
+		XMLSpan _text;
+		XMLSpan _attributes;
+
+		// names of the open elements, to check each end tag matches its start
+		XMLSpan _openElements[TINYXML2_MAX_ELEMENT_DEPTH];
+
+		// Prohibit cloning, intentionally not implemented
+		XMLPullReader(const XMLPullReader&);
+		XMLPullReader& operator=(const XMLPullReader&);
+	};
+
+
 }	// tinyxml2
 
 #if defined(_MSC_VER)
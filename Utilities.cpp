@@ -1,4 +1,14 @@
 #include "Utilities.h"
+#include <cstring>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#define UTIL_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 void Util::ExtractFrustumPlanes(XMFLOAT4 planes[6], XMFLOAT4X4 matrix)
 {
@@ -57,3 +67,226 @@ void Util::ExtractFrustumPlanes(XMFLOAT4 planes[6], XMFLOAT4X4 matrix)
 		XMStoreFloat4(&planes[i], v);
 	}
 }
+
+const char* Util::ParseInt(const char * first, const char * last, int & value)
+{
+	const char* current = first;
+	bool negative = false;
+
+	if (current < last && (*current == '-' || *current == '+'))
+	{
+		negative = *current == '-';
+		current++;
+	}
+
+	const char* digitsStart = current;
+	int result = 0;
+	while (current < last && (unsigned)(*current - '0') < 10)
+	{
+		result = result * 10 + (*current - '0');
+		current++;
+	}
+
+	if (current == digitsStart)
+	{
+		return first;
+	}
+
+	value = negative ? -result : result;
+	return current;
+}
+
+const char* Util::ParseFloat(const char * first, const char * last, float & value)
+{
+	static const double powersOfTen[] =
+	{
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+		1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+
+	const char* current = first;
+	bool negative = false;
+
+	if (current < last && (*current == '-' || *current == '+'))
+	{
+		negative = *current == '-';
+		current++;
+	}
+
+	//accumulate up to 19 significant digits as an integer and track where the decimal point falls
+	unsigned long long mantissa = 0;
+	int significantDigits = 0;
+	int exponent = 0;
+	bool anyDigits = false;
+
+	while (current < last && (unsigned)(*current - '0') < 10)
+	{
+		if (significantDigits < 19)
+		{
+			mantissa = mantissa * 10 + (*current - '0');
+			if (mantissa) significantDigits++;
+		}
+		else
+		{
+			exponent++;
+		}
+		anyDigits = true;
+		current++;
+	}
+
+	if (current < last && *current == '.')
+	{
+		current++;
+		while (current < last && (unsigned)(*current - '0') < 10)
+		{
+			if (significantDigits < 19)
+			{
+				mantissa = mantissa * 10 + (*current - '0');
+				if (mantissa) significantDigits++;
+				exponent--;
+			}
+			anyDigits = true;
+			current++;
+		}
+	}
+
+	if (!anyDigits)
+	{
+		return first;
+	}
+
+	if (current < last && (*current == 'e' || *current == 'E'))
+	{
+		int exponentValue;
+		const char* exponentEnd = ParseInt(current + 1, last, exponentValue);
+		if (exponentEnd != current + 1)
+		{
+			exponent += exponentValue;
+			current = exponentEnd;
+		}
+	}
+
+	double result = (double)mantissa;
+	while (exponent > 22)
+	{
+		result *= 1e22;
+		exponent -= 22;
+	}
+	while (exponent < -22)
+	{
+		result /= 1e22;
+		exponent += 22;
+	}
+	result = exponent >= 0 ? result * powersOfTen[exponent] : result / powersOfTen[-exponent];
+
+	value = (float)(negative ? -result : result);
+	return current;
+}
+
+size_t Util::ParseFloatArray(const char * first, const char * last, float * values, size_t count)
+{
+	size_t read = 0;
+
+	first = SkipWhitespaceRun(first, last);
+	while (read < count && first < last)
+	{
+		const char* next = ParseFloat(first, last, values[read]);
+		if (next == first)
+			break;
+
+		read++;
+		first = SkipWhitespaceRun(next, last);
+	}
+
+	return read;
+}
+
+size_t Util::ParseIntArray(const char * first, const char * last, int * values, size_t count)
+{
+	size_t read = 0;
+
+	first = SkipWhitespaceRun(first, last);
+	while (read < count && first < last)
+	{
+		const char* next = ParseInt(first, last, values[read]);
+		if (next == first)
+			break;
+
+		read++;
+		first = SkipWhitespaceRun(next, last);
+	}
+
+	return read;
+}
+
+const char* Util::SkipWhitespaceRun(const char * first, const char * last)
+{
+	//a single separator between numbers is the common case and isn't worth loading a block for
+	if (first < last && IsSpace(*first))
+		first++;
+	if (first == last || !IsSpace(*first))
+		return first;
+
+#ifdef UTIL_SSE2
+	const __m128i space = _mm_set1_epi8(' ');
+	const __m128i tab = _mm_set1_epi8('\t');
+	const __m128i carriageReturn = _mm_set1_epi8('\r');
+	const __m128i lineFeed = _mm_set1_epi8('\n');
+
+	//only whole blocks inside the range are loaded, whatever is left over is finished one character at a time
+	while (last - first >= 16)
+	{
+		__m128i block = _mm_loadu_si128((const __m128i*)first);
+		__m128i isSpace = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, space), _mm_cmpeq_epi8(block, tab)),
+			_mm_or_si128(_mm_cmpeq_epi8(block, carriageReturn), _mm_cmpeq_epi8(block, lineFeed)));
+
+		unsigned int notSpace = ~(unsigned int)_mm_movemask_epi8(isSpace) & 0xFFFF;
+		if (notSpace)
+		{
+#ifdef _MSC_VER
+			unsigned long index;
+			_BitScanForward(&index, notSpace);
+			return first + index;
+#else
+			return first + __builtin_ctz(notSpace);
+#endif
+		}
+
+		first += 16;
+	}
+#endif
+
+	return SkipWhitespace(first, last);
+}
+
+unsigned long long Util::HashBytes(const void * data, size_t size, unsigned long long seed)
+{
+	const unsigned long long prime = 0x9E3779B97F4A7C15ull;
+
+	const unsigned char* bytes = (const unsigned char*)data;
+	unsigned long long hash = seed ^ (size * prime);
+
+	//mix in a word at a time, memcpy keeps the loads legal for unaligned data and compiles down to a single mov
+	size_t wordCount = size / sizeof(unsigned long long);
+	for (size_t i = 0; i < wordCount; i++)
+	{
+		unsigned long long word;
+		memcpy(&word, bytes + i * sizeof(unsigned long long), sizeof(word));
+
+		word *= 0xFF51AFD7ED558CCDull;
+		word ^= word >> 32;
+		hash = (hash ^ word) * prime;
+	}
+
+	for (size_t i = wordCount * sizeof(unsigned long long); i < size; i++)
+	{
+		hash = (hash ^ bytes[i]) * prime;
+	}
+
+	//final avalanche so every input bit affects every output bit
+	hash ^= hash >> 33;
+	hash *= 0xC4CEB9FE1A85EC53ull;
+	hash ^= hash >> 33;
+
+	return hash;
+}
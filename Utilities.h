@@ -8,6 +8,50 @@ using namespace DirectX;
 namespace Util
 {
 	void ExtractFrustumPlanes(XMFLOAT4 planes[6], XMFLOAT4X4 matrix);
+
+	//Number parsing that works in place on a character range, in the style of std::from_chars.
+	//Returns one past the last character consumed, or first if no number could be read
+	const char* ParseFloat(const char* first, const char* last, float& value);
+	const char* ParseInt(const char* first, const char* last, int& value);
+
+	//Read up to count whitespace separated numbers into values without allocating. Return how many were read, parsing
+	//stops early at anything that isn't a number
+	size_t ParseFloatArray(const char* first, const char* last, float* values, size_t count);
+	size_t ParseIntArray(const char* first, const char* last, int* values, size_t count);
+
+	//Fast non cryptographic 64 bit hash, used to tell when a cooked file is stale or has been corrupted
+	unsigned long long HashBytes(const void* data, size_t size, unsigned long long seed = 0);
+
+	inline bool IsSpace(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+	}
+
+	//skips spaces and tabs but stops at the end of a line
+	inline const char* SkipBlanks(const char* first, const char* last)
+	{
+		while (first < last && (*first == ' ' || *first == '\t'))
+			first++;
+		return first;
+	}
+
+	inline const char* SkipWhitespace(const char* first, const char* last)
+	{
+		while (first < last && IsSpace(*first))
+			first++;
+		return first;
+	}
+
+	//SkipWhitespace for text with long runs of it, such as the indentation and line breaks inside XML, which are
+	//checked 16 characters at a time
+	const char* SkipWhitespaceRun(const char* first, const char* last);
+
+	inline const char* SkipLine(const char* first, const char* last)
+	{
+		while (first < last && *first != '\n')
+			first++;
+		return first < last ? first + 1 : last;
+	}
 }
 
 namespace Random
@@ -0,0 +1,248 @@
+#include "VertexCompression.h"
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+
+using namespace DirectX::PackedVector;
+
+namespace
+{
+	const float c_MaxUnorm16 = 65535.0f;
+	const float c_MaxSnorm16 = 32767.0f;
+
+	float SignNotZero(float value)
+	{
+		return value >= 0.0f ? 1.0f : -1.0f;
+	}
+
+	//projects onto the octahedron then folds the lower half over the diagonals so the result fills [-1, 1]^2
+	XMFLOAT2 OctahedralProject(XMFLOAT3 direction)
+	{
+		float length = fabsf(direction.x) + fabsf(direction.y) + fabsf(direction.z);
+		if (length == 0.0f)
+			return XMFLOAT2(0.0f, 0.0f);
+
+		float x = direction.x / length;
+		float y = direction.y / length;
+
+		if (direction.z < 0.0f)
+		{
+			float foldedX = (1.0f - fabsf(y)) * SignNotZero(x);
+			float foldedY = (1.0f - fabsf(x)) * SignNotZero(y);
+			x = foldedX;
+			y = foldedY;
+		}
+
+		return XMFLOAT2(x, y);
+	}
+
+	XMFLOAT3 OctahedralUnproject(float x, float y)
+	{
+		float z = 1.0f - fabsf(x) - fabsf(y);
+
+		if (z < 0.0f)
+		{
+			float unfoldedX = (1.0f - fabsf(y)) * SignNotZero(x);
+			float unfoldedY = (1.0f - fabsf(x)) * SignNotZero(y);
+			x = unfoldedX;
+			y = unfoldedY;
+		}
+
+		XMFLOAT3 direction;
+		XMStoreFloat3(&direction, XMVector3Normalize(XMVectorSet(x, y, z, 0.0f)));
+		return direction;
+	}
+
+	SHORT ClampSnorm(float value)
+	{
+		return (SHORT)std::max(-c_MaxSnorm16, std::min(c_MaxSnorm16, value));
+	}
+
+	float AngleBetweenDegrees(XMFLOAT3 a, XMFLOAT3 b)
+	{
+		XMVECTOR va = XMVector3Normalize(XMLoadFloat3(&a));
+		XMVECTOR vb = XMVector3Normalize(XMLoadFloat3(&b));
+
+		//a zero vector has no direction to lose
+		if (XMVectorGetX(XMVector3LengthSq(va)) == 0.0f || XMVectorGetX(XMVector3LengthSq(vb)) == 0.0f)
+			return 0.0f;
+
+		//acos of the dot product can't resolve angles this small in single precision, atan2 of sine over cosine can
+		float sine = XMVectorGetX(XMVector3Length(XMVector3Cross(va, vb)));
+		float cosine = XMVectorGetX(XMVector3Dot(va, vb));
+
+		return XMConvertToDegrees(atan2f(sine, cosine));
+	}
+}
+
+void VertexCompression::EncodeOctahedral(XMFLOAT3 direction, SHORT encoded[2])
+{
+	XMFLOAT2 projected = OctahedralProject(direction);
+
+	float x = projected.x * c_MaxSnorm16;
+	float y = projected.y * c_MaxSnorm16;
+
+	//plain rounding can be a couple of steps out once the fold is undone, so all four neighbours are tried
+	float bestDistance = FLT_MAX;
+	XMVECTOR original = XMVector3Normalize(XMLoadFloat3(&direction));
+
+	for (int i = 0; i < 4; i++)
+	{
+		SHORT candidate[2] = { ClampSnorm(i & 1 ? ceilf(x) : floorf(x)), ClampSnorm(i & 2 ? ceilf(y) : floorf(y)) };
+
+		//the dot product is too close to 1 to compare in single precision, the squared distance between the two isn't
+		XMFLOAT3 decoded = DecodeOctahedral(candidate);
+		float distance = XMVectorGetX(XMVector3LengthSq(XMLoadFloat3(&decoded) - original));
+
+		if (distance < bestDistance)
+		{
+			bestDistance = distance;
+			encoded[0] = candidate[0];
+			encoded[1] = candidate[1];
+		}
+	}
+}
+
+XMFLOAT3 VertexCompression::DecodeOctahedral(const SHORT encoded[2])
+{
+	return OctahedralUnproject(encoded[0] / c_MaxSnorm16, encoded[1] / c_MaxSnorm16);
+}
+
+VertexCompression::CompressedVertex VertexCompression::EncodeVertex(const SimpleVertex & vertex, XMFLOAT3 boundsMin, XMFLOAT3 inverseExtent)
+{
+	CompressedVertex compressed;
+
+	const float* position = &vertex.PosL.x;
+	const float* minimum = &boundsMin.x;
+	const float* inverse = &inverseExtent.x;
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		float fraction = (position[axis] - minimum[axis]) * inverse[axis];
+		compressed.PosL[axis] = (USHORT)(std::max(0.0f, std::min(1.0f, fraction)) * c_MaxUnorm16 + 0.5f);
+	}
+	compressed.PosL[3] = vertex.Tangent.w < 0.0f ? 0 : (USHORT)c_MaxUnorm16;
+
+	EncodeOctahedral(vertex.NormL, compressed.NormL);
+	EncodeOctahedral(XMFLOAT3(vertex.Tangent.x, vertex.Tangent.y, vertex.Tangent.z), compressed.Tangent);
+
+	compressed.Tex[0] = XMConvertFloatToHalf(vertex.Tex.x);
+	compressed.Tex[1] = XMConvertFloatToHalf(vertex.Tex.y);
+
+	return compressed;
+}
+
+SimpleVertex VertexCompression::DecodeVertex(const CompressedVertex & vertex, XMFLOAT3 boundsMin, XMFLOAT3 boundsExtent)
+{
+	SimpleVertex decoded;
+
+	decoded.PosL.x = boundsMin.x + vertex.PosL[0] / c_MaxUnorm16 * boundsExtent.x;
+	decoded.PosL.y = boundsMin.y + vertex.PosL[1] / c_MaxUnorm16 * boundsExtent.y;
+	decoded.PosL.z = boundsMin.z + vertex.PosL[2] / c_MaxUnorm16 * boundsExtent.z;
+
+	decoded.NormL = DecodeOctahedral(vertex.NormL);
+	XMFLOAT3 tangent = DecodeOctahedral(vertex.Tangent);
+	decoded.Tangent = XMFLOAT4(tangent.x, tangent.y, tangent.z, vertex.PosL[3] != 0 ? 1.0f : -1.0f);
+
+	decoded.Tex.x = XMConvertHalfToFloat(vertex.Tex[0]);
+	decoded.Tex.y = XMConvertHalfToFloat(vertex.Tex[1]);
+
+	return decoded;
+}
+
+VertexCompression::CompressedModel VertexCompression::Compress(const IndexedModel & model)
+{
+	CompressedModel compressed;
+	compressed.Indices = model.Indices;
+
+	XMVECTOR minimum = XMVectorReplicate(FLT_MAX);
+	XMVECTOR maximum = XMVectorReplicate(-FLT_MAX);
+
+	for (const SimpleVertex& vertex : model.Vertices)
+	{
+		XMVECTOR position = XMLoadFloat3(&vertex.PosL);
+		minimum = XMVectorMin(minimum, position);
+		maximum = XMVectorMax(maximum, position);
+	}
+
+	if (model.Vertices.empty())
+	{
+		minimum = maximum = XMVectorZero();
+	}
+
+	XMStoreFloat3(&compressed.BoundsMin, minimum);
+	XMStoreFloat3(&compressed.BoundsExtent, maximum - minimum);
+
+	//a flat axis has nothing to encode, leave it at the minimum rather than dividing by zero
+	const float* extent = &compressed.BoundsExtent.x;
+	XMFLOAT3 inverseExtent;
+	float* inverse = &inverseExtent.x;
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		inverse[axis] = extent[axis] > 0.0f ? 1.0f / extent[axis] : 0.0f;
+	}
+
+	compressed.Vertices.resize(model.Vertices.size());
+	for (size_t i = 0; i < model.Vertices.size(); i++)
+	{
+		compressed.Vertices[i] = EncodeVertex(model.Vertices[i], compressed.BoundsMin, inverseExtent);
+	}
+
+	return compressed;
+}
+
+void VertexCompression::Decompress(const CompressedModel & model, std::vector<SimpleVertex>& vertices)
+{
+	vertices.resize(model.Vertices.size());
+	for (size_t i = 0; i < model.Vertices.size(); i++)
+	{
+		vertices[i] = DecodeVertex(model.Vertices[i], model.BoundsMin, model.BoundsExtent);
+	}
+}
+
+VertexCompression::CompressionError VertexCompression::MeasureError(const IndexedModel & original, const CompressedModel & compressed)
+{
+	CompressionError error;
+
+	std::vector<SimpleVertex> decoded;
+	Decompress(compressed, decoded);
+
+	for (size_t i = 0; i < decoded.size() && i < original.Vertices.size(); i++)
+	{
+		const SimpleVertex& a = original.Vertices[i];
+		const SimpleVertex& b = decoded[i];
+
+		error.Position = std::max(error.Position, std::max(fabsf(a.PosL.x - b.PosL.x), std::max(fabsf(a.PosL.y - b.PosL.y), fabsf(a.PosL.z - b.PosL.z))));
+		error.NormalDegrees = std::max(error.NormalDegrees, AngleBetweenDegrees(a.NormL, b.NormL));
+		//a flipped handedness mirrors the bitangent, which is as wrong as a tangent turned right round
+		float tangentDegrees = (a.Tangent.w < 0.0f) != (b.Tangent.w < 0.0f) ? 180.0f :
+			AngleBetweenDegrees(XMFLOAT3(a.Tangent.x, a.Tangent.y, a.Tangent.z), XMFLOAT3(b.Tangent.x, b.Tangent.y, b.Tangent.z));
+		error.TangentDegrees = std::max(error.TangentDegrees, tangentDegrees);
+		error.Tex = std::max(error.Tex, std::max(fabsf(a.Tex.x - b.Tex.x), fabsf(a.Tex.y - b.Tex.y)));
+	}
+
+	return error;
+}
+
+bool VertexCompression::IsWithinErrorBounds(const IndexedModel & original, const CompressedModel & compressed, const CompressionError & error)
+{
+	float largestExtent = std::max(compressed.BoundsExtent.x, std::max(compressed.BoundsExtent.y, compressed.BoundsExtent.z));
+
+	float largestTex = 0.0f;
+	for (const SimpleVertex& vertex : original.Vertices)
+	{
+		largestTex = std::max(largestTex, std::max(fabsf(vertex.Tex.x), fabsf(vertex.Tex.y)));
+	}
+
+	//on top of the half step the float maths in the encode and decode can each be a few ulps out at the largest coordinate
+	XMVECTOR boundsMin = XMLoadFloat3(&compressed.BoundsMin);
+	XMVECTOR boundsMax = boundsMin + XMLoadFloat3(&compressed.BoundsExtent);
+	float largestCoordinate = XMVectorGetX(XMVector3LengthSq(XMVectorMax(XMVectorAbs(boundsMin), XMVectorAbs(boundsMax))));
+
+	float positionBound = largestExtent * (0.5f / c_MaxUnorm16) + sqrtf(largestCoordinate) * FLT_EPSILON * 4.0f;
+	float texBound = largestTex * c_HalfRelativePrecision + FLT_EPSILON;
+
+	return error.Position <= positionBound && error.NormalDegrees <= c_MaxDirectionErrorDegrees &&
+		error.TangentDegrees <= c_MaxDirectionErrorDegrees && error.Tex <= texBound;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <vector>
+#include <DirectXPackedVector.h>
+
+#include "Commons.h"
+
+//Opt in 20 byte replacement for the 48 byte SimpleVertex. Positions are 16 bit fractions of the mesh bounds, the normal
+//and tangent are octahedral encoded into two 16 bit values each and the texture coordinates are halves
+namespace VertexCompression
+{
+	struct CompressedVertex
+	{
+		USHORT PosL[4]; //w holds the tangent's handedness, the maximum for +1 and 0 for -1
+		SHORT NormL[2];
+		SHORT Tangent[2];
+		PackedVector::HALF Tex[2];
+	};
+
+	//The positions only decode to object space once scaled by BoundsExtent and offset by BoundsMin. CompressedNormalVS
+	//does that itself, along with the normal and tangent, rather than folding a scale into the world matrix that would skew them
+	struct CompressedModel
+	{
+		std::vector<CompressedVertex> Vertices;
+		std::vector<UINT> Indices;
+
+		XMFLOAT3 BoundsMin;
+		XMFLOAT3 BoundsExtent;
+
+		DXGI_FORMAT GetIndexFormat() const { return GetIndexFormatForVertexCount(Vertices.size()); }
+	};
+
+	//The normal and tangent arrive in the shader as octahedral float2s and need decoding there
+	const D3D11_INPUT_ELEMENT_DESC c_InputLayout[] =
+	{
+		{ "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, 8, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "TANGENT", 0, DXGI_FORMAT_R16G16_SNORM, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, 0, 16, D3D11_INPUT_PER_VERTEX_DATA, 0 }
+	};
+
+	//Largest errors the encoding can introduce. Positions are off by at most half a step of the bounds, directions by a
+	//fixed angle (about 0.0025 degrees is the worst seen) and halves by their relative precision times the largest coordinate
+	const float c_MaxDirectionErrorDegrees = 0.005f;
+	const float c_HalfRelativePrecision = 1.0f / 2048.0f;
+
+	struct CompressionError
+	{
+		float Position = 0.0f;
+		float NormalDegrees = 0.0f;
+		float TangentDegrees = 0.0f;
+		float Tex = 0.0f;
+	};
+
+	CompressedModel Compress(const IndexedModel& model);
+	void Decompress(const CompressedModel& model, std::vector<SimpleVertex>& vertices);
+
+	CompressedVertex EncodeVertex(const SimpleVertex& vertex, XMFLOAT3 boundsMin, XMFLOAT3 inverseExtent);
+	SimpleVertex DecodeVertex(const CompressedVertex& vertex, XMFLOAT3 boundsMin, XMFLOAT3 boundsExtent);
+
+	//Octahedral mapping of a unit vector to two snorm values, the rounding that lands closest to the input is picked
+	void EncodeOctahedral(XMFLOAT3 direction, SHORT encoded[2]);
+	XMFLOAT3 DecodeOctahedral(const SHORT encoded[2]);
+
+	//Largest difference between the original and the decompressed vertices
+	CompressionError MeasureError(const IndexedModel& original, const CompressedModel& compressed);
+
+	//Measured errors against the bounds above for this model, true if every attribute is within them
+	bool IsWithinErrorBounds(const IndexedModel& original, const CompressedModel& compressed, const CompressionError& error);
+}
@@ -0,0 +1,287 @@
+#include "VertexWelder.h"
+
+#include <climits>
+#include <cmath>
+
+#include "Parallel.h"
+
+namespace
+{
+	const unsigned int c_Empty = 0xffffffff;
+
+	//position, normal and uv after quantization
+	struct WeldKey
+	{
+		int values[8];
+
+		bool operator==(const WeldKey& other) const
+		{
+			return memcmp(values, other.values, sizeof(values)) == 0;
+		}
+	};
+
+	int Quantize(float value, float inverseEpsilon)
+	{
+		if (inverseEpsilon == 0.0f)
+		{
+			//exact match, but treat -0 and +0 as the same value
+			if (value == 0.0f)
+				return 0;
+
+			int bits;
+			memcpy(&bits, &value, sizeof(int));
+			return bits;
+		}
+
+		//cells past the range of an int, and NaNs, are clamped to the end cells rather than overflowing the conversion
+		float cell = floorf(value * inverseEpsilon + 0.5f);
+		if (!(cell > (float)INT_MIN))
+			return INT_MIN;
+		if (cell >= 2147483648.0f)
+			return INT_MAX;
+		return (int)cell;
+	}
+
+	unsigned int HashKey(const WeldKey& key)
+	{
+		//FNV-1a over the quantized values followed by a final mix so the top bits are usable for partitioning
+		unsigned int hash = 2166136261u;
+		for (int value : key.values)
+		{
+			hash ^= (unsigned int)value;
+			hash *= 16777619u;
+		}
+		hash ^= hash >> 16;
+		hash *= 0x7feb352du;
+		hash ^= hash >> 15;
+		return hash;
+	}
+
+	unsigned int NextPowerOfTwo(unsigned int value)
+	{
+		unsigned int result = 1;
+		while (result < value)
+			result <<= 1;
+		return result;
+	}
+
+	//Open addressing with linear probing, each slot holds the index of the first vertex seen with that key
+	class WeldTable
+	{
+	public:
+		WeldTable(unsigned int expectedCount)
+		{
+			_mask = NextPowerOfTwo(expectedCount * 2 + 1) - 1;
+			_slots.assign(_mask + 1, c_Empty);
+		}
+
+		//returns the first vertex with an equal key, inserting this one if there isn't one
+		unsigned int FindOrInsert(unsigned int vertex, const std::vector<WeldKey>& keys, const std::vector<unsigned int>& hashes)
+		{
+			unsigned int slot = hashes[vertex] & _mask;
+
+			while (true)
+			{
+				unsigned int existing = _slots[slot];
+
+				if (existing == c_Empty)
+				{
+					_slots[slot] = vertex;
+					return vertex;
+				}
+
+				if (hashes[existing] == hashes[vertex] && keys[existing] == keys[vertex])
+				{
+					return existing;
+				}
+
+				slot = (slot + 1) & _mask;
+			}
+		}
+
+	private:
+		std::vector<unsigned int> _slots;
+		unsigned int _mask;
+	};
+
+	//Fills firstOccurrence[i] with the first vertex whose key is equal to vertex i's. makeKey(i, key) fills in the key
+	template<typename MakeKey>
+	void FindFirstOccurrences(unsigned int vertexCount, MakeKey makeKey, std::vector<unsigned int>& firstOccurrence)
+	{
+		std::vector<WeldKey> keys(vertexCount);
+		std::vector<unsigned int> hashes(vertexCount);
+
+		//Equal keys always have equal hashes, so splitting the vertices by the top bits of the hash gives partitions that can be
+		//welded independently
+		unsigned int partitionCount = vertexCount >= VertexWelder::c_MinVerticesForParallelWeld ? NextPowerOfTwo(Parallel::WorkerCount()) : 1;
+		unsigned int partitionShift = 32;
+		for (unsigned int count = partitionCount; count > 1; count >>= 1)
+			partitionShift--;
+
+		auto partitionOf = [&](unsigned int hash) { return partitionCount > 1 ? hash >> partitionShift : 0u; };
+
+		//each task counts how many of its vertices fall in each partition while it hashes them
+		size_t minPerTask = VertexWelder::c_MinVerticesForParallelWeld / 4;
+		std::vector<size_t> taskBegins(Parallel::WorkerCount()), taskEnds(Parallel::WorkerCount());
+		std::vector<unsigned int> taskCounts((size_t)Parallel::WorkerCount() * partitionCount, 0);
+
+		unsigned int taskCount = Parallel::For(vertexCount, minPerTask, [&](size_t begin, size_t end, unsigned int task)
+		{
+			taskBegins[task] = begin;
+			taskEnds[task] = end;
+			unsigned int* counts = &taskCounts[(size_t)task * partitionCount];
+
+			for (size_t i = begin; i < end; i++)
+			{
+				makeKey(i, keys[i]);
+				hashes[i] = HashKey(keys[i]);
+				counts[partitionOf(hashes[i])]++;
+			}
+		});
+
+		//the counts become where each task starts writing in each partition's bucket, earlier tasks first, so every
+		//bucket lists its vertices in their original order
+		std::vector<unsigned int> partitionStarts(partitionCount + 1);
+		unsigned int offset = 0;
+		for (unsigned int partition = 0; partition < partitionCount; partition++)
+		{
+			partitionStarts[partition] = offset;
+			for (unsigned int task = 0; task < taskCount; task++)
+			{
+				unsigned int& count = taskCounts[(size_t)task * partitionCount + partition];
+				unsigned int taskOffset = offset;
+				offset += count;
+				count = taskOffset;
+			}
+		}
+		partitionStarts[partitionCount] = offset;
+
+		std::vector<unsigned int> buckets(vertexCount);
+
+		Parallel::For(taskCount, 1, [&](size_t begin, size_t end, unsigned int)
+		{
+			for (size_t task = begin; task < end; task++)
+			{
+				unsigned int* next = &taskCounts[task * partitionCount];
+				for (size_t i = taskBegins[task]; i < taskEnds[task]; i++)
+				{
+					buckets[next[partitionOf(hashes[i])]++] = (unsigned int)i;
+				}
+			}
+		});
+
+		//each partition only walks its own bucket, in order, so the first occurrence of a key is always the one kept
+		firstOccurrence.resize(vertexCount);
+
+		Parallel::For(partitionCount, 1, [&](size_t begin, size_t end, unsigned int)
+		{
+			for (size_t partition = begin; partition < end; partition++)
+			{
+				WeldTable table(partitionStarts[partition + 1] - partitionStarts[partition]);
+
+				for (unsigned int bucket = partitionStarts[partition]; bucket < partitionStarts[partition + 1]; bucket++)
+				{
+					unsigned int i = buckets[bucket];
+					firstOccurrence[i] = table.FindOrInsert(i, keys, hashes);
+				}
+			}
+		});
+	}
+
+	//Keeps the first occurrence of every key in order and points the rest at it
+	template<typename VertexType>
+	VertexWelder::WeldStatistics Compact(const std::vector<VertexType>& vertices, const std::vector<unsigned int>& firstOccurrence,
+		std::vector<VertexType>& outVertices, std::vector<unsigned int>& remap)
+	{
+		unsigned int vertexCount = (unsigned int)vertices.size();
+
+		outVertices.clear();
+		outVertices.reserve(vertexCount);
+		remap.resize(vertexCount);
+
+		for (unsigned int i = 0; i < vertexCount; i++)
+		{
+			if (firstOccurrence[i] == i)
+			{
+				remap[i] = (unsigned int)outVertices.size();
+				outVertices.push_back(vertices[i]);
+			}
+			else
+			{
+				remap[i] = remap[firstOccurrence[i]];
+			}
+		}
+
+		VertexWelder::WeldStatistics statistics;
+		statistics.InputVertices = vertexCount;
+		statistics.OutputVertices = (unsigned int)outVertices.size();
+		return statistics;
+	}
+}
+
+VertexWelder::WeldStatistics VertexWelder::Weld(const std::vector<SimpleVertex>& vertices, float epsilon, std::vector<SimpleVertex>& outVertices, std::vector<unsigned int>& remap)
+{
+	float inverseEpsilon = epsilon > 0.0f ? 1.0f / epsilon : 0.0f;
+
+	std::vector<unsigned int> firstOccurrence;
+
+	FindFirstOccurrences((unsigned int)vertices.size(), [&](size_t i, WeldKey& key)
+	{
+		const SimpleVertex& vertex = vertices[i];
+
+		key.values[0] = Quantize(vertex.PosL.x, inverseEpsilon);
+		key.values[1] = Quantize(vertex.PosL.y, inverseEpsilon);
+		key.values[2] = Quantize(vertex.PosL.z, inverseEpsilon);
+		key.values[3] = Quantize(vertex.NormL.x, inverseEpsilon);
+		key.values[4] = Quantize(vertex.NormL.y, inverseEpsilon);
+		key.values[5] = Quantize(vertex.NormL.z, inverseEpsilon);
+		key.values[6] = Quantize(vertex.Tex.x, inverseEpsilon);
+		key.values[7] = Quantize(vertex.Tex.y, inverseEpsilon);
+	}, firstOccurrence);
+
+	return Compact(vertices, firstOccurrence, outVertices, remap);
+}
+
+VertexWelder::WeldStatistics VertexWelder::WeldPositions(const std::vector<XMFLOAT3>& positions, float epsilon, std::vector<XMFLOAT3>& outPositions, std::vector<unsigned int>& remap)
+{
+	float inverseEpsilon = epsilon > 0.0f ? 1.0f / epsilon : 0.0f;
+
+	std::vector<unsigned int> firstOccurrence;
+
+	FindFirstOccurrences((unsigned int)positions.size(), [&](size_t i, WeldKey& key)
+	{
+		key.values[0] = Quantize(positions[i].x, inverseEpsilon);
+		key.values[1] = Quantize(positions[i].y, inverseEpsilon);
+		key.values[2] = Quantize(positions[i].z, inverseEpsilon);
+
+		for (int value = 3; value < 8; value++)
+		{
+			key.values[value] = 0;
+		}
+	}, firstOccurrence);
+
+	return Compact(positions, firstOccurrence, outPositions, remap);
+}
+
+VertexWelder::WeldStatistics VertexWelder::Weld(const std::vector<NormalDepthVertex>& vertices, float epsilon, std::vector<NormalDepthVertex>& outVertices, std::vector<unsigned int>& remap)
+{
+	float inverseEpsilon = epsilon > 0.0f ? 1.0f / epsilon : 0.0f;
+
+	std::vector<unsigned int> firstOccurrence;
+
+	FindFirstOccurrences((unsigned int)vertices.size(), [&](size_t i, WeldKey& key)
+	{
+		const NormalDepthVertex& vertex = vertices[i];
+
+		key.values[0] = Quantize(vertex.PosL.x, inverseEpsilon);
+		key.values[1] = Quantize(vertex.PosL.y, inverseEpsilon);
+		key.values[2] = Quantize(vertex.PosL.z, inverseEpsilon);
+		key.values[3] = Quantize(vertex.NormL.x, inverseEpsilon);
+		key.values[4] = Quantize(vertex.NormL.y, inverseEpsilon);
+		key.values[5] = Quantize(vertex.NormL.z, inverseEpsilon);
+		key.values[6] = 0;
+		key.values[7] = 0;
+	}, firstOccurrence);
+
+	return Compact(vertices, firstOccurrence, outVertices, remap);
+}
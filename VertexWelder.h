@@ -0,0 +1,32 @@
+#pragma once
+
+#include <vector>
+
+#include "Commons.h"
+
+namespace VertexWelder
+{
+	struct WeldStatistics
+	{
+		unsigned int InputVertices = 0;
+		unsigned int OutputVertices = 0;
+
+		//average number of corners sharing each output vertex, 1 means nothing was welded
+		float ReuseRatio() const { return OutputVertices ? (float)InputVertices / (float)OutputVertices : 0.0f; }
+	};
+
+	//Meshes with fewer vertices than this are welded on the calling thread
+	const unsigned int c_MinVerticesForParallelWeld = 64 * 1024;
+
+	//Merges vertices whose position, normal and texture coordinate are equal. With an epsilon of 0 the attributes have to match
+	//exactly, otherwise they are quantized to a grid of that size first so vertices that fall in the same cell are welded.
+	//The tangent is ignored as it gets generated after welding.
+	//remap[i] is the output vertex for input vertex i, output vertices keep the order they first appear in
+	WeldStatistics Weld(const std::vector<SimpleVertex>& vertices, float epsilon, std::vector<SimpleVertex>& outVertices, std::vector<unsigned int>& remap);
+
+	//Same as Weld but only the position is compared, so vertices split by a normal or texture seam come back together
+	WeldStatistics WeldPositions(const std::vector<XMFLOAT3>& positions, float epsilon, std::vector<XMFLOAT3>& outPositions, std::vector<unsigned int>& remap);
+
+	//Compares the position and normal, so only texture seams come back together
+	WeldStatistics Weld(const std::vector<NormalDepthVertex>& vertices, float epsilon, std::vector<NormalDepthVertex>& outVertices, std::vector<unsigned int>& remap);
+}